@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+# mathBench -format json の結果をベースラインと比べる
+# ns_per_op が threshold より大きく増えた case があれば終了コード 1 を返す
+#
+#   mathBench -format json -o current.json
+#   python3 compare.py baseline.json current.json [-threshold 0.10]
+#
+# ベースラインは同じ machine, compiler, build type で取ったものと比べる (違うときは警告だけ出す)
+# 更新するときは current.json で baseline.json を置き換える
+
+import json
+import sys
+
+
+def load(path):
+    with open(path, encoding="utf-8") as f:
+        data = json.load(f)
+    results = {}
+    for r in data["results"]:
+        results[(r["name"], r["variant"], r["mode"])] = r["ns_per_op"]
+    return data, results
+
+
+def main(argv):
+    threshold = 0.10
+    paths = []
+    i = 1
+    while i < len(argv):
+        if argv[i] == "-threshold" and i + 1 < len(argv):
+            threshold = float(argv[i + 1])
+            i += 2
+        else:
+            paths.append(argv[i])
+            i += 1
+    if len(paths) != 2:
+        print("usage: compare.py baseline.json current.json [-threshold 0.10]")
+        return 2
+
+    baseline_data, baseline = load(paths[0])
+    current_data, current = load(paths[1])
+    for key in ("simd", "compiler"):
+        if baseline_data.get(key) != current_data.get(key):
+            print("warning: %s differs (baseline %s, current %s)" % (key, baseline_data.get(key), current_data.get(key)))
+
+    regressions = 0
+    print("%-26s %-12s %-11s %10s %10s %8s" % ("name", "variant", "mode", "baseline", "current", "ratio"))
+    for key, now in current.items():
+        if key not in baseline:
+            print("%-26s %-12s %-11s %10s %10.3f %8s" % (key + ("-", now, "new")))
+            continue
+        ratio = now / baseline[key] if baseline[key] > 0.0 else 1.0
+        mark = ""
+        if ratio > 1.0 + threshold:
+            mark = "  slower"
+            regressions += 1
+        elif ratio < 1.0 - threshold:
+            mark = "  faster"
+        print("%-26s %-12s %-11s %10.3f %10.3f %8.3f%s" % (key + (baseline[key], now, ratio, mark)))
+    for key in baseline:
+        if key not in current:
+            print("%-26s %-12s %-11s %10.3f %10s %8s" % (key + (baseline[key], "-", "missing")))
+
+    print("%d case(s) slower than %.0f%% over baseline" % (regressions, threshold * 100.0))
+    return 1 if regressions > 0 else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
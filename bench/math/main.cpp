@@ -0,0 +1,963 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// 演算子は scalar 版のままにして、SIMD の kernel は直接呼んで比べる
+#define MATHFUNC_SCALAR
+#include "src/utils/mathfunc/mathfunc.hpp"
+#include "src/utils/mathfunc/mathAligned.hpp"
+#include "src/utils/mathfunc/mathSoA.hpp"
+#include "src/utils/mathfunc/mathExpr.hpp"
+#include "src/utils/geometry/IntOnMesh.hpp"
+
+// 数学ライブラリの microbenchmark
+// 演算ごとに 1 回あたりの時間を 2 通りに測る
+//	throughput : 独立な入力 (L1 に乗る BenchPoolSize 個) を続けて処理する
+//	latency	   : 前の結果を次の入力にして、依存が 1 本の列を処理する (出力を入力にできる演算だけ)
+// variant は scalar (mathfunc.hpp の演算子), simd (mathSimd.hpp の kernel), soa (mathSoA.hpp の 8 lane の型)
+// soa は 1 回の演算で SoAWidth 個の要素を処理するので、要素 1 つあたりの時間も出す
+// MeshCM, MeshInertia は三角形 1 つを 1 回の演算として、演算子, mathExpr.hpp の式, IntOnMesh.hpp の版を比べる
+//
+// 結果は表 (text), json, csv で出す。json を baseline.json と compare.py で比べると遅くなった演算が分かる
+//	mathBench -format json -o current.json
+//	python3 compare.py baseline.json current.json
+
+constexpr uint32_t BenchPoolSize = 256;
+
+struct BenchCase {
+	std::string name;
+	std::string variant;
+	std::string mode;
+	uint32_t elements; // 1 回の演算で処理する要素の数
+	uint32_t ops;	   // run を 1 回呼んだときの演算の回数
+	std::function<void()> run;
+};
+
+struct BenchResult {
+	const BenchCase* benchCase;
+	double nanoseconds; // 1 回の演算あたり
+};
+
+// 入力と出力の置き場所
+// 回転に近い行列と単位 quaternion を使い、latency の列を長くしても値が発散したり 0 に潰れたりしないようにする
+struct BenchData {
+	std::vector<fvec3> v3a, v3b, v3c, v3out;
+	std::vector<fvec3a> v3aligned, v3alignedout;
+	std::vector<fvec4> v4a, v4out;
+	std::vector<fquaternion> qa, qb, qout;
+	std::vector<fmat3> m3a, m3b, m3out;
+	std::vector<fmat4> m4a, m4b, m4out;
+	std::vector<float> sout;
+
+	std::vector<fvec3x8> x3a, x3b, x3c, x3out;
+	std::vector<fmat3x8> xm3a, xm3b, xm3out;
+	std::vector<fquaternionx8> xqa, xqb, xqout;
+	std::vector<floatx8> xsout;
+
+	std::vector<fvec3> meshVertex;
+	std::vector<uint32_t> meshIndex;
+};
+
+// 緯度経度で分割した球 (閉じた三角形メッシュ)
+void MakeSphere(std::vector<fvec3>& vertex, std::vector<uint32_t>& index, const uint32_t n)
+{
+	const float pi = 3.14159265358979f;
+
+	vertex.clear();
+	index.clear();
+	vertex.emplace_back(0.0f, 0.0f, 1.0f);
+	for (uint32_t i = 1; i < n; i++) {
+		const float theta = pi * i / n;
+		for (uint32_t j = 0; j < 2 * n; j++) {
+			const float phi = pi * j / n;
+			vertex.emplace_back(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta));
+		}
+	}
+	vertex.emplace_back(0.0f, 0.0f, -1.0f);
+
+	const uint32_t bottom = vertex.size() - 1;
+	auto Ring	      = [n](const uint32_t i, const uint32_t j) { return 1 + (i - 1) * 2 * n + (j % (2 * n)); };
+	for (uint32_t j = 0; j < 2 * n; j++) {
+		index.insert(index.end(), { 0, Ring(1, j), Ring(1, j + 1) });
+		index.insert(index.end(), { bottom, Ring(n - 1, j + 1), Ring(n - 1, j) });
+	}
+	for (uint32_t i = 1; i < n - 1; i++) {
+		for (uint32_t j = 0; j < 2 * n; j++) {
+			index.insert(index.end(), { Ring(i, j), Ring(i + 1, j), Ring(i + 1, j + 1) });
+			index.insert(index.end(), { Ring(i, j), Ring(i + 1, j + 1), Ring(i, j + 1) });
+		}
+	}
+}
+
+void MakeBenchData(BenchData& d)
+{
+	std::mt19937 engine(1);
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+	auto RandomVec3 = [&]() { return fvec3(dist(engine), dist(engine), dist(engine)); };
+	auto RandomUnitQuaternion = [&]() {
+		const fquaternion q(dist(engine), dist(engine), dist(engine), dist(engine) + 2.0f);
+		return q / q.norm();
+	};
+	// 回転に小さな乱数を足した行列
+	auto RandomMat3 = [&]() {
+		fmat3 m = RandomUnitQuaternion().torotation();
+		for (uint32_t i = 0; i < 9; i++)
+			m.cmp[i] += 0.05f * dist(engine);
+		return m;
+	};
+	auto RandomMat4 = [&]() {
+		const fmat3 r = RandomMat3();
+		const fvec3 t = RandomVec3();
+		return fmat4(
+		    r.cmp[0], r.cmp[1], r.cmp[2], t.x,
+		    r.cmp[3], r.cmp[4], r.cmp[5], t.y,
+		    r.cmp[6], r.cmp[7], r.cmp[8], t.z,
+		    0.0f, 0.0f, 0.0f, 1.0f);
+	};
+
+	for (uint32_t i = 0; i < BenchPoolSize; i++) {
+		d.v3a.push_back(RandomVec3().normalized());
+		d.v3b.push_back(RandomVec3().normalized());
+		d.v3c.push_back(RandomVec3().normalized());
+		d.v4a.push_back(fvec4(dist(engine), dist(engine), dist(engine), dist(engine) + 2.0f));
+		d.qa.push_back(RandomUnitQuaternion());
+		d.qb.push_back(RandomUnitQuaternion());
+		d.m3a.push_back(RandomMat3());
+		d.m3b.push_back(RandomMat3());
+		d.m4a.push_back(RandomMat4());
+		d.m4b.push_back(RandomMat4());
+	}
+	d.v3out.resize(BenchPoolSize);
+	d.v3aligned.assign(d.v3a.begin(), d.v3a.end());
+	d.v3alignedout.resize(BenchPoolSize);
+	d.v4out.resize(BenchPoolSize);
+	d.qout.resize(BenchPoolSize);
+	d.m3out.resize(BenchPoolSize);
+	d.m4out.resize(BenchPoolSize);
+	d.sout.resize(BenchPoolSize);
+
+	// scalar と同じ値を SoAWidth 個ずつ並べる
+	for (uint32_t b = 0; b < BenchPoolSize / SoAWidth; b++) {
+		fvec3x8 a, v, c;
+		a.load(d.v3a.data() + SoAWidth * b);
+		v.load(d.v3b.data() + SoAWidth * b);
+		c.load(d.v3c.data() + SoAWidth * b);
+		d.x3a.push_back(a);
+		d.x3b.push_back(v);
+		d.x3c.push_back(c);
+
+		fmat3x8 ma, mb;
+		for (uint32_t k = 0; k < 9; k++) {
+			float lanes[2][SoAWidth];
+			for (uint32_t l = 0; l < SoAWidth; l++) {
+				lanes[0][l] = d.m3a[SoAWidth * b + l].cmp[k];
+				lanes[1][l] = d.m3b[SoAWidth * b + l].cmp[k];
+			}
+			ma.cmp[k] = SimdLoad8(lanes[0]);
+			mb.cmp[k] = SimdLoad8(lanes[1]);
+		}
+		d.xm3a.push_back(ma);
+		d.xm3b.push_back(mb);
+
+		fquaternionx8 qa, qb;
+		qa.load(d.qa.data() + SoAWidth * b);
+		qb.load(d.qb.data() + SoAWidth * b);
+		d.xqa.push_back(qa);
+		d.xqb.push_back(qb);
+	}
+	d.x3out.resize(BenchPoolSize / SoAWidth);
+	d.xm3out.resize(BenchPoolSize / SoAWidth);
+	d.xqout.resize(BenchPoolSize / SoAWidth);
+	d.xsout.resize(BenchPoolSize / SoAWidth);
+
+	MakeSphere(d.meshVertex, d.meshIndex, 128);
+}
+
+////////////////////
+// mesh の積分 (演算子と mathExpr.hpp の式で書いた scalar 版)
+
+void OperatorMeshCM(fvec3& Cm, float& Mass, const fvec3* const MVdata, const uint32_t* const MIlist, const uint32_t Misize, const float rho)
+{
+	Cm   = fvec3(0.0f, 0.0f, 0.0f);
+	Mass = 0.0f;
+
+	for (uint32_t i = 0; i < Misize / 3; i++) {
+		const fvec3& r0 = MVdata[MIlist[3 * i + 0]];
+		const fvec3& r1 = MVdata[MIlist[3 * i + 1]];
+		const fvec3& r2 = MVdata[MIlist[3 * i + 2]];
+
+		Cm = Cm + rho * fvec3::STP(r0, r1, r2) * (static_cast<float>(1.0f / 24.0f) * (r0 + r1 + r2));
+
+		Mass += rho * (1.0f / 6.0f) * fvec3::STP(r0, r1, r2);
+	}
+
+	Cm = Cm / Mass;
+}
+
+void ExpressionMeshCM(fvec3& Cm, float& Mass, const fvec3* const MVdata, const uint32_t* const MIlist, const uint32_t Misize, const float rho)
+{
+	Cm   = fvec3(0.0f, 0.0f, 0.0f);
+	Mass = 0.0f;
+
+	for (uint32_t i = 0; i < Misize / 3; i++) {
+		const fvec3& r0 = MVdata[MIlist[3 * i + 0]];
+		const fvec3& r1 = MVdata[MIlist[3 * i + 1]];
+		const fvec3& r2 = MVdata[MIlist[3 * i + 2]];
+
+		Cm += rho * fvec3::STP(r0, r1, r2) * (static_cast<float>(1.0f / 24.0f) * (Lazy(r0) + Lazy(r1) + Lazy(r2)));
+
+		Mass += rho * (1.0f / 6.0f) * fvec3::STP(r0, r1, r2);
+	}
+
+	Cm = Cm / Mass;
+}
+
+void OperatorMeshInertia(fmat3& Inertia, const fvec3& cm, const fvec3* const MVdata, const uint32_t* const MIlist, const uint32_t Misize, const float rho)
+{
+	Inertia = fmat3();
+
+	for (uint32_t i = 0; i < Misize / 3; i++) {
+		const fvec3 r0 = MVdata[MIlist[3 * i + 0]] - cm;
+		const fvec3 r1 = MVdata[MIlist[3 * i + 1]] - cm;
+		const fvec3 r2 = MVdata[MIlist[3 * i + 2]] - cm;
+
+		Inertia = Inertia + rho * fvec3::STP(r0, r1, r2) * (1.0f / 120.0f) * (2.0f * (r0.sqnorm() + r1.sqnorm() + r2.sqnorm() + r0.dot(r1) + r1.dot(r2) + r2.dot(r0)) * fmat3::identity() - 2.0f * (r0.tensorproduct(r0) + r1.tensorproduct(r1) + r2.tensorproduct(r2)) - (r0.tensorproduct(r1) + r1.tensorproduct(r0) + r1.tensorproduct(r2) + r2.tensorproduct(r1) + r2.tensorproduct(r0) + r0.tensorproduct(r2)));
+	}
+}
+
+void ExpressionMeshInertia(fmat3& Inertia, const fvec3& cm, const fvec3* const MVdata, const uint32_t* const MIlist, const uint32_t Misize, const float rho)
+{
+	Inertia = fmat3();
+
+	for (uint32_t i = 0; i < Misize / 3; i++) {
+		const fvec3 r0 = MVdata[MIlist[3 * i + 0]] - cm;
+		const fvec3 r1 = MVdata[MIlist[3 * i + 1]] - cm;
+		const fvec3 r2 = MVdata[MIlist[3 * i + 2]] - cm;
+
+		const Vec3Ref<float> e0 = Lazy(r0), e1 = Lazy(r1), e2 = Lazy(r2);
+		Inertia += rho * fvec3::STP(r0, r1, r2) * (1.0f / 120.0f) * (2.0f * (r0.sqnorm() + r1.sqnorm() + r2.sqnorm() + r0.dot(r1) + r1.dot(r2) + r2.dot(r0)) * Identity<float>() - 2.0f * (TensorProduct(e0, e0) + TensorProduct(e1, e1) + TensorProduct(e2, e2)) - (TensorProduct(e0, e1) + TensorProduct(e1, e0) + TensorProduct(e1, e2) + TensorProduct(e2, e1) + TensorProduct(e2, e0) + TensorProduct(e0, e2)));
+	}
+}
+
+////////////////////
+
+void MakeBenchCases(BenchData& d, std::vector<BenchCase>& cases)
+{
+	const uint32_t N = BenchPoolSize;
+	const uint32_t B = BenchPoolSize / SoAWidth;
+
+	auto Add = [&](const char* name, const char* variant, const char* mode, const uint32_t elements, const uint32_t ops, std::function<void()> run) {
+		cases.push_back(BenchCase { name, variant, mode, elements, ops, std::move(run) });
+	};
+
+	// vec3
+	Add("vec3 normalize", "scalar", "throughput", 1, N, [&d, N]() {
+		for (uint32_t i = 0; i < N; i++)
+			d.v3out[i] = d.v3a[i].normalized();
+	});
+	Add("vec3 normalize", "scalar", "latency", 1, N, [&d, N]() {
+		fvec3 x = d.v3a[0];
+		for (uint32_t i = 0; i < N; i++)
+			x = x.normalized();
+		d.v3out[0] = x;
+	});
+	Add("vec3 normalize", "soa", "throughput", SoAWidth, B, [&d, B]() {
+		for (uint32_t i = 0; i < B; i++)
+			d.x3out[i] = d.x3a[i].normalized();
+	});
+	Add("vec3 normalize", "soa", "latency", SoAWidth, B, [&d, B]() {
+		fvec3x8 x = d.x3a[0];
+		for (uint32_t i = 0; i < B; i++)
+			x = x.normalized();
+		d.x3out[0] = x;
+	});
+
+	// 結果を次の c.x にする
+	Add("vec3 STP", "scalar", "throughput", 1, N, [&d, N]() {
+		for (uint32_t i = 0; i < N; i++)
+			d.sout[i] = fvec3::STP(d.v3a[i], d.v3b[i], d.v3c[i]);
+	});
+	Add("vec3 STP", "scalar", "latency", 1, N, [&d, N]() {
+		float s = 0.0f;
+		for (uint32_t i = 0; i < N; i++)
+			s = fvec3::STP(d.v3a[i], d.v3b[i], fvec3(s, d.v3c[i].y, d.v3c[i].z));
+		d.sout[0] = s;
+	});
+	Add("vec3 STP", "soa", "throughput", SoAWidth, B, [&d, B]() {
+		for (uint32_t i = 0; i < B; i++)
+			d.xsout[i] = fvec3x8::STP(d.x3a[i], d.x3b[i], d.x3c[i]);
+	});
+	Add("vec3 STP", "soa", "latency", SoAWidth, B, [&d, B]() {
+		floatx8 s = floatx8::zero();
+		for (uint32_t i = 0; i < B; i++)
+			s = fvec3x8::STP(d.x3a[i], d.x3b[i], fvec3x8(s.v, d.x3c[i].y, d.x3c[i].z));
+		d.xsout[0] = s;
+	});
+
+	Add("vec3 cross", "scalar", "throughput", 1, N, [&d, N]() {
+		for (uint32_t i = 0; i < N; i++)
+			d.v3out[i] = d.v3a[i].cross(d.v3b[i]);
+	});
+	Add("vec3 cross", "scalar", "latency", 1, N, [&d, N]() {
+		fvec3 x = d.v3a[0];
+		for (uint32_t i = 0; i < N; i++)
+			x = x.cross(d.v3b[i]);
+		d.v3out[0] = x;
+	});
+#if defined(MATHFUNC_SIMD_SSE) || defined(MATHFUNC_SIMD_NEON)
+	Add("vec3 cross", "simd", "throughput", 1, N, [&d, N]() {
+		for (uint32_t i = 0; i < N; i++)
+			SimdVec3Cross(d.v3a[i].cmp, d.v3b[i].cmp, d.v3out[i].cmp);
+	});
+	Add("vec3 cross", "simd", "latency", 1, N, [&d, N]() {
+		fvec3 x = d.v3a[0];
+		for (uint32_t i = 0; i < N; i++) {
+			fvec3 y;
+			SimdVec3Cross(x.cmp, d.v3b[i].cmp, y.cmp);
+			x = y;
+		}
+		d.v3out[0] = x;
+	});
+#endif
+	Add("vec3 cross", "soa", "throughput", SoAWidth, B, [&d, B]() {
+		for (uint32_t i = 0; i < B; i++)
+			d.x3out[i] = d.x3a[i].cross(d.x3b[i]);
+	});
+
+	Add("vec3 tensorproduct", "scalar", "throughput", 1, N, [&d, N]() {
+		for (uint32_t i = 0; i < N; i++)
+			d.m3out[i] = d.v3a[i].tensorproduct(d.v3b[i]);
+	});
+	Add("vec3 tensorproduct", "soa", "throughput", SoAWidth, B, [&d, B]() {
+		for (uint32_t i = 0; i < B; i++)
+			d.xm3out[i] = d.x3a[i].tensorproduct(d.x3b[i]);
+	});
+
+	// AoS の配列との受け渡し (fvec3 は 1 成分ずつ, fvec3a は 4 成分ずつ転置する)
+	Add("vec3 load store", "soa", "throughput", SoAWidth, B, [&d, B]() {
+		for (uint32_t i = 0; i < B; i++) {
+			fvec3x8 x;
+			x.load(d.v3a.data() + SoAWidth * i);
+			x.store(d.v3out.data() + SoAWidth * i);
+		}
+	});
+	Add("vec3 load store", "soa aligned", "throughput", SoAWidth, B, [&d, B]() {
+		for (uint32_t i = 0; i < B; i++) {
+			fvec3x8 x;
+			x.load(d.v3aligned.data() + SoAWidth * i);
+			x.store(d.v3alignedout.data() + SoAWidth * i);
+		}
+	});
+
+	// vec4
+	Add("vec4 normalize", "scalar", "throughput", 1, N, [&d, N]() {
+		for (uint32_t i = 0; i < N; i++)
+			d.v4out[i] = d.v4a[i].normalized();
+	});
+	Add("vec4 normalize", "scalar", "latency", 1, N, [&d, N]() {
+		fvec4 x = d.v4a[0];
+		for (uint32_t i = 0; i < N; i++)
+			x = x.normalized();
+		d.v4out[0] = x;
+	});
+#if defined(MATHFUNC_SIMD_SSE) || defined(MATHFUNC_SIMD_NEON)
+	Add("vec4 normalize", "simd", "throughput", 1, N, [&d, N]() {
+		for (uint32_t i = 0; i < N; i++)
+			SimdVec4Normalized(d.v4a[i].cmp, d.v4out[i].cmp);
+	});
+	Add("vec4 normalize", "simd", "latency", 1, N, [&d, N]() {
+		fvec4 x = d.v4a[0];
+		for (uint32_t i = 0; i < N; i++) {
+			fvec4 y;
+			SimdVec4Normalized(x.cmp, y.cmp);
+			x = y;
+		}
+		d.v4out[0] = x;
+	});
+#endif
+
+	// mat3
+	Add("mat3 mul", "scalar", "throughput", 1, N, [&d, N]() {
+		for (uint32_t i = 0; i < N; i++)
+			d.m3out[i] = d.m3a[i] * d.m3b[i];
+	});
+	Add("mat3 mul", "scalar", "latency", 1, N, [&d, N]() {
+		fmat3 x = d.m3a[0];
+		for (uint32_t i = 0; i < N; i++)
+			x = x * d.m3b[i];
+		d.m3out[0] = x;
+	});
+#if defined(MATHFUNC_SIMD_SSE) || defined(MATHFUNC_SIMD_NEON)
+	Add("mat3 mul", "simd", "throughput", 1, N, [&d, N]() {
+		for (uint32_t i = 0; i < N; i++)
+			SimdMat3Mul(d.m3a[i].cmp, d.m3b[i].cmp, d.m3out[i].cmp);
+	});
+	Add("mat3 mul", "simd", "latency", 1, N, [&d, N]() {
+		fmat3 x = d.m3a[0];
+		for (uint32_t i = 0; i < N; i++) {
+			fmat3 y;
+			SimdMat3Mul(x.cmp, d.m3b[i].cmp, y.cmp);
+			x = y;
+		}
+		d.m3out[0] = x;
+	});
+#endif
+	Add("mat3 mul", "soa", "throughput", SoAWidth, B, [&d, B]() {
+		for (uint32_t i = 0; i < B; i++)
+			d.xm3out[i] = d.xm3a[i] * d.xm3b[i];
+	});
+	Add("mat3 mul", "soa", "latency", SoAWidth, B, [&d, B]() {
+		fmat3x8 x = d.xm3a[0];
+		for (uint32_t i = 0; i < B; i++)
+			x = x * d.xm3b[i];
+		d.xm3out[0] = x;
+	});
+
+	Add("mat3 mulvec", "scalar", "throughput", 1, N, [&d, N]() {
+		for (uint32_t i = 0; i < N; i++)
+			d.v3out[i] = d.m3a[i] * d.v3a[i];
+	});
+	Add("mat3 mulvec", "scalar", "latency", 1, N, [&d, N]() {
+		fvec3 x = d.v3a[0];
+		for (uint32_t i = 0; i < N; i++)
+			x = d.m3a[i] * x;
+		d.v3out[0] = x;
+	});
+#if defined(MATHFUNC_SIMD_SSE) || defined(MATHFUNC_SIMD_NEON)
+	Add("mat3 mulvec", "simd", "throughput", 1, N, [&d, N]() {
+		for (uint32_t i = 0; i < N; i++)
+			SimdMat3MulVec3(d.m3a[i].cmp, d.v3a[i].cmp, d.v3out[i].cmp);
+	});
+	Add("mat3 mulvec", "simd", "latency", 1, N, [&d, N]() {
+		fvec3 x = d.v3a[0];
+		for (uint32_t i = 0; i < N; i++) {
+			fvec3 y;
+			SimdMat3MulVec3(d.m3a[i].cmp, x.cmp, y.cmp);
+			x = y;
+		}
+		d.v3out[0] = x;
+	});
+#endif
+	Add("mat3 mulvec", "soa", "throughput", SoAWidth, B, [&d, B]() {
+		for (uint32_t i = 0; i < B; i++)
+			d.x3out[i] = d.xm3a[i] * d.x3a[i];
+	});
+	Add("mat3 mulvec", "soa", "latency", SoAWidth, B, [&d, B]() {
+		fvec3x8 x = d.x3a[0];
+		for (uint32_t i = 0; i < B; i++)
+			x = d.xm3a[i] * x;
+		d.x3out[0] = x;
+	});
+
+	Add("mat3 inverse", "scalar", "throughput", 1, N, [&d, N]() {
+		for (uint32_t i = 0; i < N; i++)
+			d.m3out[i] = d.m3a[i].inverse();
+	});
+	Add("mat3 inverse", "scalar", "latency", 1, N, [&d, N]() {
+		fmat3 x = d.m3a[0];
+		for (uint32_t i = 0; i < N; i++)
+			x = x.inverse();
+		d.m3out[0] = x;
+	});
+#if defined(MATHFUNC_SIMD_SSE) || defined(MATHFUNC_SIMD_NEON)
+	Add("mat3 inverse", "simd", "throughput", 1, N, [&d, N]() {
+		for (uint32_t i = 0; i < N; i++)
+			SimdMat3Inverse(d.m3a[i].cmp, d.m3out[i].cmp);
+	});
+	Add("mat3 inverse", "simd", "latency", 1, N, [&d, N]() {
+		fmat3 x = d.m3a[0];
+		for (uint32_t i = 0; i < N; i++) {
+			fmat3 y;
+			SimdMat3Inverse(x.cmp, y.cmp);
+			x = y;
+		}
+		d.m3out[0] = x;
+	});
+#endif
+	Add("mat3 inverse", "soa", "throughput", SoAWidth, B, [&d, B]() {
+		for (uint32_t i = 0; i < B; i++)
+			d.xm3out[i] = d.xm3a[i].inverse();
+	});
+	Add("mat3 inverse", "soa", "latency", SoAWidth, B, [&d, B]() {
+		fmat3x8 x = d.xm3a[0];
+		for (uint32_t i = 0; i < B; i++)
+			x = x.inverse();
+		d.xm3out[0] = x;
+	});
+
+	// mat4
+	Add("mat4 mul", "scalar", "throughput", 1, N, [&d, N]() {
+		for (uint32_t i = 0; i < N; i++)
+			d.m4out[i] = d.m4a[i] * d.m4b[i];
+	});
+	Add("mat4 mul", "scalar", "latency", 1, N, [&d, N]() {
+		fmat4 x = d.m4a[0];
+		for (uint32_t i = 0; i < N; i++)
+			x = x * d.m4b[i];
+		d.m4out[0] = x;
+	});
+#if defined(MATHFUNC_SIMD_SSE) || defined(MATHFUNC_SIMD_NEON)
+	Add("mat4 mul", "simd", "throughput", 1, N, [&d, N]() {
+		for (uint32_t i = 0; i < N; i++)
+			SimdMat4Mul(d.m4a[i].cmp, d.m4b[i].cmp, d.m4out[i].cmp);
+	});
+	Add("mat4 mul", "simd", "latency", 1, N, [&d, N]() {
+		fmat4 x = d.m4a[0];
+		for (uint32_t i = 0; i < N; i++) {
+			fmat4 y;
+			SimdMat4Mul(x.cmp, d.m4b[i].cmp, y.cmp);
+			x = y;
+		}
+		d.m4out[0] = x;
+	});
+#endif
+
+	Add("mat4 mulvec", "scalar", "throughput", 1, N, [&d, N]() {
+		for (uint32_t i = 0; i < N; i++)
+			d.v4out[i] = d.m4a[i] * d.v4a[i];
+	});
+	Add("mat4 mulvec", "scalar", "latency", 1, N, [&d, N]() {
+		fvec4 x = d.v4a[0];
+		for (uint32_t i = 0; i < N; i++)
+			x = d.m4a[i] * x;
+		d.v4out[0] = x;
+	});
+#if defined(MATHFUNC_SIMD_SSE) || defined(MATHFUNC_SIMD_NEON)
+	Add("mat4 mulvec", "simd", "throughput", 1, N, [&d, N]() {
+		for (uint32_t i = 0; i < N; i++)
+			SimdMat4MulVec4(d.m4a[i].cmp, d.v4a[i].cmp, d.v4out[i].cmp);
+	});
+	Add("mat4 mulvec", "simd", "latency", 1, N, [&d, N]() {
+		fvec4 x = d.v4a[0];
+		for (uint32_t i = 0; i < N; i++) {
+			fvec4 y;
+			SimdMat4MulVec4(d.m4a[i].cmp, x.cmp, y.cmp);
+			x = y;
+		}
+		d.v4out[0] = x;
+	});
+#endif
+
+	Add("mat4 inverse", "scalar", "throughput", 1, N, [&d, N]() {
+		for (uint32_t i = 0; i < N; i++)
+			d.m4out[i] = d.m4a[i].inverse();
+	});
+	Add("mat4 inverse", "scalar", "latency", 1, N, [&d, N]() {
+		fmat4 x = d.m4a[0];
+		for (uint32_t i = 0; i < N; i++)
+			x = x.inverse();
+		d.m4out[0] = x;
+	});
+	Add("mat4 affineinverse", "scalar", "throughput", 1, N, [&d, N]() {
+		for (uint32_t i = 0; i < N; i++)
+			d.m4out[i] = d.m4a[i].affineinverse();
+	});
+	Add("mat4 affineinverse", "scalar", "latency", 1, N, [&d, N]() {
+		fmat4 x = d.m4a[0];
+		for (uint32_t i = 0; i < N; i++)
+			x = x.affineinverse();
+		d.m4out[0] = x;
+	});
+#if defined(MATHFUNC_SIMD_SSE) || defined(MATHFUNC_SIMD_NEON)
+	Add("mat4 inverse", "simd", "throughput", 1, N, [&d, N]() {
+		for (uint32_t i = 0; i < N; i++)
+			SimdMat4Inverse(d.m4a[i].cmp, d.m4out[i].cmp);
+	});
+	Add("mat4 inverse", "simd", "latency", 1, N, [&d, N]() {
+		fmat4 x = d.m4a[0];
+		for (uint32_t i = 0; i < N; i++) {
+			fmat4 y;
+			SimdMat4Inverse(x.cmp, y.cmp);
+			x = y;
+		}
+		d.m4out[0] = x;
+	});
+	Add("mat4 affineinverse", "simd", "throughput", 1, N, [&d, N]() {
+		for (uint32_t i = 0; i < N; i++)
+			SimdMat4AffineInverse(d.m4a[i].cmp, d.m4out[i].cmp);
+	});
+	Add("mat4 affineinverse", "simd", "latency", 1, N, [&d, N]() {
+		fmat4 x = d.m4a[0];
+		for (uint32_t i = 0; i < N; i++) {
+			fmat4 y;
+			SimdMat4AffineInverse(x.cmp, y.cmp);
+			x = y;
+		}
+		d.m4out[0] = x;
+	});
+#endif
+
+	// quaternion
+	Add("quaternion mul", "scalar", "throughput", 1, N, [&d, N]() {
+		for (uint32_t i = 0; i < N; i++)
+			d.qout[i] = d.qa[i] * d.qb[i];
+	});
+	Add("quaternion mul", "scalar", "latency", 1, N, [&d, N]() {
+		fquaternion x = d.qa[0];
+		for (uint32_t i = 0; i < N; i++)
+			x = x * d.qb[i];
+		d.qout[0] = x;
+	});
+#if defined(MATHFUNC_SIMD_SSE) || defined(MATHFUNC_SIMD_NEON)
+	Add("quaternion mul", "simd", "throughput", 1, N, [&d, N]() {
+		for (uint32_t i = 0; i < N; i++)
+			SimdQuaternionMul(d.qa[i].cmp, d.qb[i].cmp, d.qout[i].cmp);
+	});
+	Add("quaternion mul", "simd", "latency", 1, N, [&d, N]() {
+		fquaternion x = d.qa[0];
+		for (uint32_t i = 0; i < N; i++) {
+			fquaternion y;
+			SimdQuaternionMul(x.cmp, d.qb[i].cmp, y.cmp);
+			x = y;
+		}
+		d.qout[0] = x;
+	});
+#endif
+	Add("quaternion mul", "soa", "throughput", SoAWidth, B, [&d, B]() {
+		for (uint32_t i = 0; i < B; i++)
+			d.xqout[i] = d.xqa[i] * d.xqb[i];
+	});
+	Add("quaternion mul", "soa", "latency", SoAWidth, B, [&d, B]() {
+		fquaternionx8 x = d.xqa[0];
+		for (uint32_t i = 0; i < B; i++)
+			x = x * d.xqb[i];
+		d.xqout[0] = x;
+	});
+
+	Add("quaternion normalize", "scalar", "throughput", 1, N, [&d, N]() {
+		for (uint32_t i = 0; i < N; i++)
+			d.qout[i] = d.qa[i] / d.qa[i].norm();
+	});
+	Add("quaternion normalize", "scalar", "latency", 1, N, [&d, N]() {
+		fquaternion x = d.qa[0];
+		for (uint32_t i = 0; i < N; i++)
+			x = x / x.norm();
+		d.qout[0] = x;
+	});
+	Add("quaternion normalize", "soa", "throughput", SoAWidth, B, [&d, B]() {
+		for (uint32_t i = 0; i < B; i++)
+			d.xqout[i] = d.xqa[i].normalized();
+	});
+	Add("quaternion normalize", "soa", "latency", SoAWidth, B, [&d, B]() {
+		fquaternionx8 x = d.xqa[0];
+		for (uint32_t i = 0; i < B; i++)
+			x = x.normalized();
+		d.xqout[0] = x;
+	});
+	Add("quaternion fastnormalize", "soa", "throughput", SoAWidth, B, [&d, B]() {
+		for (uint32_t i = 0; i < B; i++)
+			d.xqout[i] = d.xqa[i].fastnormalized();
+	});
+	Add("quaternion fastnormalize", "soa", "latency", SoAWidth, B, [&d, B]() {
+		fquaternionx8 x = d.xqa[0];
+		for (uint32_t i = 0; i < B; i++)
+			x = x.fastnormalized();
+		d.xqout[0] = x;
+	});
+
+	// 角速度は x3a (長さ 1) を使う
+	Add("quaternion integrate", "scalar", "throughput", 1, N, [&d, N]() {
+		for (uint32_t i = 0; i < N; i++) {
+			const fquaternion q = d.qa[i] + (0.5f * 0.01f) * (fquaternion(0.0f, d.v3a[i]) * d.qa[i]);
+			d.qout[i]	    = q / q.norm();
+		}
+	});
+	Add("quaternion integrate", "soa", "throughput", SoAWidth, B, [&d, B]() {
+		for (uint32_t i = 0; i < B; i++)
+			d.xqout[i] = d.xqa[i].integrate(d.x3a[i], 0.01f);
+	});
+	Add("quaternion integrate", "soa", "latency", SoAWidth, B, [&d, B]() {
+		fquaternionx8 x = d.xqa[0];
+		for (uint32_t i = 0; i < B; i++)
+			x = x.integrate(d.x3a[i], 0.01f);
+		d.xqout[0] = x;
+	});
+
+	Add("quaternion slerp", "scalar", "throughput", 1, N, [&d, N]() {
+		for (uint32_t i = 0; i < N; i++)
+			d.qout[i] = fquaternion::slerp(d.qa[i], d.qb[i], 0.3f);
+	});
+	Add("quaternion slerp", "scalar", "latency", 1, N, [&d, N]() {
+		fquaternion x = d.qa[0];
+		for (uint32_t i = 0; i < N; i++)
+			x = fquaternion::slerp(x, d.qb[i], 0.3f);
+		d.qout[0] = x;
+	});
+	Add("quaternion slerp", "soa", "throughput", SoAWidth, B, [&d, B]() {
+		const floatx8 t(0.3f);
+		for (uint32_t i = 0; i < B; i++)
+			d.xqout[i] = fquaternionx8::slerp(d.xqa[i], d.xqb[i], t);
+	});
+	Add("quaternion slerp", "soa", "latency", SoAWidth, B, [&d, B]() {
+		const floatx8 t(0.3f);
+		fquaternionx8 x = d.xqa[0];
+		for (uint32_t i = 0; i < B; i++)
+			x = fquaternionx8::slerp(x, d.xqb[i], t);
+		d.xqout[0] = x;
+	});
+	Add("quaternion nlerp", "soa", "throughput", SoAWidth, B, [&d, B]() {
+		const floatx8 t(0.3f);
+		for (uint32_t i = 0; i < B; i++)
+			d.xqout[i] = fquaternionx8::nlerp(d.xqa[i], d.xqb[i], t);
+	});
+	Add("quaternion nlerp", "soa", "latency", SoAWidth, B, [&d, B]() {
+		const floatx8 t(0.3f);
+		fquaternionx8 x = d.xqa[0];
+		for (uint32_t i = 0; i < B; i++)
+			x = fquaternionx8::nlerp(x, d.xqb[i], t);
+		d.xqout[0] = x;
+	});
+
+	Add("quaternion rotatevector", "scalar", "throughput", 1, N, [&d, N]() {
+		for (uint32_t i = 0; i < N; i++)
+			d.v3out[i] = d.qa[i].rotatevector(d.v3a[i]);
+	});
+	Add("quaternion rotatevector", "scalar", "latency", 1, N, [&d, N]() {
+		fvec3 x = d.v3a[0];
+		for (uint32_t i = 0; i < N; i++)
+			x = d.qa[i].rotatevector(x);
+		d.v3out[0] = x;
+	});
+	Add("quaternion rotatevector", "soa", "throughput", SoAWidth, B, [&d, B]() {
+		for (uint32_t i = 0; i < B; i++)
+			d.x3out[i] = d.xqa[i].rotatevector(d.x3a[i]);
+	});
+	Add("quaternion rotatevector", "soa", "latency", SoAWidth, B, [&d, B]() {
+		fvec3x8 x = d.x3a[0];
+		for (uint32_t i = 0; i < B; i++)
+			x = d.xqa[i].rotatevector(x);
+		d.x3out[0] = x;
+	});
+
+	Add("quaternion torotation", "scalar", "throughput", 1, N, [&d, N]() {
+		for (uint32_t i = 0; i < N; i++)
+			d.m3out[i] = d.qa[i].torotation();
+	});
+	Add("quaternion torotation", "soa", "throughput", SoAWidth, B, [&d, B]() {
+		for (uint32_t i = 0; i < B; i++)
+			d.xm3out[i] = d.xqa[i].torotation();
+	});
+	Add("quaternion storetransform", "scalar", "throughput", 1, N, [&d, N]() {
+		for (uint32_t i = 0; i < N; i++) {
+			const fmat3 r = d.qa[i].torotation();
+			d.m4out[i]    = fmat4(
+			       r.cmp[0], r.cmp[1], r.cmp[2], d.v3a[i].x,
+			       r.cmp[3], r.cmp[4], r.cmp[5], d.v3a[i].y,
+			       r.cmp[6], r.cmp[7], r.cmp[8], d.v3a[i].z,
+			       0.0f, 0.0f, 0.0f, 1.0f);
+		}
+	});
+	Add("quaternion storetransform", "soa", "throughput", SoAWidth, B, [&d, B]() {
+		for (uint32_t i = 0; i < B; i++)
+			d.xqa[i].storetransform(d.m4out.data() + SoAWidth * i, d.x3a[i]);
+	});
+
+	// mesh の積分 (1 回の演算が三角形 1 つ)
+	const uint32_t T = d.meshIndex.size() / 3;
+	Add("MeshCM", "scalar", "throughput", 1, T, [&d]() {
+		OperatorMeshCM(d.v3out[0], d.sout[0], d.meshVertex.data(), d.meshIndex.data(), d.meshIndex.size(), 1.0f);
+	});
+	Add("MeshCM", "expression", "throughput", 1, T, [&d]() {
+		ExpressionMeshCM(d.v3out[0], d.sout[0], d.meshVertex.data(), d.meshIndex.data(), d.meshIndex.size(), 1.0f);
+	});
+	Add("MeshCM", "soa", "throughput", 1, T, [&d]() {
+		MeshCM(d.v3out[0], d.sout[0], d.meshVertex.data(), d.meshVertex.size(), d.meshIndex.data(), d.meshIndex.size(), 1.0f);
+	});
+	Add("MeshCM", "soa double", "throughput", 1, T, [&d]() {
+		dvec3 cm;
+		double mass;
+		MeshCM(cm, mass, d.meshVertex.data(), d.meshVertex.size(), d.meshIndex.data(), d.meshIndex.size(), 1.0f);
+		d.sout[0] = mass;
+	});
+	Add("MeshInertia", "scalar", "throughput", 1, T, [&d]() {
+		OperatorMeshInertia(d.m3out[0], d.v3a[0], d.meshVertex.data(), d.meshIndex.data(), d.meshIndex.size(), 1.0f);
+	});
+	Add("MeshInertia", "expression", "throughput", 1, T, [&d]() {
+		ExpressionMeshInertia(d.m3out[0], d.v3a[0], d.meshVertex.data(), d.meshIndex.data(), d.meshIndex.size(), 1.0f);
+	});
+	Add("MeshInertia", "soa", "throughput", 1, T, [&d]() {
+		MeshInertia(d.m3out[0], d.v3a[0], d.meshVertex.data(), d.meshVertex.size(), d.meshIndex.data(), d.meshIndex.size(), 1.0f);
+	});
+	Add("MeshInertia", "soa double", "throughput", 1, T, [&d]() {
+		dmat3 inertia;
+		MeshInertia(inertia, static_cast<dvec3>(d.v3a[0]), d.meshVertex.data(), d.meshVertex.size(), d.meshIndex.data(), d.meshIndex.size(), 1.0f);
+		d.m3out[0] = static_cast<fmat3>(inertia);
+	});
+}
+
+// run を reps 回続けて呼ぶ時間が minMilliseconds を超えるまで reps を倍にしてから samples 回測り、一番速い回の 1 演算あたりの時間 (ns) を返す
+double MeasureNanoseconds(const BenchCase& c, const double minMilliseconds, const uint32_t samples)
+{
+	auto Time = [&c](const uint64_t reps) {
+		const auto start = std::chrono::steady_clock::now();
+		for (uint64_t r = 0; r < reps; r++)
+			c.run();
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	};
+
+	uint64_t reps = 1;
+	while (Time(reps) < minMilliseconds * 1.0e6 && reps < (uint64_t(1) << 40))
+		reps *= 2;
+
+	double best = 1.0e300;
+	for (uint32_t s = 0; s < samples; s++)
+		best = std::min(best, Time(reps));
+	return best / (double(reps) * c.ops);
+}
+
+const char* SimdName()
+{
+#if defined(MATHFUNC_SIMD_AVX)
+	return "avx";
+#elif defined(MATHFUNC_SIMD_SSE)
+	return "sse";
+#elif defined(MATHFUNC_SIMD_NEON)
+	return "neon";
+#else
+	return "none";
+#endif
+}
+
+std::string CompilerName()
+{
+	std::ostringstream ss;
+#if defined(__clang__)
+	ss << "clang " << __clang_major__ << "." << __clang_minor__;
+#elif defined(__GNUC__)
+	ss << "gcc " << __GNUC__ << "." << __GNUC_MINOR__;
+#elif defined(_MSC_VER)
+	ss << "msvc " << _MSC_VER;
+#else
+	ss << "unknown";
+#endif
+	return ss.str();
+}
+
+void WriteText(std::ostream& os, const std::vector<BenchResult>& results)
+{
+	os << "simd: " << SimdName() << ", compiler: " << CompilerName() << std::endl;
+	char line[256];
+	std::snprintf(line, sizeof(line), "%-26s %-12s %-11s %12s %12s", "name", "variant", "mode", "ns/op", "ns/element");
+	os << line << std::endl;
+	for (const BenchResult& r : results) {
+		const BenchCase& c = *r.benchCase;
+		std::snprintf(line, sizeof(line), "%-26s %-12s %-11s %12.3f %12.3f", c.name.c_str(), c.variant.c_str(), c.mode.c_str(), r.nanoseconds, r.nanoseconds / c.elements);
+		os << line << std::endl;
+	}
+}
+
+void WriteJson(std::ostream& os, const std::vector<BenchResult>& results)
+{
+	os << "{" << std::endl;
+	os << "  \"simd\": \"" << SimdName() << "\"," << std::endl;
+	os << "  \"compiler\": \"" << CompilerName() << "\"," << std::endl;
+	os << "  \"results\": [" << std::endl;
+	for (size_t i = 0; i < results.size(); i++) {
+		const BenchCase& c = *results[i].benchCase;
+		os << "    { \"name\": \"" << c.name << "\", \"variant\": \"" << c.variant << "\", \"mode\": \"" << c.mode << "\", \"elements\": " << c.elements
+		   << ", \"ns_per_op\": " << results[i].nanoseconds << ", \"ns_per_element\": " << results[i].nanoseconds / c.elements << " }"
+		   << (i + 1 < results.size() ? "," : "") << std::endl;
+	}
+	os << "  ]" << std::endl;
+	os << "}" << std::endl;
+}
+
+void WriteCsv(std::ostream& os, const std::vector<BenchResult>& results)
+{
+	os << "name,variant,mode,elements,ns_per_op,ns_per_element" << std::endl;
+	for (const BenchResult& r : results) {
+		const BenchCase& c = *r.benchCase;
+		os << c.name << "," << c.variant << "," << c.mode << "," << c.elements << "," << r.nanoseconds << "," << r.nanoseconds / c.elements << std::endl;
+	}
+}
+
+void PrintUsage()
+{
+	std::cout << "usage: mathBench [options]" << std::endl;
+	std::cout << "  -format text|json|csv  output format (default: text)" << std::endl;
+	std::cout << "  -o output              output file (default: stdout)" << std::endl;
+	std::cout << "  -filter text           run cases whose \"name variant mode\" contains text" << std::endl;
+	std::cout << "  -time ms               minimum time of one sample (default: 10)" << std::endl;
+	std::cout << "  -samples n             samples per case, the fastest is reported (default: 5)" << std::endl;
+	std::cout << "  -list                  list cases and exit" << std::endl;
+}
+
+int main(int argc, char const* argv[])
+{
+	std::string format = "text";
+	std::string output;
+	std::string filter;
+	double minMilliseconds = 10.0;
+	uint32_t samples       = 5;
+	bool isListOnly	       = false;
+
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		if (arg == "-format" && i + 1 < argc)
+			format = argv[++i];
+		else if (arg == "-o" && i + 1 < argc)
+			output = argv[++i];
+		else if (arg == "-filter" && i + 1 < argc)
+			filter = argv[++i];
+		else if (arg == "-time" && i + 1 < argc)
+			minMilliseconds = std::max(0.01, std::atof(argv[++i]));
+		else if (arg == "-samples" && i + 1 < argc)
+			samples = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "-list")
+			isListOnly = true;
+		else {
+			PrintUsage();
+			return 1;
+		}
+	}
+	if (format != "text" && format != "json" && format != "csv") {
+		std::cout << "unknown format: " << format << std::endl;
+		return 1;
+	}
+
+	BenchData data;
+	MakeBenchData(data);
+	std::vector<BenchCase> cases;
+	MakeBenchCases(data, cases);
+
+	std::vector<BenchResult> results;
+	for (const BenchCase& c : cases) {
+		if (!filter.empty() && (c.name + " " + c.variant + " " + c.mode).find(filter) == std::string::npos)
+			continue;
+		if (isListOnly) {
+			std::cout << c.name << " / " << c.variant << " / " << c.mode << std::endl;
+			continue;
+		}
+		results.push_back(BenchResult { &c, MeasureNanoseconds(c, minMilliseconds, samples) });
+	}
+	if (isListOnly)
+		return 0;
+
+	std::ofstream file;
+	if (!output.empty()) {
+		file.open(output);
+		if (!file) {
+			std::cout << "cannot open " << output << std::endl;
+			return 1;
+		}
+	}
+	std::ostream& os = output.empty() ? std::cout : file;
+
+	if (format == "json")
+		WriteJson(os, results);
+	else if (format == "csv")
+		WriteCsv(os, results);
+	else
+		WriteText(os, results);
+
+	return 0;
+}
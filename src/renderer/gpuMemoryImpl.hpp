@@ -1,6 +1,6 @@
 #pragma once
 
-// ̏ŃCN[h邱
+// この順序でインクルードすること
 #include <vulkan/vulkan.h>
 #include <GLFW/glfw3.h>
 
@@ -25,11 +25,23 @@ class GpuTextureMemoryImpl {
 	uint32_t width;
 	uint32_t height;
 	uint32_t size;
+	uint32_t mipLevels;
+	bool generateMips;
+	float maxAnisotropy;
+	float minLod;
+	float maxLod;
+	float mipLodBias;
 	GpuMemoryImpl gpuMemory;
 	VkImageView imageView;
 	VkSampler sampler;
 	GpuTextureMemoryImpl()
 	    : image(VK_NULL_HANDLE)
+	    , mipLevels(1)
+	    , generateMips(false)
+	    , maxAnisotropy(1.0f)
+	    , minLod(0.0f)
+	    , maxLod(VK_LOD_CLAMP_NONE)
+	    , mipLodBias(0.0f)
 	    , gpuMemory()
 	    , imageView(VK_NULL_HANDLE)
 	{
@@ -10,38 +10,28 @@
 #include "src/renderer/mesh/drawArray.hpp"
 
 template class DrawVertexArray<int32_t>;
+template class DrawVertexArray<uint16_t>;
 template class DrawVertexArray<BasicVertex>;
 
-template<class ValueType>
-void DrawVertexArray<ValueType>::gpuInitialize(RendererImpl* pRendererImpl)
-{
-	VkDevice& logicaldevice = pRendererImpl->logicalDevice;
-
-	m_pGpuMemoryImpl = new GpuMemoryImpl();
-
-	pRendererImpl->CreateBuffer(*m_pGpuMemoryImpl, (m_isIndexBufffer) ? Renderer::BufferCreateUsage::VertexIndex : Renderer::BufferCreateUsage::Vertex, this->size() * getValueTypeSize());
-}
-
-template<class ValueType>
-void DrawVertexArray<ValueType>::updateGpuMemory(RendererImpl* pRendererImpl)
+// deviceMemory を map して write(mappedData) で書き、flush して unmap する
+template<class WriteFunction>
+static void WriteGpuMemory(VkDevice& logicaldevice, GpuMemoryImpl* pGpuMemoryImpl, WriteFunction write)
 {
-	VkDevice& logicaldevice = pRendererImpl->logicalDevice;
-
 	void* mappedData;
-	VkResult result = vkMapMemory(logicaldevice, m_pGpuMemoryImpl->deviceMemory, 0, VK_WHOLE_SIZE, 0, &mappedData);
+	VkResult result = vkMapMemory(logicaldevice, pGpuMemoryImpl->deviceMemory, 0, VK_WHOLE_SIZE, 0, &mappedData);
 	if (result != VK_SUCCESS)
 	{
 		std::cout << "faild to map device memory!!!" << std::endl;
 		exit(1);
 	}
 
-	std::memcpy(mappedData, this->data(), this->size() * getValueTypeSize());
+	write(static_cast<uint8_t*>(mappedData));
 
 	// VK_MEMORY_PROPERTY_HOST_COHERENT_BIT ���^�Ȃ̂� flush �̕K�v�͂Ȃ����ꉞ
 	VkMappedMemoryRange memoryRange;
 	memoryRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
 	memoryRange.pNext = nullptr;
-	memoryRange.memory = m_pGpuMemoryImpl->deviceMemory;
+	memoryRange.memory = pGpuMemoryImpl->deviceMemory;
 	memoryRange.offset = 0;
 	memoryRange.size = VK_WHOLE_SIZE;
 	result = vkFlushMappedMemoryRanges(logicaldevice, 1, &memoryRange);
@@ -52,5 +42,88 @@ void DrawVertexArray<ValueType>::updateGpuMemory(RendererImpl* pRendererImpl)
 	}
 
 	// unmap
-	vkUnmapMemory(logicaldevice, m_pGpuMemoryImpl->deviceMemory);
-}
\ No newline at end of file
+	vkUnmapMemory(logicaldevice, pGpuMemoryImpl->deviceMemory);
+}
+
+template<class ValueType>
+void DrawVertexArray<ValueType>::gpuInitialize(RendererImpl* pRendererImpl)
+{
+	m_pGpuMemoryImpl = new GpuMemoryImpl();
+
+	if constexpr (hasPositionStream) {
+		// 属性ストリームは先頭の position を切り落とした頂点を並べる
+		static_assert(offsetof(ValueType, position) == 0);
+		constexpr uint32_t positionSize = sizeof(decltype(ValueType::position));
+
+		m_pPositionGpuMemoryImpl = new GpuMemoryImpl();
+		pRendererImpl->CreateBuffer(*m_pPositionGpuMemoryImpl, Renderer::BufferCreateUsage::Vertex, this->size() * positionSize);
+		pRendererImpl->CreateBuffer(*m_pGpuMemoryImpl, Renderer::BufferCreateUsage::Vertex, this->size() * (sizeof(ValueType) - positionSize));
+	}
+	else {
+		pRendererImpl->CreateBuffer(*m_pGpuMemoryImpl, (m_isIndexBufffer) ? Renderer::BufferCreateUsage::VertexIndex : Renderer::BufferCreateUsage::Vertex, this->size() * getValueTypeSize());
+	}
+}
+
+template<class ValueType>
+void DrawVertexArray<ValueType>::updateGpuMemory(RendererImpl* pRendererImpl)
+{
+	VkDevice& logicaldevice = pRendererImpl->logicalDevice;
+
+	if constexpr (hasPositionStream) {
+		using PositionType = decltype(ValueType::position);
+		constexpr uint32_t positionSize = sizeof(PositionType);
+		constexpr uint32_t attributeStride = sizeof(ValueType) - positionSize;
+
+		WriteGpuMemory(logicaldevice, m_pPositionGpuMemoryImpl, [&](uint8_t* pMapped) {
+			PositionType* pPositions = reinterpret_cast<PositionType*>(pMapped);
+			for (uint32_t i = 0; i < this->size(); i++) {
+				pPositions[i] = (*this)[i].position;
+			}
+		});
+
+		WriteGpuMemory(logicaldevice, m_pGpuMemoryImpl, [&](uint8_t* pMapped) {
+			const uint8_t* pVertices = reinterpret_cast<const uint8_t*>(this->data());
+			for (uint32_t i = 0; i < this->size(); i++) {
+				std::memcpy(pMapped + size_t(i) * attributeStride, pVertices + size_t(i) * sizeof(ValueType) + positionSize, attributeStride);
+			}
+		});
+	}
+	else {
+		WriteGpuMemory(logicaldevice, m_pGpuMemoryImpl, [&](uint8_t* pMapped) {
+			std::memcpy(pMapped, this->data(), this->size() * getValueTypeSize());
+		});
+	}
+}
+
+template<class ValueType>
+void DrawVertexArray<ValueType>::updateGpuMemoryPositions(RendererImpl* pRendererImpl, const fvec3* pPositions, const fvec3* pNormals)
+{
+	if constexpr (requires(ValueType v) { v.position; v.normal; }) {
+		VkDevice& logicaldevice = pRendererImpl->logicalDevice;
+
+		// CPU 側の配列も合わせておく (後で updateGpuMemory を呼んでも古い position に戻らないように)
+		for (uint32_t i = 0; i < this->size(); i++) {
+			(*this)[i].position = pPositions[i];
+			(*this)[i].normal = pNormals[i];
+		}
+
+		// position ストリームはそのまま写せる
+		WriteGpuMemory(logicaldevice, m_pPositionGpuMemoryImpl, [&](uint8_t* pMapped) {
+			std::memcpy(pMapped, pPositions, this->size() * sizeof(fvec3));
+		});
+
+		// 属性ストリームは他の属性を読み書きせず、頂点ごとに normal だけを書く
+		constexpr uint32_t positionSize = sizeof(decltype(ValueType::position));
+		constexpr uint32_t attributeStride = sizeof(ValueType) - positionSize;
+		const uint32_t normalOffset = offsetof(ValueType, normal) - positionSize;
+		WriteGpuMemory(logicaldevice, m_pGpuMemoryImpl, [&](uint8_t* pMapped) {
+			for (uint32_t i = 0; i < this->size(); i++) {
+				std::memcpy(pMapped + size_t(i) * attributeStride + normalOffset, &pNormals[i], sizeof(fvec3));
+			}
+		});
+	}
+	else {
+		std::cout << "updateGpuMemoryPositions needs position and normal" << std::endl;
+		exit(1);
+	}
+}
@@ -12,17 +12,28 @@ struct BasicVertex
 	fvec3 normal;
 	fvec2 uv;
 	fvec4 color;
-	fvec4 tangent; // xyz = tangent, w = handedness (}1)
+	fvec4 tangent; // xyz = tangent, w = handedness (±1)
 	float roughness;
 };
 
+// 頂点数が 65536 以下なら 16bit インデックスで足りる
+inline Renderer::IndexType SelectIndexType(uint32_t vertexCount)
+{
+	return (vertexCount <= 0x10000) ? Renderer::IndexUint16 : Renderer::IndexUint32;
+}
+
+// position を持つ頂点型は GPU に 2 本のストリームで送る
+// binding 0 : position だけを密に詰めたもの (シャドウ・デプスパスはこれだけを読む)
+// binding 1 : 頂点から先頭の position を除いた残りの属性 (Renderer::CreateVertexAttributeLayout2 と同じ並び)
 template<class ValueType>
 class DrawVertexArray : public ValueArray<ValueType>
 {
 private:
-	GpuMemoryImpl* m_pGpuMemoryImpl = nullptr;
+	GpuMemoryImpl* m_pGpuMemoryImpl = nullptr; // position を持つ型では属性ストリーム
+	GpuMemoryImpl* m_pPositionGpuMemoryImpl = nullptr; // position ストリーム
 	bool m_isIndexBufffer = false;
 public:
+	static constexpr bool hasPositionStream = requires(ValueType v) { v.position; };
 
 	DrawVertexArray(TypeAllocator<ValueType>& alloc, bool isIndexBuffer = false)
 		: ValueArray<ValueType>(alloc), m_isIndexBufffer(isIndexBuffer)
@@ -39,12 +50,27 @@ public:
 		return sizeof(ValueType);
 	}
 
+	// インデックスバッファとして使うときの型 (uint16_t のみ 16bit)
+	static constexpr Renderer::IndexType getIndexType()
+	{
+		return (sizeof(ValueType) == 2) ? Renderer::IndexUint16 : Renderer::IndexUint32;
+	}
+
 	void gpuInitialize(RendererImpl* pRendererImpl);
 	void updateGpuMemory(RendererImpl* pRendererImpl);
+	// position と normal だけを書き換える (uv などは前に updateGpuMemory で送ったものを残す)
+	void updateGpuMemoryPositions(RendererImpl* pRendererImpl, const fvec3* pPositions, const fvec3* pNormals);
 	void draw(RendererImpl* pRendererImpl);
 
+	// position を持つ型では属性ストリーム (binding 1)
 	GpuMemoryImpl* getGpuMemoryImpl()
 	{
 		return m_pGpuMemoryImpl;
 	}
+
+	// position ストリーム (binding 0), position を持たない型では nullptr
+	GpuMemoryImpl* getPositionGpuMemoryImpl()
+	{
+		return m_pPositionGpuMemoryImpl;
+	}
 };
\ No newline at end of file
@@ -557,6 +557,13 @@ Renderer::GpuBuffer Renderer::CreateGpuBuffer(uint32_t size, Renderer::BufferCre
 	return { pGpuMemoryImpl };
 }
 
+void Renderer::DestroyGpuBuffer(GpuBuffer& gpuBuffer)
+{
+	m_pImpl->DestroyBuffer(*gpuBuffer.pGpuMemoryImpl);
+	delete gpuBuffer.pGpuMemoryImpl;
+	gpuBuffer.pGpuMemoryImpl = nullptr;
+}
+
 Renderer::GpuTexture Renderer::CreateGpuTexture(CreateImageParams& createImageParams)
 {
 	GpuTextureMemoryImpl* pGpuTextureMemoryImpl = new GpuTextureMemoryImpl();
@@ -723,6 +730,16 @@ void Renderer::TransferStagingBufferToImage(GpuBuffer& stagingBuffer, GpuTexture
 	m_pImpl->TransferStagingBufferToImage(*stagingBuffer.pGpuMemoryImpl, *textureMemory.pGpuTextureMemoryImpl);
 }
 
+void Renderer::TransferStagingBufferToImages(GpuBuffer& stagingBuffer, ValueArray<ImageUploadRegion>& regions)
+{
+	m_pImpl->TransferStagingBufferToImages(*stagingBuffer.pGpuMemoryImpl, regions.data(), regions.size());
+}
+
+bool Renderer::IsTextureCompressionBCSupported()
+{
+	return m_pImpl->isTextureCompressionBCEnabled;
+}
+
 void Renderer::Initialize(InitializeParams& initializeParams)
 {
 	const bool isDebugMode = initializeParams.isDebugMode;
@@ -1142,8 +1159,20 @@ void Renderer::Initialize(InitializeParams& initializeParams)
 	DCInfo.ppEnabledLayerNames = &LAYER_NAME;
 	DCInfo.enabledExtensionCount = deviceExtensionCount; //ここでは拡張機能は設定しない
 	DCInfo.ppEnabledExtensionNames = deviceExtensionName;
-	DCInfo.pEnabledFeatures = nullptr; //ここではオプション機能は設定しない，有効化されたオプション機能はこの変数に書き込まれる．
-	//サポートされるオプション機能についてはvkGetPhysicalDeviceFeatures()で確認できる．
+	// meshlet の indirect draw を 1 回の呼び出しで出すため multiDrawIndirect を有効にする（非対応なら 1 件ずつ発行）
+	VkPhysicalDeviceFeatures enabledFeatures = {};
+	enabledFeatures.multiDrawIndirect = pPDFs[physical_device_index].multiDrawIndirect;
+	m_pImpl->isMultiDrawIndirectEnabled = (enabledFeatures.multiDrawIndirect == VK_TRUE);
+	// 斜めから見た texture のぼけを抑えるため samplerAnisotropy を有効にする（非対応なら等方のまま）
+	enabledFeatures.samplerAnisotropy = pPDFs[physical_device_index].samplerAnisotropy;
+	m_pImpl->isSamplerAnisotropyEnabled = (enabledFeatures.samplerAnisotropy == VK_TRUE);
+	m_pImpl->maxSamplerAnisotropy = pPDPs[physical_device_index].limits.maxSamplerAnisotropy;
+	// 事前に BC 圧縮した texture を使うため textureCompressionBC を有効にする（非対応なら非圧縮の texture を使う）
+	enabledFeatures.textureCompressionBC = pPDFs[physical_device_index].textureCompressionBC;
+	m_pImpl->isTextureCompressionBCEnabled = (enabledFeatures.textureCompressionBC == VK_TRUE);
+	m_pImpl->physicalDevice = pPDs[physical_device_index];
+
+	DCInfo.pEnabledFeatures = &enabledFeatures; //サポートされるオプション機能についてはvkGetPhysicalDeviceFeatures()で確認できる．
 
 	VkDevice logicaldevice;
 	result = vkCreateDevice(pPDs[physical_device_index], &DCInfo, nullptr, &logicaldevice);
@@ -1600,9 +1629,13 @@ void Renderer::Draw(DrawParams& drawParams)
 	if (drawParams.pVertexArray != nullptr) {
 		vkCmdBindVertexBuffers(m_pImpl->CB[gpuIndex], 0, 1, &drawParams.pVertexArray->buffer, &vertexBufferOffsets);
 	}
+	for (uint32_t i = 0; i < drawParams.pAdditionalVertexArrays.size(); i++) {
+		vkCmdBindVertexBuffers(m_pImpl->CB[gpuIndex], i + 1, 1, &drawParams.pAdditionalVertexArrays[i]->buffer, &vertexBufferOffsets);
+	}
 
 	if (drawParams.pIndexArray != nullptr) {
-		vkCmdBindIndexBuffer(m_pImpl->CB[gpuIndex], drawParams.pIndexArray->buffer, 0, VkIndexType::VK_INDEX_TYPE_UINT32);
+		VkIndexType indexType = (drawParams.indexType == IndexUint16) ? VkIndexType::VK_INDEX_TYPE_UINT16 : VkIndexType::VK_INDEX_TYPE_UINT32;
+		vkCmdBindIndexBuffer(m_pImpl->CB[gpuIndex], drawParams.pIndexArray->buffer, 0, indexType);
 	}
 
 	// 動的に決める state を設定
@@ -1610,8 +1643,20 @@ void Renderer::Draw(DrawParams& drawParams)
 	vkCmdSetScissor(m_pImpl->CB[gpuIndex], 0, 1, &m_pImpl->scissor);
 
 	// draw
-	if (drawParams.pIndexArray != nullptr) {
-		vkCmdDrawIndexed(m_pImpl->CB[gpuIndex], drawParams.count, drawParams.instanceCount, 0, 0, 0);
+	if (drawParams.pIndexArray != nullptr && drawParams.pIndirectArray != nullptr) {
+		static_assert(sizeof(Renderer::DrawIndexedIndirectCommand) == sizeof(VkDrawIndexedIndirectCommand));
+		const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+		if (m_pImpl->isMultiDrawIndirectEnabled) {
+			vkCmdDrawIndexedIndirect(m_pImpl->CB[gpuIndex], drawParams.pIndirectArray->buffer, 0, drawParams.indirectDrawCount, stride);
+		}
+		else {
+			for (uint32_t i = 0; i < drawParams.indirectDrawCount; i++) {
+				vkCmdDrawIndexedIndirect(m_pImpl->CB[gpuIndex], drawParams.pIndirectArray->buffer, i * stride, 1, stride);
+			}
+		}
+	}
+	else if (drawParams.pIndexArray != nullptr) {
+		vkCmdDrawIndexed(m_pImpl->CB[gpuIndex], drawParams.count, drawParams.instanceCount, drawParams.firstIndex, 0, 0);
 	}
 	else {
 		vkCmdDraw(m_pImpl->CB[gpuIndex], drawParams.count, drawParams.instanceCount, 0, 0);
@@ -1682,10 +1727,12 @@ void Renderer::RegisterVertexInputStateImpl3(VertexAttributeLayout* vertexAttrib
 
 	m_pImpl->vertexInputStateImplMap[vertexAttributeLayout->name.data()] = pVertexInputStateImpl;
 
-	pVertexInputStateImpl->bindingDescriptions.resize(1);
-	pVertexInputStateImpl->bindingDescriptions[0].binding = vertexAttributeLayout->binding; // binding は vkCmdBindVertexBuffers の指定
-	pVertexInputStateImpl->bindingDescriptions[0].stride = vertexAttributeLayout->stride;
-	pVertexInputStateImpl->bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX; // 各頂点ごとに切り替える（インスタンスごとに切り替えることも可能）
+	pVertexInputStateImpl->bindingDescriptions.resize(vertexAttributeLayout->bindings.size());
+	for (int i = 0; i < pVertexInputStateImpl->bindingDescriptions.size(); i++) {
+		pVertexInputStateImpl->bindingDescriptions[i].binding = vertexAttributeLayout->bindings[i].binding; // binding は vkCmdBindVertexBuffers の指定
+		pVertexInputStateImpl->bindingDescriptions[i].stride = vertexAttributeLayout->bindings[i].stride;
+		pVertexInputStateImpl->bindingDescriptions[i].inputRate = VK_VERTEX_INPUT_RATE_VERTEX; // 各頂点ごとに切り替える（インスタンスごとに切り替えることも可能）
+	}
 
 	pVertexInputStateImpl->attributeDescriptions.resize(vertexAttributeLayout->attributes.size());
 	for (int i = 0; i < pVertexInputStateImpl->attributeDescriptions.size(); i++) {
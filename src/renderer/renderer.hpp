@@ -28,7 +28,13 @@ public:
 		Uniform,
 		Vertex,
 		VertexIndex,
-		Transfer
+		Transfer,
+		Indirect, // indirect draw の引数 (compute から書けるよう storage も付ける)
+	};
+
+	enum IndexType {
+		IndexUint16,
+		IndexUint32,
 	};
 
 	struct GpuBuffer {
@@ -91,6 +97,11 @@ public:
 		R32G32B32A32_FLOAT,
 		DEPTH16_UNORM,
 		DEPTH32_SFLOAT,
+		// 4x4 block 圧縮 (IsTextureCompressionBCSupported が true のときだけ使える)
+		BC1_RGBA_UNORM,
+		BC3_UNORM,
+		BC5_UNORM,
+		BC7_UNORM,
 	};
 
 
@@ -105,7 +116,7 @@ public:
 		PreInitialized,
 		DepthReadOnlyStencilAttachmentOptimal,
 		PresentSrcKHR,
-		// TODO ǉ
+		// TODO 追加
 	};
 
 	enum AttatchmentLabel {
@@ -185,13 +196,31 @@ public:
 		uint32_t width;
 		uint32_t height;
 		ImageFormat format;
+		uint32_t mipLevels = 1; // 0 なら 1x1 までの全 level を確保する
+		bool generateMips = false; // 転送時に level 0 から残りの level を GPU で縮小して作る
+		float maxAnisotropy = 1.0f; // 1 より大きければ異方性フィルタを使う (デバイスの上限に丸める)
+		float minLod = 0.0f;
+		float maxLod = 1000.0f; // VK_LOD_CLAMP_NONE
+		float mipLodBias = 0.0f;
 		bool isColorAttatchment = false;
 		bool isDepthStencilAttatchment = false;
 		bool isInputAttatchment = false;
 	};
 
+	// staging buffer の bufferOffset から texture の mipLevel へ写す範囲
+	// bufferOffset は texel の大きさ (RGBA8 なら 4, RGBA32 なら 16, BC は block の大きさ) の倍数にすること
+	struct ImageUploadRegion
+	{
+		GpuTexture texture;
+		uint32_t mipLevel;
+		uint32_t width;
+		uint32_t height;
+		uint32_t bufferOffset;
+	};
+
 
 	GpuBuffer CreateGpuBuffer(uint32_t size, BufferCreateUsage usage);
+	void DestroyGpuBuffer(GpuBuffer& gpuBuffer);
 	GpuTexture CreateGpuTexture(CreateImageParams& createImageParams);
 	GpuTexture GetRenderPassAttatchmentTexture(std::string renderPassName, Renderer::AttatchmentLabel label);
 	DescriptorSetInterface CreateDescriptorSetInterface(std::string graphicsPipelineName, int set);
@@ -202,10 +231,14 @@ public:
 	void GetCpuMemoryPointer(GpuBuffer& gpuMemory, void** ppData);
 	void UnmapCpuMemoryPointer(GpuBuffer& gpuMemoryImpl);
 	void TransferStagingBufferToImage(GpuBuffer& stagingBuffer, GpuTexture& textureMemory);
+	// 複数の texture (の各 mip) への転送を 1 回の submit にまとめる
+	void TransferStagingBufferToImages(GpuBuffer& stagingBuffer, ValueArray<ImageUploadRegion>& regions);
+	// BC1 - BC7 の texture を作れるか (textureCompressionBC)
+	bool IsTextureCompressionBCSupported();
 
 
 
-	struct DescriptorSetBindingParams // DescriptorSet Ɠ
+	struct DescriptorSetBindingParams // DescriptorSet と同じ
 	{
 		enum DescriptorType {
 			UniformBuffer_bit = 0x00000001,
@@ -226,13 +259,13 @@ public:
 		uint32_t count;
 	};
 
-	struct DescriptorSetLayoutParams // DescriptorSetLayout Ɠ
+	struct DescriptorSetLayoutParams // DescriptorSetLayout と同じ
 	{
 		ValueArray<DescriptorSetBindingParams*> descriptorSetBindingParams;
 		bool isBindless = false;
 	};
 
-	struct VertexAttributeLayout // VertexInputState Ɠ
+	struct VertexAttributeLayout // VertexInputState と同じ
 	{
 		std::string name;
 		struct Attributes {
@@ -245,13 +278,17 @@ public:
 			int binding = 0;
 		};
 
-		// Ƃ肠 binding = 0 ŌŒ
+		struct Bindings {
+		public:
+			int binding = 0; // vkCmdBindVertexBuffers の firstBinding からの位置
+			int stride = 0;
+		};
+
 		ValueArray<Attributes> attributes;
-		int stride = 0;
-		int binding = 0;
+		ValueArray<Bindings> bindings; // position ストリームと属性ストリームのように複数持てる
 	};
 
-	struct ShaderStageParams // ShaderStage Ɠ
+	struct ShaderStageParams // ShaderStage と同じ
 	{
 		std::string shaderPath = "";
 		int specializationConstantCount;
@@ -273,13 +310,13 @@ public:
 	};
 
 	struct SubpassParams {
-		std::vector<int> colorAttachments; // pXindex
-		std::vector<int> inputAttachments; // pXindex
+		std::vector<int> colorAttachments; // 特定パス内のindex
+		std::vector<int> inputAttachments; // 特定パス内のindex
 		int depthAttathment;
 	};
 
 	struct SubpassDependencyParams {
-		int srcSubpass = -1; // pXindex
+		int srcSubpass = -1; // 特定パス内のindex
 		int dstSubpass = -1;
 		PipelineStageFlagBits srcStageMask = PipelineStageFlagBits::None;
 		PipelineStageFlagBits dstStageMask = PipelineStageFlagBits::None;
@@ -298,7 +335,7 @@ public:
 		std::string clearRenderPassName = "";
 	};
 
-	struct GraphicsPipelineParams // GraphicsPipeline Ɠ
+	struct GraphicsPipelineParams // GraphicsPipeline と同じ
 	{
 		std::string name;
 		ValueArray<ShaderStageParams*> shaders;
@@ -319,52 +356,80 @@ public:
 		return VertexAttributeFormat::Error;
 	}
 
-		// TODO : vulkan ɈˑȂ
+		// TODO : vulkan に依存しない
+	// position は binding 0 (position だけのストリーム), 他は binding 1 (先頭の position を除いた属性ストリーム) から読む
+	// DrawVertexArray が GPU に送る並びと同じ
 	template <class ValueType>
 	static void SetVertexAttributeDescription2(VertexAttributeLayout* pVertexAttributeLayout)
 	{
+		static_assert(offsetof(ValueType, ValueType::position) == 0);
+		constexpr int positionSize = sizeof(decltype(ValueType::position));
+
 		pVertexAttributeLayout->attributes[0].binding = 0;
 		pVertexAttributeLayout->attributes[0].location = 0;
 		pVertexAttributeLayout->attributes[0].format = typeConverterFormat<decltype(ValueType::position)>();
-		pVertexAttributeLayout->attributes[0].offset = offsetof(ValueType, ValueType::position);
+		pVertexAttributeLayout->attributes[0].offset = 0;
 
-		pVertexAttributeLayout->attributes[1].binding = 0;
+		pVertexAttributeLayout->attributes[1].binding = 1;
 		pVertexAttributeLayout->attributes[1].location = 1;
 		pVertexAttributeLayout->attributes[1].format = typeConverterFormat<decltype(ValueType::normal)>();
-		pVertexAttributeLayout->attributes[1].offset = offsetof(ValueType, ValueType::normal);
+		pVertexAttributeLayout->attributes[1].offset = offsetof(ValueType, ValueType::normal) - positionSize;
 
-		pVertexAttributeLayout->attributes[2].binding = 0;
+		pVertexAttributeLayout->attributes[2].binding = 1;
 		pVertexAttributeLayout->attributes[2].location = 2;
 		pVertexAttributeLayout->attributes[2].format = typeConverterFormat<decltype(ValueType::color)>();
-		pVertexAttributeLayout->attributes[2].offset = offsetof(ValueType, ValueType::color);
+		pVertexAttributeLayout->attributes[2].offset = offsetof(ValueType, ValueType::color) - positionSize;
 
-		pVertexAttributeLayout->attributes[3].binding = 0;
+		pVertexAttributeLayout->attributes[3].binding = 1;
 		pVertexAttributeLayout->attributes[3].location = 3;
 		pVertexAttributeLayout->attributes[3].format = typeConverterFormat<decltype(ValueType::uv)>();
-		pVertexAttributeLayout->attributes[3].offset = offsetof(ValueType, ValueType::uv);
+		pVertexAttributeLayout->attributes[3].offset = offsetof(ValueType, ValueType::uv) - positionSize;
 
-		pVertexAttributeLayout->attributes[4].binding = 0;
+		pVertexAttributeLayout->attributes[4].binding = 1;
 		pVertexAttributeLayout->attributes[4].location = 4;
 		pVertexAttributeLayout->attributes[4].format = typeConverterFormat<decltype(ValueType::tangent)>();
-		pVertexAttributeLayout->attributes[4].offset = offsetof(ValueType, ValueType::tangent);
+		pVertexAttributeLayout->attributes[4].offset = offsetof(ValueType, ValueType::tangent) - positionSize;
 
-		pVertexAttributeLayout->attributes[5].binding = 0;
+		pVertexAttributeLayout->attributes[5].binding = 1;
 		pVertexAttributeLayout->attributes[5].location = 5;
 		pVertexAttributeLayout->attributes[5].format = typeConverterFormat<decltype(ValueType::roughness)>();
-		pVertexAttributeLayout->attributes[5].offset = offsetof(ValueType, ValueType::roughness);
+		pVertexAttributeLayout->attributes[5].offset = offsetof(ValueType, ValueType::roughness) - positionSize;
 	}
 
 	template <class ValueType>
 	static void CreateVertexAttributeLayout2(VertexAttributeLayout* pVertexAttributeLayout)
 	{
 		pVertexAttributeLayout->name = typeid(ValueType).name();
-		pVertexAttributeLayout->binding = 0; // binding  vkCmdBindVertexBuffers ̎w
-		pVertexAttributeLayout->stride = sizeof(ValueType);
+
+		constexpr int positionSize = sizeof(decltype(ValueType::position));
+		pVertexAttributeLayout->bindings.resize(2);
+		pVertexAttributeLayout->bindings[0].binding = 0; // binding は vkCmdBindVertexBuffers の指定
+		pVertexAttributeLayout->bindings[0].stride = positionSize;
+		pVertexAttributeLayout->bindings[1].binding = 1;
+		pVertexAttributeLayout->bindings[1].stride = sizeof(ValueType) - positionSize;
 
 		pVertexAttributeLayout->attributes.resize(6);
 		SetVertexAttributeDescription2<ValueType>(pVertexAttributeLayout);
 	}
 
+	// シャドウ・デプスパス用：密に詰めた position ストリームだけを binding 0 で読む
+	// CreateVertexAttributeLayout2 の binding 0 と同じなので、同じ DrawVertexArray の position ストリーム (getPositionGpuMemoryImpl) をそのまま使える
+	template <class ValueType>
+	static void CreatePositionOnlyVertexAttributeLayout(VertexAttributeLayout* pVertexAttributeLayout)
+	{
+		pVertexAttributeLayout->name = std::string(typeid(ValueType).name()) + "_PositionOnly";
+
+		pVertexAttributeLayout->bindings.resize(1);
+		pVertexAttributeLayout->bindings[0].binding = 0;
+		pVertexAttributeLayout->bindings[0].stride = sizeof(decltype(ValueType::position));
+
+		pVertexAttributeLayout->attributes.resize(1);
+		pVertexAttributeLayout->attributes[0].binding = 0;
+		pVertexAttributeLayout->attributes[0].location = 0;
+		pVertexAttributeLayout->attributes[0].format = typeConverterFormat<decltype(ValueType::position)>();
+		pVertexAttributeLayout->attributes[0].offset = 0;
+	}
+
 	void RegisterVertexInputStateImpl3(VertexAttributeLayout* vertexAttributeLayout);
 
 	class InitializeParams {
@@ -383,7 +448,7 @@ public:
 	template <class ValueType>
 	void InitializeVertexArray(DrawVertexArray<ValueType>* pDrawArray)
 	{
-		// drawArray.cpp ɎȂƑʖ
+		// drawArray.cpp に実装しないと駄目
 		pDrawArray->gpuInitialize(m_pImpl);
 	}
 
@@ -393,10 +458,18 @@ public:
 	template <class ValueType>
 	void UpdateVertexArray(DrawVertexArray<ValueType>* pDrawArray)
 	{
-		// drawArray.cpp ɎȂƑʖ
+		// drawArray.cpp に実装しないと駄目
 		pDrawArray->updateGpuMemory(m_pImpl);
 	}
 
+	// 頂点数と接続が変わらない mesh (MeshSequence の再生など) の position と normal だけを送る
+	template <class ValueType>
+	void UpdateVertexArrayPositions(DrawVertexArray<ValueType>* pDrawArray, const fvec3* pPositions, const fvec3* pNormals)
+	{
+		// drawArray.cpp に実装しないと駄目
+		pDrawArray->updateGpuMemoryPositions(m_pImpl, pPositions, pNormals);
+	}
+
 	class UpdatePushConstantParams
 	{
 	public:
@@ -424,12 +497,26 @@ public:
 		std::vector<ClearColorValue> clearColorValues;
 	};
 
+	// VkDrawIndexedIndirectCommand と同じレイアウト
+	struct DrawIndexedIndirectCommand {
+		uint32_t indexCount;
+		uint32_t instanceCount;
+		uint32_t firstIndex;
+		int32_t vertexOffset;
+		uint32_t firstInstance;
+	};
+
 	class DrawParams {
 	public:
-		GpuMemoryImpl* pVertexArray;
+		GpuMemoryImpl* pVertexArray; // binding 0 に bind する頂点ストリーム (position を持つ頂点では position ストリーム)
 		uint32_t count; // index or vertex 
+		uint32_t firstIndex = 0; // LOD など index buffer の一部を描くときの開始位置
 		uint32_t instanceCount;
 		GpuMemoryImpl* pIndexArray;
+		IndexType indexType = IndexUint32; // pIndexArray の要素型
+		std::vector<GpuMemoryImpl*> pAdditionalVertexArrays; // binding 1 以降に bind する頂点ストリーム (position 以外の属性ストリームなど)
+		GpuMemoryImpl* pIndirectArray = nullptr; // nullptr でなければ DrawIndexedIndirectCommand の配列で描く (count は無視)
+		uint32_t indirectDrawCount = 0;
 		std::vector<DescriptorSetInterface> descriptorSetInterfaces;
 		std::string graphicsPipelineName;
 	};
@@ -5,6 +5,7 @@
 #include <GLFW/glfw3.h>
 
 #include <unordered_map>
+#include <algorithm>
 #include <cassert>
 
 #include "src/renderer/mesh/drawArray.hpp"
@@ -57,6 +58,14 @@ inline VkFormat ConvertImageFormat(Renderer::ImageFormat format, VkFormat swapCh
 		return VK_FORMAT_D16_UNORM;
 	case Renderer::DEPTH32_SFLOAT:
 		return VK_FORMAT_D32_SFLOAT;
+	case Renderer::BC1_RGBA_UNORM:
+		return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+	case Renderer::BC3_UNORM:
+		return VK_FORMAT_BC3_UNORM_BLOCK;
+	case Renderer::BC5_UNORM:
+		return VK_FORMAT_BC5_UNORM_BLOCK;
+	case Renderer::BC7_UNORM:
+		return VK_FORMAT_BC7_UNORM_BLOCK;
 	default:
 		assert(false);
 		return VK_FORMAT_UNDEFINED;
@@ -176,7 +185,12 @@ public:
 	std::unordered_map<std::string, RenderPassImpl*> renderPassImpl;
 	std::unordered_map<std::string, std::vector<DescriptorSetImpl*>> descriptorSetImplMap;
 
+	VkPhysicalDevice physicalDevice;
 	VkDevice logicalDevice;
+	bool isMultiDrawIndirectEnabled = false;
+	bool isSamplerAnisotropyEnabled = false;
+	bool isTextureCompressionBCEnabled = false;
+	float maxSamplerAnisotropy = 1.0f;
 	uint32_t memory_type_index;
 	uint32_t memory_type_index_host_local;
 
@@ -197,6 +211,9 @@ public:
 		case Renderer::BufferCreateUsage::Transfer:
 			usageFlag = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
 			break;
+		case Renderer::BufferCreateUsage::Indirect:
+			usageFlag = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+			break;
 		}
 
 		VkBufferCreateInfo uboBufferCreateInfo;
@@ -264,12 +281,53 @@ public:
 	{
 		gpuTextureMemoryImpl.width = createImageParams.width;
 		gpuTextureMemoryImpl.height = createImageParams.height;
+		gpuTextureMemoryImpl.mipLevels = createImageParams.mipLevels;
+		gpuTextureMemoryImpl.generateMips = createImageParams.generateMips;
+		gpuTextureMemoryImpl.maxAnisotropy = createImageParams.maxAnisotropy;
+		gpuTextureMemoryImpl.minLod = createImageParams.minLod;
+		gpuTextureMemoryImpl.maxLod = createImageParams.maxLod;
+		gpuTextureMemoryImpl.mipLodBias = createImageParams.mipLodBias;
 
 		VkFormat vkFormat;
 		VkImageUsageFlags usageFlag = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 
 		vkFormat = ConvertImageFormat(createImageParams.format, VK_FORMAT_UNDEFINED);
 
+		if (!isTextureCompressionBCEnabled && createImageParams.format >= Renderer::ImageFormat::BC1_RGBA_UNORM && createImageParams.format <= Renderer::ImageFormat::BC7_UNORM)
+		{
+			std::cout << "textureCompressionBC is not supported on this device!!!" << std::endl;
+			exit(1);
+		}
+
+		if (gpuTextureMemoryImpl.mipLevels == 0)
+		{
+			gpuTextureMemoryImpl.mipLevels = 1;
+			for (uint32_t size = std::max(createImageParams.width, createImageParams.height); size > 1; size /= 2)
+				gpuTextureMemoryImpl.mipLevels++;
+		}
+
+		if (gpuTextureMemoryImpl.generateMips && gpuTextureMemoryImpl.mipLevels > 1)
+		{
+			// vkCmdBlitImage の線形補間による縮小には format の対応が必要
+			VkFormatProperties formatProperties;
+			vkGetPhysicalDeviceFormatProperties(physicalDevice, vkFormat, &formatProperties);
+			constexpr VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+			if ((formatProperties.optimalTilingFeatures & requiredFeatures) == requiredFeatures)
+			{
+				usageFlag |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+			}
+			else
+			{
+				std::cout << "this format does not support linear blit. mipmap is not generated." << std::endl;
+				gpuTextureMemoryImpl.generateMips = false;
+				gpuTextureMemoryImpl.mipLevels = 1;
+			}
+		}
+		else
+		{
+			gpuTextureMemoryImpl.generateMips = false;
+		}
+
 		if (createImageParams.isInputAttatchment)
 		{
 			usageFlag |= VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
@@ -289,7 +347,7 @@ public:
 		imageCreateInfo.extent.width = createImageParams.width;
 		imageCreateInfo.extent.height = createImageParams.height;
 		imageCreateInfo.extent.depth = 1;
-		imageCreateInfo.mipLevels = 1;
+		imageCreateInfo.mipLevels = gpuTextureMemoryImpl.mipLevels;
 		imageCreateInfo.arrayLayers = 1;
 		imageCreateInfo.format = vkFormat;
 		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
@@ -339,7 +397,7 @@ public:
 		textureImageVCI.format = vkFormat;
 		textureImageVCI.subresourceRange.aspectMask = aspectMask;
 		textureImageVCI.subresourceRange.baseMipLevel = 0;
-		textureImageVCI.subresourceRange.levelCount = 1;
+		textureImageVCI.subresourceRange.levelCount = gpuTextureMemoryImpl.mipLevels;
 		textureImageVCI.subresourceRange.baseArrayLayer = 0;
 		textureImageVCI.subresourceRange.layerCount = 1;
 
@@ -359,6 +417,16 @@ public:
 		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
 		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
 		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+		samplerInfo.minLod = gpuTextureMemoryImpl.minLod;
+		samplerInfo.maxLod = gpuTextureMemoryImpl.maxLod;
+		samplerInfo.mipLodBias = gpuTextureMemoryImpl.mipLodBias;
+		// samplerAnisotropy が有効なときだけ使える
+		if (isSamplerAnisotropyEnabled && gpuTextureMemoryImpl.maxAnisotropy > 1.0f)
+		{
+			samplerInfo.anisotropyEnable = VK_TRUE;
+			samplerInfo.maxAnisotropy = std::min(gpuTextureMemoryImpl.maxAnisotropy, maxSamplerAnisotropy);
+		}
 		VkResult result = vkCreateSampler(logicalDevice, &samplerInfo, nullptr, &gpuTextureMemoryImpl.sampler);
 		if (result != VK_SUCCESS)
 		{
@@ -366,6 +434,70 @@ public:
 		}
 	}
 
+	// 全 level が TRANSFER_DST_OPTIMAL で level 0 が転送済みの texture について、
+	// level - 1 を線形補間で半分に縮小して level を作り、全 level を SHADER_READ_ONLY_OPTIMAL にする
+	void CmdGenerateMips(VkCommandBuffer commandBuffer, GpuTextureMemoryImpl& textureMemory)
+	{
+		VkImageMemoryBarrier memoryBarrier{};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		memoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		memoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		memoryBarrier.image = textureMemory.image;
+		memoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		memoryBarrier.subresourceRange.levelCount = 1;
+		memoryBarrier.subresourceRange.layerCount = 1;
+		memoryBarrier.subresourceRange.baseArrayLayer = 0;
+
+		int32_t width = int32_t(textureMemory.width);
+		int32_t height = int32_t(textureMemory.height);
+		for (uint32_t level = 1; level < textureMemory.mipLevels; level++)
+		{
+			// 縮小元の level を転送元にする
+			memoryBarrier.subresourceRange.baseMipLevel = level - 1;
+			memoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			memoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &memoryBarrier);
+
+			const int32_t nextWidth = std::max(width / 2, 1);
+			const int32_t nextHeight = std::max(height / 2, 1);
+
+			VkImageBlit blit = {};
+			blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			blit.srcSubresource.mipLevel = level - 1;
+			blit.srcSubresource.baseArrayLayer = 0;
+			blit.srcSubresource.layerCount = 1;
+			blit.srcOffsets[0] = { 0,0,0 };
+			blit.srcOffsets[1] = { width,height,1 };
+			blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			blit.dstSubresource.mipLevel = level;
+			blit.dstSubresource.baseArrayLayer = 0;
+			blit.dstSubresource.layerCount = 1;
+			blit.dstOffsets[0] = { 0,0,0 };
+			blit.dstOffsets[1] = { nextWidth,nextHeight,1 };
+			vkCmdBlitImage(commandBuffer, textureMemory.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, textureMemory.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+			// 縮小元はもう書き換えないので shader から読めるようにする
+			memoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			memoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &memoryBarrier);
+
+			width = nextWidth;
+			height = nextHeight;
+		}
+
+		// 最後の level は縮小元にならない
+		memoryBarrier.subresourceRange.baseMipLevel = textureMemory.mipLevels - 1;
+		memoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		memoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &memoryBarrier);
+	}
+
 	void TransferStagingBufferToImage(GpuMemoryImpl& stagingBufferMemory, GpuTextureMemoryImpl& textureMemory)
 	{
 		// GPU で転送
@@ -387,7 +519,7 @@ public:
 		memoryBarrier.image = textureMemory.image;
 		memoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		memoryBarrier.subresourceRange.baseMipLevel = 0;
-		memoryBarrier.subresourceRange.levelCount = 1;
+		memoryBarrier.subresourceRange.levelCount = textureMemory.mipLevels;
 		memoryBarrier.subresourceRange.layerCount = 1;
 		memoryBarrier.subresourceRange.baseArrayLayer = 0;
 		memoryBarrier.srcAccessMask = 0;
@@ -410,12 +542,19 @@ public:
 		vkCmdCopyBufferToImage(CB[0], stagingBufferMemory.buffer, textureMemory.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageCopy);
 
 
-		memoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-		memoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		if (textureMemory.generateMips)
+		{
+			CmdGenerateMips(CB[0], textureMemory);
+		}
+		else
+		{
+			memoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			memoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-		vkCmdPipelineBarrier(CB[0], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &memoryBarrier);
+			vkCmdPipelineBarrier(CB[0], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &memoryBarrier);
+		}
 
 
 		vkEndCommandBuffer(CB[0]);
@@ -431,4 +570,97 @@ public:
 
 	}
 
+	void TransferStagingBufferToImages(GpuMemoryImpl& stagingBufferMemory, Renderer::ImageUploadRegion* pRegions, uint32_t regionCount)
+	{
+		// 全 texture の layout 変更と copy を 1 つの command buffer に積み、submit と待ちを 1 回にする
+		// generateMips の texture は level 0 だけ転送すれば残りは GPU で作る
+
+		std::vector<GpuTextureMemoryImpl*> textures;
+		std::vector<VkImageMemoryBarrier> barriers;
+		for (uint32_t i = 0; i < regionCount; i++) {
+			GpuTextureMemoryImpl* pTexture = pRegions[i].texture.pGpuTextureMemoryImpl;
+			if (std::find(textures.begin(), textures.end(), pTexture) != textures.end())
+				continue;
+			textures.push_back(pTexture);
+
+			VkImageMemoryBarrier memoryBarrier{};
+			memoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			memoryBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			memoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			memoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			memoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			memoryBarrier.image = pTexture->image;
+			memoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			memoryBarrier.subresourceRange.baseMipLevel = 0;
+			memoryBarrier.subresourceRange.levelCount = pTexture->mipLevels;
+			memoryBarrier.subresourceRange.layerCount = 1;
+			memoryBarrier.subresourceRange.baseArrayLayer = 0;
+			memoryBarrier.srcAccessMask = 0;
+			memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barriers.push_back(memoryBarrier);
+		}
+
+		VkCommandBufferBeginInfo textureCBBI = {};
+		textureCBBI.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		textureCBBI.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		vkBeginCommandBuffer(CB[0], &textureCBBI);
+
+		vkCmdPipelineBarrier(CB[0], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, uint32_t(barriers.size()), barriers.data());
+
+		for (uint32_t i = 0; i < regionCount; i++) {
+			const Renderer::ImageUploadRegion& region = pRegions[i];
+
+			VkBufferImageCopy imageCopy = {};
+			imageCopy.bufferOffset = region.bufferOffset;
+			imageCopy.bufferRowLength = 0;
+			imageCopy.bufferImageHeight = 0;
+			imageCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			imageCopy.imageSubresource.mipLevel = region.mipLevel;
+			imageCopy.imageSubresource.baseArrayLayer = 0;
+			imageCopy.imageSubresource.layerCount = 1;
+			imageCopy.imageOffset = { 0,0,0 };
+			imageCopy.imageExtent = { region.width, region.height, 1 };
+
+			vkCmdCopyBufferToImage(CB[0], stagingBufferMemory.buffer, region.texture.pGpuTextureMemoryImpl->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageCopy);
+		}
+
+		std::vector<VkImageMemoryBarrier> readBarriers;
+		for (uint32_t i = 0; i < textures.size(); i++) {
+			if (textures[i]->generateMips) {
+				CmdGenerateMips(CB[0], *textures[i]);
+				continue;
+			}
+
+			VkImageMemoryBarrier memoryBarrier = barriers[i];
+			memoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			memoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			readBarriers.push_back(memoryBarrier);
+		}
+
+		if (!readBarriers.empty())
+			vkCmdPipelineBarrier(CB[0], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, uint32_t(readBarriers.size()), readBarriers.data());
+
+		vkEndCommandBuffer(CB[0]);
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &CB[0];
+
+		vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+
+		vkQueueWaitIdle(queue);
+	}
+
+	void DestroyBuffer(GpuMemoryImpl& gpuMemoryImpl)
+	{
+		vkDestroyBuffer(logicalDevice, gpuMemoryImpl.buffer, nullptr);
+		vkFreeMemory(logicalDevice, gpuMemoryImpl.deviceMemory, nullptr);
+		gpuMemoryImpl.buffer = VK_NULL_HANDLE;
+		gpuMemoryImpl.deviceMemory = VK_NULL_HANDLE;
+	}
+
 };
\ No newline at end of file
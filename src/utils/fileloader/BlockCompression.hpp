@@ -0,0 +1,753 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include "src/utils/fileloader/ImageData.hpp"
+#include "src/utils/thread/parallelFor.hpp"
+#include "src/utils/mathfunc/mathSimd.hpp"
+
+// BC1 / BC3 / BC5 / BC7 の CPU encoder と decoder
+// encoder は 4x4 block ごとに、主成分方向の両端を端点の初期値として index を決め、
+// その index に対する最小二乗で端点を取り直すのを数回繰り返す
+// BC7 は mode 6 (1 subset, RGBA 7bit + p bit, 4bit index) だけを使う
+// decoder は encoder の確認用なので、BC7 は mode 6 の block しか展開できない
+// 一番時間のかかる index の選択は 16 texel を SimdFloat8 2 本に並べて palette の各色と一度に比べる (BCSelectIndices)
+// 値は全て 2^24 未満の整数なので float で計算しても整数で計算したのと結果は一致する
+
+// count 個の点の平均と主成分方向 (単位ベクトル, 分散が無ければ 0) を power iteration で求める
+template <uint32_t N>
+void BCPrincipalAxis(const float (*points)[N], const uint32_t& count, float (&mean)[N], float (&axis)[N])
+{
+	for (uint32_t c = 0; c < N; c++) {
+		mean[c] = 0.0f;
+		for (uint32_t i = 0; i < count; i++)
+			mean[c] += points[i][c];
+		mean[c] /= float(count);
+	}
+
+	float covariance[N][N] = {};
+	for (uint32_t i = 0; i < count; i++) {
+		for (uint32_t a = 0; a < N; a++) {
+			for (uint32_t b = 0; b < N; b++)
+				covariance[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+		}
+	}
+
+	// 分散が一番大きい軸の列から始める
+	uint32_t largest = 0;
+	for (uint32_t c = 1; c < N; c++) {
+		if (covariance[c][c] > covariance[largest][largest])
+			largest = c;
+	}
+	for (uint32_t c = 0; c < N; c++)
+		axis[c] = covariance[largest][c];
+
+	for (uint32_t iteration = 0; iteration < 8; iteration++) {
+		float next[N] = {};
+		float maxValue = 0.0f;
+		for (uint32_t a = 0; a < N; a++) {
+			for (uint32_t b = 0; b < N; b++)
+				next[a] += covariance[a][b] * axis[b];
+			maxValue = std::max(maxValue, std::abs(next[a]));
+		}
+		if (maxValue == 0.0f)
+			break;
+		for (uint32_t c = 0; c < N; c++)
+			axis[c] = next[c] / maxValue;
+	}
+
+	float length = 0.0f;
+	for (uint32_t c = 0; c < N; c++)
+		length += axis[c] * axis[c];
+	length = std::sqrt(length);
+	for (uint32_t c = 0; c < N; c++)
+		axis[c] = (length > 0.0f) ? axis[c] / length : 0.0f;
+}
+
+// 点を主成分方向に射影したときの両端を端点にする
+template <uint32_t N>
+void BCInitialEndpoints(const float (*points)[N], const uint32_t& count, float (&endpoint0)[N], float (&endpoint1)[N])
+{
+	float mean[N];
+	float axis[N];
+	BCPrincipalAxis(points, count, mean, axis);
+
+	float minT = 0.0f;
+	float maxT = 0.0f;
+	for (uint32_t i = 0; i < count; i++) {
+		float t = 0.0f;
+		for (uint32_t c = 0; c < N; c++)
+			t += (points[i][c] - mean[c]) * axis[c];
+		minT = std::min(minT, t);
+		maxT = std::max(maxT, t);
+	}
+
+	for (uint32_t c = 0; c < N; c++) {
+		endpoint0[c] = std::clamp(mean[c] + minT * axis[c], 0.0f, 255.0f);
+		endpoint1[c] = std::clamp(mean[c] + maxT * axis[c], 0.0f, 255.0f);
+	}
+}
+
+// index ごとの補間係数 weights[index] (0 : endpoint0, 1 : endpoint1) を固定したときの最小二乗の端点
+// 解けない (全 texel が同じ index) ときは false
+template <uint32_t N>
+bool BCFitEndpoints(const float (*points)[N], const uint32_t& count, const uint8_t* indices, const float* weights, float (&endpoint0)[N], float (&endpoint1)[N])
+{
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+	float ax[N] = {};
+	float bx[N] = {};
+	for (uint32_t i = 0; i < count; i++) {
+		const float t = weights[indices[i]];
+		const float s = 1.0f - t;
+		aa += s * s;
+		ab += s * t;
+		bb += t * t;
+		for (uint32_t c = 0; c < N; c++) {
+			ax[c] += s * points[i][c];
+			bx[c] += t * points[i][c];
+		}
+	}
+
+	const float det = aa * bb - ab * ab;
+	if (std::abs(det) < 1e-6f)
+		return false;
+
+	for (uint32_t c = 0; c < N; c++) {
+		endpoint0[c] = std::clamp((bb * ax[c] - ab * bx[c]) / det, 0.0f, 255.0f);
+		endpoint1[c] = std::clamp((aa * bx[c] - ab * ax[c]) / det, 0.0f, 255.0f);
+	}
+	return true;
+}
+
+// count 個の点を channel ごとに 16 lane (SimdFloat8 2 本, texel 0-7 と 8-15) に並べる (count 以降の lane は 0)
+template <uint32_t N>
+inline void BCLoadPoints(const float (*points)[N], const uint32_t& count, SimdFloat8 (&lanes)[N][2])
+{
+	float channel[N][16] = {};
+	for (uint32_t i = 0; i < count; i++) {
+		for (uint32_t c = 0; c < N; c++)
+			channel[c][i] = points[i][c];
+	}
+	for (uint32_t c = 0; c < N; c++) {
+		lanes[c][0] = SimdLoad8(channel[c]);
+		lanes[c][1] = SimdLoad8(channel[c] + 8);
+	}
+}
+
+// 16 texel それぞれについて palette の中で一番近い entry の index と距離の 2 乗を求める
+// 距離が同じなら小さい index にする (k の順に < で比べるのと同じ)
+// nearest (texel ごとの index) を渡すと nearest - 1 から nearest + 1 の entry だけを比べる
+// このときは texel ごとに entry が違うので、3 つの候補の値を lane ごとに集めてから比べる
+template <uint32_t N>
+inline void BCSelectIndices(const SimdFloat8 (&points)[N][2], const int32_t (*palette)[N], const uint32_t& paletteCount, const uint8_t* nearest, uint8_t (&indices)[16], int32_t (&distances)[16])
+{
+	for (uint32_t h = 0; h < 2; h++) {
+		SimdFloat8 bestDistance = SimdSplat8(FLT_MAX);
+		SimdFloat8 bestIndex = SimdSplat8(0.0f);
+		auto Compare = [&](const SimdFloat8 (&entry)[N], const SimdFloat8& index) {
+			SimdFloat8 distance = SimdSplat8(0.0f);
+			for (uint32_t c = 0; c < N; c++) {
+				const SimdFloat8 d = SimdSub8(entry[c], points[c][h]);
+				distance = SimdAdd8(distance, SimdMul8(d, d));
+			}
+			const SimdFloat8 isCloser = SimdLess8(distance, bestDistance);
+			bestDistance = SimdSelect8(isCloser, distance, bestDistance);
+			bestIndex = SimdSelect8(isCloser, index, bestIndex);
+		};
+
+		if (nearest) {
+			// 端の index では候補が重なるが、同じ距離は < で弾かれるので結果は変わらない
+			for (int32_t offset = -1; offset <= 1; offset++) {
+				uint32_t k[8];
+				for (uint32_t l = 0; l < 8; l++)
+					k[l] = uint32_t(std::clamp(int32_t(nearest[8 * h + l]) + offset, 0, int32_t(paletteCount) - 1));
+				SimdFloat8 entry[N];
+				for (uint32_t c = 0; c < N; c++)
+					entry[c] = SimdSet8(float(palette[k[0]][c]), float(palette[k[1]][c]), float(palette[k[2]][c]), float(palette[k[3]][c]), float(palette[k[4]][c]), float(palette[k[5]][c]), float(palette[k[6]][c]), float(palette[k[7]][c]));
+				Compare(entry, SimdSet8(float(k[0]), float(k[1]), float(k[2]), float(k[3]), float(k[4]), float(k[5]), float(k[6]), float(k[7])));
+			}
+		}
+		else {
+			for (uint32_t k = 0; k < paletteCount; k++) {
+				SimdFloat8 entry[N];
+				for (uint32_t c = 0; c < N; c++)
+					entry[c] = SimdSplat8(float(palette[k][c]));
+				Compare(entry, SimdSplat8(float(k)));
+			}
+		}
+
+		float laneDistances[8];
+		float laneIndices[8];
+		SimdStore8(laneDistances, bestDistance);
+		SimdStore8(laneIndices, bestIndex);
+		for (uint32_t l = 0; l < 8; l++) {
+			indices[8 * h + l] = uint8_t(laneIndices[l]);
+			distances[8 * h + l] = int32_t(laneDistances[l]);
+		}
+	}
+}
+
+inline uint16_t BCPackRGB565(const float (&color)[3])
+{
+	const uint32_t r = uint32_t(std::clamp(color[0] * (31.0f / 255.0f) + 0.5f, 0.0f, 31.0f));
+	const uint32_t g = uint32_t(std::clamp(color[1] * (63.0f / 255.0f) + 0.5f, 0.0f, 63.0f));
+	const uint32_t b = uint32_t(std::clamp(color[2] * (31.0f / 255.0f) + 0.5f, 0.0f, 31.0f));
+	return uint16_t((r << 11) | (g << 5) | b);
+}
+
+inline void BCUnpackRGB565(const uint16_t& value, int32_t (&color)[3])
+{
+	const int32_t r = (value >> 11) & 31;
+	const int32_t g = (value >> 5) & 63;
+	const int32_t b = value & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+// BC1 の 4 色 (isFourColor) または 3 色 + 透明の palette
+inline void BCColorPalette(const uint16_t& color0, const uint16_t& color1, const bool& isFourColor, int32_t (&palette)[4][3])
+{
+	BCUnpackRGB565(color0, palette[0]);
+	BCUnpackRGB565(color1, palette[1]);
+	for (uint32_t c = 0; c < 3; c++) {
+		if (isFourColor) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+		}
+		else {
+			palette[2][c] = (palette[0][c] + palette[1][c] + 1) / 2;
+			palette[3][c] = 0;
+		}
+	}
+}
+
+inline void BCWriteUint16(uint8_t* p, const uint16_t& value)
+{
+	p[0] = uint8_t(value);
+	p[1] = uint8_t(value >> 8);
+}
+
+inline uint16_t BCReadUint16(const uint8_t* p)
+{
+	return uint16_t(p[0] | (p[1] << 8));
+}
+
+// BC1 (BC3 の色部分) の 8 byte を書く
+// allowPunchThrough のとき alpha < 128 の texel があれば 3 色 + 透明の mode にする
+// BC3 の色部分は常に 4 色として解釈されるので allowPunchThrough = false で呼ぶ
+void EncodeBC1Block(const uint8_t (&texels)[16][4], uint8_t* block, const bool& allowPunchThrough)
+{
+	float points[16][3];
+	uint32_t pointTexel[16];
+	uint32_t count = 0;
+	bool hasTransparent = false;
+	for (uint32_t i = 0; i < 16; i++) {
+		if (allowPunchThrough && texels[i][3] < 128) {
+			hasTransparent = true;
+			continue;
+		}
+		for (uint32_t c = 0; c < 3; c++)
+			points[count][c] = texels[i][c];
+		pointTexel[count] = i;
+		count++;
+	}
+
+	if (count == 0) {
+		// 全て透明
+		BCWriteUint16(block + 0, 0);
+		BCWriteUint16(block + 2, 0);
+		std::memset(block + 4, 0xFF, 4);
+		return;
+	}
+
+	const bool isFourColor = !hasTransparent;
+	// palette の index に対する endpoint1 側の重み
+	const float fourColorWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+	const float threeColorWeights[4] = { 0.0f, 1.0f, 0.5f, 0.0f };
+	const float* weights = isFourColor ? fourColorWeights : threeColorWeights;
+
+	float endpoint0[3];
+	float endpoint1[3];
+	BCInitialEndpoints(points, count, endpoint0, endpoint1);
+
+	SimdFloat8 pointLanes[3][2];
+	BCLoadPoints(points, count, pointLanes);
+
+	uint16_t bestColor0 = 0;
+	uint16_t bestColor1 = 0;
+	uint8_t bestIndices[16] = {};
+	int32_t bestError = INT32_MAX;
+
+	for (uint32_t iteration = 0; iteration < 3; iteration++) {
+		uint16_t color0 = BCPackRGB565(endpoint0);
+		uint16_t color1 = BCPackRGB565(endpoint1);
+		// 4 色 mode は color0 > color1, 3 色 mode は color0 <= color1 で区別される
+		if ((isFourColor && color0 < color1) || (!isFourColor && color0 > color1)) {
+			std::swap(color0, color1);
+			std::swap(endpoint0, endpoint1);
+		}
+
+		// 4 色 mode で color0 == color1 になったときは 3 色 mode として解釈される (3 色とも同じ色)
+		int32_t palette[4][3];
+		BCColorPalette(color0, color1, color0 > color1, palette);
+		const uint32_t paletteCount = (color0 > color1) ? 4 : 3;
+
+		uint8_t indices[16];
+		int32_t distances[16];
+		BCSelectIndices(pointLanes, palette, paletteCount, nullptr, indices, distances);
+		int32_t error = 0;
+		for (uint32_t i = 0; i < count; i++)
+			error += distances[i];
+
+		if (error < bestError) {
+			bestError = error;
+			bestColor0 = color0;
+			bestColor1 = color1;
+			std::memcpy(bestIndices, indices, sizeof(indices));
+		}
+		if (error == 0 || color0 == color1)
+			break;
+
+		if (!BCFitEndpoints(points, count, indices, weights, endpoint0, endpoint1))
+			break;
+	}
+
+	uint32_t packedIndices = 0;
+	for (uint32_t i = 0; i < 16; i++) {
+		// 透明の texel は index 3
+		if (hasTransparent)
+			packedIndices |= 3u << (2 * i);
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		packedIndices &= ~(3u << (2 * pointTexel[i]));
+		packedIndices |= uint32_t(bestIndices[i]) << (2 * pointTexel[i]);
+	}
+
+	BCWriteUint16(block + 0, bestColor0);
+	BCWriteUint16(block + 2, bestColor1);
+	for (uint32_t i = 0; i < 4; i++)
+		block[4 + i] = uint8_t(packedIndices >> (8 * i));
+}
+
+// BC4 の 8 値 (value0 > value1) または 6 値 + 0 + 255 の palette
+inline void BCAlphaPalette(const uint8_t& value0, const uint8_t& value1, int32_t (&palette)[8])
+{
+	palette[0] = value0;
+	palette[1] = value1;
+	if (value0 > value1) {
+		for (int32_t k = 1; k < 7; k++)
+			palette[k + 1] = ((7 - k) * value0 + k * value1 + 3) / 7;
+	}
+	else {
+		for (int32_t k = 1; k < 5; k++)
+			palette[k + 1] = ((5 - k) * value0 + k * value1 + 2) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+// 1 channel の 16 texel を BC4 (BC3 の alpha, BC5 の各 channel) の 8 byte にする
+// 最小値と最大値を端点にした 8 値 mode と、0 と 255 を除いた範囲を端点にした 6 値 mode の誤差が小さい方を使う
+void EncodeBC4Block(const uint8_t (&values)[16], uint8_t* block)
+{
+	uint8_t minValue = 255, maxValue = 0;
+	uint8_t minInner = 255, maxInner = 0;
+	for (uint32_t i = 0; i < 16; i++) {
+		minValue = std::min(minValue, values[i]);
+		maxValue = std::max(maxValue, values[i]);
+		if (values[i] != 0 && values[i] != 255) {
+			minInner = std::min(minInner, values[i]);
+			maxInner = std::max(maxInner, values[i]);
+		}
+	}
+
+	float points[16][1];
+	for (uint32_t i = 0; i < 16; i++)
+		points[i][0] = values[i];
+	SimdFloat8 pointLanes[1][2];
+	BCLoadPoints(points, 16, pointLanes);
+
+	auto Evaluate = [&pointLanes](const uint8_t& value0, const uint8_t& value1, uint8_t (&indices)[16]) {
+		int32_t alphaPalette[8];
+		BCAlphaPalette(value0, value1, alphaPalette);
+		int32_t palette[8][1];
+		for (uint32_t k = 0; k < 8; k++)
+			palette[k][0] = alphaPalette[k];
+		int32_t distances[16];
+		BCSelectIndices(pointLanes, palette, 8, nullptr, indices, distances);
+		int32_t error = 0;
+		for (uint32_t i = 0; i < 16; i++)
+			error += distances[i];
+		return error;
+	};
+
+	uint8_t value0 = maxValue;
+	uint8_t value1 = minValue;
+	uint8_t indices[16];
+	int32_t error = Evaluate(value0, value1, indices);
+
+	if (error > 0 && minInner <= maxInner) {
+		uint8_t innerIndices[16];
+		const int32_t innerError = Evaluate(minInner, maxInner, innerIndices);
+		if (innerError < error) {
+			value0 = minInner;
+			value1 = maxInner;
+			std::memcpy(indices, innerIndices, sizeof(indices));
+		}
+	}
+
+	uint64_t packedIndices = 0;
+	for (uint32_t i = 0; i < 16; i++)
+		packedIndices |= uint64_t(indices[i]) << (3 * i);
+
+	block[0] = value0;
+	block[1] = value1;
+	for (uint32_t i = 0; i < 6; i++)
+		block[2 + i] = uint8_t(packedIndices >> (8 * i));
+}
+
+// BC7 mode 6 の 4bit index の補間係数 (/64)
+constexpr int32_t BC7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// BC7 の 128bit を下位 bit から順に読み書きする
+struct BC7BitStream {
+	uint8_t* data;
+	uint32_t position = 0;
+
+	void Write(const uint32_t& value, const uint32_t& bitCount)
+	{
+		for (uint32_t i = 0; i < bitCount; i++, position++) {
+			if ((value >> i) & 1)
+				data[position / 8] |= uint8_t(1u << (position % 8));
+		}
+	}
+};
+
+inline uint32_t BC7ReadBits(const uint8_t* block, uint32_t& position, const uint32_t& bitCount)
+{
+	uint32_t value = 0;
+	for (uint32_t i = 0; i < bitCount; i++, position++)
+		value |= uint32_t((block[position / 8] >> (position % 8)) & 1) << i;
+	return value;
+}
+
+// 16 texel の RGBA を BC7 mode 6 の 16 byte にする
+// 端点は 7bit の値と p bit (RGBA で共通の最下位 bit) で、p bit の 4 通りを全て試す
+void EncodeBC7Block(const uint8_t (&texels)[16][4], uint8_t* block)
+{
+	float points[16][4];
+	for (uint32_t i = 0; i < 16; i++) {
+		for (uint32_t c = 0; c < 4; c++)
+			points[i][c] = texels[i][c];
+	}
+
+	float endpoint0[4];
+	float endpoint1[4];
+	BCInitialEndpoints(points, 16, endpoint0, endpoint1);
+
+	SimdFloat8 pointLanes[4][2];
+	BCLoadPoints(points, 16, pointLanes);
+
+	float fitWeights[16];
+	for (uint32_t k = 0; k < 16; k++)
+		fitWeights[k] = BC7Weights4[k] / 64.0f;
+
+	uint32_t bestQuantized[2][4] = {};
+	uint32_t bestPBits[2] = {};
+	uint8_t bestIndices[16] = {};
+	int32_t bestError = INT32_MAX;
+
+	for (uint32_t iteration = 0; iteration < 3; iteration++) {
+		const float* endpoints[2] = { endpoint0, endpoint1 };
+
+		int32_t iterationError = INT32_MAX;
+		uint8_t iterationIndices[16];
+		for (uint32_t pbitPattern = 0; pbitPattern < 4; pbitPattern++) {
+			uint32_t quantized[2][4];
+			int32_t values[2][4];
+			const uint32_t pbits[2] = { pbitPattern & 1, pbitPattern >> 1 };
+			for (uint32_t e = 0; e < 2; e++) {
+				for (uint32_t c = 0; c < 4; c++) {
+					quantized[e][c] = uint32_t(std::clamp((endpoints[e][c] - float(pbits[e])) * 0.5f + 0.5f, 0.0f, 127.0f));
+					values[e][c] = int32_t((quantized[e][c] << 1) | pbits[e]);
+				}
+			}
+
+			int32_t palette[16][4];
+			for (uint32_t k = 0; k < 16; k++) {
+				for (uint32_t c = 0; c < 4; c++)
+					palette[k][c] = ((64 - BC7Weights4[k]) * values[0][c] + BC7Weights4[k] * values[1][c] + 32) >> 6;
+			}
+
+			// 端点を結ぶ線分への射影から一番近い補間係数を求め、その前後の index だけを比べる
+			// 補間係数 weight = (64 dot + |d|^2 / 2) / |d|^2 (整数の割り算) に対して 2 weight > BC7Weights4[k] + BC7Weights4[k + 1] となる k の数が nearest
+			// weight >= m (m = (BC7Weights4[k] + BC7Weights4[k + 1]) / 2 + 1) は 64 dot + |d|^2 / 2 >= m |d|^2 と同じなので割り算をせずに比べる
+			int32_t direction[4];
+			int32_t lengthSquared = 0;
+			for (uint32_t c = 0; c < 4; c++) {
+				direction[c] = values[1][c] - values[0][c];
+				lengthSquared += direction[c] * direction[c];
+			}
+
+			uint8_t nearest[16] = {};
+			if (lengthSquared > 0) {
+				for (uint32_t h = 0; h < 2; h++) {
+					SimdFloat8 dot = SimdSplat8(0.0f);
+					for (uint32_t c = 0; c < 4; c++)
+						dot = SimdAdd8(dot, SimdMul8(SimdSub8(pointLanes[c][h], SimdSplat8(float(values[0][c]))), SimdSplat8(float(direction[c]))));
+					const SimdFloat8 scaled = SimdAdd8(SimdMul8(dot, SimdSplat8(64.0f)), SimdSplat8(float(lengthSquared / 2)));
+					SimdFloat8 count = SimdSplat8(0.0f);
+					for (uint32_t k = 0; k < 15; k++) {
+						const int32_t threshold = ((BC7Weights4[k] + BC7Weights4[k + 1]) / 2 + 1) * lengthSquared;
+						count = SimdAdd8(count, SimdSelect8(SimdLess8(scaled, SimdSplat8(float(threshold))), SimdSplat8(0.0f), SimdSplat8(1.0f)));
+					}
+					float lanes[8];
+					SimdStore8(lanes, count);
+					for (uint32_t l = 0; l < 8; l++)
+						nearest[8 * h + l] = uint8_t(lanes[l]);
+				}
+			}
+
+			uint8_t indices[16];
+			int32_t distances[16];
+			BCSelectIndices(pointLanes, palette, 16, nearest, indices, distances);
+
+			// 前から足していって今までの最良に届いたら、この p bit の組は使わない
+			int32_t error = 0;
+			uint32_t i = 0;
+			for (; i < 16 && error < bestError; i++)
+				error += distances[i];
+
+			if (i < 16)
+				continue;
+
+			if (error < iterationError) {
+				iterationError = error;
+				std::memcpy(iterationIndices, indices, sizeof(indices));
+			}
+			if (error < bestError) {
+				bestError = error;
+				std::memcpy(bestQuantized, quantized, sizeof(quantized));
+				bestPBits[0] = pbits[0];
+				bestPBits[1] = pbits[1];
+				std::memcpy(bestIndices, indices, sizeof(indices));
+			}
+		}
+
+		if (bestError == 0 || iterationError == INT32_MAX)
+			break;
+		if (!BCFitEndpoints(points, 16, iterationIndices, fitWeights, endpoint0, endpoint1))
+			break;
+	}
+
+	// texel 0 の index は最上位 bit を省くので 8 未満にする (端点を入れ替えて index を反転する)
+	if (bestIndices[0] >= 8) {
+		for (uint32_t c = 0; c < 4; c++)
+			std::swap(bestQuantized[0][c], bestQuantized[1][c]);
+		std::swap(bestPBits[0], bestPBits[1]);
+		for (uint32_t i = 0; i < 16; i++)
+			bestIndices[i] = uint8_t(15 - bestIndices[i]);
+	}
+
+	std::memset(block, 0, 16);
+	BC7BitStream stream { block };
+	stream.Write(1u << 6, 7); // mode 6
+	for (uint32_t c = 0; c < 4; c++) {
+		stream.Write(bestQuantized[0][c], 7);
+		stream.Write(bestQuantized[1][c], 7);
+	}
+	stream.Write(bestPBits[0], 1);
+	stream.Write(bestPBits[1], 1);
+	for (uint32_t i = 0; i < 16; i++)
+		stream.Write(bestIndices[i], i == 0 ? 3 : 4);
+}
+
+void DecodeBC1Block(const uint8_t* block, uint8_t (&texels)[16][4], const bool& isBC3Color)
+{
+	const uint16_t color0 = BCReadUint16(block + 0);
+	const uint16_t color1 = BCReadUint16(block + 2);
+	const bool isFourColor = isBC3Color || color0 > color1;
+
+	int32_t palette[4][3];
+	BCColorPalette(color0, color1, isFourColor, palette);
+
+	for (uint32_t i = 0; i < 16; i++) {
+		const uint32_t index = (block[4 + i / 4] >> (2 * (i % 4))) & 3;
+		for (uint32_t c = 0; c < 3; c++)
+			texels[i][c] = uint8_t(palette[index][c]);
+		texels[i][3] = (!isFourColor && index == 3) ? 0 : 255;
+	}
+}
+
+void DecodeBC4Block(const uint8_t* block, uint8_t (&values)[16])
+{
+	int32_t palette[8];
+	BCAlphaPalette(block[0], block[1], palette);
+
+	uint64_t packedIndices = 0;
+	for (uint32_t i = 0; i < 6; i++)
+		packedIndices |= uint64_t(block[2 + i]) << (8 * i);
+	for (uint32_t i = 0; i < 16; i++)
+		values[i] = uint8_t(palette[(packedIndices >> (3 * i)) & 7]);
+}
+
+// mode 6 以外の block は false
+bool DecodeBC7Block(const uint8_t* block, uint8_t (&texels)[16][4])
+{
+	if ((block[0] & 0x7F) != 0x40)
+		return false;
+
+	uint32_t position = 7;
+	int32_t values[2][4];
+	for (uint32_t c = 0; c < 4; c++) {
+		values[0][c] = int32_t(BC7ReadBits(block, position, 7)) << 1;
+		values[1][c] = int32_t(BC7ReadBits(block, position, 7)) << 1;
+	}
+	const uint32_t pbit0 = BC7ReadBits(block, position, 1);
+	const uint32_t pbit1 = BC7ReadBits(block, position, 1);
+	for (uint32_t c = 0; c < 4; c++) {
+		values[0][c] |= pbit0;
+		values[1][c] |= pbit1;
+	}
+
+	for (uint32_t i = 0; i < 16; i++) {
+		const uint32_t index = BC7ReadBits(block, position, i == 0 ? 3 : 4);
+		for (uint32_t c = 0; c < 4; c++)
+			texels[i][c] = uint8_t(((64 - BC7Weights4[index]) * values[0][c] + BC7Weights4[index] * values[1][c] + 32) >> 6);
+	}
+	return true;
+}
+
+// RGBA8 の 1 level を圧縮する
+// 画像の端で 4x4 に満たない block は端の texel を繰り返して埋める
+// block の行ごとに threadCount 本の thread で分ける
+void EncodeBCImage(const uint8_t* rgba, const uint32_t& width, const uint32_t& height, const ImagePixelFormat& format, uint8_t* blocks, const uint32_t& threadCount = 1)
+{
+	const uint32_t blockWidth = (width + 3) / 4;
+	const uint32_t blockHeight = (height + 3) / 4;
+	const uint32_t blockSize = GetImageBlockSize(format);
+
+	ParallelFor(blockHeight, threadCount, [&](const uint32_t by) {
+		for (uint32_t bx = 0; bx < blockWidth; bx++) {
+			uint8_t texels[16][4];
+			for (uint32_t i = 0; i < 16; i++) {
+				const uint32_t x = std::min(4 * bx + i % 4, width - 1);
+				const uint32_t y = std::min(4 * by + i / 4, height - 1);
+				std::memcpy(texels[i], rgba + 4 * (size_t(y) * width + x), 4);
+			}
+
+			uint8_t* block = blocks + (size_t(by) * blockWidth + bx) * blockSize;
+			uint8_t channel[16];
+			switch (format) {
+			case ImagePixelFormat::BC1:
+				EncodeBC1Block(texels, block, true);
+				break;
+			case ImagePixelFormat::BC3:
+				for (uint32_t i = 0; i < 16; i++)
+					channel[i] = texels[i][3];
+				EncodeBC4Block(channel, block);
+				EncodeBC1Block(texels, block + 8, false);
+				break;
+			case ImagePixelFormat::BC5:
+				for (uint32_t c = 0; c < 2; c++) {
+					for (uint32_t i = 0; i < 16; i++)
+						channel[i] = texels[i][c];
+					EncodeBC4Block(channel, block + 8 * c);
+				}
+				break;
+			case ImagePixelFormat::BC7:
+				EncodeBC7Block(texels, block);
+				break;
+			default:
+				break;
+			}
+		}
+	});
+}
+
+// 圧縮した 1 level を RGBA8 に展開する (BC5 は b = 0, a = 255)
+bool DecodeBCImage(const uint8_t* blocks, const uint32_t& width, const uint32_t& height, const ImagePixelFormat& format, uint8_t* rgba)
+{
+	const uint32_t blockWidth = (width + 3) / 4;
+	const uint32_t blockHeight = (height + 3) / 4;
+	const uint32_t blockSize = GetImageBlockSize(format);
+
+	for (uint32_t by = 0; by < blockHeight; by++) {
+		for (uint32_t bx = 0; bx < blockWidth; bx++) {
+			const uint8_t* block = blocks + (size_t(by) * blockWidth + bx) * blockSize;
+			uint8_t texels[16][4];
+			uint8_t channel[16];
+			switch (format) {
+			case ImagePixelFormat::BC1:
+				DecodeBC1Block(block, texels, false);
+				break;
+			case ImagePixelFormat::BC3:
+				DecodeBC1Block(block + 8, texels, true);
+				DecodeBC4Block(block, channel);
+				for (uint32_t i = 0; i < 16; i++)
+					texels[i][3] = channel[i];
+				break;
+			case ImagePixelFormat::BC5:
+				for (uint32_t c = 0; c < 2; c++) {
+					DecodeBC4Block(block + 8 * c, channel);
+					for (uint32_t i = 0; i < 16; i++)
+						texels[i][c] = channel[i];
+				}
+				for (uint32_t i = 0; i < 16; i++) {
+					texels[i][2] = 0;
+					texels[i][3] = 255;
+				}
+				break;
+			case ImagePixelFormat::BC7:
+				if (!DecodeBC7Block(block, texels)) {
+					std::cout << "unsupported BC7 block mode" << std::endl;
+					return false;
+				}
+				break;
+			default:
+				return false;
+			}
+
+			for (uint32_t i = 0; i < 16; i++) {
+				const uint32_t x = 4 * bx + i % 4;
+				const uint32_t y = 4 * by + i / 4;
+				if (x < width && y < height)
+					std::memcpy(rgba + 4 * (size_t(y) * width + x), texels[i], 4);
+			}
+		}
+	}
+	return true;
+}
+
+// RGBA8 の ImageData の全 mip を format で圧縮した ImageData を作る
+bool CompressImage(const ImageData& source, const ImagePixelFormat& format, ImageData& compressed, const uint32_t& threadCount = 1)
+{
+	if (source.format != ImagePixelFormat::RGBA8 || !IsBlockCompressed(format)) {
+		std::cout << "CompressImage needs an RGBA8 image and a block compressed format" << std::endl;
+		return false;
+	}
+
+	compressed.width = source.width;
+	compressed.height = source.height;
+	compressed.format = format;
+	compressed.mips.clear();
+
+	size_t total = 0;
+	for (const auto& mip : source.mips) {
+		compressed.mips.push_back({ mip.width, mip.height, total });
+		total += GetImageLevelSize(format, mip.width, mip.height);
+	}
+	compressed.pixels.assign(total, 0);
+
+	for (size_t level = 0; level < source.mips.size(); level++) {
+		const ImageMipLevel& mip = source.mips[level];
+		EncodeBCImage(source.pixels.data() + mip.offset, mip.width, mip.height, format, compressed.pixels.data() + compressed.mips[level].offset, threadCount);
+	}
+	return true;
+}
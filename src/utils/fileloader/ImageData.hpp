@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// 読み込んだ画像 (mip 込み) を texture に送るまで持っておくための型
+// ImageLoader (PNG / JPEG / HDR / TGA), BlockCompression, TextureContainer で共有する
+
+enum class ImagePixelFormat : uint32_t {
+	RGBA8,   // 1 texel 4 byte
+	RGBA32F, // 1 texel 16 byte
+	BC1,     // 4x4 block 8 byte (RGB + 1bit alpha)
+	BC3,     // 4x4 block 16 byte (RGBA)
+	BC5,     // 4x4 block 16 byte (RG, 法線 map 用)
+	BC7,     // 4x4 block 16 byte (RGBA)
+};
+
+inline bool IsBlockCompressed(const ImagePixelFormat& format)
+{
+	return format != ImagePixelFormat::RGBA8 && format != ImagePixelFormat::RGBA32F;
+}
+
+// 圧縮形式なら 4x4 block の byte 数, 非圧縮なら 1 texel の byte 数
+inline uint32_t GetImageBlockSize(const ImagePixelFormat& format)
+{
+	switch (format) {
+	case ImagePixelFormat::RGBA8:
+		return 4;
+	case ImagePixelFormat::BC1:
+		return 8;
+	default:
+		return 16;
+	}
+}
+
+// width x height の 1 level の byte 数 (圧縮形式は端の block も 4x4 として数える)
+inline size_t GetImageLevelSize(const ImagePixelFormat& format, const uint32_t& width, const uint32_t& height)
+{
+	if (IsBlockCompressed(format))
+		return size_t((width + 3) / 4) * ((height + 3) / 4) * GetImageBlockSize(format);
+	return size_t(width) * height * GetImageBlockSize(format);
+}
+
+struct ImageMipLevel {
+	uint32_t width;
+	uint32_t height;
+	size_t offset; // ImageData::pixels の先頭からの byte offset
+};
+
+struct ImageData {
+	uint32_t width = 0;
+	uint32_t height = 0;
+	ImagePixelFormat format = ImagePixelFormat::RGBA8;
+	std::vector<uint8_t> pixels; // mip 0 から順に全 level を詰めたもの
+	std::vector<ImageMipLevel> mips;
+
+	// 非圧縮形式のときだけ使う
+	uint32_t GetTexelSize() const
+	{
+		return GetImageBlockSize(format);
+	}
+};
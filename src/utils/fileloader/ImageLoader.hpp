@@ -0,0 +1,533 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include <cmath>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "src/utils/fileloader/MappedFile.hpp"
+#include "src/utils/fileloader/ImageData.hpp"
+#include "src/utils/fileloader/TextureContainer.hpp"
+#include "src/utils/fileloader/PNGLoader.hpp"
+#include "src/utils/fileloader/JPEGLoader.hpp"
+#include "src/utils/thread/workerPool.hpp"
+
+// texture 用の画像を読む
+// PNG / JPEG / TGA は RGBA8, Radiance HDR は RGBA32F に展開する
+// 行は上から順に並べる (ファイルの向きによらない)
+
+// Radiance HDR (RGBE, 新形式の run length 圧縮と無圧縮) を読む
+// 向きは "-Y H +X W" のみ扱う
+bool DecodeHDR(const uint8_t* data, const size_t& size, std::vector<float>& rgba, uint32_t& width, uint32_t& height)
+{
+	const uint8_t* p = data;
+	const uint8_t* const end = data + size;
+
+	auto ReadLine = [&]() {
+		const uint8_t* begin = p;
+		while (p < end && *p != '\n')
+			p++;
+		std::string line(reinterpret_cast<const char*>(begin), p - begin);
+		if (p < end)
+			p++;
+		return line;
+	};
+
+	const std::string magic = ReadLine();
+	if (magic != "#?RADIANCE" && magic != "#?RGBE") {
+		std::cout << "HDR: invalid header" << std::endl;
+		return false;
+	}
+	while (true) {
+		if (p >= end)
+			return false;
+		const std::string line = ReadLine();
+		if (line.empty())
+			break;
+		if (line.compare(0, 7, "FORMAT=") == 0 && line != "FORMAT=32-bit_rle_rgbe") {
+			std::cout << "HDR: unsupported format " << line << std::endl;
+			return false;
+		}
+	}
+
+	const std::string resolution = ReadLine();
+	int32_t h = 0;
+	int32_t w = 0;
+	if (std::sscanf(resolution.c_str(), "-Y %d +X %d", &h, &w) != 2 || w <= 0 || h <= 0) {
+		std::cout << "HDR: unsupported orientation " << resolution << std::endl;
+		return false;
+	}
+	width = uint32_t(w);
+	height = uint32_t(h);
+
+	rgba.resize(size_t(width) * height * 4);
+	std::vector<uint8_t> scanline(size_t(width) * 4);
+	for (uint32_t y = 0; y < height; y++) {
+		const bool isRLE = width >= 8 && width < 32768 && end - p >= 4 && p[0] == 2 && p[1] == 2 && (p[2] & 0x80) == 0;
+		if (isRLE) {
+			if (((uint32_t(p[2]) << 8) | p[3]) != width)
+				return false;
+			p += 4;
+			// 成分ごとに 1 行分が run length で並ぶ
+			for (uint32_t c = 0; c < 4; c++) {
+				uint32_t x = 0;
+				while (x < width) {
+					if (p >= end)
+						return false;
+					uint32_t count = *p++;
+					if (count > 128) {
+						count -= 128;
+						if (p >= end || x + count > width)
+							return false;
+						const uint8_t value = *p++;
+						for (uint32_t i = 0; i < count; i++)
+							scanline[4 * (x + i) + c] = value;
+					}
+					else {
+						if (count == 0 || size_t(end - p) < count || x + count > width)
+							return false;
+						for (uint32_t i = 0; i < count; i++)
+							scanline[4 * (x + i) + c] = p[i];
+						p += count;
+					}
+					x += count;
+				}
+			}
+		}
+		else {
+			if (size_t(end - p) < scanline.size())
+				return false;
+			std::memcpy(scanline.data(), p, scanline.size());
+			p += scanline.size();
+		}
+
+		float* out = rgba.data() + size_t(y) * width * 4;
+		for (uint32_t x = 0; x < width; x++) {
+			const uint8_t* rgbe = scanline.data() + 4 * x;
+			const float scale = (rgbe[3] == 0) ? 0.0f : std::ldexp(1.0f, int32_t(rgbe[3]) - (128 + 8));
+			out[4 * x + 0] = rgbe[0] * scale;
+			out[4 * x + 1] = rgbe[1] * scale;
+			out[4 * x + 2] = rgbe[2] * scale;
+			out[4 * x + 3] = 1.0f;
+		}
+	}
+
+	return true;
+}
+
+// TGA (true color / gray / color map, 各 run length 圧縮あり) を読む
+bool DecodeTGA(const uint8_t* data, const size_t& size, std::vector<uint8_t>& rgba, uint32_t& width, uint32_t& height)
+{
+	if (size < 18)
+		return false;
+	const uint32_t idLength = data[0];
+	const uint32_t colorMapType = data[1];
+	const uint32_t imageType = data[2];
+	const uint32_t colorMapFirst = data[3] | (data[4] << 8);
+	const uint32_t colorMapLength = data[5] | (data[6] << 8);
+	const uint32_t colorMapDepth = data[7];
+	width = data[12] | (data[13] << 8);
+	height = data[14] | (data[15] << 8);
+	const uint32_t depth = data[16];
+	const uint32_t descriptor = data[17];
+
+	const bool isRLE = imageType >= 9;
+	const uint32_t baseType = isRLE ? imageType - 8 : imageType;
+	const bool isMapped = baseType == 1;
+	if ((baseType != 1 && baseType != 2 && baseType != 3) || width == 0 || height == 0
+		|| (isMapped && (colorMapType != 1 || (depth != 8 && depth != 16))) || (!isMapped && depth != 8 && depth != 15 && depth != 16 && depth != 24 && depth != 32)) {
+		std::cout << "TGA: unsupported format" << std::endl;
+		return false;
+	}
+
+	const uint8_t* p = data + 18 + idLength;
+	const uint8_t* const end = data + size;
+
+	// 1 画素を RGBA8 にする (TGA は BGR(A) の順)
+	auto ToRGBA = [](const uint8_t* src, const uint32_t& bits, const bool& isGray, uint8_t* out) {
+		if (isGray) {
+			out[0] = out[1] = out[2] = src[0];
+			out[3] = (bits == 16) ? src[1] : 255;
+		}
+		else if (bits == 15 || bits == 16) {
+			const uint32_t v = src[0] | (src[1] << 8);
+			out[0] = uint8_t(((v >> 10) & 31) * 255 / 31);
+			out[1] = uint8_t(((v >> 5) & 31) * 255 / 31);
+			out[2] = uint8_t((v & 31) * 255 / 31);
+			out[3] = 255;
+		}
+		else {
+			out[0] = src[2];
+			out[1] = src[1];
+			out[2] = src[0];
+			out[3] = (bits == 32) ? src[3] : 255;
+		}
+	};
+
+	std::vector<uint8_t> palette;
+	if (colorMapType == 1) {
+		const uint32_t entrySize = (colorMapDepth + 7) / 8;
+		if (size_t(end - p) < size_t(entrySize) * colorMapLength)
+			return false;
+		if (isMapped) {
+			palette.resize(size_t(colorMapFirst + colorMapLength) * 4, 0);
+			for (uint32_t i = 0; i < colorMapLength; i++)
+				ToRGBA(p + entrySize * i, colorMapDepth, false, palette.data() + 4 * (colorMapFirst + i));
+		}
+		p += size_t(entrySize) * colorMapLength;
+	}
+
+	const uint32_t pixelSize = (depth + 7) / 8;
+	const bool isGray = baseType == 3;
+	auto ReadPixel = [&](const uint8_t* src, uint8_t* out) {
+		if (isMapped) {
+			const uint32_t index = (depth == 8) ? src[0] : (src[0] | (src[1] << 8));
+			if (size_t(index) * 4 + 4 <= palette.size())
+				std::memcpy(out, palette.data() + 4 * index, 4);
+			else
+				std::memset(out, 0, 4);
+		}
+		else {
+			ToRGBA(src, depth, isGray, out);
+		}
+	};
+
+	const size_t pixelCount = size_t(width) * height;
+	rgba.resize(pixelCount * 4);
+	size_t i = 0;
+	while (i < pixelCount) {
+		if (!isRLE) {
+			if (size_t(end - p) < pixelCount * pixelSize)
+				return false;
+			for (; i < pixelCount; i++, p += pixelSize)
+				ReadPixel(p, rgba.data() + 4 * i);
+			break;
+		}
+
+		if (p >= end)
+			return false;
+		const uint32_t packet = *p++;
+		const uint32_t count = std::min<size_t>((packet & 0x7F) + 1, pixelCount - i);
+		if (packet & 0x80) {
+			if (size_t(end - p) < pixelSize)
+				return false;
+			uint8_t color[4];
+			ReadPixel(p, color);
+			p += pixelSize;
+			for (uint32_t j = 0; j < count; j++, i++)
+				std::memcpy(rgba.data() + 4 * i, color, 4);
+		}
+		else {
+			if (size_t(end - p) < size_t(count) * pixelSize)
+				return false;
+			for (uint32_t j = 0; j < count; j++, i++, p += pixelSize)
+				ReadPixel(p, rgba.data() + 4 * i);
+		}
+	}
+
+	// descriptor の bit 5 が立っていなければ下の行から並んでいる
+	if ((descriptor & 0x20) == 0) {
+		const size_t stride = size_t(width) * 4;
+		for (uint32_t y = 0; y < height / 2; y++)
+			std::swap_ranges(rgba.begin() + y * stride, rgba.begin() + (y + 1) * stride, rgba.begin() + (height - 1 - y) * stride);
+	}
+	if (descriptor & 0x10) {
+		for (uint32_t y = 0; y < height; y++) {
+			uint32_t* row = reinterpret_cast<uint32_t*>(rgba.data() + size_t(y) * width * 4);
+			std::reverse(row, row + width);
+		}
+	}
+
+	return true;
+}
+
+// 中身を見て形式を決める (TGA は識別子が無いので拡張子で決める)
+// texture container (.pbtx) は作ったときの level と形式のまま読む (上下の反転は作るときに済ませておく)
+bool LoadImageFile(const char* filename, ImageData& image, const bool& isFlipVertical = false)
+{
+	MappedFile file;
+	if (!file.Open(filename))
+		return false;
+
+	const uint8_t* data = reinterpret_cast<const uint8_t*>(file.data());
+	const size_t size = file.size();
+
+	const std::string name(filename);
+	const std::string extension = name.substr(std::min(name.size(), name.find_last_of('.') + 1));
+	auto IsExtension = [&](const char* ext) {
+		if (extension.size() != std::strlen(ext))
+			return false;
+		for (size_t i = 0; i < extension.size(); i++) {
+			if (std::tolower(static_cast<unsigned char>(extension[i])) != ext[i])
+				return false;
+		}
+		return true;
+	};
+
+	uint32_t magic = 0;
+	if (size >= 4)
+		std::memcpy(&magic, data, 4);
+	if (magic == TextureContainerMagic) {
+		uint32_t flags = 0;
+		if (!ReadTextureContainer(file, filename, image, flags))
+			return false;
+		if (((flags & TextureContainerFlipVertical) != 0) != isFlipVertical) {
+			std::cout << filename << " was made with a different vertical flip" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	bool isSucceeded = false;
+	if (size >= 8 && data[0] == 0x89 && data[1] == 'P' && data[2] == 'N' && data[3] == 'G') {
+		image.format = ImagePixelFormat::RGBA8;
+		isSucceeded = DecodePNG(data, size, image.pixels, image.width, image.height);
+	}
+	else if (size >= 2 && data[0] == 0xFF && data[1] == 0xD8) {
+		image.format = ImagePixelFormat::RGBA8;
+		isSucceeded = DecodeJPEG(data, size, image.pixels, image.width, image.height);
+	}
+	else if (size >= 2 && data[0] == '#' && data[1] == '?') {
+		std::vector<float> rgba;
+		image.format = ImagePixelFormat::RGBA32F;
+		isSucceeded = DecodeHDR(data, size, rgba, image.width, image.height);
+		image.pixels.resize(rgba.size() * sizeof(float));
+		std::memcpy(image.pixels.data(), rgba.data(), image.pixels.size());
+	}
+	else if (IsExtension("tga")) {
+		image.format = ImagePixelFormat::RGBA8;
+		isSucceeded = DecodeTGA(data, size, image.pixels, image.width, image.height);
+	}
+	else {
+		std::cout << "unknown image format: " << filename << std::endl;
+		return false;
+	}
+
+	if (!isSucceeded) {
+		std::cout << "fail to decode image: " << filename << std::endl;
+		image.width = image.height = 0;
+		image.pixels.clear();
+		image.mips.clear();
+		return false;
+	}
+
+	if (isFlipVertical) {
+		const size_t stride = size_t(image.width) * image.GetTexelSize();
+		for (uint32_t y = 0; y < image.height / 2; y++)
+			std::swap_ranges(image.pixels.begin() + y * stride, image.pixels.begin() + (y + 1) * stride, image.pixels.begin() + (image.height - 1 - y) * stride);
+	}
+
+	image.mips.assign(1, { image.width, image.height, 0 });
+	return true;
+}
+
+// 1x1 まで半分にしていったときの level 数
+inline uint32_t GetMipLevelCount(const uint32_t& width, const uint32_t& height)
+{
+	uint32_t levels = 1;
+	for (uint32_t size = std::max(width, height); size > 1; size >>= 1)
+		levels++;
+	return levels;
+}
+
+inline float SRGBToLinear(const float& value)
+{
+	return (value <= 0.04045f) ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+inline float LinearToSRGB(const float& value)
+{
+	return (value <= 0.0031308f) ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+// mip 0 から 2x2 の box filter で 1x1 まで縮小した level を pixels の後ろに足す
+// 奇数の辺は端の画素を繰り返して扱う
+// isSRGB なら RGB は linear に直してから平均する (alpha はそのまま)
+void GenerateImageMips(ImageData& image, const bool& isSRGB)
+{
+	// 圧縮形式は CPU では縮小しない (texture container は mip 込みで作る)
+	if (image.width == 0 || image.height == 0 || IsBlockCompressed(image.format))
+		return;
+
+	const uint32_t levelCount = GetMipLevelCount(image.width, image.height);
+	const uint32_t texelSize = image.GetTexelSize();
+
+	image.mips.resize(1);
+	size_t total = size_t(image.width) * image.height * texelSize;
+	for (uint32_t level = 1, w = image.width, h = image.height; level < levelCount; level++) {
+		w = std::max(1u, w / 2);
+		h = std::max(1u, h / 2);
+		image.mips.push_back({ w, h, total });
+		total += size_t(w) * h * texelSize;
+	}
+	image.pixels.resize(total);
+
+	static const auto SRGBTable = []() {
+		std::vector<float> table(256);
+		for (uint32_t i = 0; i < 256; i++)
+			table[i] = SRGBToLinear(i / 255.0f);
+		return table;
+	}();
+	// linear -> sRGB8 は、隣り合う sRGB の値の中点 (linear) との比較で丸める
+	// 4096 分割した区間の先頭での値から始めて、中点を越えている分だけ進める
+	static const auto SRGBThreshold = []() {
+		std::vector<float> table(256);
+		for (uint32_t i = 0; i < 255; i++)
+			table[i] = SRGBToLinear((i + 0.5f) / 255.0f);
+		table[255] = 2.0f; // 番兵
+		return table;
+	}();
+	static const auto SRGBBucket = []() {
+		std::vector<uint8_t> table(4097);
+		uint32_t value = 0;
+		for (uint32_t i = 0; i <= 4096; i++) {
+			while (value < 255 && SRGBThreshold[value] < i / 4096.0f)
+				value++;
+			table[i] = uint8_t(value);
+		}
+		return table;
+	}();
+	auto ToSRGB8 = [](const float& linear) {
+		uint32_t value = SRGBBucket[uint32_t(linear * 4096.0f)];
+		while (linear > SRGBThreshold[value])
+			value++;
+		return uint8_t(value);
+	};
+
+	for (uint32_t level = 1; level < levelCount; level++) {
+		const ImageMipLevel& src = image.mips[level - 1];
+		const ImageMipLevel& dst = image.mips[level];
+
+		for (uint32_t y = 0; y < dst.height; y++) {
+			const uint32_t y0 = std::min(2 * y, src.height - 1);
+			const uint32_t y1 = std::min(2 * y + 1, src.height - 1);
+			for (uint32_t x = 0; x < dst.width; x++) {
+				const uint32_t x0 = std::min(2 * x, src.width - 1);
+				const uint32_t x1 = std::min(2 * x + 1, src.width - 1);
+				const size_t texels[4] = {
+					size_t(y0) * src.width + x0, size_t(y0) * src.width + x1,
+					size_t(y1) * src.width + x0, size_t(y1) * src.width + x1
+				};
+				const size_t out = size_t(y) * dst.width + x;
+
+				if (image.format == ImagePixelFormat::RGBA32F) {
+					const float* s = reinterpret_cast<const float*>(image.pixels.data() + src.offset);
+					float* d = reinterpret_cast<float*>(image.pixels.data() + dst.offset);
+					for (uint32_t c = 0; c < 4; c++)
+						d[4 * out + c] = 0.25f * (s[4 * texels[0] + c] + s[4 * texels[1] + c] + s[4 * texels[2] + c] + s[4 * texels[3] + c]);
+					continue;
+				}
+
+				const uint8_t* s = image.pixels.data() + src.offset;
+				uint8_t* d = image.pixels.data() + dst.offset;
+				for (uint32_t c = 0; c < 4; c++) {
+					if (isSRGB && c < 3) {
+						const float sum = SRGBTable[s[4 * texels[0] + c]] + SRGBTable[s[4 * texels[1] + c]] + SRGBTable[s[4 * texels[2] + c]] + SRGBTable[s[4 * texels[3] + c]];
+						d[4 * out + c] = ToSRGB8(0.25f * sum);
+					}
+					else {
+						const uint32_t sum = s[4 * texels[0] + c] + s[4 * texels[1] + c] + s[4 * texels[2] + c] + s[4 * texels[3] + c];
+						d[4 * out + c] = uint8_t((sum + 2) / 4);
+					}
+				}
+			}
+		}
+	}
+}
+
+struct ImageLoadParams {
+	bool isSRGB = false;         // mip を作るとき linear に直してから平均する (albedo など)
+	bool isFlipVertical = false; // OBJ の uv は左下が原点なので、上下を反転して読む
+	bool generateMips = true;
+};
+
+// 画像の decode と mip の生成を WorkerPool で裏で進める
+// 同じファイルを同じ設定で何度 Request しても decode は 1 回だけ行う
+// Request / Wait は 1 つの thread (main thread) から呼ぶこと
+class ImageLoadQueue
+{
+public:
+	explicit ImageLoadQueue(const uint32_t& threadCount)
+	    : m_pool(threadCount)
+	{
+	}
+
+	uint32_t Request(const std::string& filename, const ImageLoadParams& params)
+	{
+		const std::string key = filename + (params.isSRGB ? "|s" : "|l") + (params.isFlipVertical ? "f" : "n") + (params.generateMips ? "m" : "1");
+
+		Entry* pEntry = nullptr;
+		uint32_t id;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			auto it = m_ids.find(key);
+			if (it != m_ids.end())
+				return it->second;
+
+			id = uint32_t(m_entries.size());
+			m_entries.emplace_back();
+			pEntry = &m_entries.back(); // deque の要素は push_back で動かない
+			m_ids.emplace(key, id);
+		}
+
+		m_pool.Push([this, pEntry, filename, params]() {
+			ImageData image;
+			const bool isSucceeded = LoadImageFile(filename.c_str(), image, params.isFlipVertical);
+			if (isSucceeded && params.generateMips && image.mips.size() == 1)
+				GenerateImageMips(image, params.isSRGB);
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				pEntry->image = std::move(image);
+				pEntry->isSucceeded = isSucceeded;
+				pEntry->isReady = true;
+			}
+			m_readyCV.notify_all();
+		});
+
+		return id;
+	}
+
+	bool IsReady(const uint32_t& id)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_entries[id].isReady;
+	}
+
+	// decode が終わるまで待つ (失敗していれば nullptr)
+	const ImageData* Wait(const uint32_t& id)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		Entry& entry = m_entries[id];
+		m_readyCV.wait(lock, [&entry]() { return entry.isReady; });
+		return entry.isSucceeded ? &entry.image : nullptr;
+	}
+
+	void WaitAll()
+	{
+		m_pool.WaitIdle();
+	}
+
+private:
+	struct Entry {
+		ImageData image;
+		bool isReady = false;
+		bool isSucceeded = false;
+	};
+
+	std::mutex m_mutex;
+	std::condition_variable m_readyCV;
+	std::deque<Entry> m_entries;
+	std::unordered_map<std::string, uint32_t> m_ids;
+
+	// job が m_entries を触るので最後に宣言して最初に破棄する (破棄時に残りの job を終えてから止まる)
+	WorkerPool m_pool;
+};
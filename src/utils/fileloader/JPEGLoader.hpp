@@ -0,0 +1,688 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+// baseline (sequential huffman, 8 bit) の JPEG を RGBA8 に展開する
+// progressive / arithmetic / 12 bit / CMYK は扱わない
+// 色差成分の拡大は最近傍で行う
+
+struct JPEGHuffman {
+	static constexpr uint32_t FastBits = 9;
+
+	uint8_t fast[1 << FastBits]; // 255 は fast 表に無い
+	uint8_t size[256];
+	uint8_t value[256];
+	uint16_t code[256];
+	uint32_t maxcode[18];
+	int32_t delta[17]; // value の index = code + delta[符号長]
+};
+
+bool BuildJPEGHuffman(JPEGHuffman& huffman, const uint8_t* counts, const uint8_t* values)
+{
+	uint32_t k = 0;
+	for (uint32_t i = 0; i < 16; i++) {
+		for (uint32_t j = 0; j < counts[i]; j++) {
+			if (k >= 256)
+				return false;
+			huffman.size[k++] = uint8_t(i + 1);
+		}
+	}
+	const uint32_t symbolCount = k;
+	std::memcpy(huffman.value, values, symbolCount);
+
+	uint32_t code = 0;
+	k = 0;
+	for (uint32_t j = 1; j <= 16; j++) {
+		huffman.delta[j] = int32_t(k) - int32_t(code);
+		if (k < symbolCount && huffman.size[k] == j) {
+			while (k < symbolCount && huffman.size[k] == j)
+				huffman.code[k++] = uint16_t(code++);
+			if (code - 1 >= (1u << j))
+				return false;
+		}
+		huffman.maxcode[j] = code << (16 - j); // 16 bit に左詰めした値で比べる
+		code <<= 1;
+	}
+	huffman.maxcode[17] = 0xFFFFFFFF;
+
+	// JPEG の符号は MSB から詰まっているので、上位 FastBits bit でそのまま表を引ける
+	std::memset(huffman.fast, 255, sizeof(huffman.fast));
+	for (uint32_t i = 0; i < symbolCount; i++) {
+		const uint32_t s = huffman.size[i];
+		if (s <= JPEGHuffman::FastBits) {
+			const uint32_t first = uint32_t(huffman.code[i]) << (JPEGHuffman::FastBits - s);
+			const uint32_t count = 1u << (JPEGHuffman::FastBits - s);
+			for (uint32_t j = 0; j < count; j++)
+				huffman.fast[first + j] = uint8_t(i);
+		}
+	}
+	return true;
+}
+
+// AAN (Arai, Agui, Nakajima) の 8 点逆 DCT を行と列に掛ける
+// 係数は zigzag を戻し、JPEGDequantizeScale を掛けたもの
+void JPEGInverseDCT(const float* coefficients, uint8_t* out, const uint32_t& stride)
+{
+	float workspace[64];
+
+	// 列方向
+	for (uint32_t i = 0; i < 8; i++) {
+		const float* in = coefficients + i;
+		float* ws = workspace + i;
+
+		if (in[8] == 0.0f && in[16] == 0.0f && in[24] == 0.0f && in[32] == 0.0f && in[40] == 0.0f && in[48] == 0.0f && in[56] == 0.0f) {
+			for (uint32_t k = 0; k < 8; k++)
+				ws[8 * k] = in[0];
+			continue;
+		}
+
+		float tmp0 = in[0];
+		float tmp1 = in[16];
+		float tmp2 = in[32];
+		float tmp3 = in[48];
+
+		float tmp10 = tmp0 + tmp2;
+		float tmp11 = tmp0 - tmp2;
+		float tmp13 = tmp1 + tmp3;
+		float tmp12 = (tmp1 - tmp3) * 1.414213562f - tmp13;
+
+		tmp0 = tmp10 + tmp13;
+		tmp3 = tmp10 - tmp13;
+		tmp1 = tmp11 + tmp12;
+		tmp2 = tmp11 - tmp12;
+
+		const float z13 = in[40] + in[24];
+		const float z10 = in[40] - in[24];
+		const float z11 = in[8] + in[56];
+		const float z12 = in[8] - in[56];
+
+		const float tmp7 = z11 + z13;
+		tmp11 = (z11 - z13) * 1.414213562f;
+		const float z5 = (z10 + z12) * 1.847759065f;
+		tmp10 = 1.082392200f * z12 - z5;
+		tmp12 = -2.613125930f * z10 + z5;
+
+		const float tmp6 = tmp12 - tmp7;
+		const float tmp5 = tmp11 - tmp6;
+		const float tmp4 = tmp10 + tmp5;
+
+		ws[0] = tmp0 + tmp7;
+		ws[56] = tmp0 - tmp7;
+		ws[8] = tmp1 + tmp6;
+		ws[48] = tmp1 - tmp6;
+		ws[16] = tmp2 + tmp5;
+		ws[40] = tmp2 - tmp5;
+		ws[32] = tmp3 + tmp4;
+		ws[24] = tmp3 - tmp4;
+	}
+
+	// 行方向 (+128 して 0 - 255 に丸める)
+	for (uint32_t i = 0; i < 8; i++) {
+		const float* ws = workspace + 8 * i;
+		uint8_t* row = out + size_t(stride) * i;
+
+		float tmp10 = ws[0] + ws[4];
+		float tmp11 = ws[0] - ws[4];
+		const float tmp13 = ws[2] + ws[6];
+		float tmp12 = (ws[2] - ws[6]) * 1.414213562f - tmp13;
+
+		const float tmp0 = tmp10 + tmp13;
+		const float tmp3 = tmp10 - tmp13;
+		const float tmp1 = tmp11 + tmp12;
+		const float tmp2 = tmp11 - tmp12;
+
+		const float z13 = ws[5] + ws[3];
+		const float z10 = ws[5] - ws[3];
+		const float z11 = ws[1] + ws[7];
+		const float z12 = ws[1] - ws[7];
+
+		const float tmp7 = z11 + z13;
+		tmp11 = (z11 - z13) * 1.414213562f;
+		const float z5 = (z10 + z12) * 1.847759065f;
+		tmp10 = 1.082392200f * z12 - z5;
+		tmp12 = -2.613125930f * z10 + z5;
+
+		const float tmp6 = tmp12 - tmp7;
+		const float tmp5 = tmp11 - tmp6;
+		const float tmp4 = tmp10 + tmp5;
+
+		const float values[8] = {
+			tmp0 + tmp7, tmp1 + tmp6, tmp2 + tmp5, tmp3 - tmp4,
+			tmp3 + tmp4, tmp2 - tmp5, tmp1 - tmp6, tmp0 - tmp7
+		};
+		for (uint32_t k = 0; k < 8; k++) {
+			const int32_t value = int32_t(values[k] + 128.5f);
+			row[k] = uint8_t(std::clamp(value, 0, 255));
+		}
+	}
+}
+
+// 量子化表 (zigzag 順) から、逆量子化と AAN の scale をまとめた係数 (自然順) を作る
+void JPEGDequantizeScale(const uint16_t* quantization, float* scale)
+{
+	static constexpr uint8_t Zigzag[64] = {
+		0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+		12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+		35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+		58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63
+	};
+	// aan[k] = cos(k pi / 16) * sqrt(2) (k = 0 は 1)
+	static constexpr double AANScale[8] = { 1.0, 1.387039845, 1.306562965, 1.175875602, 1.0, 0.785694958, 0.541196100, 0.275899379 };
+
+	for (uint32_t k = 0; k < 64; k++) {
+		const uint32_t natural = Zigzag[k];
+		scale[natural] = float(quantization[k] * AANScale[natural / 8] * AANScale[natural % 8] / 8.0);
+	}
+}
+
+class JPEGDecoder
+{
+public:
+	JPEGDecoder(const uint8_t* data, const size_t& size)
+	    : m_p(data)
+	    , m_end(data + size)
+	{
+	}
+
+	bool Decode(std::vector<uint8_t>& rgba, uint32_t& width, uint32_t& height)
+	{
+		if (m_end - m_p < 2 || m_p[0] != 0xFF || m_p[1] != 0xD8) {
+			std::cout << "JPEG: invalid SOI" << std::endl;
+			return false;
+		}
+		m_p += 2;
+
+		bool hasFrame = false;
+		bool hasScan = false;
+		while (true) {
+			const int32_t marker = NextMarker();
+			if (marker < 0) {
+				// EOI 無しで終わっているファイルは、scan を読めていればそのまま使う
+				if (hasScan)
+					break;
+				std::cout << "JPEG: unexpected end of file" << std::endl;
+				return false;
+			}
+			if (marker == 0xD9)
+				break;
+
+			// 長さを持たない marker
+			if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7))
+				continue;
+
+			if (m_end - m_p < 2)
+				return false;
+			const uint32_t length = (uint32_t(m_p[0]) << 8) | m_p[1];
+			if (length < 2 || size_t(m_end - m_p) < length)
+				return false;
+			const uint8_t* segment = m_p + 2;
+			const uint32_t segmentSize = length - 2;
+			m_p += length;
+
+			switch (marker) {
+			case 0xC0: // baseline
+			case 0xC1: // extended sequential (huffman)
+				if (!ReadFrame(segment, segmentSize))
+					return false;
+				hasFrame = true;
+				break;
+			case 0xC2:
+			case 0xC3:
+			case 0xC5:
+			case 0xC6:
+			case 0xC7:
+			case 0xC9:
+			case 0xCA:
+			case 0xCB:
+			case 0xCD:
+			case 0xCE:
+			case 0xCF:
+				std::cout << "JPEG: progressive / lossless / arithmetic coding is not supported" << std::endl;
+				return false;
+			case 0xC4:
+				if (!ReadHuffmanTables(segment, segmentSize))
+					return false;
+				break;
+			case 0xDB:
+				if (!ReadQuantizationTables(segment, segmentSize))
+					return false;
+				break;
+			case 0xDD:
+				if (segmentSize < 2)
+					return false;
+				m_restartInterval = (uint32_t(segment[0]) << 8) | segment[1];
+				break;
+			case 0xEE:
+				// Adobe : transform == 0 なら 3 成分は YCbCr ではなく RGB
+				if (segmentSize >= 12 && std::memcmp(segment, "Adobe", 5) == 0)
+					m_isAdobeRGB = (segment[11] == 0);
+				break;
+			case 0xDA:
+				if (!hasFrame || !ReadScan(segment, segmentSize))
+					return false;
+				hasScan = true;
+				break;
+			default:
+				break; // APPn, COM など
+			}
+		}
+
+		if (!hasFrame || !hasScan) {
+			std::cout << "JPEG: missing frame or scan" << std::endl;
+			return false;
+		}
+
+		width = m_width;
+		height = m_height;
+		ConvertToRGBA(rgba);
+		return true;
+	}
+
+private:
+	struct Component {
+		uint32_t id;
+		uint32_t h;
+		uint32_t v;
+		uint32_t tq;
+		uint32_t td = 0;
+		uint32_t ta = 0;
+		int32_t dcpred = 0;
+		uint32_t stride;             // plane の横幅 (MCU の整数倍)
+		std::vector<uint8_t> plane; // 逆 DCT した画素
+	};
+
+	const uint8_t* m_p;
+	const uint8_t* m_end;
+
+	uint32_t m_width = 0;
+	uint32_t m_height = 0;
+	uint32_t m_hmax = 1;
+	uint32_t m_vmax = 1;
+	uint32_t m_mcuX = 0;
+	uint32_t m_mcuY = 0;
+	uint32_t m_restartInterval = 0;
+	bool m_isAdobeRGB = false;
+
+	std::vector<Component> m_components;
+	float m_dequantize[4][64] = {}; // JPEGDequantizeScale の結果
+	JPEGHuffman m_dcTables[4] = {};
+	JPEGHuffman m_acTables[4] = {};
+	// DHT で定義された表だけを scan で使える (壊れたファイルが未定義の表を指したら読まない)
+	bool m_isDCTableDefined[4] = {};
+	bool m_isACTableDefined[4] = {};
+
+	// entropy 符号化された部分を読む bit reader
+	const uint8_t* m_bitp = nullptr;
+	uint32_t m_bitbuffer = 0;
+	int32_t m_bitcount = 0;
+	bool m_isMarkerHit = false;
+
+	int32_t NextMarker()
+	{
+		while (m_p < m_end && *m_p != 0xFF)
+			m_p++;
+		while (m_p < m_end && *m_p == 0xFF)
+			m_p++;
+		if (m_p >= m_end)
+			return -1;
+		return *m_p++;
+	}
+
+	bool ReadFrame(const uint8_t* p, const uint32_t& size)
+	{
+		if (size < 6 || p[0] != 8) {
+			std::cout << "JPEG: only 8 bit precision is supported" << std::endl;
+			return false;
+		}
+		m_height = (uint32_t(p[1]) << 8) | p[2];
+		m_width = (uint32_t(p[3]) << 8) | p[4];
+		const uint32_t count = p[5];
+		if (m_width == 0 || m_height == 0 || (count != 1 && count != 3) || size < 6 + 3 * count) {
+			std::cout << "JPEG: unsupported frame (" << count << " components)" << std::endl;
+			return false;
+		}
+
+		m_components.resize(count);
+		m_hmax = m_vmax = 1;
+		for (uint32_t i = 0; i < count; i++) {
+			const uint8_t* c = p + 6 + 3 * i;
+			m_components[i].id = c[0];
+			m_components[i].h = c[1] >> 4;
+			m_components[i].v = c[1] & 15;
+			m_components[i].tq = c[2] & 3;
+			if (m_components[i].h < 1 || m_components[i].h > 4 || m_components[i].v < 1 || m_components[i].v > 4)
+				return false;
+			m_hmax = std::max(m_hmax, m_components[i].h);
+			m_vmax = std::max(m_vmax, m_components[i].v);
+		}
+
+		m_mcuX = (m_width + 8 * m_hmax - 1) / (8 * m_hmax);
+		m_mcuY = (m_height + 8 * m_vmax - 1) / (8 * m_vmax);
+		for (auto& component : m_components) {
+			component.stride = m_mcuX * component.h * 8;
+			component.plane.assign(size_t(component.stride) * m_mcuY * component.v * 8, 0);
+		}
+		return true;
+	}
+
+	bool ReadHuffmanTables(const uint8_t* p, uint32_t size)
+	{
+		while (size >= 17) {
+			const uint32_t tc = p[0] >> 4;
+			const uint32_t th = p[0] & 15;
+			uint32_t total = 0;
+			for (uint32_t i = 0; i < 16; i++)
+				total += p[1 + i];
+			if (tc > 1 || th > 3 || total > 256 || size < 17 + total)
+				return false;
+			JPEGHuffman& table = (tc == 0) ? m_dcTables[th] : m_acTables[th];
+			if (!BuildJPEGHuffman(table, p + 1, p + 17))
+				return false;
+			((tc == 0) ? m_isDCTableDefined[th] : m_isACTableDefined[th]) = true;
+			p += 17 + total;
+			size -= 17 + total;
+		}
+		return true;
+	}
+
+	bool ReadQuantizationTables(const uint8_t* p, uint32_t size)
+	{
+		while (size >= 65) {
+			const uint32_t pq = p[0] >> 4;
+			const uint32_t tq = p[0] & 15;
+			const uint32_t tableSize = (pq == 0) ? 65 : 129;
+			if (tq > 3 || size < tableSize)
+				return false;
+			uint16_t quantization[64];
+			for (uint32_t i = 0; i < 64; i++)
+				quantization[i] = (pq == 0) ? p[1 + i] : uint16_t((p[1 + 2 * i] << 8) | p[2 + 2 * i]);
+			JPEGDequantizeScale(quantization, m_dequantize[tq]);
+			p += tableSize;
+			size -= tableSize;
+		}
+		return true;
+	}
+
+	void ResetBits()
+	{
+		m_bitbuffer = 0;
+		m_bitcount = 0;
+		m_isMarkerHit = false;
+	}
+
+	void FillBits()
+	{
+		while (m_bitcount <= 24) {
+			uint32_t byte = 0;
+			if (!m_isMarkerHit && m_bitp < m_end) {
+				byte = *m_bitp;
+				if (byte == 0xFF) {
+					const uint32_t next = (m_bitp + 1 < m_end) ? m_bitp[1] : 0xD9;
+					if (next == 0x00) {
+						m_bitp += 2; // byte stuffing
+					}
+					else {
+						// marker に当たったら以降は 0 を詰める (m_bitp は marker の先頭で止める)
+						m_isMarkerHit = true;
+						byte = 0;
+					}
+				}
+				else {
+					m_bitp++;
+				}
+			}
+			m_bitbuffer |= byte << (24 - m_bitcount);
+			m_bitcount += 8;
+		}
+	}
+
+	uint32_t GetBits(const uint32_t& n)
+	{
+		if (n == 0)
+			return 0;
+		if (m_bitcount < int32_t(n))
+			FillBits();
+		const uint32_t value = m_bitbuffer >> (32 - n);
+		m_bitbuffer <<= n;
+		m_bitcount -= n;
+		return value;
+	}
+
+	// n bit を読んで符号付きの値に直す (JPEG の EXTEND)
+	int32_t Receive(const uint32_t& n)
+	{
+		if (n == 0)
+			return 0;
+		const int32_t value = int32_t(GetBits(n));
+		return (value < (1 << (n - 1))) ? value - (1 << n) + 1 : value;
+	}
+
+	int32_t DecodeHuffman(const JPEGHuffman& huffman)
+	{
+		if (m_bitcount < 16)
+			FillBits();
+
+		const uint32_t fast = huffman.fast[m_bitbuffer >> (32 - JPEGHuffman::FastBits)];
+		if (fast != 255) {
+			const uint32_t s = huffman.size[fast];
+			m_bitbuffer <<= s;
+			m_bitcount -= s;
+			return huffman.value[fast];
+		}
+
+		const uint32_t k = m_bitbuffer >> 16;
+		uint32_t s = JPEGHuffman::FastBits + 1;
+		while (s <= 16 && k >= huffman.maxcode[s])
+			s++;
+		if (s > 16)
+			return -1;
+		const int32_t index = int32_t(m_bitbuffer >> (32 - s)) + huffman.delta[s];
+		if (index < 0 || index >= 256 || huffman.size[index] != s)
+			return -1;
+		m_bitbuffer <<= s;
+		m_bitcount -= s;
+		return huffman.value[index];
+	}
+
+	bool DecodeBlock(Component& component, uint8_t* out)
+	{
+		static constexpr uint8_t Zigzag[64 + 16] = {
+			0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+			12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+			35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+			58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+			// 壊れたデータで k が 63 を越えても範囲外に書かないための余白
+			63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63
+		};
+
+		const float* dequantize = m_dequantize[component.tq];
+		float coefficients[64] = {};
+
+		const int32_t t = DecodeHuffman(m_dcTables[component.td]);
+		if (t < 0 || t > 16)
+			return false;
+		component.dcpred += Receive(uint32_t(t));
+		coefficients[0] = float(component.dcpred) * dequantize[0];
+
+		const JPEGHuffman& ac = m_acTables[component.ta];
+		for (uint32_t k = 1; k < 64;) {
+			const int32_t rs = DecodeHuffman(ac);
+			if (rs < 0)
+				return false;
+			const uint32_t r = uint32_t(rs) >> 4;
+			const uint32_t s = uint32_t(rs) & 15;
+			if (s == 0) {
+				if (r != 15)
+					break; // EOB
+				k += 16;
+				continue;
+			}
+			k += r;
+			if (k > 63)
+				return false;
+			const uint32_t natural = Zigzag[k];
+			coefficients[natural] = float(Receive(s)) * dequantize[natural];
+			k++;
+		}
+
+		JPEGInverseDCT(coefficients, out, component.stride);
+		return true;
+	}
+
+	// restart marker を読み飛ばし、DC の予測値を戻す
+	bool HandleRestart()
+	{
+		ResetBits();
+		while (m_bitp + 1 < m_end && !(m_bitp[0] == 0xFF && m_bitp[1] >= 0xD0 && m_bitp[1] <= 0xD7))
+			m_bitp++;
+		if (m_bitp + 1 >= m_end)
+			return false;
+		m_bitp += 2;
+		for (auto& component : m_components)
+			component.dcpred = 0;
+		return true;
+	}
+
+	bool ReadScan(const uint8_t* p, const uint32_t& size)
+	{
+		if (size < 1)
+			return false;
+		const uint32_t count = p[0];
+		if (count < 1 || count > 4 || size < 4 + 2 * count)
+			return false;
+
+		std::vector<Component*> scanComponents;
+		for (uint32_t i = 0; i < count; i++) {
+			const uint32_t id = p[1 + 2 * i];
+			const uint32_t tables = p[2 + 2 * i];
+			Component* pComponent = nullptr;
+			for (auto& component : m_components) {
+				if (component.id == id)
+					pComponent = &component;
+			}
+			if (pComponent == nullptr)
+				return false;
+			pComponent->td = tables >> 4;
+			pComponent->ta = tables & 15;
+			if (pComponent->td > 3 || pComponent->ta > 3 || !m_isDCTableDefined[pComponent->td] || !m_isACTableDefined[pComponent->ta]) {
+				std::cout << "JPEG: scan uses an undefined Huffman table" << std::endl;
+				return false;
+			}
+			pComponent->dcpred = 0;
+			scanComponents.push_back(pComponent);
+		}
+
+		m_bitp = m_p;
+		ResetBits();
+
+		uint32_t restartCount = 0;
+		auto NextMCU = [&]() -> bool {
+			if (m_restartInterval == 0 || ++restartCount < m_restartInterval)
+				return true;
+			restartCount = 0;
+			return HandleRestart();
+		};
+
+		if (count == 1) {
+			// 非 interleave : 成分ごとの画素数で block を並べる (MCU = 1 block)
+			Component& component = *scanComponents[0];
+			const uint32_t blocksX = ((m_width * component.h + m_hmax - 1) / m_hmax + 7) / 8;
+			const uint32_t blocksY = ((m_height * component.v + m_vmax - 1) / m_vmax + 7) / 8;
+			const uint32_t total = blocksX * blocksY;
+			for (uint32_t by = 0; by < blocksY; by++) {
+				for (uint32_t bx = 0; bx < blocksX; bx++) {
+					uint8_t* out = component.plane.data() + size_t(component.stride) * by * 8 + bx * 8;
+					if (!DecodeBlock(component, out))
+						return false;
+					if (by * blocksX + bx + 1 < total && !NextMCU())
+						return false;
+				}
+			}
+		}
+		else {
+			const uint32_t total = m_mcuX * m_mcuY;
+			for (uint32_t my = 0; my < m_mcuY; my++) {
+				for (uint32_t mx = 0; mx < m_mcuX; mx++) {
+					for (Component* pComponent : scanComponents) {
+						for (uint32_t v = 0; v < pComponent->v; v++) {
+							for (uint32_t h = 0; h < pComponent->h; h++) {
+								const size_t x = size_t(mx * pComponent->h + h) * 8;
+								const size_t y = size_t(my * pComponent->v + v) * 8;
+								if (!DecodeBlock(*pComponent, pComponent->plane.data() + y * pComponent->stride + x))
+									return false;
+							}
+						}
+					}
+					if (my * m_mcuX + mx + 1 < total && !NextMCU())
+						return false;
+				}
+			}
+		}
+
+		// scan の後ろの marker まで進める
+		m_p = m_bitp;
+		return true;
+	}
+
+	void ConvertToRGBA(std::vector<uint8_t>& rgba)
+	{
+		rgba.resize(size_t(m_width) * m_height * 4);
+
+		// 成分ごとに、出力画素の x から plane 上の x を引く表を作る (最近傍)
+		std::vector<std::vector<uint32_t>> columnIndex(m_components.size());
+		for (uint32_t c = 0; c < m_components.size(); c++) {
+			columnIndex[c].resize(m_width);
+			for (uint32_t x = 0; x < m_width; x++)
+				columnIndex[c][x] = x * m_components[c].h / m_hmax;
+		}
+
+		for (uint32_t y = 0; y < m_height; y++) {
+			uint8_t* out = rgba.data() + size_t(y) * m_width * 4;
+			if (m_components.size() == 1) {
+				const Component& g = m_components[0];
+				const uint8_t* row = g.plane.data() + size_t(y * g.v / m_vmax) * g.stride;
+				for (uint32_t x = 0; x < m_width; x++) {
+					out[4 * x + 0] = out[4 * x + 1] = out[4 * x + 2] = row[columnIndex[0][x]];
+					out[4 * x + 3] = 255;
+				}
+				continue;
+			}
+
+			const uint8_t* rows[3];
+			for (uint32_t c = 0; c < 3; c++)
+				rows[c] = m_components[c].plane.data() + size_t(y * m_components[c].v / m_vmax) * m_components[c].stride;
+
+			for (uint32_t x = 0; x < m_width; x++) {
+				const int32_t c0 = rows[0][columnIndex[0][x]];
+				const int32_t c1 = rows[1][columnIndex[1][x]];
+				const int32_t c2 = rows[2][columnIndex[2][x]];
+				if (m_isAdobeRGB) {
+					out[4 * x + 0] = uint8_t(c0);
+					out[4 * x + 1] = uint8_t(c1);
+					out[4 * x + 2] = uint8_t(c2);
+				}
+				else {
+					// JFIF の YCbCr -> RGB (16 bit 固定小数)
+					const int32_t y = (c0 << 16) + 32768;
+					const int32_t cb = c1 - 128;
+					const int32_t cr = c2 - 128;
+					out[4 * x + 0] = uint8_t(std::clamp((y + 91881 * cr) >> 16, 0, 255));
+					out[4 * x + 1] = uint8_t(std::clamp((y - 22554 * cb - 46802 * cr) >> 16, 0, 255));
+					out[4 * x + 2] = uint8_t(std::clamp((y + 116130 * cb) >> 16, 0, 255));
+				}
+				out[4 * x + 3] = 255;
+			}
+		}
+	}
+};
+
+bool DecodeJPEG(const uint8_t* data, const size_t& size, std::vector<uint8_t>& rgba, uint32_t& width, uint32_t& height)
+{
+	JPEGDecoder decoder(data, size);
+	return decoder.Decode(rgba, width, height);
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <filesystem>
+#include "src/utils/mathfunc/mathfunc.hpp"
+#include "src/utils/fileloader/MappedFile.hpp"
+#include "src/utils/fileloader/OBJLoader.hpp"
+
+// OBJ の material (.mtl) を読む
+// PBR 拡張 (Pr, Pm, map_Pr, map_Pm, norm) が無いときは Ns から roughness を決める
+// texture のファイル名は mtl のあるディレクトリからの path に直しておく
+
+struct OBJMaterial {
+	std::string name;
+
+	fvec3 albedo = fvec3(1.0f, 1.0f, 1.0f); // Kd
+	float roughness = 0.5f;                 // Pr (無ければ Ns から換算)
+	float metallic = 0.0f;                  // Pm
+
+	std::string albedoTexture;    // map_Kd
+	std::string roughnessTexture; // map_Pr
+	std::string metallicTexture;  // map_Pm
+	std::string normalTexture;    // norm / map_Bump / bump
+};
+
+// "map_Kd -s 1 1 1 -bm 0.5 foo bar.png" のような行から option を除いたファイル名を読み、
+// directory からの path にする
+std::string MTLParseTexturePath(const char*& p, const char* const end, const std::filesystem::path& directory)
+{
+	while (true) {
+		p = OBJSkipSpace(p, end);
+		if (p >= end || *p != '-')
+			break;
+
+		const std::string_view option = OBJParseKeyword(p, end);
+		// 引数の数が決まっている option
+		uint32_t argumentCount = 1;
+		if (option == "-mm")
+			argumentCount = 2;
+		if (option == "-o" || option == "-s" || option == "-t") {
+			// 1 - 3 個の数値
+			float value;
+			for (uint32_t i = 0; i < 3; i++) {
+				const char* q = p;
+				if (!OBJParseFloat(q, end, value))
+					break;
+				p = q;
+			}
+			continue;
+		}
+		for (uint32_t i = 0; i < argumentCount; i++)
+			OBJParseKeyword(p, end);
+	}
+
+	std::string name = OBJParseName(p, end);
+	if (name.empty())
+		return name;
+
+	// Windows で書かれた mtl は区切りが '\' になっている
+	for (char& c : name) {
+		if (c == '\\')
+			c = '/';
+	}
+	return (directory / std::filesystem::path(name)).lexically_normal().generic_string();
+}
+
+bool LoadMTLFile(const char* filename, std::vector<OBJMaterial>& materials)
+{
+	std::vector<char> buffer;
+	if (!ReadOBJFile(filename, buffer))
+		return false;
+
+	const std::filesystem::path directory = std::filesystem::path(filename).parent_path();
+
+	const char* p = buffer.data();
+	const char* const end = buffer.data() + buffer.size();
+
+	OBJMaterial* pMaterial = nullptr;
+	bool hasRoughness = false;
+
+	while (p < end) {
+		std::string_view linetype = OBJParseKeyword(p, end);
+
+		if (linetype == "newmtl") {
+			materials.emplace_back();
+			pMaterial = &materials.back();
+			pMaterial->name = OBJParseName(p, end);
+			hasRoughness = false;
+		}
+		else if (pMaterial == nullptr) {
+			// newmtl より前の行は無視する
+		}
+		else if (linetype == "Kd") {
+			float r = 1.0, g = 1.0, b = 1.0;
+			OBJParseFloat(p, end, r) && OBJParseFloat(p, end, g) && OBJParseFloat(p, end, b);
+			pMaterial->albedo = fvec3(r, g, b);
+		}
+		else if (linetype == "Pr") {
+			OBJParseFloat(p, end, pMaterial->roughness);
+			hasRoughness = true;
+		}
+		else if (linetype == "Pm") {
+			OBJParseFloat(p, end, pMaterial->metallic);
+		}
+		else if (linetype == "Ns" && !hasRoughness) {
+			// Blinn-Phong の指数から Beckmann の roughness に換算する
+			float shininess = 0.0;
+			if (OBJParseFloat(p, end, shininess))
+				pMaterial->roughness = std::sqrt(2.0f / (std::max(shininess, 0.0f) + 2.0f));
+		}
+		else if (linetype == "map_Kd") {
+			pMaterial->albedoTexture = MTLParseTexturePath(p, end, directory);
+		}
+		else if (linetype == "map_Pr") {
+			pMaterial->roughnessTexture = MTLParseTexturePath(p, end, directory);
+		}
+		else if (linetype == "map_Pm") {
+			pMaterial->metallicTexture = MTLParseTexturePath(p, end, directory);
+		}
+		else if (linetype == "norm" || linetype == "map_Bump" || linetype == "map_bump" || linetype == "bump") {
+			// norm を優先する (map_Bump は height map のこともある)
+			if (linetype == "norm" || pMaterial->normalTexture.empty())
+				pMaterial->normalTexture = MTLParseTexturePath(p, end, directory);
+		}
+
+		p = OBJSkipLine(p, end);
+	}
+
+	return true;
+}
+
+// OBJ の mtllib に書かれた mtl のファイル名を、OBJ のあるディレクトリからの path にして返す
+// 面などは読まないので、mesh cache から読むときにも使える
+bool ReadOBJMaterialLibraries(const char* filename, std::vector<std::string>& libraries)
+{
+	MappedFile file;
+	if (!file.Open(filename))
+		return false;
+
+	const std::filesystem::path directory = std::filesystem::path(filename).parent_path();
+
+	const char* p = file.data();
+	const char* const end = p + file.size();
+	while (p < end) {
+		const char* next = static_cast<const char*>(std::memchr(p, '\n', end - p));
+		next = (next != nullptr) ? next + 1 : end;
+
+		const char* q = OBJSkipSpace(p, next);
+		if (q < next && *q == 'm' && OBJParseKeyword(q, next) == "mtllib") {
+			// 空白区切りで複数書ける
+			while (true) {
+				const std::string_view name = OBJParseKeyword(q, next);
+				if (name.empty())
+					break;
+				libraries.push_back((directory / std::filesystem::path(std::string(name))).lexically_normal().generic_string());
+			}
+		}
+
+		p = next;
+	}
+
+	return true;
+}
+
+// OBJ の mtllib から参照される全ての material を読む
+bool LoadOBJMaterials(const char* filename, std::vector<OBJMaterial>& materials)
+{
+	std::vector<std::string> libraries;
+	if (!ReadOBJMaterialLibraries(filename, libraries))
+		return false;
+
+	for (const auto& library : libraries) {
+		if (!LoadMTLFile(library.c_str(), materials))
+			std::cout << "fail to load material library: " << library << std::endl;
+	}
+
+	return true;
+}
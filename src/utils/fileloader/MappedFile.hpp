@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// ファイル全体を読み込み専用で memory map する
+// 0 byte のファイルは data() == nullptr, size() == 0 として開ける
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	~MappedFile()
+	{
+		Close();
+	}
+
+	bool Open(const char* filename)
+	{
+		Close();
+
+#ifdef _WIN32
+		m_hFile = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (m_hFile == INVALID_HANDLE_VALUE) {
+			std::cout << "fail to open file: " << filename << std::endl;
+			return false;
+		}
+
+		LARGE_INTEGER filesize;
+		GetFileSizeEx(m_hFile, &filesize);
+		m_size = size_t(filesize.QuadPart);
+		if (m_size == 0)
+			return true;
+
+		m_hMapping = CreateFileMappingA(m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_hMapping != nullptr)
+			m_pData = static_cast<const char*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+#else
+		m_fd = open(filename, O_RDONLY);
+		if (m_fd < 0) {
+			std::cout << "fail to open file: " << filename << std::endl;
+			return false;
+		}
+
+		struct stat filestat;
+		fstat(m_fd, &filestat);
+		m_size = size_t(filestat.st_size);
+		if (m_size == 0)
+			return true;
+
+		void* pMapped = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+		if (pMapped != MAP_FAILED) {
+			m_pData = static_cast<const char*>(pMapped);
+			madvise(pMapped, m_size, MADV_SEQUENTIAL);
+		}
+#endif
+
+		if (m_pData == nullptr) {
+			std::cout << "fail to map file: " << filename << std::endl;
+			Close();
+			return false;
+		}
+
+		return true;
+	}
+
+	void Close()
+	{
+#ifdef _WIN32
+		if (m_pData != nullptr)
+			UnmapViewOfFile(m_pData);
+		if (m_hMapping != nullptr)
+			CloseHandle(m_hMapping);
+		if (m_hFile != INVALID_HANDLE_VALUE)
+			CloseHandle(m_hFile);
+		m_hMapping = nullptr;
+		m_hFile = INVALID_HANDLE_VALUE;
+#else
+		if (m_pData != nullptr)
+			munmap(const_cast<char*>(m_pData), m_size);
+		if (m_fd >= 0)
+			close(m_fd);
+		m_fd = -1;
+#endif
+		m_pData = nullptr;
+		m_size = 0;
+	}
+
+	const char* data() const
+	{
+		return m_pData;
+	}
+
+	size_t size() const
+	{
+		return m_size;
+	}
+
+private:
+	const char* m_pData = nullptr;
+	size_t m_size = 0;
+
+#ifdef _WIN32
+	HANDLE m_hFile = INVALID_HANDLE_VALUE;
+	HANDLE m_hMapping = nullptr;
+#else
+	int m_fd = -1;
+#endif
+};
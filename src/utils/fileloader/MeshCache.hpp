@@ -0,0 +1,365 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include "src/utils/mathfunc/mathfunc.hpp"
+#include "src/utils/fileloader/MappedFile.hpp"
+#include "src/utils/fileloader/OBJLoader.hpp"
+#include "src/utils/geometry/MeshConv.hpp"
+
+// OBJ を読んだ結果をそのまま mmap して使える binary mesh cache (.pbmc)
+// header, 各 section (先頭を MeshCacheAlignment byte 境界に揃える) の順に書く
+// section は要素をそのまま並べたもので、mmap した領域を fvec3* / uint32_t* として直接参照できる
+// 元の OBJ の size と更新時刻を header に持ち、OBJ が更新されていたら作り直す
+
+constexpr uint32_t MeshCacheMagic = 0x434d4250; // "PBMC"
+constexpr uint32_t MeshCacheVersion = 2;
+constexpr uint64_t MeshCacheAlignment = 64;
+
+static_assert(sizeof(fvec3) == 3 * sizeof(float), "fvec3 must be tightly packed");
+static_assert(sizeof(fvec2) == 2 * sizeof(float), "fvec2 must be tightly packed");
+
+enum MeshCacheKind : uint32_t {
+	MeshCacheRenderTriangle,  // LoadOBJtoRenderTriangleMesh の出力
+	MeshCachePhysicsTriangle, // LoadOBJtoPhysicsTriangleMesh の出力
+};
+
+enum MeshCacheSectionType : uint32_t {
+	MeshCachePositions,
+	MeshCacheNormals,
+	MeshCacheUVs,
+	MeshCacheIndices,
+	MeshCacheVEIndex, // ConvertEVtoVE の elsup_index (頂点数 + 1)
+	MeshCacheVEList,  // ConvertEVtoVE の elsup
+	MeshCacheEdges,   // ConvertPTMtoPEM の edge list
+	MeshCacheSectionCount,
+};
+
+struct MeshCacheSection {
+	uint64_t offset; // ファイル先頭からの byte offset
+	uint64_t count;  // 要素数
+};
+
+struct MeshCacheHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t kind;
+	uint32_t sectionCount;
+	uint64_t sourceSize;
+	int64_t sourceTime;
+	float meshoffset[3];
+	float meshscale;
+	MeshCacheSection sections[MeshCacheSectionCount];
+};
+
+// mmap した section への view
+template <class T>
+struct MeshCacheArray {
+	const T* data = nullptr;
+	uint32_t size = 0;
+
+	const T& operator[](const uint32_t& i) const
+	{
+		return data[i];
+	}
+};
+
+std::string GetMeshCachePath(const char* objfilename, const MeshCacheKind& kind)
+{
+	return std::string(objfilename) + (kind == MeshCacheRenderTriangle ? ".render.pbmc" : ".physics.pbmc");
+}
+
+// 元ファイルの size と更新時刻
+bool GetMeshCacheSourceStamp(const char* filename, uint64_t& sourceSize, int64_t& sourceTime)
+{
+	std::error_code ec;
+	sourceSize = std::filesystem::file_size(filename, ec);
+	if (ec)
+		return false;
+	sourceTime = std::filesystem::last_write_time(filename, ec).time_since_epoch().count();
+	return !ec;
+}
+
+// section ごとの (data, 要素数, 要素 size) を受け取って書く
+// 一時ファイルに書いてから rename するので、書き込み途中の cache を他の process が読むことはない
+bool WriteMeshCache(
+    const char* const cachefilename,
+    const MeshCacheKind& kind,
+    const char* const sourcefilename,
+    const fvec3& meshoffset,
+    const float& meshscale,
+    const void* const (&sectionData)[MeshCacheSectionCount],
+    const uint32_t (&sectionCount)[MeshCacheSectionCount],
+    const uint32_t (&sectionElementSize)[MeshCacheSectionCount])
+{
+	MeshCacheHeader header;
+	std::memset(&header, 0, sizeof(MeshCacheHeader));
+	header.magic = MeshCacheMagic;
+	header.version = MeshCacheVersion;
+	header.kind = kind;
+	header.sectionCount = MeshCacheSectionCount;
+	if (!GetMeshCacheSourceStamp(sourcefilename, header.sourceSize, header.sourceTime)) {
+		std::cout << "fail to stat file: " << sourcefilename << std::endl;
+		return false;
+	}
+	header.meshoffset[0] = meshoffset.x;
+	header.meshoffset[1] = meshoffset.y;
+	header.meshoffset[2] = meshoffset.z;
+	header.meshscale = meshscale;
+
+	uint64_t offset = sizeof(MeshCacheHeader);
+	for (uint32_t i = 0; i < MeshCacheSectionCount; i++) {
+		offset = (offset + MeshCacheAlignment - 1) / MeshCacheAlignment * MeshCacheAlignment;
+		header.sections[i].offset = offset;
+		header.sections[i].count = sectionCount[i];
+		offset += uint64_t(sectionCount[i]) * sectionElementSize[i];
+	}
+
+	const std::string tempfilename = std::string(cachefilename) + ".tmp";
+	{
+		std::ofstream file(tempfilename, std::ios::binary);
+		if (!file) {
+			std::cout << "fail to open file: " << tempfilename << std::endl;
+			return false;
+		}
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(MeshCacheHeader));
+
+		const char padding[MeshCacheAlignment] = {};
+		uint64_t written = sizeof(MeshCacheHeader);
+		for (uint32_t i = 0; i < MeshCacheSectionCount; i++) {
+			file.write(padding, header.sections[i].offset - written);
+			const uint64_t size = uint64_t(sectionCount[i]) * sectionElementSize[i];
+			if (size > 0)
+				file.write(static_cast<const char*>(sectionData[i]), size);
+			written = header.sections[i].offset + size;
+		}
+
+		if (!file) {
+			std::cout << "fail to write file: " << tempfilename << std::endl;
+			return false;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tempfilename, cachefilename, ec);
+	if (ec) {
+		std::cout << "fail to write file: " << cachefilename << std::endl;
+		std::filesystem::remove(tempfilename, ec);
+		return false;
+	}
+
+	return true;
+}
+
+// OBJ を読んで cache を書く
+// withAdjacency のときは ConvertEVtoVE の CSR と ConvertPTMtoPEM の edge list も書く
+bool ConvertOBJtoMeshCache(
+    const char* const objfilename,
+    const char* const cachefilename,
+    const MeshCacheKind& kind,
+    const fvec3& meshoffset,
+    const float& meshscale,
+    const bool& withAdjacency,
+    const uint32_t& threadcount = 1)
+{
+	std::vector<fvec3> positions;
+	std::vector<fvec3> normals;
+	std::vector<fvec2> uvs;
+	std::vector<uint32_t> faceindices;
+
+	if (kind == MeshCacheRenderTriangle) {
+		if (!LoadOBJtoRenderTriangleMesh(objfilename, positions, normals, uvs, faceindices, meshoffset, meshscale, threadcount))
+			return false;
+	}
+	else {
+		fvec3* pVertData = nullptr;
+		uint32_t vertSize = 0;
+		uint32_t* pIListData = nullptr;
+		uint32_t iListSize = 0;
+		if (!LoadOBJtoPhysicsTriangleMesh(objfilename, &pVertData, vertSize, &pIListData, iListSize, meshoffset, meshscale, threadcount))
+			return false;
+
+		positions.assign(pVertData, pVertData + vertSize);
+		faceindices.assign(pIListData, pIListData + iListSize);
+		delete[] pVertData;
+		delete[] pIListData;
+	}
+
+	const uint32_t vertSize = positions.size();
+	const uint32_t iListSize = faceindices.size();
+
+	uint32_t* pElsup_index = nullptr;
+	uint32_t* pElsup = nullptr;
+	uint32_t* pEdgeData = nullptr;
+	uint32_t edgeSize = 0;
+	if (withAdjacency) {
+		ConvertEVtoVE(vertSize, faceindices.data(), iListSize, &pElsup_index, &pElsup);
+		ConvertPTMtoPEM(vertSize, faceindices.data(), iListSize, &pEdgeData, edgeSize);
+	}
+
+	const void* const sectionData[MeshCacheSectionCount] = {
+		positions.data(), normals.data(), uvs.data(), faceindices.data(), pElsup_index, pElsup, pEdgeData
+	};
+	const uint32_t sectionCount[MeshCacheSectionCount] = {
+		vertSize,
+		uint32_t(normals.size()),
+		uint32_t(uvs.size()),
+		iListSize,
+		withAdjacency ? vertSize + 1 : 0,
+		withAdjacency ? iListSize : 0,
+		edgeSize
+	};
+	const uint32_t sectionElementSize[MeshCacheSectionCount] = {
+		sizeof(fvec3), sizeof(fvec3), sizeof(fvec2), sizeof(uint32_t), sizeof(uint32_t), sizeof(uint32_t), sizeof(uint32_t)
+	};
+
+	const bool result = WriteMeshCache(cachefilename, kind, objfilename, meshoffset, meshscale, sectionData, sectionCount, sectionElementSize);
+
+	delete[] pElsup_index;
+	delete[] pElsup;
+	delete[] pEdgeData;
+
+	return result;
+}
+
+// mmap した cache
+// 各 MeshCacheArray は MeshCache が生きている間だけ有効
+// (DrawVertexArray への upload や physics の入力配列としてそのまま使う)
+class MeshCache
+{
+public:
+	MeshCacheArray<fvec3> positions;
+	MeshCacheArray<fvec3> normals;
+	MeshCacheArray<fvec2> uvs;
+	MeshCacheArray<uint32_t> indices;
+	MeshCacheArray<uint32_t> veIndex;
+	MeshCacheArray<uint32_t> veList;
+	MeshCacheArray<uint32_t> edges;
+
+	bool Open(const char* const cachefilename)
+	{
+		Close();
+
+		if (!m_file.Open(cachefilename))
+			return false;
+
+		if (m_file.size() < sizeof(MeshCacheHeader)) {
+			std::cout << cachefilename << " is not a mesh cache file" << std::endl;
+			Close();
+			return false;
+		}
+
+		std::memcpy(&m_header, m_file.data(), sizeof(MeshCacheHeader));
+		if (m_header.magic != MeshCacheMagic || m_header.version != MeshCacheVersion || m_header.sectionCount != MeshCacheSectionCount) {
+			std::cout << cachefilename << " is not a mesh cache file" << std::endl;
+			Close();
+			return false;
+		}
+
+		const uint32_t sectionElementSize[MeshCacheSectionCount] = {
+			sizeof(fvec3), sizeof(fvec3), sizeof(fvec2), sizeof(uint32_t), sizeof(uint32_t), sizeof(uint32_t), sizeof(uint32_t)
+		};
+		for (uint32_t i = 0; i < MeshCacheSectionCount; i++) {
+			const MeshCacheSection& section = m_header.sections[i];
+			// offset + count * size は壊れたファイルで桁あふれするので、残りの byte 数と比べる
+			if (section.offset % MeshCacheAlignment != 0
+			    || section.offset > m_file.size()
+			    || section.count > UINT32_MAX
+			    || section.count > (m_file.size() - section.offset) / sectionElementSize[i]) {
+				std::cout << cachefilename << " is broken" << std::endl;
+				Close();
+				return false;
+			}
+		}
+
+		SetArray(positions, MeshCachePositions);
+		SetArray(normals, MeshCacheNormals);
+		SetArray(uvs, MeshCacheUVs);
+		SetArray(indices, MeshCacheIndices);
+		SetArray(veIndex, MeshCacheVEIndex);
+		SetArray(veList, MeshCacheVEList);
+		SetArray(edges, MeshCacheEdges);
+
+		return true;
+	}
+
+	void Close()
+	{
+		m_file.Close();
+		std::memset(&m_header, 0, sizeof(MeshCacheHeader));
+		positions = MeshCacheArray<fvec3>();
+		normals = MeshCacheArray<fvec3>();
+		uvs = MeshCacheArray<fvec2>();
+		indices = MeshCacheArray<uint32_t>();
+		veIndex = MeshCacheArray<uint32_t>();
+		veList = MeshCacheArray<uint32_t>();
+		edges = MeshCacheArray<uint32_t>();
+	}
+
+	// objfilename から kind, meshoffset, meshscale で作った cache で、OBJ がその後更新されていないか
+	bool IsUpToDate(const char* const objfilename, const MeshCacheKind& kind, const fvec3& meshoffset, const float& meshscale, const bool& withAdjacency) const
+	{
+		uint64_t sourceSize;
+		int64_t sourceTime;
+		if (!GetMeshCacheSourceStamp(objfilename, sourceSize, sourceTime))
+			return false;
+
+		return m_header.kind == kind
+		    && m_header.sourceSize == sourceSize
+		    && m_header.sourceTime == sourceTime
+		    && m_header.meshoffset[0] == meshoffset.x
+		    && m_header.meshoffset[1] == meshoffset.y
+		    && m_header.meshoffset[2] == meshoffset.z
+		    && m_header.meshscale == meshscale
+		    && (!withAdjacency || veIndex.size == positions.size + 1);
+	}
+
+	const MeshCacheHeader& GetHeader() const
+	{
+		return m_header;
+	}
+
+private:
+	MappedFile m_file;
+	MeshCacheHeader m_header = {};
+
+	template <class T>
+	void SetArray(MeshCacheArray<T>& array, const MeshCacheSectionType& type)
+	{
+		array.size = m_header.sections[type].count;
+		array.data = array.size > 0 ? reinterpret_cast<const T*>(m_file.data() + m_header.sections[type].offset) : nullptr;
+	}
+};
+
+// OBJ に対応する cache (GetMeshCachePath) を開く
+// cache が無い、壊れている、または OBJ の方が新しい場合は OBJ を読み直して cache を作り直す
+bool LoadMeshCache(
+    const char* const objfilename,
+    const MeshCacheKind& kind,
+    const fvec3& meshoffset,
+    const float& meshscale,
+    const bool& withAdjacency,
+    MeshCache& cache,
+    const uint32_t& threadcount = 1)
+{
+	const std::string cachefilename = GetMeshCachePath(objfilename, kind);
+
+	std::error_code ec;
+	if (std::filesystem::exists(cachefilename, ec) && cache.Open(cachefilename.c_str())) {
+		if (cache.IsUpToDate(objfilename, kind, meshoffset, meshscale, withAdjacency))
+			return true;
+		cache.Close();
+	}
+
+	std::cout << "build mesh cache: " << cachefilename << std::endl;
+	if (!ConvertOBJtoMeshCache(objfilename, cachefilename.c_str(), kind, meshoffset, meshscale, withAdjacency, threadcount))
+		return false;
+
+	return cache.Open(cachefilename.c_str());
+}
@@ -0,0 +1,448 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "src/utils/mathfunc/mathfunc.hpp"
+#include "src/utils/fileloader/MappedFile.hpp"
+#include "src/utils/fileloader/OBJLoader.hpp"
+#include "src/utils/fileloader/MeshCache.hpp"
+
+// 頂点数と接続が全 frame で同じ mesh の列 (シミュレーション結果の再生用) を 1 ファイルにまとめた形式 (.pbms)
+// header, uv, index (全 frame で共有), 各 frame の position と normal の順に書く
+// frame は 1 つあたり frameStride byte の固定長なので、frame 番号から offset が決まる
+// 再生時は frame ごとに OBJ を読み直したり DrawVertexArray を作り直したりせず、position と normal だけを差し替える
+
+constexpr uint32_t MeshSequenceMagic = 0x534d4250; // "PBMS"
+constexpr uint32_t MeshSequenceVersion = 1;
+constexpr uint64_t MeshSequenceAlignment = 64;
+
+struct MeshSequenceHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t frameCount;
+	float frameRate; // 1 秒あたりの frame 数
+	uint64_t uvOffset;    // ファイル先頭からの byte offset
+	uint64_t indexOffset;
+	uint64_t frameOffset; // frame 0 の offset
+	uint64_t frameStride; // position (vertexCount 個) と normal (vertexCount 個) を詰めたものを MeshSequenceAlignment に揃えた byte 数
+};
+
+inline uint64_t MeshSequenceAlign(const uint64_t& offset)
+{
+	return (offset + MeshSequenceAlignment - 1) / MeshSequenceAlignment * MeshSequenceAlignment;
+}
+
+// frame を 1 つずつ足していく
+// 一時ファイルに書いてから Close で rename するので、書き込み途中のファイルを他の process が読むことはない
+class MeshSequenceWriter
+{
+public:
+	MeshSequenceWriter() = default;
+	MeshSequenceWriter(const MeshSequenceWriter&) = delete;
+	MeshSequenceWriter& operator=(const MeshSequenceWriter&) = delete;
+
+	~MeshSequenceWriter()
+	{
+		// Close されなかったものは捨てる
+		if (m_file.is_open()) {
+			m_file.close();
+			std::error_code ec;
+			std::filesystem::remove(m_tempfilename, ec);
+		}
+	}
+
+	bool Open(const char* const filename, const std::vector<fvec2>& uvs, const std::vector<uint32_t>& indices, const float& frameRate)
+	{
+		m_filename = filename;
+		m_tempfilename = m_filename + ".tmp";
+		m_file.open(m_tempfilename, std::ios::binary);
+		if (!m_file) {
+			std::cout << "fail to open file: " << m_tempfilename << std::endl;
+			return false;
+		}
+
+		std::memset(&m_header, 0, sizeof(MeshSequenceHeader));
+		m_header.magic = MeshSequenceMagic;
+		m_header.version = MeshSequenceVersion;
+		m_header.vertexCount = uvs.size();
+		m_header.indexCount = indices.size();
+		m_header.frameCount = 0;
+		m_header.frameRate = frameRate;
+		m_header.uvOffset = MeshSequenceAlign(sizeof(MeshSequenceHeader));
+		m_header.indexOffset = MeshSequenceAlign(m_header.uvOffset + uvs.size() * sizeof(fvec2));
+		m_header.frameOffset = MeshSequenceAlign(m_header.indexOffset + indices.size() * sizeof(uint32_t));
+		m_header.frameStride = MeshSequenceAlign(2 * uint64_t(m_header.vertexCount) * sizeof(fvec3));
+
+		// frameCount は Close で書き直す
+		m_file.write(reinterpret_cast<const char*>(&m_header), sizeof(MeshSequenceHeader));
+		WritePadding(m_header.uvOffset - sizeof(MeshSequenceHeader));
+		m_file.write(reinterpret_cast<const char*>(uvs.data()), uvs.size() * sizeof(fvec2));
+		WritePadding(m_header.indexOffset - (m_header.uvOffset + uvs.size() * sizeof(fvec2)));
+		m_file.write(reinterpret_cast<const char*>(indices.data()), indices.size() * sizeof(uint32_t));
+		WritePadding(m_header.frameOffset - (m_header.indexOffset + indices.size() * sizeof(uint32_t)));
+
+		return bool(m_file);
+	}
+
+	bool AppendFrame(const std::vector<fvec3>& positions, const std::vector<fvec3>& normals)
+	{
+		if (positions.size() != m_header.vertexCount || normals.size() != m_header.vertexCount) {
+			std::cout << m_filename << " : frame " << m_header.frameCount << " has " << positions.size() << " vertices (expected " << m_header.vertexCount << ")" << std::endl;
+			return false;
+		}
+
+		m_file.write(reinterpret_cast<const char*>(positions.data()), positions.size() * sizeof(fvec3));
+		m_file.write(reinterpret_cast<const char*>(normals.data()), normals.size() * sizeof(fvec3));
+		WritePadding(m_header.frameStride - 2 * uint64_t(m_header.vertexCount) * sizeof(fvec3));
+		m_header.frameCount++;
+
+		return bool(m_file);
+	}
+
+	bool Close()
+	{
+		m_file.seekp(0);
+		m_file.write(reinterpret_cast<const char*>(&m_header), sizeof(MeshSequenceHeader));
+		const bool isSucceeded = bool(m_file);
+		m_file.close();
+
+		std::error_code ec;
+		if (!isSucceeded) {
+			std::cout << "fail to write file: " << m_tempfilename << std::endl;
+			std::filesystem::remove(m_tempfilename, ec);
+			return false;
+		}
+
+		std::filesystem::rename(m_tempfilename, m_filename, ec);
+		if (ec) {
+			std::cout << "fail to write file: " << m_filename << std::endl;
+			std::filesystem::remove(m_tempfilename, ec);
+			return false;
+		}
+
+		return true;
+	}
+
+private:
+	std::string m_filename;
+	std::string m_tempfilename;
+	std::ofstream m_file;
+	MeshSequenceHeader m_header = {};
+
+	void WritePadding(const uint64_t& size)
+	{
+		const char padding[MeshSequenceAlignment] = {};
+		m_file.write(padding, size);
+	}
+};
+
+// frame ごとの OBJ を読んで 1 つの sequence にまとめる
+// 全ての OBJ が同じ面の並びを持っている (LoadOBJtoRenderTriangleMesh の頂点と index が一致する) 必要がある
+bool ConvertOBJSequenceToMeshSequence(
+    const std::vector<std::string>& objfilenames,
+    const char* const sequencefilename,
+    const fvec3& meshoffset,
+    const float& meshscale,
+    const float& frameRate,
+    const uint32_t& threadcount = 1)
+{
+	if (objfilenames.empty()) {
+		std::cout << "no frame to write: " << sequencefilename << std::endl;
+		return false;
+	}
+
+	MeshSequenceWriter writer;
+	std::vector<uint32_t> topology;
+	std::vector<fvec3> positions;
+	std::vector<fvec3> normals;
+	std::vector<fvec2> uvs;
+	std::vector<uint32_t> faceindices;
+
+	for (size_t i = 0; i < objfilenames.size(); i++) {
+		const char* const objfilename = objfilenames[i].c_str();
+		if (!LoadOBJtoRenderTriangleMesh(objfilename, positions, normals, uvs, faceindices, meshoffset, meshscale, threadcount))
+			return false;
+
+		if (i == 0) {
+			if (!writer.Open(sequencefilename, uvs, faceindices, frameRate))
+				return false;
+			topology = faceindices;
+		}
+		else if (faceindices != topology) {
+			std::cout << objfilename << " has a different topology from " << objfilenames[0] << std::endl;
+			return false;
+		}
+
+		if (!writer.AppendFrame(positions, normals))
+			return false;
+	}
+
+	return writer.Close();
+}
+
+// mmap した sequence
+// uvs, indices は MeshSequence が生きている間だけ有効
+class MeshSequence
+{
+public:
+	MeshCacheArray<fvec2> uvs;
+	MeshCacheArray<uint32_t> indices;
+
+	bool Open(const char* const filename)
+	{
+		Close();
+
+		if (!m_file.Open(filename))
+			return false;
+
+		if (m_file.size() < sizeof(MeshSequenceHeader)) {
+			std::cout << filename << " is not a mesh sequence file" << std::endl;
+			Close();
+			return false;
+		}
+
+		std::memcpy(&m_header, m_file.data(), sizeof(MeshSequenceHeader));
+		if (m_header.magic != MeshSequenceMagic || m_header.version != MeshSequenceVersion) {
+			std::cout << filename << " is not a mesh sequence file" << std::endl;
+			Close();
+			return false;
+		}
+
+		// offset + count * size は壊れたファイルで桁あふれするので、残りの byte 数と比べる
+		const uint64_t filesize = m_file.size();
+		if (m_header.uvOffset % MeshSequenceAlignment != 0
+		    || m_header.indexOffset % MeshSequenceAlignment != 0
+		    || m_header.frameOffset % MeshSequenceAlignment != 0
+		    || m_header.frameStride < 2 * uint64_t(m_header.vertexCount) * sizeof(fvec3)
+		    || m_header.uvOffset > filesize
+		    || m_header.vertexCount > (filesize - m_header.uvOffset) / sizeof(fvec2)
+		    || m_header.indexOffset > filesize
+		    || m_header.indexCount > (filesize - m_header.indexOffset) / sizeof(uint32_t)
+		    || m_header.frameOffset > filesize
+		    || (m_header.frameCount > 0 && m_header.frameStride > (filesize - m_header.frameOffset) / m_header.frameCount)) {
+			std::cout << filename << " is broken" << std::endl;
+			Close();
+			return false;
+		}
+
+		uvs.size = m_header.vertexCount;
+		uvs.data = uvs.size > 0 ? reinterpret_cast<const fvec2*>(m_file.data() + m_header.uvOffset) : nullptr;
+		indices.size = m_header.indexCount;
+		indices.data = indices.size > 0 ? reinterpret_cast<const uint32_t*>(m_file.data() + m_header.indexOffset) : nullptr;
+
+		return true;
+	}
+
+	void Close()
+	{
+		m_file.Close();
+		std::memset(&m_header, 0, sizeof(MeshSequenceHeader));
+		uvs = MeshCacheArray<fvec2>();
+		indices = MeshCacheArray<uint32_t>();
+	}
+
+	uint32_t GetVertexCount() const
+	{
+		return m_header.vertexCount;
+	}
+
+	uint32_t GetFrameCount() const
+	{
+		return m_header.frameCount;
+	}
+
+	float GetFrameRate() const
+	{
+		return m_header.frameRate;
+	}
+
+	// frame の position と normal (それぞれ vertexCount 個) を mmap した領域から写す
+	// まだ読まれていない page はここで読まれるので、描画の thread からは呼ばず MeshSequenceStream に任せる
+	void ReadFrame(const uint32_t& frame, fvec3* const pPositions, fvec3* const pNormals) const
+	{
+		const char* const pFrame = m_file.data() + m_header.frameOffset + uint64_t(frame) * m_header.frameStride;
+		std::memcpy(static_cast<void*>(pPositions), pFrame, m_header.vertexCount * sizeof(fvec3));
+		std::memcpy(static_cast<void*>(pNormals), pFrame + m_header.vertexCount * sizeof(fvec3), m_header.vertexCount * sizeof(fvec3));
+	}
+
+	const MeshSequenceHeader& GetHeader() const
+	{
+		return m_header;
+	}
+
+private:
+	MappedFile m_file;
+	MeshSequenceHeader m_header = {};
+};
+
+// sequence の frame を裏の thread で先読みして ringSize 個の buffer に順に置いておく
+// 描画側は AcquireFrame で取り出して頂点 buffer に書き、ReleaseFrame で buffer を返す
+// 先読みした frame より先を要求されたら、間の frame を捨てて進める (描画が sequence より遅いとき)
+// 先読みしていない frame (戻る, 先読みより先へ飛ぶ) を要求されたら (seek) そこから読み直す
+// seek は先読みを捨てて読み終わるまで待つので、描画が sequence より速いときは frame が変わったときだけ AcquireFrame を呼ぶ
+class MeshSequenceStream
+{
+public:
+	MeshSequenceStream(const MeshSequence& sequence, const uint32_t& ringSize = 4, const bool& isLooping = true)
+		: m_sequence(sequence)
+		, m_ringSize(ringSize > 0 ? ringSize : 1)
+		, m_isLooping(isLooping)
+		, m_ring(size_t(m_ringSize) * 2 * sequence.GetVertexCount())
+	{
+		// frame 0 から先読みを始めておく
+		m_end = sequence.GetFrameCount() == 0 ? 0 : (m_isLooping ? UINT64_MAX : uint64_t(sequence.GetFrameCount()));
+		m_thread = std::thread([this]() { PrefetchLoop(); });
+	}
+
+	MeshSequenceStream(const MeshSequenceStream&) = delete;
+	MeshSequenceStream& operator=(const MeshSequenceStream&) = delete;
+
+	~MeshSequenceStream()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_isStopping = true;
+		}
+		m_prefetchCV.notify_all();
+		m_thread.join();
+	}
+
+	// frame が読み終わるまで待ち、その position と normal を返す
+	// 返した buffer は ReleaseFrame を呼ぶまで上書きされない
+	// isLooping でないときに最後の frame より後を要求されたら false
+	bool AcquireFrame(const uint32_t& frame, const fvec3*& pPositions, const fvec3*& pNormals)
+	{
+		if (frame >= m_sequence.GetFrameCount())
+			return false;
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (m_isAcquired) {
+			std::cout << "MeshSequenceStream : AcquireFrame is called twice without ReleaseFrame" << std::endl;
+			return false;
+		}
+
+		const uint64_t skip = GetDistanceTo(frame);
+		if (skip <= m_head - m_tail && m_tail + skip < m_end) {
+			// 先読みした (または読んでいる) frame まで、前の frame を捨てて進める
+			m_tail += skip;
+			m_prefetchCV.notify_all();
+		}
+		else {
+			// seek : 先読みした分を捨てて frame から読み直す
+			m_startFrame = frame;
+			m_head = 0;
+			m_tail = 0;
+			m_end = m_isLooping ? UINT64_MAX : uint64_t(m_sequence.GetFrameCount() - frame);
+			m_generation++;
+			m_prefetchCV.notify_all();
+		}
+
+		m_readyCV.wait(lock, [this]() { return m_tail < m_head; });
+
+		const size_t slot = m_tail % m_ringSize;
+		pPositions = m_ring.data() + slot * 2 * m_sequence.GetVertexCount();
+		pNormals = pPositions + m_sequence.GetVertexCount();
+		m_isAcquired = true;
+
+		return true;
+	}
+
+	void ReleaseFrame()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_isAcquired)
+				return;
+			m_isAcquired = false;
+			m_tail++;
+		}
+		m_prefetchCV.notify_all();
+	}
+
+	// frame が読み終わっていて、AcquireFrame が待たずに返るか (待たずに描画を進めたいとき用)
+	bool IsFrameReady(const uint32_t& frame)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return frame < m_sequence.GetFrameCount() && GetDistanceTo(frame) < m_head - m_tail;
+	}
+
+private:
+	const MeshSequence& m_sequence;
+	const uint32_t m_ringSize;
+	const bool m_isLooping;
+	std::vector<fvec3> m_ring; // slot ごとに position (vertexCount 個), normal (vertexCount 個)
+
+	std::thread m_thread;
+	std::mutex m_mutex;
+	std::condition_variable m_prefetchCV;
+	std::condition_variable m_readyCV;
+
+	// seek してからの通し番号で数える
+	// [m_tail, m_head) が読み終わって待っている frame, m_end は読む frame の数
+	uint32_t m_startFrame = 0;
+	uint64_t m_head = 0;
+	uint64_t m_tail = 0;
+	uint64_t m_end = 0;
+	uint64_t m_generation = 0; // seek のたびに増やす
+	bool m_isAcquired = false;
+	bool m_isStopping = false;
+
+	uint32_t GetFrameOf(const uint64_t& count) const
+	{
+		return uint32_t((m_startFrame + count) % m_sequence.GetFrameCount());
+	}
+
+	// m_tail の frame から frame まで進む数 (戻るときは UINT64_MAX)
+	// loop するときは最後の frame の次を frame 0 として数える
+	uint64_t GetDistanceTo(const uint32_t& frame) const
+	{
+		const uint32_t tailFrame = GetFrameOf(m_tail);
+		if (frame >= tailFrame)
+			return frame - tailFrame;
+		if (m_isLooping)
+			return uint64_t(frame) + m_sequence.GetFrameCount() - tailFrame;
+		return UINT64_MAX;
+	}
+
+	void PrefetchLoop()
+	{
+		while (true) {
+			uint64_t count;
+			uint64_t generation;
+			uint32_t frame;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_prefetchCV.wait(lock, [this]() { return m_isStopping || (m_head < m_end && m_head - m_tail < m_ringSize); });
+				if (m_isStopping)
+					return;
+				count = m_head;
+				generation = m_generation;
+				frame = GetFrameOf(count);
+			}
+
+			// 空いている slot には描画側が触らないので lock の外で読む
+			// (page fault による読み込みの待ちはこの thread だけが受ける)
+			fvec3* const pPositions = m_ring.data() + (count % m_ringSize) * 2 * m_sequence.GetVertexCount();
+			m_sequence.ReadFrame(frame, pPositions, pPositions + m_sequence.GetVertexCount());
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				// 読んでいる間に seek された場合は捨てる
+				if (generation != m_generation)
+					continue;
+				m_head++;
+			}
+			m_readyCV.notify_all();
+		}
+	}
+};
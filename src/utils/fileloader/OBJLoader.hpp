@@ -2,461 +2,1013 @@
 
 #include <iostream>
 #include <vector>
-#include <set>
 #include <fstream>
-#include <deque>
-#include <sstream>
 #include <string>
+#include <string_view>
 #include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cmath>
 #include "src/utils/mathfunc/mathfunc.hpp"
+#include "src/utils/fileloader/MappedFile.hpp"
+#include "src/utils/thread/parallelFor.hpp"
 
+// OBJ のパースは以下の方針で行う
+// 1. ファイル全体を 1 つの buffer に読み込む (threadcount > 1 なら mmap して chunk ごとに並列に読む)
+// 2. buffer を先頭から 1 度だけ走査し、std::from_chars で token をその場で数値にする
+// 3. 出力先は std::vector に push_back して幾何級数的に伸ばす (要素数を数えるための 2 pass 目は無い)
 
-bool LoadOBJtoRenderTriangleMesh(
-	const char* filename,
-	std::vector<fvec3>& positions,
-	std::vector<fvec3>& normals,
-	std::vector<fvec2>& uvs,
-	std::vector<uint32_t>& faceindices,
-	const fvec3 meshoffset,
-	const float meshscale)
+bool ReadOBJFile(const char* filename, std::vector<char>& buffer)
 {
-	std::ifstream file(filename);
+	std::ifstream file(filename, std::ios::binary | std::ios::ate);
 	if (file.fail()) {
 		std::cout << "fail to open file: " << filename << std::endl;
 		return false;
 	}
 
-	uint32_t FaceSize = 0;
+	const std::streamsize filesize = file.tellg();
+	file.seekg(0L, std::ios::beg);
 
-	std::deque<fvec3> PositionSet;
-	PositionSet.emplace_back(fvec3(0.0, 0.0, 0.0));
-	std::deque<fvec3> NormalSet;
-	NormalSet.emplace_back(fvec3(0.0, 0.0, 0.0));
-	std::deque<fvec2> UVSet;
-	UVSet.emplace_back(fvec2(0.0, 0.0));
+	buffer.resize(filesize);
+	if (filesize > 0 && !file.read(buffer.data(), filesize)) {
+		std::cout << "fail to read file: " << filename << std::endl;
+		return false;
+	}
 
-	std::string line;
+	return true;
+}
 
-	bool is_Normal = true;
+// 改行以外の空白を読み飛ばす
+const char* OBJSkipSpace(const char* p, const char* const end)
+{
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+		p++;
+	return p;
+}
 
-	while (std::getline(file, line)) {
-		std::istringstream iss(line);
-		std::string linetype;
-		iss >> linetype;
+// 次の行の先頭まで進める
+const char* OBJSkipLine(const char* p, const char* const end)
+{
+	while (p < end && *p != '\n')
+		p++;
+	return p < end ? p + 1 : end;
+}
 
-		if (linetype == "v") {
-			float x, y, z;
-			iss >> x >> y >> z;
-			x *= meshscale;
-			y *= meshscale;
-			z *= meshscale;
-			PositionSet.emplace_back(fvec3(x, y, z) + meshoffset);
-		}
-		else if (linetype == "vn") {
-			float x, y, z;
-			iss >> x >> y >> z;
-			NormalSet.emplace_back(fvec3(x, y, z));
-		}
-		else if (linetype == "vt") {
-			float u, v;
-			iss >> u >> v;
-			UVSet.emplace_back(fvec2(u, v));
+// 行頭の record 名 ("v", "vn", "vt", "f" ...) を読む
+// p は record 名の直後に進む
+std::string_view OBJParseKeyword(const char*& p, const char* const end)
+{
+	p = OBJSkipSpace(p, end);
+	const char* begin = p;
+	while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+		p++;
+	return std::string_view(begin, p - begin);
+}
+
+bool OBJParseFloat(const char*& p, const char* const end, float& value)
+{
+	p = OBJSkipSpace(p, end);
+	if (p < end && *p == '+')
+		p++;
+
+	auto [ptr, ec] = std::from_chars(p, end, value);
+	if (ec != std::errc())
+		return false;
+
+	p = ptr;
+	return true;
+}
+
+// OBJ の index は 1-based
+// 負の index は直前までに定義された要素数 Count からの相対位置になる
+// 並列読み込みでは chunk より前の要素数がまだ分からないので、chunk 内の要素数 Count で解決した値を返し
+// isRelative を立てておく (後で chunk の先頭 index を足す。uint32_t の wrap を使うので Count + index + 1 <= 0 でもよい)
+bool OBJParseIndex(const char*& p, const char* const end, const uint32_t& Count, uint32_t& value, bool& isRelative)
+{
+	int64_t index = 0;
+	auto [ptr, ec] = std::from_chars(p, end, index);
+	if (ec != std::errc())
+		return false;
+
+	p = ptr;
+	// uint32_t に入らない index は wrap して別の要素を指さないよう、必ず範囲外になる値にする
+	if (index > int64_t(UINT32_MAX) || index < -int64_t(UINT32_MAX)) {
+		isRelative = false;
+		value = UINT32_MAX;
+		return true;
+	}
+	isRelative = index < 0;
+	value = isRelative ? uint32_t(int64_t(Count) + index + 1) : uint32_t(index);
+	return true;
+}
+
+// face の頂点 1 つ分 ("p", "p/t", "p//n", "p/t/n") を読む
+// index.x : position, index.y : uv, index.z : normal (無い場合は 0)
+// relativeMask には相対 index だった成分の bit (x: 1, y: 2, z: 4) が入る
+// normal を持たない頂点なら hasNormal を false にする
+bool OBJParseFaceVertex(
+    const char*& p,
+    const char* const end,
+    const uint32_t& PositionCount,
+    const uint32_t& UVCount,
+    const uint32_t& NormalCount,
+    vec3<uint32_t>& index,
+    uint32_t& relativeMask,
+    bool& hasNormal)
+{
+	index.x = 0;
+	index.y = 0;
+	index.z = 0;
+	relativeMask = 0;
+
+	bool isRelative = false;
+
+	p = OBJSkipSpace(p, end);
+	if (!OBJParseIndex(p, end, PositionCount, index.x, isRelative))
+		return false;
+	relativeMask |= isRelative ? 1 : 0;
+
+	if (p < end && *p == '/') {
+		p++;
+		if (p < end && *p != '/' && OBJParseIndex(p, end, UVCount, index.y, isRelative))
+			relativeMask |= isRelative ? 2 : 0;
+
+		if (p < end && *p == '/') {
+			p++;
+			if (OBJParseIndex(p, end, NormalCount, index.z, isRelative))
+				relativeMask |= isRelative ? 4 : 0;
 		}
-		else if (linetype == "f") {
-			std::string stv[4];
-			iss >> stv[0] >> stv[1] >> stv[2] >> stv[3];
-			if (stv[3] == "")
-				FaceSize += 1;
-			else
-				FaceSize += 2;
+		else {
+			// Position/UV
+			hasNormal = false;
 		}
 	}
+	else {
+		// Position
+		hasNormal = false;
+	}
 
-	file.clear();
-	file.seekg(0L, std::ios::beg);
+	// 数値の後ろに続く余分な文字は読み飛ばす
+	while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+		p++;
 
-	std::deque<uint32_t> FaceIndexList(3 * FaceSize);
-	std::deque<vec3<uint32_t>> VertIndexList(PositionSet.size() + 1);
+	return true;
+}
+
+// record 名の後ろ、行末までを名前として読む (o / g / usemtl)
+std::string OBJParseName(const char*& p, const char* const end)
+{
+	p = OBJSkipSpace(p, end);
+	const char* begin = p;
+	while (p < end && *p != '\n')
+		p++;
+
+	const char* last = p;
+	while (last > begin && (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\r'))
+		last--;
+	return std::string(begin, last - begin);
+}
+
+// o / g / usemtl で区切られた部分 mesh
+// indexOffset, indexCount は faceindices (三角形) 内の範囲
+// lineIndexOffset, lineIndexCount は lineindices (線分) 内の範囲
+struct OBJSubMesh {
+	std::string objectName;
+	std::string groupName;
+	std::string materialName;
+	uint32_t indexOffset = 0;
+	uint32_t indexCount = 0;
+	uint32_t lineIndexOffset = 0;
+	uint32_t lineIndexCount = 0;
+};
+
+// 読み込み中の部分 mesh
+// faceBegin, lineBegin は FaceSizeList, LineSizeList 内の先頭 (FinalizeOBJRawMesh の後は FaceVertList, LineVertList 内の先頭)
+// chunk ごとに読むときは chunk の先頭での o / g / usemtl が分からないので、
+// chunk 内で決まったかどうかを持っておき、決まっていない名前は前の部分 mesh から引き継ぐ
+struct OBJRawSubMesh {
+	OBJSubMesh info;
+	size_t faceBegin = 0;
+	size_t lineBegin = 0;
+	bool isObjectSet = false;
+	bool isGroupSet = false;
+	bool isMaterialSet = false;
+};
+
+// OBJ の record を読んだままの形で持つ
+// 各 Set の 0 番は未指定の index 用のダミー (OBJ の 1-based index をそのまま添字に使える)
+struct OBJRawMesh {
+	std::vector<fvec3> PositionSet;
+	std::vector<fvec3> NormalSet;
+	std::vector<fvec2> UVSet;
+
+	// f の頂点を多角形ごとに続けて並べる (FinalizeOBJRawMesh の後は三角形の頂点 3 つずつ)
 	// x: index in PositionSet
 	// y: index in UVSet
 	// z: index in NormalSet
+	std::vector<vec3<uint32_t>> FaceVertList;
+	// 多角形ごとの頂点数 (FinalizeOBJRawMesh の後は空)
+	std::vector<uint32_t> FaceSizeList;
+
+	// l の頂点を折れ線ごとに続けて並べる (FinalizeOBJRawMesh の後は線分の頂点 2 つずつ, z は使わない)
+	std::vector<vec3<uint32_t>> LineVertList;
+	// 折れ線ごとの頂点数 (FinalizeOBJRawMesh の後は空)
+	std::vector<uint32_t> LineSizeList;
+
+	// 相対 index で書かれていた成分 (3 * FaceVertList, LineVertList の index + 成分)
+	// chunk ごとに読んだときにだけ使う
+	std::vector<uint64_t> RelativeIndexList;
+	std::vector<uint64_t> LineRelativeIndexList;
+
+	std::vector<OBJRawSubMesh> SubMeshList;
 
-	for (auto& Vert : VertIndexList)
+	// すべての face 頂点が normal を持つか
+	bool hasNormal = true;
+
+	OBJRawMesh()
 	{
-		Vert.x = 0;
-		Vert.y = 0;
-		Vert.z = 0;
+		PositionSet.emplace_back(fvec3(0.0, 0.0, 0.0));
+		NormalSet.emplace_back(fvec3(0.0, 0.0, 0.0));
+		UVSet.emplace_back(fvec2(0.0, 0.0));
+		SubMeshList.emplace_back();
+	}
+};
+
+// f / l の頂点を 1 行分読んで VertList に追加する
+// minCount 個に満たなければ追加しない
+// 戻り値は追加した頂点数
+uint32_t ParseOBJElement(
+    const char*& p,
+    const char* const end,
+    const OBJRawMesh& raw,
+    const uint32_t& minCount,
+    std::vector<vec3<uint32_t>>& VertList,
+    std::vector<uint64_t>& RelativeIndexList,
+    bool& hasNormal)
+{
+	const size_t VertBegin = VertList.size();
+	const size_t RelativeBegin = RelativeIndexList.size();
+
+	vec3<uint32_t> Index;
+	uint32_t RelativeMask;
+	while (OBJParseFaceVertex(p, end, raw.PositionSet.size() - 1, raw.UVSet.size() - 1, raw.NormalSet.size() - 1, Index, RelativeMask, hasNormal)) {
+		for (uint32_t k = 0; k < 3; k++) {
+			if (RelativeMask & (1 << k))
+				RelativeIndexList.emplace_back(3 * uint64_t(VertList.size()) + k);
+		}
+		VertList.emplace_back(Index);
 	}
 
-	uint32_t CurrentFaceIndex = 0;
-	while (std::getline(file, line)) {
-		std::istringstream iss(line);
-		std::string linetype;
-		iss >> linetype;
+	const uint32_t VertCount = VertList.size() - VertBegin;
+	if (VertCount < minCount) {
+		VertList.resize(VertBegin, vec3<uint32_t>(0, 0, 0));
+		RelativeIndexList.resize(RelativeBegin);
+		return 0;
+	}
+	return VertCount;
+}
 
-		if (linetype == "f") {
-			std::string stv[4];
-			iss >> stv[0] >> stv[1] >> stv[2] >> stv[3];
-			if (stv[3] == "") {
-				vec3<uint32_t> VertIndexes[3];
-				for (uint32_t i = 0; i < 3; i++) {
-					VertIndexes[i].x = 0;
-					VertIndexes[i].y = 0;
-					VertIndexes[i].z = 0;
+// [p, end) の record を読んで raw に追加する
+// isPositionOnly のときは vn / vt を読み飛ばす
+// 多角形は FinalizeOBJRawMesh で三角形に分割する
+void ParseOBJRecords(
+    const char* p,
+    const char* const end,
+    const fvec3& meshoffset,
+    const float& meshscale,
+    const bool& isPositionOnly,
+    OBJRawMesh& raw)
+{
+	while (p < end) {
+		std::string_view linetype = OBJParseKeyword(p, end);
 
-					uint32_t slashcounter = std::count(stv[i].begin(), stv[i].end(), '/');
-					std::istringstream viss(stv[i]);
-					std::string Index;
+		if (linetype == "v") {
+			float x = 0.0, y = 0.0, z = 0.0;
+			OBJParseFloat(p, end, x) && OBJParseFloat(p, end, y) && OBJParseFloat(p, end, z);
+			x *= meshscale;
+			y *= meshscale;
+			z *= meshscale;
+			raw.PositionSet.emplace_back(fvec3(x, y, z) + meshoffset);
+		}
+		else if (linetype == "vn" && !isPositionOnly) {
+			float x = 0.0, y = 0.0, z = 0.0;
+			OBJParseFloat(p, end, x) && OBJParseFloat(p, end, y) && OBJParseFloat(p, end, z);
+			raw.NormalSet.emplace_back(fvec3(x, y, z));
+		}
+		else if (linetype == "vt" && !isPositionOnly) {
+			float u = 0.0, v = 0.0;
+			OBJParseFloat(p, end, u) && OBJParseFloat(p, end, v);
+			raw.UVSet.emplace_back(fvec2(u, v));
+		}
+		else if (linetype == "f") {
+			const uint32_t VertCount = ParseOBJElement(p, end, raw, 3, raw.FaceVertList, raw.RelativeIndexList, raw.hasNormal);
+			if (VertCount > 0)
+				raw.FaceSizeList.emplace_back(VertCount);
+		}
+		else if (linetype == "l") {
+			// l の頂点は normal を持たないので hasNormal には反映しない
+			bool hasNormal = true;
+			const uint32_t VertCount = ParseOBJElement(p, end, raw, 2, raw.LineVertList, raw.LineRelativeIndexList, hasNormal);
+			if (VertCount > 0)
+				raw.LineSizeList.emplace_back(VertCount);
+		}
+		else if (linetype == "o" || linetype == "g" || linetype == "usemtl") {
+			OBJRawSubMesh SubMesh = raw.SubMeshList.back();
+			SubMesh.faceBegin = raw.FaceSizeList.size();
+			SubMesh.lineBegin = raw.LineSizeList.size();
+
+			if (linetype == "o") {
+				SubMesh.info.objectName = OBJParseName(p, end);
+				SubMesh.isObjectSet = true;
+			}
+			else if (linetype == "g") {
+				SubMesh.info.groupName = OBJParseName(p, end);
+				SubMesh.isGroupSet = true;
+			}
+			else {
+				SubMesh.info.materialName = OBJParseName(p, end);
+				SubMesh.isMaterialSet = true;
+			}
 
-					std::getline(viss, Index, '/');
-					VertIndexes[i].x = std::stoi(Index);
+			// 直前の部分 mesh に要素が無ければ置き換える
+			const OBJRawSubMesh& Last = raw.SubMeshList.back();
+			if (Last.faceBegin == SubMesh.faceBegin && Last.lineBegin == SubMesh.lineBegin)
+				raw.SubMeshList.back() = SubMesh;
+			else
+				raw.SubMeshList.emplace_back(SubMesh);
+		}
 
-					std::getline(viss, Index, '/');
-					if (Index != "" && slashcounter == 1) {
-						// Position/UV
+		p = OBJSkipLine(p, end);
+	}
+}
 
-						VertIndexes[i].y = std::stoi(Index);
+// 多角形 1 つを三角形に分割して TriangleVertList に追加する
+// 多角形の normal (Newell 法) の最大成分の軸に沿って平面に投影し、
+// 凸なら 0 番の頂点からの fan、凸でなければ ear clipping で分割する
+void TriangulateOBJPolygon(
+    const std::vector<fvec3>& PositionSet,
+    const vec3<uint32_t>* const Polygon,
+    const uint32_t& VertCount,
+    std::vector<vec3<uint32_t>>& TriangleVertList,
+    std::vector<fvec2>& Projected,
+    std::vector<uint32_t>& Remaining)
+{
+	if (VertCount == 3) {
+		TriangleVertList.insert(TriangleVertList.end(), Polygon, Polygon + 3);
+		return;
+	}
 
-						is_Normal = false;
-					}
-					else if (Index != "" && slashcounter == 2) {
-						// Position/UV/Normal
+	auto PositionOf = [&](const uint32_t& i) -> const fvec3& {
+		return PositionSet[Polygon[i].x < PositionSet.size() ? Polygon[i].x : 0];
+	};
+
+	fvec3 Normal(0.0, 0.0, 0.0);
+	for (uint32_t i = 0; i < VertCount; i++) {
+		const fvec3& cur = PositionOf(i);
+		const fvec3& next = PositionOf((i + 1) % VertCount);
+		Normal.x += (cur.y - next.y) * (cur.z + next.z);
+		Normal.y += (cur.z - next.z) * (cur.x + next.x);
+		Normal.z += (cur.x - next.x) * (cur.y + next.y);
+	}
 
-						VertIndexes[i].y = std::stoi(Index);
+	// 投影で落とす軸
+	uint32_t Axis = 2;
+	if (std::abs(Normal.x) > std::abs(Normal.y) && std::abs(Normal.x) > std::abs(Normal.z))
+		Axis = 0;
+	else if (std::abs(Normal.y) > std::abs(Normal.z))
+		Axis = 1;
+	const uint32_t U = (Axis + 1) % 3;
+	const uint32_t V = (Axis + 2) % 3;
+	// 投影した多角形が反時計回りになるよう符号を揃える
+	const float Sign = Normal.cmp[Axis] < 0.0f ? -1.0f : 1.0f;
+
+	Projected.resize(VertCount);
+	for (uint32_t i = 0; i < VertCount; i++) {
+		const fvec3& position = PositionOf(i);
+		Projected[i] = fvec2(position.cmp[U], Sign * position.cmp[V]);
+	}
 
-						std::getline(viss, Index, '/');
-						VertIndexes[i].z = std::stoi(Index);
-					}
-					else if (Index == "" && slashcounter == 2) {
-						// Position//Normal
+	auto Cross = [&](const uint32_t& a, const uint32_t& b, const uint32_t& c) {
+		const fvec2 ab = Projected[b] - Projected[a];
+		const fvec2 ac = Projected[c] - Projected[a];
+		return ab.x * ac.y - ab.y * ac.x;
+	};
+
+	bool isConvex = true;
+	for (uint32_t i = 0; i < VertCount && isConvex; i++)
+		isConvex = Cross(i, (i + 1) % VertCount, (i + 2) % VertCount) >= 0.0f;
+
+	if (isConvex) {
+		for (uint32_t i = 1; i + 1 < VertCount; i++) {
+			TriangleVertList.emplace_back(Polygon[0]);
+			TriangleVertList.emplace_back(Polygon[i]);
+			TriangleVertList.emplace_back(Polygon[i + 1]);
+		}
+		return;
+	}
 
-						std::getline(viss, Index, '/');
-						VertIndexes[i].z = std::stoi(Index);
-					}
-					else if ((viss.rdstate() & std::ios_base::eofbit) && slashcounter == 0) {
-						// Position
+	// ear clipping
+	Remaining.resize(VertCount);
+	for (uint32_t i = 0; i < VertCount; i++)
+		Remaining[i] = i;
+
+	auto IsInside = [&](const uint32_t& p, const uint32_t& a, const uint32_t& b, const uint32_t& c) {
+		return Cross(a, b, p) >= 0.0f && Cross(b, c, p) >= 0.0f && Cross(c, a, p) >= 0.0f;
+	};
+
+	while (Remaining.size() > 3) {
+		const uint32_t Size = Remaining.size();
+
+		// ear が見つからない (自己交差などで退化している) ときは先頭の頂点を切り落とす
+		uint32_t Ear = 0;
+		for (uint32_t k = 0; k < Size; k++) {
+			const uint32_t a = Remaining[(k + Size - 1) % Size];
+			const uint32_t b = Remaining[k];
+			const uint32_t c = Remaining[(k + 1) % Size];
+			if (Cross(a, b, c) <= 0.0f)
+				continue;
+
+			bool isEar = true;
+			for (uint32_t l = 0; l < Size && isEar; l++) {
+				const uint32_t q = Remaining[l];
+				if (q == a || q == b || q == c)
+					continue;
+				isEar = !IsInside(q, a, b, c);
+			}
 
-						is_Normal = false;
-					}
-				}
+			if (isEar) {
+				Ear = k;
+				break;
+			}
+		}
 
-				for (uint32_t i = 0, OrderArray[3] = { 0, 1, 2 }; i < 3; i++) {
-					uint32_t j = OrderArray[i];
-					if (VertIndexList[VertIndexes[j].x].x == 0
-						|| (VertIndexList[VertIndexes[j].x].y == VertIndexes[j].y
-							&& VertIndexList[VertIndexes[j].x].z == VertIndexes[j].z)) {
+		TriangleVertList.emplace_back(Polygon[Remaining[(Ear + Size - 1) % Size]]);
+		TriangleVertList.emplace_back(Polygon[Remaining[Ear]]);
+		TriangleVertList.emplace_back(Polygon[Remaining[(Ear + 1) % Size]]);
+		Remaining.erase(Remaining.begin() + Ear);
+	}
 
-						VertIndexList[VertIndexes[j].x].x = VertIndexes[j].x;
-						VertIndexList[VertIndexes[j].x].y = VertIndexes[j].y;
-						VertIndexList[VertIndexes[j].x].z = VertIndexes[j].z;
+	TriangleVertList.emplace_back(Polygon[Remaining[0]]);
+	TriangleVertList.emplace_back(Polygon[Remaining[1]]);
+	TriangleVertList.emplace_back(Polygon[Remaining[2]]);
+}
 
-						FaceIndexList[3 * CurrentFaceIndex + i] = VertIndexes[j].x;
-					}
-					else {
-						VertIndexList.emplace_back(VertIndexes[j]);
-						FaceIndexList[3 * CurrentFaceIndex + i] = VertIndexList.size() - 1;
-					}
-				}
-				CurrentFaceIndex++;
+// 読み終えた raw を三角形と線分の list にする
+// 1. 部分 mesh の名前を前の部分 mesh から引き継いで決め、同じ名前が続く部分 mesh をまとめる
+// 2. 多角形を三角形に、折れ線を線分に分け、部分 mesh の先頭を FaceVertList, LineVertList 内の位置に直す
+void FinalizeOBJRawMesh(OBJRawMesh& raw)
+{
+	OBJSubMesh Current;
+	for (auto& SubMesh : raw.SubMeshList) {
+		if (!SubMesh.isObjectSet)
+			SubMesh.info.objectName = Current.objectName;
+		if (!SubMesh.isGroupSet)
+			SubMesh.info.groupName = Current.groupName;
+		if (!SubMesh.isMaterialSet)
+			SubMesh.info.materialName = Current.materialName;
+		SubMesh.isObjectSet = SubMesh.isGroupSet = SubMesh.isMaterialSet = true;
+		Current = SubMesh.info;
+	}
 
-			}
-			else {
+	// chunk の境目などで分かれた、名前が同じ部分 mesh の並びを 1 つにまとめる
+	auto IsSameSubMesh = [](const OBJRawSubMesh& a, const OBJRawSubMesh& b) {
+		return a.info.objectName == b.info.objectName && a.info.groupName == b.info.groupName && a.info.materialName == b.info.materialName;
+	};
+	raw.SubMeshList.erase(std::unique(raw.SubMeshList.begin(), raw.SubMeshList.end(), IsSameSubMesh), raw.SubMeshList.end());
+
+	// 三角形と 4 角形だけなら FaceVertList はほぼそのままの大きさで済む
+	std::vector<vec3<uint32_t>> TriangleVertList;
+	TriangleVertList.reserve(raw.FaceVertList.size() + raw.FaceVertList.size() / 2);
+	std::vector<fvec2> Projected;
+	std::vector<uint32_t> Remaining;
+
+	size_t SubMeshIndex = 0;
+	size_t FaceVertBegin = 0;
+	for (size_t i = 0; i < raw.FaceSizeList.size(); i++) {
+		for (; SubMeshIndex < raw.SubMeshList.size() && raw.SubMeshList[SubMeshIndex].faceBegin <= i; SubMeshIndex++)
+			raw.SubMeshList[SubMeshIndex].faceBegin = TriangleVertList.size();
+
+		TriangulateOBJPolygon(raw.PositionSet, raw.FaceVertList.data() + FaceVertBegin, raw.FaceSizeList[i], TriangleVertList, Projected, Remaining);
+		FaceVertBegin += raw.FaceSizeList[i];
+	}
+	for (; SubMeshIndex < raw.SubMeshList.size(); SubMeshIndex++)
+		raw.SubMeshList[SubMeshIndex].faceBegin = TriangleVertList.size();
 
-				vec3<uint32_t> VertIndexes[4];
-				for (uint32_t i = 0; i < 4; i++) {
-					VertIndexes[i].x = 0;
-					VertIndexes[i].y = 0;
-					VertIndexes[i].z = 0;
+	raw.FaceVertList = std::move(TriangleVertList);
+	raw.FaceSizeList.clear();
 
-					uint32_t slashcounter = std::count(stv[i].begin(), stv[i].end(), '/');
-					std::istringstream viss(stv[i]);
-					std::string Index;
+	std::vector<vec3<uint32_t>> SegmentVertList;
+	SegmentVertList.reserve(2 * raw.LineVertList.size());
 
-					std::getline(viss, Index, '/');
-					VertIndexes[i].x = std::stoi(Index);
+	SubMeshIndex = 0;
+	size_t LineVertBegin = 0;
+	for (size_t i = 0; i < raw.LineSizeList.size(); i++) {
+		for (; SubMeshIndex < raw.SubMeshList.size() && raw.SubMeshList[SubMeshIndex].lineBegin <= i; SubMeshIndex++)
+			raw.SubMeshList[SubMeshIndex].lineBegin = SegmentVertList.size();
 
-					std::getline(viss, Index, '/');
-					if (Index != "" && slashcounter == 1) {
-						// Position/UV
+		for (uint32_t j = 0; j + 1 < raw.LineSizeList[i]; j++) {
+			SegmentVertList.emplace_back(raw.LineVertList[LineVertBegin + j]);
+			SegmentVertList.emplace_back(raw.LineVertList[LineVertBegin + j + 1]);
+		}
+		LineVertBegin += raw.LineSizeList[i];
+	}
+	for (; SubMeshIndex < raw.SubMeshList.size(); SubMeshIndex++)
+		raw.SubMeshList[SubMeshIndex].lineBegin = SegmentVertList.size();
 
-						VertIndexes[i].y = std::stoi(Index);
+	raw.LineVertList = std::move(SegmentVertList);
+	raw.LineSizeList.clear();
+}
 
-						is_Normal = false;
-					}
-					else if (Index != "" && slashcounter == 2) {
-						// Position/UV/Normal
+// ファイル全体を 1 つの buffer に読み込んで 1 thread で読む
+bool ReadOBJRawMesh(
+    const char* filename,
+    const fvec3& meshoffset,
+    const float& meshscale,
+    const bool& isPositionOnly,
+    OBJRawMesh& raw)
+{
+	std::vector<char> buffer;
+	if (!ReadOBJFile(filename, buffer))
+		return false;
 
-						VertIndexes[i].y = std::stoi(Index);
+	ParseOBJRecords(buffer.data(), buffer.data() + buffer.size(), meshoffset, meshscale, isPositionOnly, raw);
 
-						std::getline(viss, Index, '/');
-						VertIndexes[i].z = std::stoi(Index);
-					}
-					else if (Index == "" && slashcounter == 2) {
-						// Position//Normal
+	// 1 chunk なので相対 index はすでに解決済み
+	raw.RelativeIndexList.clear();
+	raw.LineRelativeIndexList.clear();
 
-						std::getline(viss, Index, '/');
-						VertIndexes[i].z = std::stoi(Index);
-					}
-					else if ((viss.rdstate() & std::ios_base::eofbit) && slashcounter == 0) {
-						// Position
+	FinalizeOBJRawMesh(raw);
 
-						is_Normal = false;
-					}
-				}
-				for (uint32_t i = 0, OrderArray[3] = { 0, 1, 2 }; i < 3; i++) {
-					uint32_t j = OrderArray[i];
-					if (VertIndexList[VertIndexes[j].x].x == 0
-						|| (VertIndexList[VertIndexes[j].x].y == VertIndexes[j].y
-							&& VertIndexList[VertIndexes[j].x].z == VertIndexes[j].z)) {
+	return true;
+}
 
-						VertIndexList[VertIndexes[j].x].x = VertIndexes[j].x;
-						VertIndexList[VertIndexes[j].x].y = VertIndexes[j].y;
-						VertIndexList[VertIndexes[j].x].z = VertIndexes[j].z;
+// ファイルを mmap し、行の境界で chunk に分けて threadCount 本の thread で読む
+// 1. chunk ごとに OBJRawMesh へ読む (index は chunk 内で解決できる分だけ解決する)
+// 2. 要素数の prefix sum から各 chunk の先頭 index を求める
+// 3. chunk を 1 つの OBJRawMesh に連結しながら、相対 index に chunk の先頭 index を足す
+// 4. FinalizeOBJRawMesh で三角形と線分に分ける
+bool ReadOBJRawMeshParallel(
+    const char* filename,
+    const fvec3& meshoffset,
+    const float& meshscale,
+    const bool& isPositionOnly,
+    const uint32_t& threadCount,
+    OBJRawMesh& raw)
+{
+	MappedFile file;
+	if (!file.Open(filename))
+		return false;
 
-						FaceIndexList[3 * CurrentFaceIndex + i] = VertIndexes[j].x;
-					}
-					else {
-						VertIndexList.emplace_back(VertIndexes[j]);
-						FaceIndexList[3 * CurrentFaceIndex + i] = VertIndexList.size() - 1;
-					}
-				}
-				CurrentFaceIndex++;
+	const char* const begin = file.data();
+	const char* const end = file.data() + file.size();
 
-				for (uint32_t i = 0, OrderArray[3] = { 0, 2, 3 }; i < 3; i++) {
-					uint32_t j = OrderArray[i];
-					if (VertIndexList[VertIndexes[j].x].x == 0
-						|| (VertIndexList[VertIndexes[j].x].y == VertIndexes[j].y
-							&& VertIndexList[VertIndexes[j].x].z == VertIndexes[j].z)) {
+	// thread 数より多めに chunk を作り、v が続く部分と f が続く部分の処理時間の差を均す
+	constexpr size_t MinChunkSize = 1 << 20;
+	const size_t ChunkCount = std::max<size_t>(1, std::min<size_t>(4 * size_t(threadCount), file.size() / MinChunkSize));
 
-						VertIndexList[VertIndexes[j].x].x = VertIndexes[j].x;
-						VertIndexList[VertIndexes[j].x].y = VertIndexes[j].y;
-						VertIndexList[VertIndexes[j].x].z = VertIndexes[j].z;
+	std::vector<const char*> ChunkBegin(ChunkCount + 1);
+	ChunkBegin[0] = begin;
+	ChunkBegin[ChunkCount] = end;
+	for (size_t i = 1; i < ChunkCount; i++) {
+		const char* p = std::max(begin + file.size() * i / ChunkCount, ChunkBegin[i - 1]);
+		ChunkBegin[i] = p == begin ? begin : OBJSkipLine(p - 1, end);
+	}
 
-						FaceIndexList[3 * CurrentFaceIndex + i] = VertIndexes[j].x;
-					}
-					else {
-						VertIndexList.emplace_back(VertIndexes[j]);
-						FaceIndexList[3 * CurrentFaceIndex + i] = VertIndexList.size() - 1;
-					}
-				}
-				CurrentFaceIndex++;
-			}
+	std::vector<OBJRawMesh> Chunks(ChunkCount);
+	ParallelFor(ChunkCount, threadCount, [&](const uint32_t& i) {
+		ParseOBJRecords(ChunkBegin[i], ChunkBegin[i + 1], meshoffset, meshscale, isPositionOnly, Chunks[i]);
+	});
+
+	// chunk の先頭 index (各 Set のダミーを除いた要素数と、各 list の要素数の prefix sum)
+	std::vector<vec3<uint32_t>> SetOffset(ChunkCount + 1, vec3<uint32_t>(0, 0, 0));
+	std::vector<size_t> FaceVertOffset(ChunkCount + 1, 0);
+	std::vector<size_t> FaceOffset(ChunkCount + 1, 0);
+	std::vector<size_t> LineVertOffset(ChunkCount + 1, 0);
+	std::vector<size_t> LineOffset(ChunkCount + 1, 0);
+	for (size_t i = 0; i < ChunkCount; i++) {
+		SetOffset[i + 1].x = SetOffset[i].x + Chunks[i].PositionSet.size() - 1;
+		SetOffset[i + 1].y = SetOffset[i].y + Chunks[i].UVSet.size() - 1;
+		SetOffset[i + 1].z = SetOffset[i].z + Chunks[i].NormalSet.size() - 1;
+		FaceVertOffset[i + 1] = FaceVertOffset[i] + Chunks[i].FaceVertList.size();
+		FaceOffset[i + 1] = FaceOffset[i] + Chunks[i].FaceSizeList.size();
+		LineVertOffset[i + 1] = LineVertOffset[i] + Chunks[i].LineVertList.size();
+		LineOffset[i + 1] = LineOffset[i] + Chunks[i].LineSizeList.size();
+		raw.hasNormal = raw.hasNormal && Chunks[i].hasNormal;
+	}
+
+	// 部分 mesh は数が少ないので先に 1 thread で連結しておく
+	raw.SubMeshList.clear();
+	for (size_t i = 0; i < ChunkCount; i++) {
+		for (auto& SubMesh : Chunks[i].SubMeshList) {
+			SubMesh.faceBegin += FaceOffset[i];
+			SubMesh.lineBegin += LineOffset[i];
+			raw.SubMeshList.emplace_back(std::move(SubMesh));
 		}
 	}
 
-	if (!is_Normal) {
-		NormalSet.clear();
-		NormalSet.resize(VertIndexList.size());
+	raw.PositionSet.resize(SetOffset[ChunkCount].x + 1, fvec3(0.0, 0.0, 0.0));
+	raw.UVSet.resize(SetOffset[ChunkCount].y + 1, fvec2(0.0, 0.0));
+	raw.NormalSet.resize(SetOffset[ChunkCount].z + 1, fvec3(0.0, 0.0, 0.0));
+	raw.FaceVertList.resize(FaceVertOffset[ChunkCount], vec3<uint32_t>(0, 0, 0));
+	raw.FaceSizeList.resize(FaceOffset[ChunkCount]);
+	raw.LineVertList.resize(LineVertOffset[ChunkCount], vec3<uint32_t>(0, 0, 0));
+	raw.LineSizeList.resize(LineOffset[ChunkCount]);
+	raw.RelativeIndexList.clear();
+	raw.LineRelativeIndexList.clear();
 
-		for (auto& normal : NormalSet)
-			normal = fvec3();
+	ParallelFor(ChunkCount, threadCount, [&](const uint32_t& i) {
+		OBJRawMesh& chunk = Chunks[i];
 
-		for (uint32_t i = 0; i < FaceSize; i++) {
-			fvec3 v0 = PositionSet[VertIndexList[FaceIndexList[i * 3 + 0]].x];
-			fvec3 v1 = PositionSet[VertIndexList[FaceIndexList[i * 3 + 1]].x];
-			fvec3 v2 = PositionSet[VertIndexList[FaceIndexList[i * 3 + 2]].x];
+		std::copy(chunk.PositionSet.begin() + 1, chunk.PositionSet.end(), raw.PositionSet.begin() + 1 + SetOffset[i].x);
+		std::copy(chunk.UVSet.begin() + 1, chunk.UVSet.end(), raw.UVSet.begin() + 1 + SetOffset[i].y);
+		std::copy(chunk.NormalSet.begin() + 1, chunk.NormalSet.end(), raw.NormalSet.begin() + 1 + SetOffset[i].z);
+		std::copy(chunk.FaceSizeList.begin(), chunk.FaceSizeList.end(), raw.FaceSizeList.begin() + FaceOffset[i]);
+		std::copy(chunk.LineSizeList.begin(), chunk.LineSizeList.end(), raw.LineSizeList.begin() + LineOffset[i]);
 
-			fvec3 normal = ((v1 - v0).cross(v2 - v0)).normalized();
+		vec3<uint32_t>* const pFaceVert = raw.FaceVertList.data() + FaceVertOffset[i];
+		std::copy(chunk.FaceVertList.begin(), chunk.FaceVertList.end(), pFaceVert);
+		for (const auto& relative : chunk.RelativeIndexList)
+			pFaceVert[relative / 3].cmp[relative % 3] += SetOffset[i].cmp[relative % 3];
 
-			NormalSet[FaceIndexList[3 * i + 0]] = NormalSet[FaceIndexList[3 * i + 0]] + normal;
-			NormalSet[FaceIndexList[3 * i + 1]] = NormalSet[FaceIndexList[3 * i + 1]] + normal;
-			NormalSet[FaceIndexList[3 * i + 2]] = NormalSet[FaceIndexList[3 * i + 2]] + normal;
-		}
+		vec3<uint32_t>* const pLineVert = raw.LineVertList.data() + LineVertOffset[i];
+		std::copy(chunk.LineVertList.begin(), chunk.LineVertList.end(), pLineVert);
+		for (const auto& relative : chunk.LineRelativeIndexList)
+			pLineVert[relative / 3].cmp[relative % 3] += SetOffset[i].cmp[relative % 3];
 
-		for (uint32_t i = 0; i < VertIndexList.size(); i++) {
-			NormalSet[i] = NormalSet[i].normalized();
-			VertIndexList[i].z = i;
-		}
-	}
+		chunk = OBJRawMesh();
+	});
+
+	FinalizeOBJRawMesh(raw);
+
+	return true;
+}
 
-	faceindices.resize(FaceSize * 3);
-	for (int i = 0; i < FaceSize * 3; i++)
-		faceindices[i] = FaceIndexList[i];
+bool ReadOBJRawMesh(
+    const char* filename,
+    const fvec3& meshoffset,
+    const float& meshscale,
+    const bool& isPositionOnly,
+    const uint32_t& threadCount,
+    OBJRawMesh& raw)
+{
+	if (threadCount > 1)
+		return ReadOBJRawMeshParallel(filename, meshoffset, meshscale, isPositionOnly, threadCount, raw);
+	return ReadOBJRawMesh(filename, meshoffset, meshscale, isPositionOnly, raw);
+}
 
+// (x, y, z) の 3 つ組を key にした open addressing (linear probing) の hash map
+// 要素数の上限 maxSize を先に決め、table はその 2 倍以上の 2 のべき乗で確保する (rehash はしない)
+class OBJTripletHashMap
+{
+public:
+	OBJTripletHashMap(const size_t& maxSize)
+	{
+		size_t tableSize = 16;
+		while (tableSize < 2 * maxSize)
+			tableSize *= 2;
 
+		m_mask = tableSize - 1;
+		m_keys.resize(tableSize, vec3<uint32_t>(0, 0, 0));
+		m_values.resize(tableSize, EmptyValue);
+	}
 
-	positions.resize(VertIndexList.size());
-	normals.resize(VertIndexList.size());
-	uvs.resize(VertIndexList.size());
+	// key があればその値を、無ければ value を入れてその場所を返す
+	// value に EmptyValue は使えない
+	uint32_t& FindOrInsert(const vec3<uint32_t>& key, const uint32_t& value)
+	{
+		size_t slot = Hash(key) & m_mask;
+		while (m_values[slot] != EmptyValue) {
+			if (m_keys[slot].x == key.x && m_keys[slot].y == key.y && m_keys[slot].z == key.z)
+				return m_values[slot];
+			slot = (slot + 1) & m_mask;
+		}
 
-	for (uint32_t i = 0; i < VertIndexList.size(); i++) {
-		auto& position = positions[i];
-		auto& normal = normals[i];
-		auto& uv = uvs[i];
+		m_keys[slot] = key;
+		m_values[slot] = value;
+		return m_values[slot];
+	}
 
-		position(0) = PositionSet[VertIndexList[i].x].x;
-		position(1) = PositionSet[VertIndexList[i].x].y;
-		position(2) = PositionSet[VertIndexList[i].x].z;
+	// key が無ければ EmptyValue を返す
+	uint32_t Find(const vec3<uint32_t>& key) const
+	{
+		size_t slot = Hash(key) & m_mask;
+		while (m_values[slot] != EmptyValue) {
+			if (m_keys[slot].x == key.x && m_keys[slot].y == key.y && m_keys[slot].z == key.z)
+				return m_values[slot];
+			slot = (slot + 1) & m_mask;
+		}
+		return EmptyValue;
+	}
 
-		uv(0) = UVSet[VertIndexList[i].y].x;
-		uv(1) = UVSet[VertIndexList[i].y].y;
+	static constexpr uint32_t EmptyValue = 0xFFFFFFFFu;
 
-		normal(0) = NormalSet[VertIndexList[i].z].x;
-		normal(1) = NormalSet[VertIndexList[i].z].y;
-		normal(2) = NormalSet[VertIndexList[i].z].z;
-		normal = normal.normalized();
+private:
+	std::vector<vec3<uint32_t>> m_keys;
+	std::vector<uint32_t> m_values;
+	size_t m_mask = 0;
 
+	static size_t Hash(const vec3<uint32_t>& key)
+	{
+		uint64_t h = uint64_t(key.x) * 0x9E3779B97F4A7C15ull;
+		h ^= uint64_t(key.y) * 0xC2B2AE3D27D4EB4Full;
+		h ^= uint64_t(key.z) * 0x165667B19E3779F9ull;
+		h ^= h >> 29;
+		return size_t(h);
 	}
+};
 
-	return true;
-}
+// 距離 epsilon 以内にある position を 1 つにまとめ、FaceVertList, LineVertList の position index を付け替える
+// epsilon の格子に分けて近傍 27 セルだけを調べる
+// まとめられた position は PositionSet から取り除き、退化した三角形と線分も取り除く
+void WeldOBJPositions(OBJRawMesh& raw, const float& epsilon)
+{
+	const uint32_t PositionSize = raw.PositionSet.size();
+	const float SqEpsilon = epsilon * epsilon;
+
+	// セル番号は double で求めて int64_t に収まるよう clamp する (NaN は下端に寄せる)
+	// hash の key は下位 32bit だけを使う。2^32 離れたセルが同じ key になっても距離で比べるので結果は変わらず、
+	// 近傍の +-1 も int64_t で足してから切り詰めるので key の上でも隣になる
+	auto CellAxis = [&](const float& x) {
+		constexpr double Limit = 4611686018427387904.0; // 2^62
+		const double c = std::floor(double(x) / double(epsilon));
+		return int64_t(c > -Limit ? (c < Limit ? c : Limit) : -Limit);
+	};
+	auto CellOf = [&](const fvec3& p) {
+		return vec3<int64_t>(CellAxis(p.x), CellAxis(p.y), CellAxis(p.z));
+	};
+
+	// まとめた後の position を前から詰めていき、セルごとにその index を Next でつないだ list を持つ
+	OBJTripletHashMap CellMap(PositionSize);
+	std::vector<uint32_t> Next(PositionSize, OBJTripletHashMap::EmptyValue);
+	std::vector<uint32_t> Remap(PositionSize, 0);
+
+	uint32_t WeldedSize = 1;
+	for (uint32_t i = 1; i < PositionSize; i++) {
+		const fvec3 p = raw.PositionSet[i];
+		const vec3<int64_t> cell = CellOf(p);
+
+		uint32_t found = 0;
+		for (int64_t dx = -1; dx <= 1 && found == 0; dx++) {
+			for (int64_t dy = -1; dy <= 1 && found == 0; dy++) {
+				for (int64_t dz = -1; dz <= 1 && found == 0; dz++) {
+					const vec3<uint32_t> key(uint32_t(cell.x + dx), uint32_t(cell.y + dy), uint32_t(cell.z + dz));
+					for (uint32_t j = CellMap.Find(key); j != OBJTripletHashMap::EmptyValue; j = Next[j]) {
+						if ((raw.PositionSet[j] - p).sqnorm() <= SqEpsilon) {
+							found = j;
+							break;
+						}
+					}
+				}
+			}
+		}
 
+		if (found != 0) {
+			Remap[i] = found;
+			continue;
+		}
 
+		uint32_t& head = CellMap.FindOrInsert(vec3<uint32_t>(uint32_t(cell.x), uint32_t(cell.y), uint32_t(cell.z)), WeldedSize);
+		if (head != WeldedSize) {
+			Next[WeldedSize] = head;
+			head = WeldedSize;
+		}
 
+		Remap[i] = WeldedSize;
+		raw.PositionSet[WeldedSize] = p;
+		WeldedSize++;
+	}
+	raw.PositionSet.resize(WeldedSize);
+
+	// 三角形 / 線分を詰め直し、部分 mesh の先頭もそれに合わせて動かす
+	auto CompactElements = [&](std::vector<vec3<uint32_t>>& VertList, const uint32_t& ElementSize, size_t OBJRawSubMesh::*Begin) {
+		size_t SubMeshIndex = 0;
+		size_t VertSize = 0;
+		for (size_t i = 0; i < VertList.size(); i += ElementSize) {
+			for (; SubMeshIndex < raw.SubMeshList.size() && raw.SubMeshList[SubMeshIndex].*Begin <= i; SubMeshIndex++)
+				raw.SubMeshList[SubMeshIndex].*Begin = VertSize;
+
+			bool isDegenerate = false;
+			for (uint32_t j = 0; j < ElementSize; j++) {
+				VertList[VertSize + j] = VertList[i + j];
+				uint32_t& x = VertList[VertSize + j].x;
+				x = x < PositionSize ? Remap[x] : 0;
+				for (uint32_t k = 0; k < j; k++)
+					isDegenerate = isDegenerate || VertList[VertSize + k].x == x;
+			}
 
+			if (!isDegenerate)
+				VertSize += ElementSize;
+		}
+		for (; SubMeshIndex < raw.SubMeshList.size(); SubMeshIndex++)
+			raw.SubMeshList[SubMeshIndex].*Begin = VertSize;
 
+		VertList.resize(VertSize);
+	};
 
-bool LoadOBJtoRenderEdgeMesh(
+	CompactElements(raw.FaceVertList, 3, &OBJRawSubMesh::faceBegin);
+	CompactElements(raw.LineVertList, 2, &OBJRawSubMesh::lineBegin);
+}
+
+// 三角形 (faceindices) と線分 (lineindices) の描画用 mesh を読む
+// o / g / usemtl で区切られた部分 mesh ごとの index の範囲を submeshes に入れる (三角形も線分も無い部分 mesh は除く)
+// threadcount > 1 のときはファイルを mmap して並列に読む (ReadOBJRawMeshParallel)
+bool LoadOBJtoRenderMesh(
 	const char* filename,
 	std::vector<fvec3>& positions,
+	std::vector<fvec3>& normals,
+	std::vector<fvec2>& uvs,
 	std::vector<uint32_t>& faceindices,
-	const fvec3& meshoffset,
-	const float& meshscale)
+	std::vector<uint32_t>& lineindices,
+	std::vector<OBJSubMesh>& submeshes,
+	const fvec3 meshoffset,
+	const float meshscale,
+	const uint32_t threadcount = 1)
 {
-	std::ifstream file(filename);
-	if (file.fail()) {
-		std::cout << "fail to open file: " << filename << std::endl;
+	OBJRawMesh raw;
+	if (!ReadOBJRawMesh(filename, meshoffset, meshscale, false, threadcount, raw))
 		return false;
-	}
 
-	uint32_t FaceSize = 0;
-	uint32_t VertSize = 0;
+	const auto& PositionSet = raw.PositionSet;
+	const auto& UVSet = raw.UVSet;
+	auto& NormalSet = raw.NormalSet;
 
-	std::deque<fvec3> PositionSet;
-	PositionSet.emplace_back(fvec3());
+	// (position, uv, normal) の index の組ごとに 1 つ頂点を作る (初めて使われた順に並べる)
+	// normal を計算し直すときは normal の index を key に含めない
+	// x: index in PositionSet
+	// y: index in UVSet
+	// z: index in NormalSet
+	std::vector<vec3<uint32_t>> VertIndexList;
+	VertIndexList.reserve(std::min(raw.FaceVertList.size() + raw.LineVertList.size(), 2 * PositionSet.size()));
+	OBJTripletHashMap VertMap(raw.FaceVertList.size() + raw.LineVertList.size());
+
+	auto EmitVertices = [&](const std::vector<vec3<uint32_t>>& VertList, std::vector<uint32_t>& IndexList) {
+		IndexList.resize(VertList.size());
+
+		for (size_t i = 0; i < VertList.size(); i++) {
+			vec3<uint32_t> Index = VertList[i];
+
+			// 範囲外の index は 0 番 (原点) として扱う
+			if (Index.x >= PositionSet.size())
+				Index.x = 0;
+			if (Index.y >= UVSet.size())
+				Index.y = 0;
+			if (Index.z >= NormalSet.size() || !raw.hasNormal)
+				Index.z = 0;
+
+			const uint32_t VertIndex = VertMap.FindOrInsert(Index, VertIndexList.size());
+			if (VertIndex == VertIndexList.size())
+				VertIndexList.emplace_back(Index);
+			IndexList[i] = VertIndex;
+		}
+	};
 
-	std::string line;
+	std::vector<uint32_t>& FaceIndexList = faceindices;
+	EmitVertices(raw.FaceVertList, FaceIndexList);
+	EmitVertices(raw.LineVertList, lineindices);
 
-	while (std::getline(file, line)) {
-		std::istringstream iss(line);
-		std::string linetype;
-		iss >> linetype;
+	const uint32_t FaceSize = FaceIndexList.size() / 3;
 
-		if (linetype == "v") {
-			float x, y, z;
-			iss >> x >> y >> z;
-			x *= meshscale;
-			y *= meshscale;
-			z *= meshscale;
-			PositionSet.emplace_back(fvec3(x, y, z) + meshoffset);
-			VertSize++;
-		}
-		else if (linetype == "f") {
-			std::string stv[4];
-			iss >> stv[0] >> stv[1] >> stv[2] >> stv[3];
-			if (stv[3] == "")
-				FaceSize += 1;
-			else
-				FaceSize += 2;
+	if (!raw.hasNormal) {
+		// uv の seam で分かれた頂点どうしも同じ normal になるよう、position ごとに足し合わせる
+		NormalSet.assign(PositionSet.size(), fvec3(0.0, 0.0, 0.0));
+
+		for (uint32_t i = 0; i < FaceSize; i++) {
+			const uint32_t p0 = VertIndexList[FaceIndexList[i * 3 + 0]].x;
+			const uint32_t p1 = VertIndexList[FaceIndexList[i * 3 + 1]].x;
+			const uint32_t p2 = VertIndexList[FaceIndexList[i * 3 + 2]].x;
+
+			fvec3 normal = ((PositionSet[p1] - PositionSet[p0]).cross(PositionSet[p2] - PositionSet[p0])).normalized();
+
+			NormalSet[p0] = NormalSet[p0] + normal;
+			NormalSet[p1] = NormalSet[p1] + normal;
+			NormalSet[p2] = NormalSet[p2] + normal;
 		}
+
+		for (auto& Vert : VertIndexList)
+			Vert.z = Vert.x;
 	}
 
-	file.clear();
-	file.seekg(0L, std::ios::beg);
+	positions.resize(VertIndexList.size());
+	normals.resize(VertIndexList.size());
+	uvs.resize(VertIndexList.size());
 
-	std::vector<std::set<uint32_t>> AdjacencyList(VertSize + 1);
-	//AdjacencyList[0]͎gȂB
-
-	uint32_t CurrentFaceIndex = 0;
-	while (std::getline(file, line)) {
-		std::istringstream iss(line);
-		std::string linetype;
-		iss >> linetype;
-		if (linetype == "f") {
-			std::string stv[4];
-			iss >> stv[0] >> stv[1] >> stv[2] >> stv[3];
-			if (stv[3] == "") {
-				uint32_t VertInFace[3];
-				for (uint32_t i = 0; i < 3; i++) {
-					std::istringstream viss(stv[i]);
-					std::string Index;
-
-					std::getline(viss, Index, '/');
-					VertInFace[i] = std::stoi(Index);
-				}
+	for (uint32_t i = 0; i < VertIndexList.size(); i++) {
+		positions[i] = PositionSet[VertIndexList[i].x];
+		uvs[i] = UVSet[VertIndexList[i].y];
+		normals[i] = NormalSet[VertIndexList[i].z].normalized();
+	}
 
-				for (uint32_t i = 0, EdgeStart[3] = { 0, 1, 2 }, EdgeEnd[3] = { 1, 2, 0 }; i < 3; i++) {
-					uint32_t ES = VertInFace[EdgeStart[i]];
-					uint32_t EE = VertInFace[EdgeEnd[i]];
-					if (ES > EE) {
-						uint32_t temp = EE;
-						EE = ES;
-						ES = temp;
-					}
+	submeshes.clear();
+	for (size_t i = 0; i < raw.SubMeshList.size(); i++) {
+		const size_t FaceEnd = i + 1 < raw.SubMeshList.size() ? raw.SubMeshList[i + 1].faceBegin : raw.FaceVertList.size();
+		const size_t LineEnd = i + 1 < raw.SubMeshList.size() ? raw.SubMeshList[i + 1].lineBegin : raw.LineVertList.size();
+
+		OBJSubMesh SubMesh = raw.SubMeshList[i].info;
+		SubMesh.indexOffset = raw.SubMeshList[i].faceBegin;
+		SubMesh.indexCount = FaceEnd - raw.SubMeshList[i].faceBegin;
+		SubMesh.lineIndexOffset = raw.SubMeshList[i].lineBegin;
+		SubMesh.lineIndexCount = LineEnd - raw.SubMeshList[i].lineBegin;
+		if (SubMesh.indexCount > 0 || SubMesh.lineIndexCount > 0)
+			submeshes.emplace_back(std::move(SubMesh));
+	}
 
-					AdjacencyList[ES].insert(EE);
-				}
+	return true;
+}
 
-			}
-			else {
-				uint32_t VertInFace[4];
-				for (uint32_t i = 0; i < 4; i++) {
-					std::istringstream viss(stv[i]);
-					std::string Index;
+// 三角形だけを読む (l の線分と部分 mesh の区切りは捨てる)
+bool LoadOBJtoRenderTriangleMesh(
+	const char* filename,
+	std::vector<fvec3>& positions,
+	std::vector<fvec3>& normals,
+	std::vector<fvec2>& uvs,
+	std::vector<uint32_t>& faceindices,
+	const fvec3 meshoffset,
+	const float meshscale,
+	const uint32_t threadcount = 1)
+{
+	std::vector<uint32_t> lineindices;
+	std::vector<OBJSubMesh> submeshes;
+	if (!LoadOBJtoRenderMesh(filename, positions, normals, uvs, faceindices, lineindices, submeshes, meshoffset, meshscale, threadcount))
+		return false;
 
-					std::getline(viss, Index, '/');
-					VertInFace[i] = std::stoi(Index);
-				}
+	if (lineindices.empty())
+		return true;
 
-				for (uint32_t i = 0, EdgeStart[3] = { 0, 1, 2 }, EdgeEnd[3] = { 1, 2, 0 }; i < 3; i++) {
-					uint32_t ES = VertInFace[EdgeStart[i]];
-					uint32_t EE = VertInFace[EdgeEnd[i]];
-					if (ES > EE) {
-						uint32_t temp = EE;
-						EE = ES;
-						ES = temp;
-					}
+	// 三角形の頂点を先に作るので、線分だけが使う頂点は後ろにまとまっている
+	const uint32_t VertSize = faceindices.empty() ? 0 : *std::max_element(faceindices.begin(), faceindices.end()) + 1;
+	positions.resize(VertSize);
+	normals.resize(VertSize);
+	uvs.resize(VertSize);
 
-					AdjacencyList[ES].insert(EE);
-				}
+	return true;
+}
 
-				for (uint32_t i = 0, EdgeStart[3] = { 0, 2, 3 }, EdgeEnd[3] = { 2, 3, 0 }; i < 3; i++) {
-					uint32_t ES = VertInFace[EdgeStart[i]];
-					uint32_t EE = VertInFace[EdgeEnd[i]];
-					if (ES > EE) {
-						uint32_t temp = EE;
-						EE = ES;
-						ES = temp;
-					}
+bool LoadOBJtoRenderEdgeMesh(
+	const char* filename,
+	std::vector<fvec3>& positions,
+	std::vector<uint32_t>& faceindices,
+	const fvec3& meshoffset,
+	const float& meshscale,
+	const uint32_t threadcount = 1)
+{
+	OBJRawMesh raw;
+	if (!ReadOBJRawMesh(filename, meshoffset, meshscale, true, threadcount, raw))
+		return false;
 
-					AdjacencyList[ES].insert(EE);
-				}
-			}
-		}
+	// 辺は (小さい index << 32 | 大きい index) として集め、最後に sort + unique で重複を除く
+	std::vector<uint64_t> EdgeList;
+	EdgeList.reserve(raw.FaceVertList.size() + raw.LineVertList.size() / 2);
+
+	// 範囲外の index は LoadOBJtoRenderMesh と同じく 0 番 (原点) として扱う
+	const uint32_t PositionSize = raw.PositionSet.size();
+	auto AddEdge = [&EdgeList, PositionSize](uint32_t ES, uint32_t EE) {
+		ES = ES < PositionSize ? ES : 0;
+		EE = EE < PositionSize ? EE : 0;
+		if (ES > EE)
+			std::swap(ES, EE);
+		EdgeList.emplace_back((uint64_t(ES) << 32) | uint64_t(EE));
+	};
+
+	for (size_t i = 0; i < raw.FaceVertList.size(); i += 3) {
+		for (uint32_t j = 0; j < 3; j++)
+			AddEdge(raw.FaceVertList[i + j].x, raw.FaceVertList[i + (j + 1) % 3].x);
 	}
 
-	uint32_t ilistsize = 0;
-	for (auto x : AdjacencyList) {
-		ilistsize += 2 * x.size();
-	}
+	// l の線分もそのまま辺にする
+	for (size_t i = 0; i < raw.LineVertList.size(); i += 2)
+		AddEdge(raw.LineVertList[i].x, raw.LineVertList[i + 1].x);
 
-	faceindices.resize(ilistsize);
+	std::sort(EdgeList.begin(), EdgeList.end());
+	EdgeList.erase(std::unique(EdgeList.begin(), EdgeList.end()), EdgeList.end());
 
-	uint32_t counter = 0;
-	for (uint32_t i = 1; i < AdjacencyList.size(); i++) {
-		uint32_t counterinlist = 0;
-		for (const auto& x : AdjacencyList[i]) {
-			faceindices[counter + 2 * counterinlist] = i;
-			faceindices[counter + 2 * counterinlist + 1] = x;
-			counterinlist++;
-		}
-		counter += 2 * AdjacencyList[i].size();
+	faceindices.resize(2 * EdgeList.size());
+	for (uint32_t i = 0; i < EdgeList.size(); i++) {
+		faceindices[2 * i + 0] = uint32_t(EdgeList[i] >> 32);
+		faceindices[2 * i + 1] = uint32_t(EdgeList[i] & 0xFFFFFFFFu);
 	}
 
-	positions.resize(VertSize + 1);
+	// positions[0] はダミー (範囲外の index だけが指す)
+	positions = std::move(raw.PositionSet);
 
-	for (uint32_t i = 0; i < VertSize + 1; i++) {
-		auto& positon = positions[i];
-
-		positon(0) = PositionSet[i].x;
-		positon(1) = PositionSet[i].y;
-		positon(2) = PositionSet[i].z;
+	return true;
+}
 
+// physics 用に position の index を確かめる (相対 index は ReadOBJRawMesh で解決済み)
+// render 用は範囲外の index を 0 番 (原点) として描くが、physics では存在しない頂点を拘束できないのでファイルごと読まない
+// 0, 定義より前を指す負の index, 定義された数を越えた index はどれも 0 か PositionSet の範囲外になっている
+bool CheckOBJPositionIndices(const char* filename, const std::vector<vec3<uint32_t>>& VertList, const size_t& PositionSize)
+{
+	for (const auto& Index : VertList) {
+		if (Index.x == 0 || Index.x >= PositionSize) {
+			std::cout << filename << " : invalid vertex index" << std::endl;
+			return false;
+		}
 	}
-
 	return true;
 }
 
+// weldepsilon > 0 のときは距離 weldepsilon 以内の position をまとめる (WeldOBJPositions)
+// seam で頂点が複製された OBJ からも閉じた physics mesh を作れる
 bool LoadOBJtoPhysicsTriangleMesh(
 	const char* filename,
 	fvec3** const vpdata,
@@ -464,101 +1016,57 @@ bool LoadOBJtoPhysicsTriangleMesh(
 	uint32_t** const ilistdata,
 	uint32_t& ilistsize,
 	const fvec3& meshoffset,
-	const float& meshscale)
+	const float& meshscale,
+	const uint32_t threadcount = 1,
+	const float weldepsilon = 0.0f)
 {
-	std::ifstream file(filename);
-	if (file.fail()) {
-		std::cout << "fail to open file: " << filename << std::endl;
+	OBJRawMesh raw;
+	if (!ReadOBJRawMesh(filename, meshoffset, meshscale, true, threadcount, raw))
+		return false;
+	if (!CheckOBJPositionIndices(filename, raw.FaceVertList, raw.PositionSet.size()))
 		return false;
-	}
-
-	uint32_t FaceSize = 0;
-	uint32_t VertSize = 0;
 
-	std::deque<fvec3> PositionSet;
+	if (weldepsilon > 0.0f)
+		WeldOBJPositions(raw, weldepsilon);
 
-	std::string line;
+	vertsize = raw.PositionSet.size() - 1;
+	(*vpdata) = new fvec3[vertsize];
+	std::copy(raw.PositionSet.begin() + 1, raw.PositionSet.end(), *vpdata);
 
-	while (std::getline(file, line)) {
-		std::istringstream iss(line);
-		std::string linetype;
-		iss >> linetype;
+	ilistsize = raw.FaceVertList.size();
+	(*ilistdata) = new uint32_t[ilistsize];
+	for (uint32_t i = 0; i < ilistsize; i++)
+		(*ilistdata)[i] = raw.FaceVertList[i].x - 1;
 
-		if (linetype == "v") {
-			float x, y, z;
-			iss >> x >> y >> z;
-			x *= meshscale;
-			y *= meshscale;
-			z *= meshscale;
-			PositionSet.emplace_back(fvec3(x, y, z) + meshoffset);
-			VertSize++;
-		}
-		else if (linetype == "f") {
-			std::string stv[4];
-			iss >> stv[0] >> stv[1] >> stv[2] >> stv[3];
-			if (stv[3] == "")
-				FaceSize += 1;
-			else
-				FaceSize += 2;
-		}
-	}
-
-	file.clear();
-	file.seekg(0L, std::ios::beg);
+	return true;
+}
 
-	(*vpdata) = new fvec3[VertSize];
-	vertsize = VertSize;
-	for (uint32_t i = 0; i < VertSize; i++)
-		(*vpdata)[i] = PositionSet[i];
-
-	(*ilistdata) = new uint32_t[3 * FaceSize];
-	ilistsize = 3 * FaceSize;
-
-	uint32_t CurrentFaceIndex = 0;
-	while (std::getline(file, line)) {
-		std::istringstream iss(line);
-		std::string linetype;
-		iss >> linetype;
-
-		if (linetype == "f") {
-			std::string stv[4];
-			iss >> stv[0] >> stv[1] >> stv[2] >> stv[3];
-			if (stv[3] == "") {
-				uint32_t VertInFace[3];
-				for (uint32_t i = 0; i < 3; i++) {
-					std::istringstream viss(stv[i]);
-					std::string Index;
-
-					std::getline(viss, Index, '/');
-					VertInFace[i] = std::stoi(Index);
-				}
+// l の線分 (rod / hair) を physics 用に読む
+// ilistdata には線分ごとの頂点 index (0-based) を 2 つずつ入れる
+bool LoadOBJtoPhysicsLineMesh(
+	const char* filename,
+	fvec3** const vpdata,
+	uint32_t& vertsize,
+	uint32_t** const ilistdata,
+	uint32_t& ilistsize,
+	const fvec3& meshoffset,
+	const float& meshscale,
+	const uint32_t threadcount = 1)
+{
+	OBJRawMesh raw;
+	if (!ReadOBJRawMesh(filename, meshoffset, meshscale, true, threadcount, raw))
+		return false;
+	if (!CheckOBJPositionIndices(filename, raw.LineVertList, raw.PositionSet.size()))
+		return false;
 
-				for (uint32_t i = 0, OrderArray[3] = { 0, 1, 2 }; i < 3; i++) {
-					(*ilistdata)[3 * CurrentFaceIndex + i] = VertInFace[OrderArray[i]] - 1;
-				}
-				CurrentFaceIndex++;
-			}
-			else {
-				uint32_t VertInFace[4];
-				for (uint32_t i = 0; i < 4; i++) {
-					std::istringstream viss(stv[i]);
-					std::string Index;
+	vertsize = raw.PositionSet.size() - 1;
+	(*vpdata) = new fvec3[vertsize];
+	std::copy(raw.PositionSet.begin() + 1, raw.PositionSet.end(), *vpdata);
 
-					std::getline(viss, Index, '/');
-					VertInFace[i] = std::stoi(Index);
-				}
-				for (uint32_t i = 0, OrderArray[3] = { 0, 1, 2 }; i < 3; i++) {
-					(*ilistdata)[3 * CurrentFaceIndex + i] = VertInFace[OrderArray[i]] - 1;
-				}
-				CurrentFaceIndex++;
-				for (uint32_t i = 0, OrderArray[3] = { 0, 2, 3 }; i < 3; i++) {
-					(*ilistdata)[3 * CurrentFaceIndex + i] = VertInFace[OrderArray[i]] - 1;
-				}
-				CurrentFaceIndex++;
-			}
-		}
-	}
+	ilistsize = raw.LineVertList.size();
+	(*ilistdata) = new uint32_t[ilistsize];
+	for (uint32_t i = 0; i < ilistsize; i++)
+		(*ilistdata)[i] = raw.LineVertList[i].x - 1;
 
 	return true;
 }
-
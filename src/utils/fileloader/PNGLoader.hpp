@@ -0,0 +1,607 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+// PNG を RGBA8 に展開する
+// zlib (deflate) の展開も自前で行う
+// 対応 : 全ての color type, bit depth 1/2/4/8/16 (16 bit は上位 8 bit を使う), Adam7 interlace, tRNS
+
+// deflate の huffman 表
+// 9 bit 以下の符号は fast 表を 1 回引くだけで求まる
+// それより長い符号は長さごとの最大値と比べて求める
+struct InflateHuffman {
+	static constexpr uint32_t FastBits = 9;
+
+	uint16_t fast[1 << FastBits];
+	uint16_t firstcode[16];
+	uint32_t maxcode[17];
+	uint16_t firstsymbol[16];
+	uint8_t size[288];
+	uint16_t value[288];
+};
+
+inline uint32_t InflateBitReverse(uint32_t code, const uint32_t& bits)
+{
+	uint32_t result = 0;
+	for (uint32_t i = 0; i < bits; i++) {
+		result = (result << 1) | (code & 1);
+		code >>= 1;
+	}
+	return result;
+}
+
+bool BuildInflateHuffman(InflateHuffman& huffman, const uint8_t* sizelist, const uint32_t& count)
+{
+	uint32_t sizes[17] = {};
+	std::memset(huffman.fast, 0, sizeof(huffman.fast));
+	std::memset(huffman.size, 0, sizeof(huffman.size));
+	for (uint32_t i = 0; i < count; i++)
+		sizes[sizelist[i]]++;
+	sizes[0] = 0;
+	for (uint32_t i = 1; i < 16; i++) {
+		if (sizes[i] > (1u << i))
+			return false;
+	}
+
+	uint32_t code = 0;
+	uint32_t k = 0;
+	uint32_t nextcode[16];
+	for (uint32_t i = 1; i < 16; i++) {
+		nextcode[i] = code;
+		huffman.firstcode[i] = uint16_t(code);
+		huffman.firstsymbol[i] = uint16_t(k);
+		code += sizes[i];
+		if (sizes[i] != 0 && code - 1 >= (1u << i))
+			return false;
+		huffman.maxcode[i] = code << (16 - i); // 16 bit に左詰めした値で比べる
+		code <<= 1;
+		k += sizes[i];
+	}
+	huffman.maxcode[16] = 0x10000;
+
+	for (uint32_t i = 0; i < count; i++) {
+		const uint32_t s = sizelist[i];
+		if (s == 0)
+			continue;
+		const uint32_t c = nextcode[s] - huffman.firstcode[s] + huffman.firstsymbol[s];
+		huffman.size[c] = uint8_t(s);
+		huffman.value[c] = uint16_t(i);
+		if (s <= InflateHuffman::FastBits) {
+			// deflate の符号は LSB から詰まっているので、反転した値で表を引く
+			for (uint32_t j = InflateBitReverse(nextcode[s], s); j < (1u << InflateHuffman::FastBits); j += (1u << s))
+				huffman.fast[j] = uint16_t((s << 9) | i);
+		}
+		nextcode[s]++;
+	}
+
+	return true;
+}
+
+class InflateStream
+{
+public:
+	InflateStream(const uint8_t* data, const size_t& size, std::vector<uint8_t>& out)
+	    : m_p(data)
+	    , m_end(data + size)
+	    , m_out(out)
+	{
+	}
+
+	bool Inflate()
+	{
+		bool isFinal = false;
+		while (!isFinal) {
+			isFinal = GetBits(1) != 0;
+			const uint32_t type = GetBits(2);
+			if (type == 0) {
+				if (!CopyStored())
+					return false;
+			}
+			else if (type == 3) {
+				return false;
+			}
+			else {
+				if (type == 1) {
+					if (!BuildFixedTables())
+						return false;
+				}
+				else if (!BuildDynamicTables()) {
+					return false;
+				}
+				if (!DecodeBlock())
+					return false;
+			}
+			if (m_isOverrun)
+				return false;
+		}
+		return true;
+	}
+
+private:
+	const uint8_t* m_p;
+	const uint8_t* m_end;
+	std::vector<uint8_t>& m_out;
+	uint64_t m_bitbuffer = 0;
+	uint32_t m_bitcount = 0;
+	bool m_isOverrun = false;
+
+	InflateHuffman m_length;
+	InflateHuffman m_distance;
+
+	void Fill()
+	{
+		while (m_bitcount <= 56) {
+			if (m_p < m_end) {
+				m_bitbuffer |= uint64_t(*m_p++) << m_bitcount;
+			}
+			else {
+				// 終端を越えて読むのは最後の符号の先読みだけなので 0 を詰める
+				// 本当に足りなかったかは GetBits / Decode で残りの bit 数と比べる
+				if (m_bitcount == 0)
+					m_isOverrun = true;
+				return;
+			}
+			m_bitcount += 8;
+		}
+	}
+
+	uint32_t GetBits(const uint32_t& n)
+	{
+		if (m_bitcount < n)
+			Fill();
+		if (m_bitcount < n) {
+			m_isOverrun = true;
+			return 0;
+		}
+		const uint32_t value = uint32_t(m_bitbuffer & ((uint64_t(1) << n) - 1));
+		m_bitbuffer >>= n;
+		m_bitcount -= n;
+		return value;
+	}
+
+	int32_t Decode(const InflateHuffman& huffman)
+	{
+		if (m_bitcount < 16)
+			Fill();
+
+		const uint32_t fast = huffman.fast[m_bitbuffer & ((1 << InflateHuffman::FastBits) - 1)];
+		if (fast != 0) {
+			const uint32_t s = fast >> 9;
+			if (s > m_bitcount)
+				return -1;
+			m_bitbuffer >>= s;
+			m_bitcount -= s;
+			return int32_t(fast & 511);
+		}
+
+		const uint32_t k = InflateBitReverse(uint32_t(m_bitbuffer & 0xFFFF), 16);
+		uint32_t s = InflateHuffman::FastBits + 1;
+		while (s < 16 && k >= huffman.maxcode[s])
+			s++;
+		if (s >= 16 || s > m_bitcount)
+			return -1;
+		const uint32_t b = (k >> (16 - s)) - huffman.firstcode[s] + huffman.firstsymbol[s];
+		if (b >= 288 || huffman.size[b] != s)
+			return -1;
+		m_bitbuffer >>= s;
+		m_bitcount -= s;
+		return huffman.value[b];
+	}
+
+	bool CopyStored()
+	{
+		// byte 境界に揃えてから LEN / NLEN を読む
+		const uint32_t skip = m_bitcount & 7;
+		GetBits(skip);
+		uint8_t header[4];
+		for (uint32_t i = 0; i < 4; i++)
+			header[i] = uint8_t(GetBits(8));
+		const uint32_t len = header[0] | (header[1] << 8);
+		const uint32_t nlen = header[2] | (header[3] << 8);
+		if (m_isOverrun || (len ^ 0xFFFF) != nlen)
+			return false;
+
+		// bit buffer に残っている分を先に出す
+		uint32_t remain = len;
+		while (remain > 0 && m_bitcount >= 8) {
+			m_out.push_back(uint8_t(GetBits(8)));
+			remain--;
+		}
+		if (size_t(m_end - m_p) < remain)
+			return false;
+		m_out.insert(m_out.end(), m_p, m_p + remain);
+		m_p += remain;
+		return true;
+	}
+
+	bool BuildFixedTables()
+	{
+		uint8_t lengthsizes[288];
+		uint8_t distancesizes[32];
+		for (uint32_t i = 0; i < 288; i++)
+			lengthsizes[i] = (i <= 143) ? 8 : (i <= 255) ? 9 : (i <= 279) ? 7 : 8;
+		for (uint32_t i = 0; i < 32; i++)
+			distancesizes[i] = 5;
+		return BuildInflateHuffman(m_length, lengthsizes, 288) && BuildInflateHuffman(m_distance, distancesizes, 32);
+	}
+
+	bool BuildDynamicTables()
+	{
+		static constexpr uint8_t CodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+		const uint32_t hlit = GetBits(5) + 257;
+		const uint32_t hdist = GetBits(5) + 1;
+		const uint32_t hclen = GetBits(4) + 4;
+
+		uint8_t codelengthsizes[19] = {};
+		for (uint32_t i = 0; i < hclen; i++)
+			codelengthsizes[CodeLengthOrder[i]] = uint8_t(GetBits(3));
+
+		InflateHuffman codelength;
+		if (m_isOverrun || !BuildInflateHuffman(codelength, codelengthsizes, 19))
+			return false;
+
+		uint8_t sizes[286 + 32];
+		uint32_t n = 0;
+		while (n < hlit + hdist) {
+			const int32_t c = Decode(codelength);
+			if (c < 0)
+				return false;
+			if (c < 16) {
+				sizes[n++] = uint8_t(c);
+				continue;
+			}
+
+			uint32_t repeat;
+			uint8_t fill = 0;
+			if (c == 16) {
+				if (n == 0)
+					return false;
+				repeat = GetBits(2) + 3;
+				fill = sizes[n - 1];
+			}
+			else if (c == 17) {
+				repeat = GetBits(3) + 3;
+			}
+			else {
+				repeat = GetBits(7) + 11;
+			}
+			if (n + repeat > hlit + hdist)
+				return false;
+			std::memset(sizes + n, fill, repeat);
+			n += repeat;
+		}
+
+		return BuildInflateHuffman(m_length, sizes, hlit) && BuildInflateHuffman(m_distance, sizes + hlit, hdist);
+	}
+
+	bool DecodeBlock()
+	{
+		static constexpr uint16_t LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+		static constexpr uint8_t LengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+		static constexpr uint16_t DistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+		static constexpr uint8_t DistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+		while (true) {
+			const int32_t symbol = Decode(m_length);
+			if (symbol < 0)
+				return false;
+			if (symbol < 256) {
+				m_out.push_back(uint8_t(symbol));
+				continue;
+			}
+			if (symbol == 256)
+				return true;
+			if (symbol >= 286)
+				return false;
+
+			const uint32_t length = LengthBase[symbol - 257] + GetBits(LengthExtra[symbol - 257]);
+			const int32_t distancesymbol = Decode(m_distance);
+			if (distancesymbol < 0 || distancesymbol >= 30)
+				return false;
+			const uint32_t distance = DistanceBase[distancesymbol] + GetBits(DistanceExtra[distancesymbol]);
+			if (m_isOverrun || distance > m_out.size())
+				return false;
+
+			// 重なりがあり得るので 1 byte ずつ写す
+			const size_t begin = m_out.size();
+			m_out.resize(begin + length);
+			uint8_t* dst = m_out.data() + begin;
+			const uint8_t* src = dst - distance;
+			for (uint32_t i = 0; i < length; i++)
+				dst[i] = src[i];
+		}
+	}
+};
+
+// zlib 形式 (2 byte の header + deflate + adler32) を展開する
+// adler32 は確かめない
+bool InflateZlib(const uint8_t* data, const size_t& size, std::vector<uint8_t>& out)
+{
+	if (size < 2)
+		return false;
+	const uint32_t cmf = data[0];
+	const uint32_t flg = data[1];
+	if ((cmf & 15) != 8 || ((cmf << 8) | flg) % 31 != 0 || (flg & 32) != 0)
+		return false;
+
+	InflateStream stream(data + 2, size - 2, out);
+	return stream.Inflate();
+}
+
+inline uint32_t PNGReadUint32(const uint8_t* p)
+{
+	return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+inline uint8_t PNGPaeth(const int32_t& a, const int32_t& b, const int32_t& c)
+{
+	const int32_t p = a + b - c;
+	const int32_t pa = std::abs(p - a);
+	const int32_t pb = std::abs(p - b);
+	const int32_t pc = std::abs(p - c);
+	if (pa <= pb && pa <= pc)
+		return uint8_t(a);
+	return (pb <= pc) ? uint8_t(b) : uint8_t(c);
+}
+
+// filter を外す (その場で書き換える)
+// rows は各行の先頭に filter type が 1 byte 付いた形
+bool PNGUnfilter(uint8_t* rows, const uint32_t& height, const uint32_t& rowbytes, const uint32_t& bpp)
+{
+	const uint32_t stride = rowbytes + 1;
+	for (uint32_t y = 0; y < height; y++) {
+		uint8_t* row = rows + size_t(stride) * y + 1;
+		const uint8_t* prior = (y > 0) ? row - stride : nullptr;
+		const uint8_t filter = row[-1];
+
+		switch (filter) {
+		case 0:
+			break;
+		case 1:
+			for (uint32_t i = bpp; i < rowbytes; i++)
+				row[i] = uint8_t(row[i] + row[i - bpp]);
+			break;
+		case 2:
+			if (prior)
+				for (uint32_t i = 0; i < rowbytes; i++)
+					row[i] = uint8_t(row[i] + prior[i]);
+			break;
+		case 3:
+			for (uint32_t i = 0; i < rowbytes; i++) {
+				const uint32_t left = (i >= bpp) ? row[i - bpp] : 0;
+				const uint32_t up = prior ? prior[i] : 0;
+				row[i] = uint8_t(row[i] + ((left + up) >> 1));
+			}
+			break;
+		case 4:
+			for (uint32_t i = 0; i < rowbytes; i++) {
+				const int32_t left = (i >= bpp) ? row[i - bpp] : 0;
+				const int32_t up = prior ? prior[i] : 0;
+				const int32_t upleft = (prior && i >= bpp) ? prior[i - bpp] : 0;
+				row[i] = uint8_t(row[i] + PNGPaeth(left, up, upleft));
+			}
+			break;
+		default:
+			return false;
+		}
+	}
+	return true;
+}
+
+struct PNGHeader {
+	uint32_t width;
+	uint32_t height;
+	uint32_t bitdepth;
+	uint32_t colortype;
+	uint32_t channels;
+	uint8_t palette[256 * 4];
+	uint32_t paletteSize = 0;
+	bool hasTransparentKey = false;
+	uint16_t transparentKey[3] = {};
+};
+
+// filter を外した 1 行分を RGBA8 にして dst の x0, x0 + dx, ... に書く
+void PNGExpandRow(const PNGHeader& header, const uint8_t* row, const uint32_t& count, uint8_t* dst, const uint32_t& dx)
+{
+	const uint32_t depth = header.bitdepth;
+
+	auto Sample = [&](const uint32_t& index) -> uint32_t {
+		if (depth == 8)
+			return row[index];
+		if (depth == 16)
+			return (uint32_t(row[2 * index]) << 8) | row[2 * index + 1];
+		const uint32_t bit = index * depth;
+		return (row[bit >> 3] >> (8 - depth - (bit & 7))) & ((1u << depth) - 1);
+	};
+	auto To8 = [&](const uint32_t& v) -> uint8_t {
+		if (depth == 16)
+			return uint8_t(v >> 8);
+		if (depth == 8)
+			return uint8_t(v);
+		return uint8_t(v * 255 / ((1u << depth) - 1));
+	};
+
+	for (uint32_t x = 0; x < count; x++) {
+		uint8_t* out = dst + size_t(4) * dx * x;
+		switch (header.colortype) {
+		case 0: {
+			const uint32_t g = Sample(x);
+			out[0] = out[1] = out[2] = To8(g);
+			out[3] = (header.hasTransparentKey && g == header.transparentKey[0]) ? 0 : 255;
+			break;
+		}
+		case 2: {
+			const uint32_t r = Sample(3 * x + 0);
+			const uint32_t g = Sample(3 * x + 1);
+			const uint32_t b = Sample(3 * x + 2);
+			out[0] = To8(r);
+			out[1] = To8(g);
+			out[2] = To8(b);
+			const bool isKey = header.hasTransparentKey && r == header.transparentKey[0] && g == header.transparentKey[1] && b == header.transparentKey[2];
+			out[3] = isKey ? 0 : 255;
+			break;
+		}
+		case 3: {
+			const uint32_t index = Sample(x);
+			const uint8_t* color = header.palette + 4 * ((index < header.paletteSize) ? index : 0);
+			std::memcpy(out, color, 4);
+			break;
+		}
+		case 4:
+			out[0] = out[1] = out[2] = To8(Sample(2 * x + 0));
+			out[3] = To8(Sample(2 * x + 1));
+			break;
+		case 6:
+			out[0] = To8(Sample(4 * x + 0));
+			out[1] = To8(Sample(4 * x + 1));
+			out[2] = To8(Sample(4 * x + 2));
+			out[3] = To8(Sample(4 * x + 3));
+			break;
+		}
+	}
+}
+
+bool DecodePNG(const uint8_t* data, const size_t& size, std::vector<uint8_t>& rgba, uint32_t& width, uint32_t& height)
+{
+	static constexpr uint8_t Signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	if (size < 8 || std::memcmp(data, Signature, 8) != 0) {
+		std::cout << "PNG: invalid signature" << std::endl;
+		return false;
+	}
+
+	PNGHeader header;
+	bool hasHeader = false;
+	uint32_t interlace = 0;
+	std::vector<uint8_t> compressed;
+
+	const uint8_t* p = data + 8;
+	const uint8_t* const end = data + size;
+	while (p + 12 <= end) {
+		const uint32_t length = PNGReadUint32(p);
+		const uint8_t* type = p + 4;
+		const uint8_t* chunk = p + 8;
+		if (length > size_t(end - chunk) - 4) {
+			std::cout << "PNG: truncated chunk" << std::endl;
+			return false;
+		}
+		p = chunk + length + 4; // CRC は確かめない
+
+		if (std::memcmp(type, "IHDR", 4) == 0) {
+			if (length < 13)
+				return false;
+			header.width = PNGReadUint32(chunk);
+			header.height = PNGReadUint32(chunk + 4);
+			header.bitdepth = chunk[8];
+			header.colortype = chunk[9];
+			interlace = chunk[12];
+			static constexpr uint32_t ChannelCount[7] = { 1, 0, 3, 1, 2, 0, 4 };
+			header.channels = (header.colortype <= 6) ? ChannelCount[header.colortype] : 0;
+			const uint32_t depth = header.bitdepth;
+			const bool isValidDepth = (depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16)
+				&& (header.colortype == 0 || header.colortype == 3 ? true : depth >= 8)
+				&& (header.colortype != 3 || depth <= 8);
+			if (header.channels == 0 || !isValidDepth || interlace > 1 || header.width == 0 || header.height == 0
+				|| header.width > (1u << 24) || header.height > (1u << 24)) {
+				std::cout << "PNG: unsupported format" << std::endl;
+				return false;
+			}
+			hasHeader = true;
+		}
+		else if (std::memcmp(type, "PLTE", 4) == 0) {
+			header.paletteSize = std::min<uint32_t>(length / 3, 256);
+			for (uint32_t i = 0; i < header.paletteSize; i++) {
+				header.palette[4 * i + 0] = chunk[3 * i + 0];
+				header.palette[4 * i + 1] = chunk[3 * i + 1];
+				header.palette[4 * i + 2] = chunk[3 * i + 2];
+				header.palette[4 * i + 3] = 255;
+			}
+		}
+		else if (std::memcmp(type, "tRNS", 4) == 0) {
+			if (header.colortype == 3) {
+				for (uint32_t i = 0; i < length && i < header.paletteSize; i++)
+					header.palette[4 * i + 3] = chunk[i];
+			}
+			else if (header.colortype == 0 && length >= 2) {
+				header.hasTransparentKey = true;
+				header.transparentKey[0] = uint16_t((chunk[0] << 8) | chunk[1]);
+			}
+			else if (header.colortype == 2 && length >= 6) {
+				header.hasTransparentKey = true;
+				for (uint32_t i = 0; i < 3; i++)
+					header.transparentKey[i] = uint16_t((chunk[2 * i] << 8) | chunk[2 * i + 1]);
+			}
+		}
+		else if (std::memcmp(type, "IDAT", 4) == 0) {
+			compressed.insert(compressed.end(), chunk, chunk + length);
+		}
+		else if (std::memcmp(type, "IEND", 4) == 0) {
+			break;
+		}
+	}
+
+	if (!hasHeader || compressed.empty() || (header.colortype == 3 && header.paletteSize == 0)) {
+		std::cout << "PNG: missing IHDR / IDAT / PLTE" << std::endl;
+		return false;
+	}
+
+	width = header.width;
+	height = header.height;
+	const uint32_t bitsPerPixel = header.bitdepth * header.channels;
+	const uint32_t bpp = std::max<uint32_t>(1, bitsPerPixel / 8);
+
+	// Adam7 の各 pass の開始位置と間隔 (interlace 無しは 1 pass として扱う)
+	static constexpr uint32_t Adam7[7][4] = {
+		{ 0, 0, 8, 8 }, { 4, 0, 8, 8 }, { 0, 4, 4, 8 }, { 2, 0, 4, 4 }, { 0, 2, 2, 4 }, { 1, 0, 2, 2 }, { 0, 1, 1, 2 }
+	};
+	static constexpr uint32_t NoInterlace[1][4] = { { 0, 0, 1, 1 } };
+	const uint32_t passCount = (interlace == 1) ? 7 : 1;
+	const uint32_t(*passes)[4] = (interlace == 1) ? Adam7 : NoInterlace;
+
+	size_t expected = 0;
+	for (uint32_t pass = 0; pass < passCount; pass++) {
+		const uint32_t pw = (width > passes[pass][0]) ? (width - passes[pass][0] + passes[pass][2] - 1) / passes[pass][2] : 0;
+		const uint32_t ph = (height > passes[pass][1]) ? (height - passes[pass][1] + passes[pass][3] - 1) / passes[pass][3] : 0;
+		if (pw > 0 && ph > 0)
+			expected += size_t(ph) * ((size_t(pw) * bitsPerPixel + 7) / 8 + 1);
+	}
+
+	std::vector<uint8_t> raw;
+	raw.reserve(expected);
+	if (!InflateZlib(compressed.data(), compressed.size(), raw) || raw.size() < expected) {
+		std::cout << "PNG: broken zlib stream" << std::endl;
+		return false;
+	}
+
+	rgba.resize(size_t(width) * height * 4);
+	uint8_t* pass_data = raw.data();
+	for (uint32_t pass = 0; pass < passCount; pass++) {
+		const uint32_t x0 = passes[pass][0];
+		const uint32_t y0 = passes[pass][1];
+		const uint32_t dx = passes[pass][2];
+		const uint32_t dy = passes[pass][3];
+		const uint32_t pw = (width > x0) ? (width - x0 + dx - 1) / dx : 0;
+		const uint32_t ph = (height > y0) ? (height - y0 + dy - 1) / dy : 0;
+		if (pw == 0 || ph == 0)
+			continue;
+
+		const uint32_t rowbytes = uint32_t((size_t(pw) * bitsPerPixel + 7) / 8);
+		if (!PNGUnfilter(pass_data, ph, rowbytes, bpp)) {
+			std::cout << "PNG: invalid filter type" << std::endl;
+			return false;
+		}
+		for (uint32_t y = 0; y < ph; y++) {
+			const uint8_t* row = pass_data + size_t(rowbytes + 1) * y + 1;
+			uint8_t* dst = rgba.data() + (size_t(y0 + y * dy) * width + x0) * 4;
+			PNGExpandRow(header, row, pw, dst, dx);
+		}
+		pass_data += size_t(rowbytes + 1) * ph;
+	}
+
+	return true;
+}
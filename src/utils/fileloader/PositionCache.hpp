@@ -0,0 +1,571 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include "src/utils/mathfunc/mathfunc.hpp"
+#include "src/utils/fileloader/MappedFile.hpp"
+#include "src/utils/fileloader/RansCoder.hpp"
+
+// シミュレーションの頂点位置 (1 frame あたり fvec3 が vertexCount 個) を frame ごとに圧縮して置いておく cache (.pbpc)
+// keyframeInterval frame ごとに区切り (group)、group 内の全 frame を包む AABB を基準に各成分を 16bit に量子化する
+// 量子化した値を keyframe では前の頂点から、それ以外は前の frame から予測し、その差を
+// 成分ごとに 1 byte の symbol にして (収まらないものは escape して 16bit のまま別に置く) rANS で符号化する
+// 差は全て 16bit の剰余で取るので、展開した値は量子化した値と完全に一致する (誤差は量子化の分だけ)
+// 任意の frame は直前の keyframe から展開し直せば読める。順に読むときは 1 frame 分の展開で済む
+
+constexpr uint32_t PositionCacheMagic = 0x43504250; // "PBPC"
+constexpr uint32_t PositionCacheVersion = 1;
+constexpr uint32_t PositionCacheEscape = 0xff;
+
+enum PositionCachePredictor : uint8_t {
+	PositionCacheSpatial,       // 1 つ前の頂点 (keyframe)
+	PositionCacheSpatialLinear, // 前の 2 頂点から線形に外挿 (keyframe, 格子状に並んだ mesh 向け)
+	PositionCachePrevious,      // 前の frame
+	PositionCacheLinear,        // 前の 2 frame から線形に外挿
+	PositionCacheMotion,        // 前の frame に 1 つ前の頂点の移動量を足す (keyframe の次など)
+};
+
+struct PositionCacheHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vertexCount;
+	uint32_t frameCount;
+	uint32_t keyframeInterval;
+	float frameRate;
+	uint64_t indexOffset; // PositionCacheFrame (frameCount 個), PositionCacheGroup (group 数) の順
+};
+
+struct PositionCacheFrame {
+	uint64_t offset; // ファイル先頭からの byte offset
+	uint32_t size;
+	uint32_t padding;
+};
+
+// 量子化した値 q から position = min + q * scale に戻す
+struct PositionCacheGroup {
+	float min[3];
+	float scale[3];
+};
+
+inline uint16_t PositionCacheZigZag(const uint16_t& delta)
+{
+	return uint16_t((delta << 1) ^ (0u - (delta >> 15)));
+}
+
+inline uint16_t PositionCacheUnZigZag(const uint16_t& value)
+{
+	return uint16_t((value >> 1) ^ (0u - (value & 1)));
+}
+
+// 16bit の剰余で予測との差を取る (成分ごと)
+inline void PredictPositionCacheAxis(
+    const PositionCachePredictor& predictor,
+    const uint16_t* const current,
+    const uint16_t* const previous,
+    const uint16_t* const previous2,
+    const uint32_t& count,
+    uint16_t* const predicted)
+{
+	for (uint32_t i = 0; i < count; i++) {
+		switch (predictor) {
+		case PositionCacheSpatial:
+			predicted[i] = (i == 0) ? 0 : current[i - 1];
+			break;
+		case PositionCacheSpatialLinear:
+			predicted[i] = (i == 0) ? 0 : (i == 1) ? current[0] : uint16_t(2 * current[i - 1] - current[i - 2]);
+			break;
+		case PositionCachePrevious:
+			predicted[i] = previous[i];
+			break;
+		case PositionCacheLinear:
+			predicted[i] = uint16_t(2 * previous[i] - previous2[i]);
+			break;
+		default:
+			predicted[i] = (i == 0) ? previous[0] : uint16_t(previous[i] + current[i - 1] - previous[i - 1]);
+			break;
+		}
+	}
+}
+
+// frame を 1 つずつ足していく
+// group の AABB を決めるため、keyframeInterval frame 分の position を溜めてからまとめて符号化する
+// 一時ファイルに書いてから Close で rename するので、書き込み途中のファイルを他の process が読むことはない
+class PositionCacheWriter
+{
+public:
+	PositionCacheWriter() = default;
+	PositionCacheWriter(const PositionCacheWriter&) = delete;
+	PositionCacheWriter& operator=(const PositionCacheWriter&) = delete;
+
+	~PositionCacheWriter()
+	{
+		// Close されなかったものは捨てる
+		if (m_file.is_open()) {
+			m_file.close();
+			std::error_code ec;
+			std::filesystem::remove(m_tempfilename, ec);
+		}
+	}
+
+	bool Open(const char* const filename, const uint32_t& vertexCount, const float& frameRate, const uint32_t& keyframeInterval = 16)
+	{
+		m_filename = filename;
+		m_tempfilename = m_filename + ".tmp";
+		if (vertexCount == 0) {
+			std::cout << m_filename << " : no vertices" << std::endl;
+			return false;
+		}
+		m_file.open(m_tempfilename, std::ios::binary);
+		if (!m_file) {
+			std::cout << "fail to open file: " << m_tempfilename << std::endl;
+			return false;
+		}
+
+		std::memset(&m_header, 0, sizeof(PositionCacheHeader));
+		m_header.magic = PositionCacheMagic;
+		m_header.version = PositionCacheVersion;
+		m_header.vertexCount = vertexCount;
+		m_header.keyframeInterval = std::max<uint32_t>(keyframeInterval, 1);
+		m_header.frameRate = frameRate;
+
+		m_frames.clear();
+		m_groups.clear();
+		m_pending.clear();
+		m_pending.reserve(size_t(m_header.keyframeInterval) * vertexCount);
+		m_offset = sizeof(PositionCacheHeader);
+
+		// frameCount と indexOffset は Close で書き直す
+		m_file.write(reinterpret_cast<const char*>(&m_header), sizeof(PositionCacheHeader));
+		return bool(m_file);
+	}
+
+	bool AppendFrame(const fvec3* const positions)
+	{
+		m_pending.insert(m_pending.end(), positions, positions + m_header.vertexCount);
+		if (m_pending.size() == size_t(m_header.keyframeInterval) * m_header.vertexCount)
+			return EncodeGroup();
+		return true;
+	}
+
+	bool AppendFrame(const std::vector<fvec3>& positions)
+	{
+		if (positions.size() != m_header.vertexCount) {
+			std::cout << m_filename << " : frame " << m_frames.size() + m_pending.size() / std::max<uint32_t>(m_header.vertexCount, 1)
+				  << " has " << positions.size() << " vertices (expected " << m_header.vertexCount << ")" << std::endl;
+			return false;
+		}
+		return AppendFrame(positions.data());
+	}
+
+	bool Close()
+	{
+		if (!m_pending.empty() && !EncodeGroup()) {
+			m_file.close();
+			std::error_code ec;
+			std::filesystem::remove(m_tempfilename, ec);
+			return false;
+		}
+
+		m_header.frameCount = uint32_t(m_frames.size());
+		m_header.indexOffset = m_offset;
+		m_file.write(reinterpret_cast<const char*>(m_frames.data()), m_frames.size() * sizeof(PositionCacheFrame));
+		m_file.write(reinterpret_cast<const char*>(m_groups.data()), m_groups.size() * sizeof(PositionCacheGroup));
+		m_file.seekp(0);
+		m_file.write(reinterpret_cast<const char*>(&m_header), sizeof(PositionCacheHeader));
+		const bool isSucceeded = bool(m_file);
+		m_file.close();
+
+		std::error_code ec;
+		if (!isSucceeded) {
+			std::cout << "fail to write file: " << m_tempfilename << std::endl;
+			std::filesystem::remove(m_tempfilename, ec);
+			return false;
+		}
+
+		std::filesystem::rename(m_tempfilename, m_filename, ec);
+		if (ec) {
+			std::cout << "fail to write file: " << m_filename << std::endl;
+			std::filesystem::remove(m_tempfilename, ec);
+			return false;
+		}
+
+		return true;
+	}
+
+	// ここまでに書いた圧縮後の byte 数 (index を除く)
+	uint64_t GetCompressedSize() const
+	{
+		return m_offset - sizeof(PositionCacheHeader);
+	}
+
+private:
+	std::string m_filename;
+	std::string m_tempfilename;
+	std::ofstream m_file;
+	PositionCacheHeader m_header = {};
+	std::vector<PositionCacheFrame> m_frames;
+	std::vector<PositionCacheGroup> m_groups;
+	std::vector<fvec3> m_pending; // 符号化を待っている frame の position
+	uint64_t m_offset = 0;
+
+	bool EncodeGroup()
+	{
+		const uint32_t vertexCount = m_header.vertexCount;
+		const uint32_t frameCount = uint32_t(m_pending.size() / vertexCount);
+
+		// group 内の全 frame を包む AABB
+		float lower[3] = { INFINITY, INFINITY, INFINITY };
+		float upper[3] = { -INFINITY, -INFINITY, -INFINITY };
+		bool isFinite = true;
+		for (const fvec3& p : m_pending) {
+			const float v[3] = { p.x, p.y, p.z };
+			for (uint32_t a = 0; a < 3; a++) {
+				lower[a] = std::min(lower[a], v[a]);
+				upper[a] = std::max(upper[a], v[a]);
+				isFinite &= std::isfinite(v[a]);
+			}
+		}
+
+		PositionCacheGroup group;
+		for (uint32_t a = 0; a < 3; a++) {
+			if (!isFinite || !std::isfinite(upper[a] - lower[a])) {
+				std::cout << m_filename << " : position is not finite" << std::endl;
+				return false;
+			}
+			group.min[a] = lower[a];
+			group.scale[a] = (upper[a] - lower[a]) / 65535.0f;
+		}
+		m_groups.push_back(group);
+
+		// 成分ごとに量子化した値 (frame, 成分, 頂点 の順)
+		std::vector<uint16_t> quantized(size_t(frameCount) * 3 * vertexCount);
+		for (uint32_t f = 0; f < frameCount; f++) {
+			for (uint32_t i = 0; i < vertexCount; i++) {
+				const fvec3& p = m_pending[size_t(f) * vertexCount + i];
+				const float v[3] = { p.x, p.y, p.z };
+				for (uint32_t a = 0; a < 3; a++) {
+					const float t = (group.scale[a] > 0.0f) ? (v[a] - group.min[a]) / group.scale[a] : 0.0f;
+					quantized[(size_t(f) * 3 + a) * vertexCount + i] = uint16_t(std::clamp(std::lround(t), 0l, 65535l));
+				}
+			}
+		}
+
+		std::vector<uint16_t> predicted(vertexCount);
+		std::vector<uint16_t> values(vertexCount);
+		std::vector<uint16_t> best(3 * size_t(vertexCount));
+		std::vector<uint8_t> symbols(vertexCount);
+		std::vector<uint8_t> block;
+
+		for (uint32_t f = 0; f < frameCount; f++) {
+			auto Axis = [&](const uint32_t& frame, const uint32_t& a) {
+				return quantized.data() + (size_t(frame) * 3 + a) * vertexCount;
+			};
+
+			// 使える予測のうち、差の絶対値の和が一番小さいものを使う
+			std::vector<PositionCachePredictor> candidates;
+			if (f == 0)
+				candidates = { PositionCacheSpatial, PositionCacheSpatialLinear };
+			else if (f == 1)
+				candidates = { PositionCachePrevious, PositionCacheMotion };
+			else
+				candidates = { PositionCachePrevious, PositionCacheLinear, PositionCacheMotion };
+
+			PositionCachePredictor predictor = candidates[0];
+			uint64_t minCost = UINT64_MAX;
+			for (const PositionCachePredictor candidate : candidates) {
+				uint64_t cost = 0;
+				for (uint32_t a = 0; a < 3; a++) {
+					PredictPositionCacheAxis(candidate, Axis(f, a), (f > 0) ? Axis(f - 1, a) : nullptr, (f > 1) ? Axis(f - 2, a) : nullptr, vertexCount, predicted.data());
+					for (uint32_t i = 0; i < vertexCount; i++)
+						cost += PositionCacheZigZag(uint16_t(Axis(f, a)[i] - predicted[i]));
+				}
+				if (cost < minCost) {
+					minCost = cost;
+					predictor = candidate;
+				}
+			}
+
+			block.clear();
+			block.push_back(predictor);
+			for (uint32_t a = 0; a < 3; a++) {
+				PredictPositionCacheAxis(predictor, Axis(f, a), (f > 0) ? Axis(f - 1, a) : nullptr, (f > 1) ? Axis(f - 2, a) : nullptr, vertexCount, predicted.data());
+
+				// 1 byte に収まらない差は escape して、16bit のまま後ろに並べる
+				uint32_t escapeCount = 0;
+				for (uint32_t i = 0; i < vertexCount; i++) {
+					const uint16_t value = PositionCacheZigZag(uint16_t(Axis(f, a)[i] - predicted[i]));
+					if (value < PositionCacheEscape) {
+						symbols[i] = uint8_t(value);
+					}
+					else {
+						symbols[i] = PositionCacheEscape;
+						values[escapeCount++] = value;
+					}
+				}
+
+				EncodeRansBlock(symbols.data(), vertexCount, block);
+				RansWriteUint32(block, escapeCount);
+				for (uint32_t i = 0; i < escapeCount; i++) {
+					block.push_back(uint8_t(values[i] & 0xff));
+					block.push_back(uint8_t(values[i] >> 8));
+				}
+			}
+
+			PositionCacheFrame frame;
+			frame.offset = m_offset;
+			frame.size = uint32_t(block.size());
+			frame.padding = 0;
+			m_frames.push_back(frame);
+
+			m_file.write(reinterpret_cast<const char*>(block.data()), block.size());
+			m_offset += block.size();
+		}
+
+		m_pending.clear();
+		if (!m_file) {
+			std::cout << "fail to write file: " << m_tempfilename << std::endl;
+			return false;
+		}
+		return true;
+	}
+};
+
+// mmap した position cache
+class PositionCache
+{
+public:
+	bool Open(const char* const filename)
+	{
+		Close();
+
+		if (!m_file.Open(filename))
+			return false;
+
+		if (m_file.size() < sizeof(PositionCacheHeader)) {
+			std::cout << filename << " is not a position cache file" << std::endl;
+			Close();
+			return false;
+		}
+
+		std::memcpy(&m_header, m_file.data(), sizeof(PositionCacheHeader));
+		if (m_header.magic != PositionCacheMagic || m_header.version != PositionCacheVersion || m_header.vertexCount == 0 || m_header.keyframeInterval == 0) {
+			std::cout << filename << " is not a position cache file" << std::endl;
+			Close();
+			return false;
+		}
+
+		// 足し算が桁あふれしないよう、残りの byte 数と比べる
+		const uint64_t fileSize = m_file.size();
+		const uint64_t groupCount = (uint64_t(m_header.frameCount) + m_header.keyframeInterval - 1) / m_header.keyframeInterval;
+		if (m_header.indexOffset < sizeof(PositionCacheHeader) || m_header.indexOffset > fileSize
+		    || m_header.frameCount > (fileSize - m_header.indexOffset) / sizeof(PositionCacheFrame)
+		    || groupCount > (fileSize - m_header.indexOffset - uint64_t(m_header.frameCount) * sizeof(PositionCacheFrame)) / sizeof(PositionCacheGroup)) {
+			std::cout << filename << " is broken" << std::endl;
+			Close();
+			return false;
+		}
+
+		m_frames.resize(m_header.frameCount);
+		m_groups.resize(groupCount);
+		if (m_header.frameCount > 0) {
+			std::memcpy(m_frames.data(), m_file.data() + m_header.indexOffset, m_frames.size() * sizeof(PositionCacheFrame));
+			std::memcpy(m_groups.data(), m_file.data() + m_header.indexOffset + m_frames.size() * sizeof(PositionCacheFrame), m_groups.size() * sizeof(PositionCacheGroup));
+		}
+		for (const auto& frame : m_frames) {
+			if (frame.offset < sizeof(PositionCacheHeader) || frame.offset > m_header.indexOffset || frame.size > m_header.indexOffset - frame.offset) {
+				std::cout << filename << " is broken" << std::endl;
+				Close();
+				return false;
+			}
+		}
+
+		m_filename = filename;
+		for (auto& buffer : m_quantized)
+			buffer.resize(3 * size_t(m_header.vertexCount));
+		m_symbols.resize(m_header.vertexCount);
+		m_deltas.resize(m_header.vertexCount);
+		m_lastFrame = UINT32_MAX;
+
+		return true;
+	}
+
+	void Close()
+	{
+		m_file.Close();
+		std::memset(&m_header, 0, sizeof(PositionCacheHeader));
+		m_frames.clear();
+		m_groups.clear();
+		m_lastFrame = UINT32_MAX;
+	}
+
+	uint32_t GetVertexCount() const
+	{
+		return m_header.vertexCount;
+	}
+
+	uint32_t GetFrameCount() const
+	{
+		return m_header.frameCount;
+	}
+
+	float GetFrameRate() const
+	{
+		return m_header.frameRate;
+	}
+
+	uint32_t GetKeyframeInterval() const
+	{
+		return m_header.keyframeInterval;
+	}
+
+	// frame の position を vertexCount 個書く
+	// 直前に読んだ frame の次なら 1 frame 分だけ、それ以外は keyframe から展開し直す
+	bool ReadFrame(const uint32_t& frame, fvec3* const positions)
+	{
+		if (frame >= m_header.frameCount) {
+			std::cout << m_filename << " : frame " << frame << " is out of range" << std::endl;
+			return false;
+		}
+
+		const uint32_t keyframe = frame / m_header.keyframeInterval * m_header.keyframeInterval;
+		uint32_t next = (m_lastFrame != UINT32_MAX && m_lastFrame >= keyframe && m_lastFrame < frame) ? m_lastFrame + 1 : keyframe;
+		if (m_lastFrame == frame)
+			next = frame + 1;
+
+		for (; next <= frame; next++) {
+			if (!DecodeFrame(next, keyframe)) {
+				std::cout << m_filename << " : frame " << next << " is broken" << std::endl;
+				m_lastFrame = UINT32_MAX;
+				return false;
+			}
+			m_lastFrame = next;
+		}
+
+		// 量子化した値から戻す
+		const PositionCacheGroup& group = m_groups[frame / m_header.keyframeInterval];
+		const uint32_t vertexCount = m_header.vertexCount;
+		const uint16_t* const qx = m_quantized[frame % 3].data();
+		const uint16_t* const qy = qx + vertexCount;
+		const uint16_t* const qz = qy + vertexCount;
+		for (uint32_t i = 0; i < vertexCount; i++) {
+			positions[i] = fvec3(
+			    group.min[0] + float(qx[i]) * group.scale[0],
+			    group.min[1] + float(qy[i]) * group.scale[1],
+			    group.min[2] + float(qz[i]) * group.scale[2]);
+		}
+
+		return true;
+	}
+
+	const PositionCacheHeader& GetHeader() const
+	{
+		return m_header;
+	}
+
+private:
+	std::string m_filename;
+	MappedFile m_file;
+	PositionCacheHeader m_header = {};
+	std::vector<PositionCacheFrame> m_frames;
+	std::vector<PositionCacheGroup> m_groups;
+
+	// frame % 3 番目に frame の量子化した値 (成分ごとに vertexCount 個) を置く (線形外挿に 2 frame 前まで使う)
+	std::vector<uint16_t> m_quantized[3];
+	std::vector<uint8_t> m_symbols;
+	std::vector<uint16_t> m_deltas;
+	uint32_t m_lastFrame = UINT32_MAX;
+
+	bool DecodeFrame(const uint32_t& frame, const uint32_t& keyframe)
+	{
+		const PositionCacheFrame& entry = m_frames[frame];
+		const uint8_t* p = reinterpret_cast<const uint8_t*>(m_file.data()) + entry.offset;
+		const uint8_t* const end = p + entry.size;
+		if (p >= end)
+			return false;
+
+		const PositionCachePredictor predictor = PositionCachePredictor(*p++);
+		if (predictor > PositionCacheMotion || (frame == keyframe) != (predictor < PositionCachePrevious) || (predictor == PositionCacheLinear && frame < keyframe + 2))
+			return false;
+
+		const uint32_t vertexCount = m_header.vertexCount;
+		uint16_t* const current = m_quantized[frame % 3].data();
+		const uint16_t* const previous = m_quantized[(frame + 2) % 3].data();
+		const uint16_t* const previous2 = m_quantized[(frame + 1) % 3].data();
+
+		for (uint32_t a = 0; a < 3; a++) {
+			if (!DecodeRansBlock(p, end, m_symbols.data(), vertexCount) || end - p < 4)
+				return false;
+			const uint32_t escapeCount = RansReadUint32(p);
+			p += 4;
+			if (uint64_t(end - p) < uint64_t(escapeCount) * 2)
+				return false;
+			const uint8_t* escape = p;
+			const uint8_t* const escapeEnd = p + size_t(escapeCount) * 2;
+			p = escapeEnd;
+
+			uint16_t* const q = current + size_t(a) * vertexCount;
+			const uint16_t* const q1 = previous + size_t(a) * vertexCount;
+			const uint16_t* const q2 = previous2 + size_t(a) * vertexCount;
+			const uint8_t* const symbols = m_symbols.data();
+
+			// 差を 16bit に戻してから、escape した所だけ書き直す
+			uint16_t* const deltas = m_deltas.data();
+			for (uint32_t i = 0; i < vertexCount; i++)
+				deltas[i] = PositionCacheUnZigZag(symbols[i]);
+			for (const uint8_t* found = symbols; escape < escapeEnd; found++) {
+				found = static_cast<const uint8_t*>(std::memchr(found, PositionCacheEscape, symbols + vertexCount - found));
+				if (found == nullptr)
+					return false;
+				deltas[found - symbols] = PositionCacheUnZigZag(uint16_t(escape[0] | (escape[1] << 8)));
+				escape += 2;
+			}
+
+			switch (predictor) {
+			case PositionCacheSpatial: {
+				uint16_t last = 0;
+				for (uint32_t i = 0; i < vertexCount; i++) {
+					last = uint16_t(last + deltas[i]);
+					q[i] = last;
+				}
+				break;
+			}
+			case PositionCacheSpatialLinear: {
+				uint16_t last = 0;
+				uint16_t last2 = 0;
+				for (uint32_t i = 0; i < vertexCount; i++) {
+					const uint16_t predicted = (i < 2) ? last : uint16_t(2 * last - last2);
+					last2 = last;
+					last = uint16_t(predicted + deltas[i]);
+					q[i] = last;
+				}
+				break;
+			}
+			case PositionCachePrevious:
+				for (uint32_t i = 0; i < vertexCount; i++)
+					q[i] = uint16_t(q1[i] + deltas[i]);
+				break;
+			case PositionCacheLinear:
+				for (uint32_t i = 0; i < vertexCount; i++)
+					q[i] = uint16_t(2 * q1[i] - q2[i] + deltas[i]);
+				break;
+			default: {
+				uint16_t motion = 0;
+				for (uint32_t i = 0; i < vertexCount; i++) {
+					motion = uint16_t(motion + deltas[i]);
+					q[i] = uint16_t(q1[i] + motion);
+				}
+				break;
+			}
+			}
+		}
+
+		return p == end;
+	}
+};
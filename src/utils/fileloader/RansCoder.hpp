@@ -0,0 +1,280 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+// byte 列の order-0 エントロピー符号 (rANS)
+// 32bit の状態を RansStateCount 本交互に使い、16bit ずつ正規化する (ryg_rans の rans_word と同じ形)
+// 状態ごとに別の byte 列に書くので、展開時に各状態の読み位置が互いに依存せず並列に進む
+// 確率は RansScaleBits bit に量子化し、展開は slot 表を 1 回引くだけで 1 symbol 求まる
+// 全て同じ値の列は定数として、縮まない列は生のまま書く
+
+constexpr uint32_t RansScaleBits = 12;
+constexpr uint32_t RansScale = 1u << RansScaleBits;
+constexpr uint32_t RansLowerBound = 1u << 16;
+constexpr uint32_t RansStateCount = 4;
+
+enum RansBlockMode : uint8_t {
+	RansBlockRaw,      // 生の byte 列
+	RansBlockConstant, // 全て同じ値 (1 byte)
+	RansBlockRans,     // 頻度表, 状態ごとの byte 列の長さ, 状態ごとの byte 列 (先頭 4 byte が初期状態, 後は 16bit 単位)
+};
+
+// 出現回数を合計 RansScale の頻度に直す (出現した symbol は必ず 1 以上)
+// 2 種類以上の symbol があるときだけ呼ぶので、どの頻度も RansScale 未満に収まる
+inline void NormalizeRansFrequencies(const uint32_t (&counts)[256], const size_t& total, uint32_t (&freqs)[256])
+{
+	uint32_t sum = 0;
+	uint32_t largest = 0;
+	for (uint32_t s = 0; s < 256; s++) {
+		freqs[s] = (counts[s] == 0) ? 0 : std::max<uint32_t>(1, uint32_t(uint64_t(counts[s]) * RansScale / total));
+		sum += freqs[s];
+		if (freqs[s] > freqs[largest])
+			largest = s;
+	}
+
+	// 丸めの誤差は一番多い symbol で吸収する
+	// 余るときは 1 を下回らないよう、largest と largest に近い頻度の symbol から 1 ずつ削る
+	if (sum < RansScale) {
+		freqs[largest] += RansScale - sum;
+		return;
+	}
+	while (sum > RansScale) {
+		for (uint32_t s = 0; s < 256 && sum > RansScale; s++) {
+			if (freqs[s] > 1 && (s == largest || freqs[s] * 64 > freqs[largest])) {
+				freqs[s]--;
+				sum--;
+			}
+		}
+	}
+}
+
+inline void RansWriteUint32(std::vector<uint8_t>& out, const uint32_t& value)
+{
+	for (uint32_t b = 0; b < 4; b++)
+		out.push_back(uint8_t(value >> (8 * b)));
+}
+
+inline uint32_t RansReadUint32(const uint8_t* p)
+{
+	return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+// data の size byte を符号化して out の後ろに足す
+inline void EncodeRansBlock(const uint8_t* const data, const size_t& size, std::vector<uint8_t>& out)
+{
+	uint32_t counts[256] = {};
+	for (size_t i = 0; i < size; i++)
+		counts[data[i]]++;
+
+	uint32_t symbolCount = 0;
+	for (uint32_t s = 0; s < 256; s++)
+		symbolCount += (counts[s] != 0) ? 1 : 0;
+
+	if (symbolCount <= 1) {
+		out.push_back(RansBlockConstant);
+		out.push_back(size > 0 ? data[0] : 0);
+		return;
+	}
+
+	auto WriteRaw = [&](const size_t& headerBegin) {
+		out.resize(headerBegin);
+		out.push_back(RansBlockRaw);
+		out.insert(out.end(), data, data + size);
+	};
+
+	uint32_t freqs[256];
+	NormalizeRansFrequencies(counts, size, freqs);
+	uint32_t starts[256];
+	for (uint32_t s = 0, start = 0; s < 256; s++) {
+		starts[s] = start;
+		start += freqs[s];
+	}
+
+	// 頻度表 : symbol 数 - 1, (symbol, 頻度 16bit) の組
+	const size_t headerBegin = out.size();
+	out.push_back(RansBlockRans);
+	out.push_back(uint8_t(symbolCount - 1));
+	for (uint32_t s = 0; s < 256; s++) {
+		if (freqs[s] == 0)
+			continue;
+		out.push_back(uint8_t(s));
+		out.push_back(uint8_t(freqs[s] & 0xff));
+		out.push_back(uint8_t(freqs[s] >> 8));
+	}
+
+	// 後ろから符号化して、状態ごとの buffer に後ろから前に向かって書く
+	// i 番目の symbol は状態 i % RansStateCount で符号化する
+	const size_t capacity = size / RansStateCount + 16;
+	std::vector<uint8_t> streams(capacity * RansStateCount);
+	uint8_t* p[RansStateCount];
+	uint32_t states[RansStateCount];
+	for (uint32_t k = 0; k < RansStateCount; k++) {
+		p[k] = streams.data() + capacity * (k + 1);
+		states[k] = RansLowerBound;
+	}
+
+	for (size_t i = size; i-- > 0;) {
+		const uint32_t k = i % RansStateCount;
+		uint32_t& x = states[k];
+		const uint32_t freq = freqs[data[i]];
+		const uint32_t xmax = ((RansLowerBound >> RansScaleBits) << 16) * freq;
+		if (x >= xmax) {
+			p[k] -= 2;
+			p[k][0] = uint8_t(x & 0xff);
+			p[k][1] = uint8_t((x >> 8) & 0xff);
+			x >>= 16;
+		}
+		x = ((x / freq) << RansScaleBits) + (x % freq) + starts[data[i]];
+
+		// 縮まないと分かった時点で生のまま書く
+		if (p[k] - (streams.data() + capacity * k) < 8) {
+			WriteRaw(headerBegin);
+			return;
+		}
+	}
+
+	// 初期状態は big endian で byte 列の先頭に置く
+	for (uint32_t k = 0; k < RansStateCount; k++) {
+		for (uint32_t b = 0; b < 4; b++)
+			*--p[k] = uint8_t(states[k] >> (8 * b));
+	}
+
+	size_t streamSize = 0;
+	for (uint32_t k = 0; k < RansStateCount; k++) {
+		const uint32_t length = uint32_t(streams.data() + capacity * (k + 1) - p[k]);
+		RansWriteUint32(out, length);
+		streamSize += length;
+	}
+	if (out.size() - headerBegin + streamSize >= size + 1) {
+		WriteRaw(headerBegin);
+		return;
+	}
+
+	for (uint32_t k = 0; k < RansStateCount; k++)
+		out.insert(out.end(), p[k], streams.data() + capacity * (k + 1));
+}
+
+// EncodeRansBlock で書いたものを size byte に展開する
+// 成功したら p を block の直後に進める
+inline bool DecodeRansBlock(const uint8_t*& p, const uint8_t* const end, uint8_t* const data, const size_t& size)
+{
+	if (p >= end)
+		return false;
+
+	const uint8_t mode = *p++;
+	if (mode == RansBlockConstant) {
+		if (p >= end)
+			return false;
+		std::memset(data, *p++, size);
+		return true;
+	}
+	if (mode == RansBlockRaw) {
+		if (size_t(end - p) < size)
+			return false;
+		std::memcpy(data, p, size);
+		p += size;
+		return true;
+	}
+	if (mode != RansBlockRans || p >= end)
+		return false;
+
+	// slot ごとの symbol, 頻度, slot - start の表
+	const uint32_t symbolCount = uint32_t(*p++) + 1;
+	if (size_t(end - p) < size_t(symbolCount) * 3)
+		return false;
+
+	uint8_t symbols[RansScale];
+	uint16_t freqs[RansScale];
+	uint16_t biases[RansScale];
+	uint32_t start = 0;
+	for (uint32_t i = 0; i < symbolCount; i++) {
+		const uint32_t symbol = p[0];
+		const uint32_t freq = uint32_t(p[1]) | (uint32_t(p[2]) << 8);
+		p += 3;
+		if (freq == 0 || freq >= RansScale || start + freq > RansScale)
+			return false;
+		for (uint32_t j = 0; j < freq; j++) {
+			symbols[start + j] = uint8_t(symbol);
+			freqs[start + j] = uint16_t(freq);
+			biases[start + j] = uint16_t(j);
+		}
+		start += freq;
+	}
+	if (start != RansScale)
+		return false;
+
+	if (size_t(end - p) < 4 * RansStateCount)
+		return false;
+	const uint8_t* q[RansStateCount];
+	const uint8_t* qend[RansStateCount];
+	const uint8_t* streamBegin = p + 4 * RansStateCount;
+	for (uint32_t k = 0; k < RansStateCount; k++) {
+		const uint32_t length = RansReadUint32(p + 4 * k);
+		if (length < 4 || size_t(end - streamBegin) < length)
+			return false;
+		q[k] = streamBegin;
+		qend[k] = streamBegin + length;
+		streamBegin += length;
+	}
+
+	uint32_t states[RansStateCount];
+	for (uint32_t k = 0; k < RansStateCount; k++) {
+		states[k] = (uint32_t(q[k][0]) << 24) | (uint32_t(q[k][1]) << 16) | (uint32_t(q[k][2]) << 8) | uint32_t(q[k][3]);
+		q[k] += 4;
+	}
+
+	// 1 symbol あたり高々 16bit しか読まないので、全ての byte 列に 2 byte 以上残っている間は範囲を確かめない
+	// 読むかどうかは予測できないので、先の 16bit を読んでおいて mask で選ぶ (三項演算子だと分岐になることがある)
+	// (状態と読み位置は local に持つ。配列のままだと data への書き込みと別名になり得て毎回読み直しになる)
+	auto DecodeSymbol = [&](uint32_t& x, const uint8_t*& r) -> uint8_t {
+		const uint32_t slot = x & (RansScale - 1);
+		x = freqs[slot] * (x >> RansScaleBits) + biases[slot];
+		const uint32_t next = (x << 16) | uint32_t(r[0]) | (uint32_t(r[1]) << 8);
+		const uint32_t mask = 0u - uint32_t(x < RansLowerBound); // 読むときは全 bit 1
+		x = (x & ~mask) | (next & mask);
+		r += mask & 2;
+		return symbols[slot];
+	};
+
+	static_assert(RansStateCount == 4, "the loop below is unrolled for 4 states");
+	uint32_t x0 = states[0], x1 = states[1], x2 = states[2], x3 = states[3];
+	const uint8_t *r0 = q[0], *r1 = q[1], *r2 = q[2], *r3 = q[3];
+	const uint8_t *e0 = qend[0] - 2, *e1 = qend[1] - 2, *e2 = qend[2] - 2, *e3 = qend[3] - 2;
+	const size_t count = size;
+	size_t i = 0;
+	for (; i + RansStateCount <= count && r0 <= e0 && r1 <= e1 && r2 <= e2 && r3 <= e3; i += RansStateCount) {
+		data[i + 0] = DecodeSymbol(x0, r0);
+		data[i + 1] = DecodeSymbol(x1, r1);
+		data[i + 2] = DecodeSymbol(x2, r2);
+		data[i + 3] = DecodeSymbol(x3, r3);
+	}
+
+	// 残りは範囲を確かめながら 1 symbol ずつ
+	states[0] = x0;
+	states[1] = x1;
+	states[2] = x2;
+	states[3] = x3;
+	q[0] = r0;
+	q[1] = r1;
+	q[2] = r2;
+	q[3] = r3;
+	for (; i < count; i++) {
+		const uint32_t k = i % RansStateCount;
+		uint32_t& x = states[k];
+		const uint32_t slot = x & (RansScale - 1);
+		x = freqs[slot] * (x >> RansScaleBits) + biases[slot];
+		if (x < RansLowerBound) {
+			if (qend[k] - q[k] < 2)
+				return false;
+			x = (x << 16) | uint32_t(q[k][0]) | (uint32_t(q[k][1]) << 8);
+			q[k] += 2;
+		}
+		data[i] = symbols[slot];
+	}
+
+	p = streamBegin;
+	return true;
+}
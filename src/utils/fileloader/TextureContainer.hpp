@@ -0,0 +1,219 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include "src/utils/fileloader/MappedFile.hpp"
+#include "src/utils/fileloader/ImageData.hpp"
+
+// 事前に圧縮した texture を mip 込みで置いておく container (.pbtx)
+// KTX2 と同じく header, level の索引, 各 level のデータ (先頭を TextureContainerAlignment byte 境界に揃える) の順に書く
+// level のデータは staging buffer にそのまま写して TransferStagingBufferToImages で送れる形で並べる
+// 元画像の size と更新時刻を header に持ち、元画像が更新されていたら使わない
+
+constexpr uint32_t TextureContainerMagic = 0x58544250; // "PBTX"
+constexpr uint32_t TextureContainerVersion = 1;
+constexpr uint64_t TextureContainerAlignment = 16;
+
+enum TextureContainerFlags : uint32_t {
+	TextureContainerSRGB = 0x00000001,         // mip を linear で平均して作った
+	TextureContainerFlipVertical = 0x00000002, // 上下を反転して読んだ画像から作った
+};
+
+struct TextureContainerLevel {
+	uint64_t offset; // ファイル先頭からの byte offset
+	uint64_t size;
+	uint32_t width;
+	uint32_t height;
+};
+
+struct TextureContainerHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t format; // ImagePixelFormat
+	uint32_t flags;  // TextureContainerFlags
+	uint32_t width;
+	uint32_t height;
+	uint32_t levelCount;
+	uint32_t padding;
+	uint64_t sourceSize;
+	int64_t sourceTime;
+};
+
+std::string GetTextureContainerPath(const char* sourcefilename)
+{
+	return std::string(sourcefilename) + ".pbtx";
+}
+
+// 元画像の size と更新時刻
+bool GetTextureSourceStamp(const char* filename, uint64_t& sourceSize, int64_t& sourceTime)
+{
+	std::error_code ec;
+	sourceSize = std::filesystem::file_size(filename, ec);
+	if (ec)
+		return false;
+	sourceTime = std::filesystem::last_write_time(filename, ec).time_since_epoch().count();
+	return !ec;
+}
+
+// image の全 level を書く
+// 一時ファイルに書いてから rename するので、書き込み途中の container を他の process が読むことはない
+bool WriteTextureContainer(const char* const containerfilename, const char* const sourcefilename, const ImageData& image, const uint32_t& flags)
+{
+	TextureContainerHeader header;
+	std::memset(&header, 0, sizeof(TextureContainerHeader));
+	header.magic = TextureContainerMagic;
+	header.version = TextureContainerVersion;
+	header.format = uint32_t(image.format);
+	header.flags = flags;
+	header.width = image.width;
+	header.height = image.height;
+	header.levelCount = uint32_t(image.mips.size());
+	if (!GetTextureSourceStamp(sourcefilename, header.sourceSize, header.sourceTime)) {
+		std::cout << "fail to stat file: " << sourcefilename << std::endl;
+		return false;
+	}
+
+	std::vector<TextureContainerLevel> levels(image.mips.size());
+	uint64_t offset = sizeof(TextureContainerHeader) + levels.size() * sizeof(TextureContainerLevel);
+	for (size_t i = 0; i < levels.size(); i++) {
+		offset = (offset + TextureContainerAlignment - 1) / TextureContainerAlignment * TextureContainerAlignment;
+		levels[i].offset = offset;
+		levels[i].size = GetImageLevelSize(image.format, image.mips[i].width, image.mips[i].height);
+		levels[i].width = image.mips[i].width;
+		levels[i].height = image.mips[i].height;
+		offset += levels[i].size;
+	}
+
+	const std::string tempfilename = std::string(containerfilename) + ".tmp";
+	{
+		std::ofstream file(tempfilename, std::ios::binary);
+		if (!file) {
+			std::cout << "fail to open file: " << tempfilename << std::endl;
+			return false;
+		}
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(TextureContainerHeader));
+		file.write(reinterpret_cast<const char*>(levels.data()), levels.size() * sizeof(TextureContainerLevel));
+
+		const char padding[TextureContainerAlignment] = {};
+		uint64_t written = sizeof(TextureContainerHeader) + levels.size() * sizeof(TextureContainerLevel);
+		for (size_t i = 0; i < levels.size(); i++) {
+			file.write(padding, levels[i].offset - written);
+			file.write(reinterpret_cast<const char*>(image.pixels.data() + image.mips[i].offset), levels[i].size);
+			written = levels[i].offset + levels[i].size;
+		}
+
+		if (!file) {
+			std::cout << "fail to write file: " << tempfilename << std::endl;
+			return false;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tempfilename, containerfilename, ec);
+	if (ec) {
+		std::cout << "fail to write file: " << containerfilename << std::endl;
+		std::filesystem::remove(tempfilename, ec);
+		return false;
+	}
+
+	return true;
+}
+
+// mmap した container の header と索引を確かめる
+bool ReadTextureContainerHeader(const MappedFile& file, const char* const containerfilename, TextureContainerHeader& header, const TextureContainerLevel*& levels)
+{
+	if (file.size() < sizeof(TextureContainerHeader)) {
+		std::cout << containerfilename << " is not a texture container file" << std::endl;
+		return false;
+	}
+
+	std::memcpy(&header, file.data(), sizeof(TextureContainerHeader));
+	if (header.magic != TextureContainerMagic || header.version != TextureContainerVersion || header.format > uint32_t(ImagePixelFormat::BC7)) {
+		std::cout << containerfilename << " is not a texture container file" << std::endl;
+		return false;
+	}
+
+	if (sizeof(TextureContainerHeader) + uint64_t(header.levelCount) * sizeof(TextureContainerLevel) > file.size()) {
+		std::cout << containerfilename << " is broken" << std::endl;
+		return false;
+	}
+
+	levels = reinterpret_cast<const TextureContainerLevel*>(file.data() + sizeof(TextureContainerHeader));
+	for (uint32_t i = 0; i < header.levelCount; i++) {
+		if (levels[i].offset % TextureContainerAlignment != 0
+		    || levels[i].offset > file.size()
+		    || levels[i].size > file.size() - levels[i].offset
+		    || levels[i].size != GetImageLevelSize(ImagePixelFormat(header.format), levels[i].width, levels[i].height)) {
+			std::cout << containerfilename << " is broken" << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// mmap した container の全 level を image に読む (pixels には level を隙間無く詰め直す)
+bool ReadTextureContainer(const MappedFile& file, const char* const containerfilename, ImageData& image, uint32_t& flags)
+{
+	TextureContainerHeader header;
+	const TextureContainerLevel* levels = nullptr;
+	if (!ReadTextureContainerHeader(file, containerfilename, header, levels))
+		return false;
+
+	flags = header.flags;
+
+	image.width = header.width;
+	image.height = header.height;
+	image.format = ImagePixelFormat(header.format);
+	image.mips.clear();
+
+	size_t total = 0;
+	for (uint32_t i = 0; i < header.levelCount; i++) {
+		image.mips.push_back({ levels[i].width, levels[i].height, total });
+		total += levels[i].size;
+	}
+	image.pixels.resize(total);
+	for (uint32_t i = 0; i < header.levelCount; i++)
+		std::memcpy(image.pixels.data() + image.mips[i].offset, file.data() + levels[i].offset, levels[i].size);
+
+	return true;
+}
+
+bool LoadTextureContainer(const char* const containerfilename, ImageData& image, uint32_t& flags)
+{
+	MappedFile file;
+	if (!file.Open(containerfilename))
+		return false;
+
+	return ReadTextureContainer(file, containerfilename, image, flags);
+}
+
+// container が sourcefilename から flags で作られたもので、元画像がその後更新されていないか
+bool IsTextureContainerUpToDate(const char* const containerfilename, const char* const sourcefilename, const uint32_t& flags)
+{
+	std::error_code ec;
+	if (!std::filesystem::exists(containerfilename, ec))
+		return false;
+
+	MappedFile file;
+	if (!file.Open(containerfilename))
+		return false;
+
+	TextureContainerHeader header;
+	const TextureContainerLevel* levels = nullptr;
+	if (!ReadTextureContainerHeader(file, containerfilename, header, levels))
+		return false;
+
+	uint64_t sourceSize;
+	int64_t sourceTime;
+	if (!GetTextureSourceStamp(sourcefilename, sourceSize, sourceTime))
+		return false;
+
+	return header.flags == flags && header.sourceSize == sourceSize && header.sourceTime == sourceTime;
+}
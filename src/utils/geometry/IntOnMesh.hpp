@@ -1,5 +1,96 @@
 
+#include <algorithm>
+
 #include "src/utils/mathfunc/mathfunc.hpp"
+#include "src/utils/mathfunc/mathSoA.hpp"
+#include "src/utils/mathfunc/mathAccumulate.hpp"
+
+// 三角形を SoAWidth 個ずつ gather して lane ごとに足し、最後に lane をまとめる
+// 端数の lane は頂点が全て同じ点になり、体積 (STP) が 0 なので何も足されない
+//
+// 三角形ごとの値は頂点と同じ float で計算し、SoAWidth * IntOnMeshBlock 個ごとの和を lane ごとに作る
+// その和を float 版は PairwiseSum で、double 版は double に変換して足す
+// 全ての三角形を 1 つの float に順に足すと誤差が三角形の数に比例して増えるので、頂点は float のままで double 版を使えばよい
+// double 版の変換は block ごとに lane の数だけなので、三角形 1 つあたり 1 回より少ない
+//
+// 重心はメッシュの 1 頂点を原点にして計算する (原点から遠いメッシュで三角形ごとの値が打ち消し合うのを避ける)
+
+constexpr uint32_t IntOnMeshBlock = 16;
+
+// block(cm, mass) に SoAWidth * IntOnMeshBlock 個ずつの三角形の Σ STP (r0 + r1 + r2) / 24, Σ STP / 6 を渡す (rho 倍, origin からの位置)
+template <class F>
+void MeshCMBlocks(
+    const fvec3& origin,
+    const fvec3* const MVdata,
+    const uint32_t* const MIlist,
+    const uint32_t Misize,
+    const float rho,
+    const F& block)
+{
+	const fvec3x8 originx8(origin);
+
+	const uint32_t trisize = Misize / 3;
+	for (uint32_t b = 0; b < trisize; b += SoAWidth * IntOnMeshBlock) {
+		const uint32_t end = std::min(trisize, b + SoAWidth * IntOnMeshBlock);
+
+		fvec3x8 Cmx8   = fvec3x8::zero();
+		floatx8 Massx8 = floatx8::zero();
+		for (uint32_t i = b; i < end; i += SoAWidth) {
+			const uint32_t count = std::min(SoAWidth, end - i);
+
+			fvec3x8 r0, r1, r2;
+			r0.gather(MVdata, MIlist + 3 * i + 0, 3, count);
+			r1.gather(MVdata, MIlist + 3 * i + 1, 3, count);
+			r2.gather(MVdata, MIlist + 3 * i + 2, 3, count);
+			r0 -= originx8;
+			r1 -= originx8;
+			r2 -= originx8;
+
+			const floatx8 stp = r0.dot((r1 - r0).cross(r2 - r0));
+
+			Cmx8 += rho * stp * (static_cast<float>(1.0f / 24.0f) * (r0 + r1 + r2));
+
+			Massx8 += rho * (1.0f / 6.0f) * stp;
+		}
+
+		block(Cmx8, Massx8);
+	}
+}
+
+// block(inertia) に SoAWidth * IntOnMeshBlock 個ずつの三角形の cm まわりの慣性テンソルを渡す
+template <class F>
+void MeshInertiaBlocks(
+    const fvec3& cm,
+    const fvec3* const MVdata,
+    const uint32_t* const MIlist,
+    const uint32_t Misize,
+    const float rho,
+    const F& block)
+{
+	const fvec3x8 cmx8(cm);
+
+	const uint32_t trisize = Misize / 3;
+	for (uint32_t b = 0; b < trisize; b += SoAWidth * IntOnMeshBlock) {
+		const uint32_t end = std::min(trisize, b + SoAWidth * IntOnMeshBlock);
+
+		fmat3x8 Inertiax8 = fmat3x8::zero();
+		for (uint32_t i = b; i < end; i += SoAWidth) {
+			const uint32_t count = std::min(SoAWidth, end - i);
+
+			fvec3x8 r0, r1, r2;
+			r0.gather(MVdata, MIlist + 3 * i + 0, 3, count);
+			r1.gather(MVdata, MIlist + 3 * i + 1, 3, count);
+			r2.gather(MVdata, MIlist + 3 * i + 2, 3, count);
+			r0 -= cmx8;
+			r1 -= cmx8;
+			r2 -= cmx8;
+
+			Inertiax8 += rho * r0.dot((r1 - r0).cross(r2 - r0)) * (1.0f / 120.0f) * (2.0f * (r0.sqnorm() + r1.sqnorm() + r2.sqnorm() + r0.dot(r1) + r1.dot(r2) + r2.dot(r0)) * fmat3x8::identity() - 2.0f * (r0.tensorproduct(r0) + r1.tensorproduct(r1) + r2.tensorproduct(r2)) - (r0.tensorproduct(r1) + r1.tensorproduct(r0) + r1.tensorproduct(r2) + r2.tensorproduct(r1) + r2.tensorproduct(r0) + r0.tensorproduct(r2)));
+		}
+
+		block(Inertiax8);
+	}
+}
 
 void MeshCM(
     fvec3& Cm,
@@ -10,21 +101,42 @@ void MeshCM(
     const uint32_t& Misize,
     const float& rho)
 {
-	Cm   = fvec3(0.0f, 0.0f, 0.0f);
-	Mass = 0.0f;
+	const fvec3 origin = (Misize > 0) ? MVdata[MIlist[0]] : fvec3::zero();
 
-	for (uint32_t i = 0; i < Misize / 3; i++) {
+	PairwiseSum<fvec3x8> Cmsum(fvec3x8::zero());
+	PairwiseSum<floatx8> Masssum(floatx8::zero());
+	MeshCMBlocks(origin, MVdata, MIlist, Misize, rho, [&](const fvec3x8& cm, const floatx8& mass) {
+		Cmsum.add(cm);
+		Masssum.add(mass);
+	});
 
-		fvec3 r0 = MVdata[MIlist[3 * i + 0]];
-		fvec3 r1 = MVdata[MIlist[3 * i + 1]];
-		fvec3 r2 = MVdata[MIlist[3 * i + 2]];
+	Mass = Masssum.value().sum();
+	Cm   = origin + Cmsum.value().sum() / Mass;
+}
 
-		Cm = Cm + rho * fvec3::STP(r0, r1, r2) * (static_cast<float>(1.0f / 24.0f) * (r0 + r1 + r2));
+// 頂点は float, 和は double
+void MeshCM(
+    dvec3& Cm,
+    double& Mass,
+    const fvec3* const MVdata,
+    const uint32_t& MVsize,
+    const uint32_t* const MIlist,
+    const uint32_t& Misize,
+    const float& rho)
+{
+	const fvec3 origin = (Misize > 0) ? MVdata[MIlist[0]] : fvec3::zero();
 
-		Mass += rho * (1.0f / 6.0f) * fvec3::STP(r0, r1, r2);
-	}
+	dvec3 cm    = dvec3::zero();
+	double mass = 0.0;
+	MeshCMBlocks(origin, MVdata, MIlist, Misize, rho, [&](const fvec3x8& cmx8, const floatx8& massx8) {
+		for (uint32_t l = 0; l < SoAWidth; l++) {
+			cm += static_cast<dvec3>(cmx8.lane(l));
+			mass += static_cast<double>(massx8.lane(l));
+		}
+	});
 
-	Cm = Cm / Mass;
+	Mass = mass;
+	Cm   = static_cast<dvec3>(origin) + cm / mass;
 }
 
 void MeshInertia(
@@ -36,15 +148,30 @@ void MeshInertia(
     const uint32_t& Misize,
     const float& rho)
 {
+	PairwiseSum<fmat3x8> Inertiasum(fmat3x8::zero());
+	MeshInertiaBlocks(cm, MVdata, MIlist, Misize, rho, [&](const fmat3x8& inertia) {
+		Inertiasum.add(inertia);
+	});
 
-	Inertia = fmat3();
-
-	for (uint32_t i = 0; i < Misize / 3; i++) {
+	Inertia = Inertiasum.value().sum();
+}
 
-		fvec3 r0 = MVdata[MIlist[3 * i + 0]] - cm;
-		fvec3 r1 = MVdata[MIlist[3 * i + 1]] - cm;
-		fvec3 r2 = MVdata[MIlist[3 * i + 2]] - cm;
+// 頂点は float, 和は double
+// 三角形ごとの値は cm を float に丸めて計算する (重心のずれ d による慣性テンソルの変化は d の 2 次なので効かない)
+void MeshInertia(
+    dmat3& Inertia,
+    const dvec3& cm,
+    const fvec3* const MVdata,
+    const uint32_t& MVsize,
+    const uint32_t* const MIlist,
+    const uint32_t& Misize,
+    const float& rho)
+{
+	dmat3 inertia = dmat3::zero();
+	MeshInertiaBlocks(static_cast<fvec3>(cm), MVdata, MIlist, Misize, rho, [&](const fmat3x8& inertiax8) {
+		for (uint32_t l = 0; l < SoAWidth; l++)
+			inertia += static_cast<dmat3>(inertiax8.lane(l));
+	});
 
-		Inertia = Inertia + rho * fvec3::STP(r0, r1, r2) * (1.0f / 120.0f) * (2.0f * (r0.sqnorm() + r1.sqnorm() + r2.sqnorm() + r0.dot(r1) + r1.dot(r2) + r2.dot(r0)) * fmat3::identity() - 2.0f * (r0.tensorproduct(r0) + r1.tensorproduct(r1) + r2.tensorproduct(r2)) - (r0.tensorproduct(r1) + r1.tensorproduct(r0) + r1.tensorproduct(r2) + r2.tensorproduct(r1) + r2.tensorproduct(r0) + r0.tensorproduct(r2)));
-	}
+	Inertia = inertia;
 }
@@ -1,8 +1,12 @@
+#pragma once
+
 #include <cstdint>
 #include <vector>
 #include <set>
+#include <algorithm>
 
 #include "src/utils/mathfunc/mathfunc.hpp"
+#include "src/utils/mathfunc/mathSoA.hpp"
 
 void ConvertPTMtoREM(
     const fvec3* const Pvdata,
@@ -169,16 +173,24 @@ void ComputeNormalFromVE(
 	const uint32_t* const VtoTlist,
 	const uint32_t* const VtoTind)
 {
+	// 三角形の法線は SoAWidth 個ずつまとめて 1 回だけ計算し、頂点ごとには足すだけにする
+	// VtoTlist は tilist の全ての index を含む (ConvertEVtoVE の出力) ので、VtoTind[vertsize] が tilist の長さ
+	const uint32_t trisize = VtoTind[vertsize] / 3;
+	SoAArray<fvec3> facenormals(trisize);
+	for (uint32_t b = 0; b < facenormals.batchsize(); b++) {
+		const uint32_t count = std::min(SoAWidth, trisize - SoAWidth * b);
+
+		fvec3x8 v0, v1, v2;
+		v0.gather(PositionList, tilist + 3 * SoAWidth * b + 0, 3, count);
+		v1.gather(PositionList, tilist + 3 * SoAWidth * b + 1, 3, count);
+		v2.gather(PositionList, tilist + 3 * SoAWidth * b + 2, 3, count);
+
+		facenormals.setbatch(b, (v1 - v0).cross(v2 - v0));
+	}
+
 	for (uint32_t i = 0; i < vertsize; i++) {
 		for (uint32_t j = VtoTind[i]; j < VtoTind[i + 1]; j++) {
-			uint32_t Tind = VtoTlist[j] / 3;
-
-			fvec3 v0 = PositionList[tilist[3 * Tind + 0]];
-			fvec3 v1 = PositionList[tilist[3 * Tind + 1]];
-			fvec3 v2 = PositionList[tilist[3 * Tind + 2]];
-
-			fvec3 normal = (v1 - v0).cross(v2 - v0);
-			NormalSet[i] = NormalSet[i] + normal;
+			NormalSet[i] = NormalSet[i] + facenormals.get(VtoTlist[j] / 3);
 		}
 		NormalSet[i] = NormalSet[i].normalized();
 	}
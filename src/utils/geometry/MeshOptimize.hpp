@@ -0,0 +1,371 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include "src/utils/mathfunc/mathfunc.hpp"
+
+// triangle index list の並べ替え
+// 1. OptimizeVertexCache : post-transform vertex cache のヒット率を上げる (Forsyth)
+// 2. OptimizeOverdraw    : 1 の結果をクラスタに分け、外向きのクラスタから描くよう並べ替える (Tipsify / Sander et al.)
+// 3. OptimizeVertexFetch : index の出現順に頂点を並べ直す remap を作る
+// AnalyzeVertexCache で ACMR (miss / triangle) と ATVR (miss / vertex) を計測する
+
+// FIFO cache を timestamp で模擬する
+// miss なら true を返して cacheTimestamp を更新する
+inline bool SimulateFIFOCache(
+    const uint32_t& vi,
+    std::vector<uint32_t>& cacheTimestamp,
+    uint32_t& timestamp,
+    const uint32_t& cacheSize)
+{
+	if (timestamp - cacheTimestamp[vi] > cacheSize) {
+		cacheTimestamp[vi] = timestamp;
+		timestamp++;
+		return true;
+	}
+	return false;
+}
+
+inline void AnalyzeVertexCache(
+    const uint32_t* const Idata,
+    const uint32_t& Isize,
+    const uint32_t& Vsize,
+    const uint32_t& cacheSize,
+    float& ACMR,
+    float& ATVR)
+{
+	std::vector<uint32_t> cacheTimestamp(Vsize, 0);
+	uint32_t timestamp = cacheSize + 1;
+
+	std::vector<bool> isUsed(Vsize, false);
+	uint32_t usedVsize = 0;
+
+	uint32_t missCount = 0;
+	for (uint32_t i = 0; i < Isize; i++) {
+		if (SimulateFIFOCache(Idata[i], cacheTimestamp, timestamp, cacheSize))
+			missCount++;
+
+		if (!isUsed[Idata[i]]) {
+			isUsed[Idata[i]] = true;
+			usedVsize++;
+		}
+	}
+
+	ACMR = (Isize >= 3) ? float(missCount) / float(Isize / 3) : 0.0f;
+	ATVR = (usedVsize > 0) ? float(missCount) / float(usedVsize) : 0.0f;
+}
+
+////////////////////////////////////
+
+constexpr uint32_t ForsythCacheSize = 32;
+
+inline float ForsythVertexScore(const int32_t& cachePosition, const uint32_t& remainingValence)
+{
+	constexpr float CacheDecayPower	 = 1.5f;
+	constexpr float LastTriScore	 = 0.75f;
+	constexpr float ValenceBoostScale = 2.0f;
+	constexpr float ValenceBoostPower = 0.5f;
+
+	if (remainingValence == 0)
+		return -1.0f;
+
+	float score = 0.0f;
+	if (cachePosition >= 0) {
+		if (cachePosition < 3) {
+			// 直前の triangle の頂点は、同じ triangle を続けて描かないよう固定値
+			score = LastTriScore;
+		} else {
+			const float scaler = 1.0f / float(ForsythCacheSize - 3);
+			score		   = std::pow(1.0f - float(cachePosition - 3) * scaler, CacheDecayPower);
+		}
+	}
+
+	// 残り valence が少ない頂点を優先して片付ける
+	score += ValenceBoostScale * std::pow(float(remainingValence), -ValenceBoostPower);
+
+	return score;
+}
+
+inline void OptimizeVertexCache(
+    const uint32_t* const Idata,
+    const uint32_t& Isize,
+    const uint32_t& Vsize,
+    uint32_t** const pOutIData)
+{
+	const uint32_t Tsize = Isize / 3;
+
+	// Isize が 3 の倍数でないときの末尾の index は並べ替えずにそのまま残す
+	*pOutIData = new uint32_t[Isize];
+	for (uint32_t i = 3 * Tsize; i < Isize; i++)
+		(*pOutIData)[i] = Idata[i];
+	if (Tsize == 0)
+		return;
+
+	// vertex -> triangle (CSR)
+	std::vector<uint32_t> vtIndex(Vsize + 1, 0);
+	for (uint32_t i = 0; i < 3 * Tsize; i++)
+		vtIndex[Idata[i] + 1]++;
+	for (uint32_t i = 0; i < Vsize; i++)
+		vtIndex[i + 1] += vtIndex[i];
+
+	std::vector<uint32_t> vtList(3 * Tsize);
+	std::vector<uint32_t> remainingValence(Vsize, 0);
+	for (uint32_t i = 0; i < Tsize; i++) {
+		for (uint32_t j = 0; j < 3; j++) {
+			uint32_t vi					  = Idata[3 * i + j];
+			vtList[vtIndex[vi] + remainingValence[vi]] = i;
+			remainingValence[vi]++;
+		}
+	}
+
+	std::vector<int32_t> cachePosition(Vsize, -1);
+	std::vector<float> vertexScore(Vsize);
+	for (uint32_t i = 0; i < Vsize; i++)
+		vertexScore[i] = ForsythVertexScore(-1, remainingValence[i]);
+
+	std::vector<float> triangleScore(Tsize);
+	std::vector<bool> isEmitted(Tsize, false);
+
+	int32_t bestTriangle = 0;
+	for (uint32_t i = 0; i < Tsize; i++) {
+		triangleScore[i] = vertexScore[Idata[3 * i + 0]] + vertexScore[Idata[3 * i + 1]] + vertexScore[Idata[3 * i + 2]];
+		if (triangleScore[i] > triangleScore[bestTriangle])
+			bestTriangle = i;
+	}
+
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> newCache;
+	cache.reserve(ForsythCacheSize + 3);
+	newCache.reserve(ForsythCacheSize + 3);
+
+	uint32_t scanCursor = 0;
+
+	for (uint32_t counter = 0; counter < Tsize; counter++) {
+
+		// cache 上に候補が無ければ未出力の triangle を先頭から探す
+		if (bestTriangle < 0) {
+			while (isEmitted[scanCursor])
+				scanCursor++;
+			bestTriangle = scanCursor;
+		}
+
+		const uint32_t ti = bestTriangle;
+		isEmitted[ti]	  = true;
+
+		newCache.clear();
+		for (uint32_t j = 0; j < 3; j++) {
+			uint32_t vi			      = Idata[3 * ti + j];
+			(*pOutIData)[3 * counter + j] = vi;
+			newCache.push_back(vi);
+
+			// 出力済みの triangle を adjacency の末尾に寄せる
+			uint32_t* begin = vtList.data() + vtIndex[vi];
+			uint32_t* end	= begin + remainingValence[vi];
+			uint32_t* itr	= std::find(begin, end, ti);
+			std::swap(*itr, *(end - 1));
+			remainingValence[vi]--;
+		}
+
+		for (const auto& vi : cache) {
+			if (vi != newCache[0] && vi != newCache[1] && vi != newCache[2])
+				newCache.push_back(vi);
+		}
+
+		// cache から溢れた頂点も score を更新する
+		for (uint32_t i = 0; i < newCache.size(); i++) {
+			uint32_t vi	  = newCache[i];
+			cachePosition[vi] = (i < ForsythCacheSize) ? int32_t(i) : -1;
+			vertexScore[vi]	  = ForsythVertexScore(cachePosition[vi], remainingValence[vi]);
+		}
+
+		bestTriangle   = -1;
+		float bestScore = -1.0f;
+		for (const auto& vi : newCache) {
+			for (uint32_t k = 0; k < remainingValence[vi]; k++) {
+				uint32_t tk	  = vtList[vtIndex[vi] + k];
+				triangleScore[tk] = vertexScore[Idata[3 * tk + 0]] + vertexScore[Idata[3 * tk + 1]] + vertexScore[Idata[3 * tk + 2]];
+				if (triangleScore[tk] > bestScore) {
+					bestScore    = triangleScore[tk];
+					bestTriangle = tk;
+				}
+			}
+		}
+
+		if (newCache.size() > ForsythCacheSize)
+			newCache.resize(ForsythCacheSize);
+		std::swap(cache, newCache);
+	}
+}
+
+////////////////////////////////////
+
+// Idata は OptimizeVertexCache 済みであることを想定する
+// threshold は cache 効率の悪化をどこまで許すか (1.05 なら ACMR が 5% 悪化するまで)
+inline void OptimizeOverdraw(
+    const fvec3* const Vdata,
+    const uint32_t& Vsize,
+    const uint32_t* const Idata,
+    const uint32_t& Isize,
+    const uint32_t& cacheSize,
+    const float& threshold,
+    uint32_t** const pOutIData)
+{
+	const uint32_t Tsize = Isize / 3;
+
+	// Isize が 3 の倍数でないときの末尾の index は並べ替えずにそのまま残す
+	*pOutIData = new uint32_t[Isize];
+	for (uint32_t i = 3 * Tsize; i < Isize; i++)
+		(*pOutIData)[i] = Idata[i];
+	if (Tsize == 0)
+		return;
+
+	std::vector<uint32_t> cacheTimestamp(Vsize, 0);
+	uint32_t timestamp = cacheSize + 1;
+
+	// hard boundary : 3 頂点とも miss する triangle (strip の切れ目)
+	std::vector<uint32_t> hardBoundary;
+	for (uint32_t i = 0; i < Tsize; i++) {
+		uint32_t missCount = 0;
+		for (uint32_t j = 0; j < 3; j++) {
+			if (SimulateFIFOCache(Idata[3 * i + j], cacheTimestamp, timestamp, cacheSize))
+				missCount++;
+		}
+		if (i == 0 || missCount == 3)
+			hardBoundary.push_back(i);
+	}
+	hardBoundary.push_back(Tsize);
+
+	// soft boundary : hard cluster の中で、途中までの ACMR が cluster 全体の ACMR * threshold を下回った所で切る
+	std::vector<uint32_t> clusterStart;
+	for (uint32_t c = 0; c + 1 < hardBoundary.size(); c++) {
+		const uint32_t start = hardBoundary[c];
+		const uint32_t end   = hardBoundary[c + 1];
+
+		timestamp += cacheSize + 1;
+		uint32_t clusterMiss = 0;
+		for (uint32_t i = 3 * start; i < 3 * end; i++) {
+			if (SimulateFIFOCache(Idata[i], cacheTimestamp, timestamp, cacheSize))
+				clusterMiss++;
+		}
+		const float targetACMR = threshold * float(clusterMiss) / float(end - start);
+
+		clusterStart.push_back(start);
+
+		timestamp += cacheSize + 1;
+		uint32_t miss = 0;
+		uint32_t tcount = 0;
+		for (uint32_t i = start; i < end; i++) {
+			for (uint32_t j = 0; j < 3; j++) {
+				if (SimulateFIFOCache(Idata[3 * i + j], cacheTimestamp, timestamp, cacheSize))
+					miss++;
+			}
+			tcount++;
+
+			if (i + 1 < end && float(miss) / float(tcount) <= targetACMR) {
+				clusterStart.push_back(i + 1);
+				timestamp += cacheSize + 1;
+				miss   = 0;
+				tcount = 0;
+			}
+		}
+	}
+	clusterStart.push_back(Tsize);
+
+	const uint32_t Csize = clusterStart.size() - 1;
+
+	// 面積重み付きの重心と法線
+	fvec3 meshCentroid = fvec3::zero();
+	float meshArea	   = 0.0f;
+	std::vector<fvec3> clusterCentroid(Csize, fvec3::zero());
+	std::vector<fvec3> clusterNormal(Csize, fvec3::zero());
+	for (uint32_t c = 0; c < Csize; c++) {
+		float clusterArea = 0.0f;
+		for (uint32_t i = clusterStart[c]; i < clusterStart[c + 1]; i++) {
+			const fvec3& X0 = Vdata[Idata[3 * i + 0]];
+			const fvec3& X1 = Vdata[Idata[3 * i + 1]];
+			const fvec3& X2 = Vdata[Idata[3 * i + 2]];
+
+			fvec3 n	   = (X1 - X0).cross(X2 - X0);
+			float area = std::sqrt(n.sqnorm()); // norm() は小さい triangle で 0 になる
+
+			clusterCentroid[c] = clusterCentroid[c] + area * (X0 + X1 + X2) / 3.0f;
+			clusterNormal[c]   = clusterNormal[c] + n;
+			clusterArea += area;
+		}
+
+		meshCentroid = meshCentroid + clusterCentroid[c];
+		meshArea += clusterArea;
+
+		if (clusterArea > 0.0f)
+			clusterCentroid[c] = clusterCentroid[c] / clusterArea;
+	}
+	if (meshArea > 0.0f)
+		meshCentroid = meshCentroid / meshArea;
+
+	// 外を向いているクラスタほど先に描く
+	std::vector<float> sortKey(Csize);
+	for (uint32_t c = 0; c < Csize; c++) {
+		float normalLength = std::sqrt(clusterNormal[c].sqnorm());
+		sortKey[c]	   = (normalLength > 0.0f) ? (clusterCentroid[c] - meshCentroid).dot(clusterNormal[c]) / normalLength : 0.0f;
+	}
+
+	std::vector<uint32_t> clusterOrder(Csize);
+	for (uint32_t c = 0; c < Csize; c++)
+		clusterOrder[c] = c;
+	std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](const uint32_t& a, const uint32_t& b) {
+		return sortKey[a] > sortKey[b];
+	});
+
+	uint32_t counter = 0;
+	for (const auto& c : clusterOrder) {
+		for (uint32_t i = 3 * clusterStart[c]; i < 3 * clusterStart[c + 1]; i++) {
+			(*pOutIData)[counter] = Idata[i];
+			counter++;
+		}
+	}
+}
+
+////////////////////////////////////
+
+// Idata を書き換え、index の出現順に頂点を詰め直す remap (old -> new) を返す
+// 参照されない頂点は 0xFFFFFFFF となり、outVsize に含まれない
+inline void OptimizeVertexFetch(
+    uint32_t* const Idata,
+    const uint32_t& Isize,
+    const uint32_t& Vsize,
+    uint32_t** const pOutRemap,
+    uint32_t& outVsize)
+{
+	*pOutRemap = new uint32_t[Vsize];
+	for (uint32_t i = 0; i < Vsize; i++)
+		(*pOutRemap)[i] = 0xFFFFFFFF;
+
+	outVsize = 0;
+	for (uint32_t i = 0; i < Isize; i++) {
+		uint32_t& newIndex = (*pOutRemap)[Idata[i]];
+		if (newIndex == 0xFFFFFFFF) {
+			newIndex = outVsize;
+			outVsize++;
+		}
+		Idata[i] = newIndex;
+	}
+}
+
+// OptimizeVertexFetch の remap を頂点属性に適用する
+template <class T>
+inline void RemapVertexData(
+    const T* const Vdata,
+    const uint32_t& Vsize,
+    const uint32_t* const remap,
+    const uint32_t& outVsize,
+    T** const pOutVdata)
+{
+	*pOutVdata = new T[outVsize];
+	for (uint32_t i = 0; i < Vsize; i++) {
+		if (remap[i] != 0xFFFFFFFF)
+			(*pOutVdata)[remap[i]] = Vdata[i];
+	}
+}
@@ -0,0 +1,456 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <queue>
+#include <unordered_map>
+#include <functional>
+#include <cstring>
+#include <iostream>
+
+#include "src/utils/mathfunc/mathfunc.hpp"
+
+// Quadric Error Metrics による edge collapse (Garland-Heckbert)
+// 頂点は削除される側から残る側の位置へ寄せる (新しい頂点は作らない) ので、
+// 出力の index list は入力と同じ頂点配列をそのまま参照できる
+//
+// 同じ位置を持つ頂点は一つの頂点としてトポロジーを組む
+// lockSeams = true  : 位置を共有する頂点 (UV / 法線の seam) は動かさず、seam へ寄せることもしない
+// lockSeams = false : seam も無視して潰す。属性を使わないパス (シャドウ・デプス) 向け
+// 境界 edge (triangle が一つしか無い edge) の頂点は境界に沿ってのみ潰す
+
+class MeshQuadric {
+public:
+	double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+	MeshQuadric()
+	    : a2(0.0), ab(0.0), ac(0.0), ad(0.0), b2(0.0), bc(0.0), bd(0.0), c2(0.0), cd(0.0), d2(0.0)
+	{
+	}
+
+	// 平面 ax + by + cz + d = 0 (a, b, c は正規化済み)
+	void addPlane(const double a, const double b, const double c, const double d, const double weight)
+	{
+		a2 += weight * a * a;
+		ab += weight * a * b;
+		ac += weight * a * c;
+		ad += weight * a * d;
+		b2 += weight * b * b;
+		bc += weight * b * c;
+		bd += weight * b * d;
+		c2 += weight * c * c;
+		cd += weight * c * d;
+		d2 += weight * d * d;
+	}
+
+	void add(const MeshQuadric& q)
+	{
+		a2 += q.a2;
+		ab += q.ab;
+		ac += q.ac;
+		ad += q.ad;
+		b2 += q.b2;
+		bc += q.bc;
+		bd += q.bd;
+		c2 += q.c2;
+		cd += q.cd;
+		d2 += q.d2;
+	}
+
+	double evaluate(const fvec3& p) const
+	{
+		const double x = p.x, y = p.y, z = p.z;
+		double error   = a2 * x * x + 2.0 * ab * x * y + 2.0 * ac * x * z + 2.0 * ad * x
+			       + b2 * y * y + 2.0 * bc * y * z + 2.0 * bd * y
+			       + c2 * z * z + 2.0 * cd * z
+			       + d2;
+		return std::max(error, 0.0);
+	}
+};
+
+// targetError は距離 (Vdata と同じ単位)。到達した誤差を resultError に返す
+inline void SimplifyMesh(
+    const fvec3* const Vdata,
+    const uint32_t& Vsize,
+    const uint32_t* const Idata,
+    const uint32_t& Isize,
+    const uint32_t& targetIsize,
+    const float& targetError,
+    const bool& lockSeams,
+    uint32_t** const pOutIData,
+    uint32_t& outISize,
+    float& resultError)
+{
+	constexpr double BoundaryWeight = 10.0;
+
+	const uint32_t Tsize = Isize / 3;
+	resultError	     = 0.0f;
+
+	// 同じ位置の頂点をまとめる
+	struct PositionHash {
+		size_t operator()(const fvec3& p) const
+		{
+			// PositionEqual (float の ==) では -0.0f と 0.0f が等しいので、0.0f を足して +0 に揃えてから bit を見る
+			const float c[3] = { p.x + 0.0f, p.y + 0.0f, p.z + 0.0f };
+			uint32_t h[3];
+			std::memcpy(h, c, sizeof(h));
+			return (h[0] * 73856093u) ^ (h[1] * 19349663u) ^ (h[2] * 83492791u);
+		}
+	};
+	struct PositionEqual {
+		bool operator()(const fvec3& a, const fvec3& b) const
+		{
+			return a.x == b.x && a.y == b.y && a.z == b.z;
+		}
+	};
+	std::unordered_map<fvec3, uint32_t, PositionHash, PositionEqual> positionMap;
+
+	std::vector<uint32_t> positionId(Vsize);
+	std::vector<uint32_t> representative;
+	std::vector<uint32_t> groupSize;
+	for (uint32_t i = 0; i < Vsize; i++) {
+		auto itr = positionMap.find(Vdata[i]);
+		if (itr == positionMap.end()) {
+			positionId[i] = representative.size();
+			positionMap.emplace(Vdata[i], positionId[i]);
+			representative.push_back(i);
+			groupSize.push_back(1);
+		} else {
+			positionId[i] = itr->second;
+			groupSize[itr->second]++;
+		}
+	}
+	const uint32_t Psize = representative.size();
+
+	// triangle (position id) と出力用の頂点 index
+	std::vector<uint32_t> tri(3 * Tsize);
+	std::vector<uint32_t> corner(3 * Tsize);
+	std::vector<bool> isRemoved(Tsize, false);
+	uint32_t liveTsize = 0;
+	for (uint32_t i = 0; i < Tsize; i++) {
+		for (uint32_t j = 0; j < 3; j++) {
+			tri[3 * i + j]	  = positionId[Idata[3 * i + j]];
+			corner[3 * i + j] = Idata[3 * i + j];
+		}
+		if (tri[3 * i + 0] == tri[3 * i + 1] || tri[3 * i + 1] == tri[3 * i + 2] || tri[3 * i + 2] == tri[3 * i + 0])
+			isRemoved[i] = true;
+		else
+			liveTsize++;
+	}
+
+	// position id -> triangle (削除済みのものも残る)
+	std::vector<std::vector<uint32_t>> adjacency(Psize);
+	for (uint32_t i = 0; i < Tsize; i++) {
+		if (isRemoved[i])
+			continue;
+		for (uint32_t j = 0; j < 3; j++)
+			adjacency[tri[3 * i + j]].push_back(i);
+	}
+
+	auto position = [&](const uint32_t& p) -> const fvec3& { return Vdata[representative[p]]; };
+
+	auto edgeTriangleCount = [&](const uint32_t& u, const uint32_t& v) -> uint32_t {
+		uint32_t count = 0;
+		for (const auto& t : adjacency[u]) {
+			if (!isRemoved[t] && (tri[3 * t + 0] == v || tri[3 * t + 1] == v || tri[3 * t + 2] == v))
+				count++;
+		}
+		return count;
+	};
+
+	// 頂点の種類
+	std::vector<bool> isLocked(Psize, false);
+	std::vector<bool> isBorder(Psize, false);
+	std::vector<MeshQuadric> quadric(Psize);
+
+	for (uint32_t i = 0; i < Psize; i++) {
+		if (lockSeams && groupSize[i] > 1)
+			isLocked[i] = true;
+	}
+
+	for (uint32_t i = 0; i < Tsize; i++) {
+		if (isRemoved[i])
+			continue;
+
+		const fvec3& X0 = position(tri[3 * i + 0]);
+		const fvec3& X1 = position(tri[3 * i + 1]);
+		const fvec3& X2 = position(tri[3 * i + 2]);
+
+		fvec3 n		   = (X1 - X0).cross(X2 - X0);
+		double nLength = std::sqrt(double(n.sqnorm()));
+		if (nLength <= 0.0)
+			continue;
+		double a = n.x / nLength, b = n.y / nLength, c = n.z / nLength;
+		double d = -(a * X0.x + b * X0.y + c * X0.z);
+
+		for (uint32_t j = 0; j < 3; j++)
+			quadric[tri[3 * i + j]].addPlane(a, b, c, d, 1.0);
+
+		for (uint32_t j = 0; j < 3; j++) {
+			uint32_t u     = tri[3 * i + j];
+			uint32_t v     = tri[3 * i + (j + 1) % 3];
+			uint32_t count = edgeTriangleCount(u, v);
+
+			if (count > 2) {
+				// 非多様体 edge は触らない
+				isLocked[u] = true;
+				isLocked[v] = true;
+			} else if (count == 1) {
+				isBorder[u] = true;
+				isBorder[v] = true;
+
+				// edge を含み面に垂直な平面で境界の形を保つ
+				fvec3 e		     = position(v) - position(u);
+				fvec3 m		     = e.cross(n);
+				double mLength	     = std::sqrt(double(m.sqnorm()));
+				if (mLength <= 0.0)
+					continue;
+				double ba = m.x / mLength, bb = m.y / mLength, bc = m.z / mLength;
+				double bd = -(ba * position(u).x + bb * position(u).y + bc * position(u).z);
+				quadric[u].addPlane(ba, bb, bc, bd, BoundaryWeight);
+				quadric[v].addPlane(ba, bb, bc, bd, BoundaryWeight);
+			}
+		}
+	}
+
+	// collapse 候補 (from -> to)
+	struct Collapse {
+		double cost;
+		uint32_t from;
+		uint32_t to;
+		uint32_t fromVersion;
+		uint32_t toVersion;
+		bool operator>(const Collapse& c) const { return cost > c.cost; }
+	};
+	std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+	std::vector<uint32_t> version(Psize, 0);
+	std::vector<bool> isCollapsed(Psize, false);
+
+	auto pushCollapse = [&](const uint32_t& from, const uint32_t& to) {
+		if (isLocked[from] || isCollapsed[from] || isCollapsed[to])
+			return;
+		if (lockSeams && groupSize[to] > 1)
+			return;
+		if (isBorder[from] && edgeTriangleCount(from, to) != 1)
+			return;
+
+		MeshQuadric q = quadric[from];
+		q.add(quadric[to]);
+		heap.push({ q.evaluate(position(to)), from, to, version[from], version[to] });
+	};
+
+	for (uint32_t i = 0; i < Tsize; i++) {
+		if (isRemoved[i])
+			continue;
+		for (uint32_t j = 0; j < 3; j++) {
+			uint32_t u = tri[3 * i + j];
+			uint32_t v = tri[3 * i + (j + 1) % 3];
+			pushCollapse(u, v);
+			pushCollapse(v, u);
+		}
+	}
+
+	const double maxCost = double(targetError) * double(targetError);
+	const uint32_t targetTsize = targetIsize / 3;
+
+	std::vector<uint32_t> neighborMark(Psize, 0xFFFFFFFF);
+
+	while (liveTsize > targetTsize && !heap.empty()) {
+		Collapse c = heap.top();
+		heap.pop();
+
+		if (isCollapsed[c.from] || isCollapsed[c.to] || c.fromVersion != version[c.from] || c.toVersion != version[c.to])
+			continue;
+		if (c.cost > maxCost)
+			break;
+
+		const uint32_t a = c.from;
+		const uint32_t b = c.to;
+
+		// link condition : a と b の共通の隣接頂点は edge (a, b) を挟む triangle の頂点だけ
+		uint32_t sharedTriangleCount = 0;
+		for (const auto& t : adjacency[a]) {
+			if (isRemoved[t])
+				continue;
+			bool hasB = false;
+			for (uint32_t j = 0; j < 3; j++) {
+				neighborMark[tri[3 * t + j]] = a;
+				hasB |= (tri[3 * t + j] == b);
+			}
+			if (hasB)
+				sharedTriangleCount++;
+		}
+		uint32_t sharedNeighborCount = 0;
+		for (const auto& t : adjacency[b]) {
+			if (isRemoved[t])
+				continue;
+			for (uint32_t j = 0; j < 3; j++) {
+				uint32_t p = tri[3 * t + j];
+				if (p != a && p != b && neighborMark[p] == a) {
+					sharedNeighborCount++;
+					neighborMark[p] = 0xFFFFFFFF;
+				}
+			}
+		}
+		if (sharedTriangleCount == 0 || sharedNeighborCount != sharedTriangleCount)
+			continue;
+
+		// 面の裏返りを防ぐ
+		bool isFlipped = false;
+		for (const auto& t : adjacency[a]) {
+			if (isRemoved[t])
+				continue;
+			const uint32_t* T = &tri[3 * t];
+			if (T[0] == b || T[1] == b || T[2] == b)
+				continue;
+
+			fvec3 X[3]  = { position(T[0]), position(T[1]), position(T[2]) };
+			fvec3 nOld  = (X[1] - X[0]).cross(X[2] - X[0]);
+			for (uint32_t j = 0; j < 3; j++) {
+				if (T[j] == a)
+					X[j] = position(b);
+			}
+			fvec3 nNew = (X[1] - X[0]).cross(X[2] - X[0]);
+			if (nOld.dot(nNew) <= 0.0f) {
+				isFlipped = true;
+				break;
+			}
+		}
+		if (isFlipped)
+			continue;
+
+		// collapse
+		for (const auto& t : adjacency[a]) {
+			if (isRemoved[t])
+				continue;
+			uint32_t* T = &tri[3 * t];
+			if (T[0] == b || T[1] == b || T[2] == b) {
+				isRemoved[t] = true;
+				liveTsize--;
+				continue;
+			}
+			for (uint32_t j = 0; j < 3; j++) {
+				if (T[j] == a) {
+					T[j]		  = b;
+					corner[3 * t + j] = representative[b];
+				}
+			}
+			adjacency[b].push_back(t);
+		}
+		adjacency[a].clear();
+
+		quadric[b].add(quadric[a]);
+		isCollapsed[a] = true;
+		isBorder[b]    = isBorder[b] || isBorder[a];
+		version[b]++;
+
+		resultError = std::max(resultError, float(std::sqrt(c.cost)));
+
+		for (const auto& t : adjacency[b]) {
+			if (isRemoved[t])
+				continue;
+			for (uint32_t j = 0; j < 3; j++) {
+				uint32_t p = tri[3 * t + j];
+				if (p != b) {
+					pushCollapse(b, p);
+					pushCollapse(p, b);
+				}
+			}
+		}
+	}
+
+	outISize   = 3 * liveTsize;
+	*pOutIData = new uint32_t[outISize];
+
+	uint32_t counter = 0;
+	for (uint32_t i = 0; i < Tsize; i++) {
+		if (isRemoved[i])
+			continue;
+		for (uint32_t j = 0; j < 3; j++) {
+			(*pOutIData)[counter] = corner[3 * i + j];
+			counter++;
+		}
+	}
+}
+
+// LOD0 (入力そのまま) から reduction 倍ずつ triangle を減らした LOD を連結して返す
+// LOD i は index list 上の [lodOffset[i], lodOffset[i + 1])、lodError[i] はその LOD の誤差 (距離)
+// これ以上減らせなくなった所で打ち切るので outLodCount <= lodCount
+inline void GenerateLODChain(
+    const fvec3* const Vdata,
+    const uint32_t& Vsize,
+    const uint32_t* const Idata,
+    const uint32_t& Isize,
+    const uint32_t& lodCount,
+    const float& reduction,
+    const float& maxError,
+    const bool& lockSeams,
+    uint32_t** const pOutIData,
+    uint32_t& outISize,
+    uint32_t** const pOutLodOffset,
+    float** const pOutLodError,
+    uint32_t& outLodCount)
+{
+	std::vector<uint32_t> indices(Idata, Idata + Isize);
+	std::vector<uint32_t> lodOffset = { 0, Isize };
+	std::vector<float> lodError	= { 0.0f };
+
+	uint32_t prevOffset = 0;
+	uint32_t prevSize   = Isize;
+	for (uint32_t lod = 1; lod < lodCount; lod++) {
+		uint32_t targetIsize = 3 * uint32_t(float(prevSize / 3) * reduction);
+
+		uint32_t* pLodIData = nullptr;
+		uint32_t lodISize   = 0;
+		float error	    = 0.0f;
+		SimplifyMesh(Vdata, Vsize, indices.data() + prevOffset, prevSize, targetIsize, maxError, lockSeams, &pLodIData, lodISize, error);
+
+		// ほとんど減らなければ打ち切る
+		if (lodISize == 0 || lodISize > prevSize * 0.95f) {
+			delete[] pLodIData;
+			break;
+		}
+
+		prevOffset = indices.size();
+		prevSize   = lodISize;
+		indices.insert(indices.end(), pLodIData, pLodIData + lodISize);
+		lodOffset.push_back(indices.size());
+		lodError.push_back(lodError.back() + error);
+
+		delete[] pLodIData;
+	}
+
+	outLodCount = lodError.size();
+	outISize    = indices.size();
+
+	*pOutIData     = new uint32_t[outISize];
+	*pOutLodOffset = new uint32_t[outLodCount + 1];
+	*pOutLodError  = new float[outLodCount];
+	for (uint32_t i = 0; i < outISize; i++)
+		(*pOutIData)[i] = indices[i];
+	for (uint32_t i = 0; i < outLodCount + 1; i++)
+		(*pOutLodOffset)[i] = lodOffset[i];
+	for (uint32_t i = 0; i < outLodCount; i++)
+		(*pOutLodError)[i] = lodError[i];
+}
+
+// 投影した誤差が pixelThreshold に収まる一番粗い LOD を選ぶ
+// projectionScale = (画面の高さ [pixel] / 2) * P(1, 1) なので、距離 distance にある長さ L は L * projectionScale / distance [pixel] に映る
+inline uint32_t SelectLOD(
+    const float* const lodError,
+    const uint32_t& lodCount,
+    const float& distance,
+    const float& projectionScale,
+    const float& pixelThreshold)
+{
+	if (distance <= 0.0f)
+		return 0;
+
+	uint32_t lod = 0;
+	for (uint32_t i = 1; i < lodCount; i++) {
+		if (lodError[i] * projectionScale / distance <= pixelThreshold)
+			lod = i;
+	}
+	return lod;
+}
@@ -0,0 +1,373 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <fstream>
+#include <iostream>
+
+#include "src/utils/mathfunc/mathfunc.hpp"
+
+// triangle index list を meshlet (既定 64 頂点 / 124 triangle) に分割する
+// 入力は OptimizeVertexCache 済みの index list を想定 (局所性が良いほど meshlet が詰まる)
+// meshletVertices  : meshlet ごとの頂点 (global index) を連結したもの
+// meshletTriangles : meshlet ごとの triangle (meshlet 内 local index, 3 つ組) を連結したもの
+
+constexpr uint32_t MeshletMaxVertices  = 64;
+constexpr uint32_t MeshletMaxTriangles = 124;
+
+struct Meshlet {
+	uint32_t vertexOffset;
+	uint32_t triangleOffset; // meshletTriangles 上の triangle 番号 (index は 3 倍)
+	uint32_t vertexCount;
+	uint32_t triangleCount;
+
+	// culling 用の bounds (object space)
+	fvec3 center;
+	float radius;
+	fvec3 coneAxis;
+	float coneCutoff; // 1.0 なら back-face culling できない
+};
+
+inline void ComputeMeshletBounds(
+    Meshlet& meshlet,
+    const fvec3* const Vdata,
+    const uint32_t* const meshletVertices,
+    const uint8_t* const meshletTriangles)
+{
+	const uint32_t* const vertices	= meshletVertices + meshlet.vertexOffset;
+	const uint8_t* const triangles = meshletTriangles + 3 * meshlet.triangleOffset;
+
+	fvec3 minp = Vdata[vertices[0]];
+	fvec3 maxp = Vdata[vertices[0]];
+	for (uint32_t i = 1; i < meshlet.vertexCount; i++) {
+		const fvec3& X = Vdata[vertices[i]];
+		for (uint32_t j = 0; j < 3; j++) {
+			minp.cmp[j] = std::min(minp.cmp[j], X.cmp[j]);
+			maxp.cmp[j] = std::max(maxp.cmp[j], X.cmp[j]);
+		}
+	}
+
+	meshlet.center = 0.5f * (minp + maxp);
+	meshlet.radius = 0.0f;
+	for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+		meshlet.radius = std::max(meshlet.radius, (Vdata[vertices[i]] - meshlet.center).sqnorm());
+	meshlet.radius = std::sqrt(meshlet.radius);
+
+	// normal cone
+	// norm() は小さいベクトルで 0 を返すので sqrt(sqnorm()) で正規化する
+	std::vector<fvec3> normals;
+	normals.reserve(meshlet.triangleCount);
+	fvec3 axis = fvec3::zero();
+	for (uint32_t i = 0; i < meshlet.triangleCount; i++) {
+		const fvec3& X0 = Vdata[vertices[triangles[3 * i + 0]]];
+		const fvec3& X1 = Vdata[vertices[triangles[3 * i + 1]]];
+		const fvec3& X2 = Vdata[vertices[triangles[3 * i + 2]]];
+
+		fvec3 n = (X1 - X0).cross(X2 - X0);
+		if (n.sqnorm() < 1.0e-20f)
+			continue;
+		n = n / std::sqrt(n.sqnorm());
+		normals.push_back(n);
+		axis = axis + n;
+	}
+
+	meshlet.coneAxis   = fvec3::zero();
+	meshlet.coneCutoff = 1.0f;
+
+	if (normals.empty() || axis.sqnorm() < 1.0e-12f)
+		return;
+
+	meshlet.coneAxis = axis / std::sqrt(axis.sqnorm());
+
+	float mindp = 1.0f;
+	for (const auto& n : normals)
+		mindp = std::min(mindp, n.dot(meshlet.coneAxis));
+
+	// cone が半球以上に開いているものは culling しない
+	if (mindp > 0.1f)
+		meshlet.coneCutoff = std::sqrt(1.0f - mindp * mindp);
+}
+
+inline void BuildMeshlets(
+    const fvec3* const Vdata,
+    const uint32_t& Vsize,
+    const uint32_t* const Idata,
+    const uint32_t& Isize,
+    const uint32_t& maxVertices,
+    const uint32_t& maxTriangles,
+    Meshlet** const pOutMeshlets,
+    uint32_t& meshletSize,
+    uint32_t** const pOutMeshletVertices,
+    uint32_t& meshletVertexSize,
+    uint8_t** const pOutMeshletTriangles,
+    uint32_t& meshletTriangleSize)
+{
+	if (maxVertices > 255 || maxVertices < 3 || maxTriangles < 1) {
+		std::cout << "invalid meshlet size!!!" << std::endl;
+		exit(1);
+	}
+
+	const uint32_t Tsize = Isize / 3;
+
+	std::vector<Meshlet> meshlets;
+	std::vector<uint32_t> vertices;
+	std::vector<uint8_t> triangles;
+	vertices.reserve(Isize);
+	triangles.reserve(Isize);
+
+	// 現在の meshlet 内での local index, 0xFF は未登録
+	std::vector<uint8_t> localIndex(Vsize, 0xFF);
+
+	Meshlet current;
+	current.vertexOffset   = 0;
+	current.triangleOffset = 0;
+	current.vertexCount    = 0;
+	current.triangleCount  = 0;
+
+	for (uint32_t i = 0; i < Tsize; i++) {
+		const uint32_t VI[3] = { Idata[3 * i + 0], Idata[3 * i + 1], Idata[3 * i + 2] };
+
+		uint32_t newVertexCount = 0;
+		for (uint32_t j = 0; j < 3; j++) {
+			if (localIndex[VI[j]] == 0xFF && (j < 1 || VI[j] != VI[0]) && (j < 2 || VI[j] != VI[1]))
+				newVertexCount++;
+		}
+
+		if (current.vertexCount + newVertexCount > maxVertices || current.triangleCount + 1 > maxTriangles) {
+			for (uint32_t k = 0; k < current.vertexCount; k++)
+				localIndex[vertices[current.vertexOffset + k]] = 0xFF;
+			meshlets.push_back(current);
+
+			current.vertexOffset += current.vertexCount;
+			current.triangleOffset += current.triangleCount;
+			current.vertexCount   = 0;
+			current.triangleCount = 0;
+		}
+
+		for (uint32_t j = 0; j < 3; j++) {
+			if (localIndex[VI[j]] == 0xFF) {
+				localIndex[VI[j]] = current.vertexCount;
+				vertices.push_back(VI[j]);
+				current.vertexCount++;
+			}
+			triangles.push_back(localIndex[VI[j]]);
+		}
+		current.triangleCount++;
+	}
+
+	if (current.triangleCount > 0)
+		meshlets.push_back(current);
+
+	meshletSize	    = meshlets.size();
+	meshletVertexSize   = vertices.size();
+	meshletTriangleSize = triangles.size() / 3;
+
+	*pOutMeshlets	       = new Meshlet[meshletSize];
+	*pOutMeshletVertices   = new uint32_t[meshletVertexSize];
+	*pOutMeshletTriangles = new uint8_t[3 * meshletTriangleSize];
+
+	for (uint32_t i = 0; i < meshletVertexSize; i++)
+		(*pOutMeshletVertices)[i] = vertices[i];
+	for (uint32_t i = 0; i < 3 * meshletTriangleSize; i++)
+		(*pOutMeshletTriangles)[i] = triangles[i];
+
+	for (uint32_t i = 0; i < meshletSize; i++) {
+		(*pOutMeshlets)[i] = meshlets[i];
+		ComputeMeshletBounds((*pOutMeshlets)[i], Vdata, *pOutMeshletVertices, *pOutMeshletTriangles);
+	}
+}
+
+// meshlet の順に global index list を展開する
+// meshlet i は index list 上の [3 * triangleOffset, 3 * (triangleOffset + triangleCount)) を占める
+inline void BuildMeshletIndexList(
+    const Meshlet* const meshlets,
+    const uint32_t& meshletSize,
+    const uint32_t* const meshletVertices,
+    const uint8_t* const meshletTriangles,
+    uint32_t** const pOutIData,
+    uint32_t& outISize)
+{
+	outISize = 0;
+	for (uint32_t i = 0; i < meshletSize; i++)
+		outISize += 3 * meshlets[i].triangleCount;
+
+	*pOutIData = new uint32_t[outISize];
+
+	for (uint32_t i = 0; i < meshletSize; i++) {
+		const Meshlet& m = meshlets[i];
+		for (uint32_t j = 0; j < 3 * m.triangleCount; j++) {
+			uint32_t local					 = meshletTriangles[3 * m.triangleOffset + j];
+			(*pOutIData)[3 * m.triangleOffset + j] = meshletVertices[m.vertexOffset + local];
+		}
+	}
+}
+
+////////////////////////////////////
+
+// cameraPosition は meshlet と同じ座標系 (object space) で与える
+inline bool IsMeshletBackfacing(const Meshlet& meshlet, const fvec3& cameraPosition)
+{
+	fvec3 d = meshlet.center - cameraPosition;
+	return d.dot(meshlet.coneAxis) >= meshlet.coneCutoff * std::sqrt(d.sqnorm()) + meshlet.radius;
+}
+
+// clipMatrix は object space -> clip space (Vulkan, 0 <= z <= w)
+inline bool IsMeshletOutsideFrustum(const Meshlet& meshlet, const fmat4& clipMatrix)
+{
+	const fvec4 row0(clipMatrix(0, 0), clipMatrix(0, 1), clipMatrix(0, 2), clipMatrix(0, 3));
+	const fvec4 row1(clipMatrix(1, 0), clipMatrix(1, 1), clipMatrix(1, 2), clipMatrix(1, 3));
+	const fvec4 row2(clipMatrix(2, 0), clipMatrix(2, 1), clipMatrix(2, 2), clipMatrix(2, 3));
+	const fvec4 row3(clipMatrix(3, 0), clipMatrix(3, 1), clipMatrix(3, 2), clipMatrix(3, 3));
+
+	const fvec4 planes[6] = {
+		row3 + row0,
+		row3 - row0,
+		row3 + row1,
+		row3 - row1,
+		row2,
+		row3 - row2,
+	};
+
+	for (const auto& plane : planes) {
+		fvec3 n(plane.x, plane.y, plane.z);
+		if (n.dot(meshlet.center) + plane.w < -meshlet.radius * std::sqrt(n.sqnorm()))
+			return true;
+	}
+	return false;
+}
+
+////////////////////////////////////
+
+// offline で作った meshlet をそのまま読めるようにする
+// magic, version, 各 size, Meshlet, meshletVertices, meshletTriangles の順に書く
+
+constexpr uint32_t MeshletFileMagic   = 0x54534c4d; // "MLST"
+constexpr uint32_t MeshletFileVersion = 1;
+
+inline void WriteMeshletFile(
+    const char* const filename,
+    const Meshlet* const meshlets,
+    const uint32_t& meshletSize,
+    const uint32_t* const meshletVertices,
+    const uint32_t& meshletVertexSize,
+    const uint8_t* const meshletTriangles,
+    const uint32_t& meshletTriangleSize)
+{
+	std::ofstream file(filename, std::ios::binary);
+	if (!file) {
+		std::cout << "failed to open " << filename << std::endl;
+		exit(1);
+	}
+
+	auto write = [&](const void* data, size_t size) { file.write(reinterpret_cast<const char*>(data), size); };
+
+	write(&MeshletFileMagic, sizeof(uint32_t));
+	write(&MeshletFileVersion, sizeof(uint32_t));
+	write(&meshletSize, sizeof(uint32_t));
+	write(&meshletVertexSize, sizeof(uint32_t));
+	write(&meshletTriangleSize, sizeof(uint32_t));
+
+	for (uint32_t i = 0; i < meshletSize; i++) {
+		const Meshlet& m = meshlets[i];
+		write(&m.vertexOffset, sizeof(uint32_t));
+		write(&m.triangleOffset, sizeof(uint32_t));
+		write(&m.vertexCount, sizeof(uint32_t));
+		write(&m.triangleCount, sizeof(uint32_t));
+		write(m.center.cmp, 3 * sizeof(float));
+		write(&m.radius, sizeof(float));
+		write(m.coneAxis.cmp, 3 * sizeof(float));
+		write(&m.coneCutoff, sizeof(float));
+	}
+
+	write(meshletVertices, meshletVertexSize * sizeof(uint32_t));
+	write(meshletTriangles, 3 * meshletTriangleSize * sizeof(uint8_t));
+}
+
+inline bool ReadMeshletFile(
+    const char* const filename,
+    Meshlet** const pOutMeshlets,
+    uint32_t& meshletSize,
+    uint32_t** const pOutMeshletVertices,
+    uint32_t& meshletVertexSize,
+    uint8_t** const pOutMeshletTriangles,
+    uint32_t& meshletTriangleSize)
+{
+	std::ifstream file(filename, std::ios::binary | std::ios::ate);
+	if (!file)
+		return false;
+	const uint64_t fileSize = uint64_t(file.tellg());
+	file.seekg(0);
+
+	auto read = [&](void* data, size_t size) { file.read(reinterpret_cast<char*>(data), size); };
+
+	uint32_t magic = 0, version = 0;
+	read(&magic, sizeof(uint32_t));
+	read(&version, sizeof(uint32_t));
+	if (!file || magic != MeshletFileMagic || version != MeshletFileVersion) {
+		std::cout << filename << " is not a meshlet file" << std::endl;
+		return false;
+	}
+
+	read(&meshletSize, sizeof(uint32_t));
+	read(&meshletVertexSize, sizeof(uint32_t));
+	read(&meshletTriangleSize, sizeof(uint32_t));
+
+	// 確保する前に、各 size が残りの byte 数に収まるかを見る (uint32_t の積なので uint64_t なら桁あふれしない)
+	constexpr uint64_t headerSize = 5 * sizeof(uint32_t);
+	constexpr uint64_t recordSize = 4 * sizeof(uint32_t) + 8 * sizeof(float);
+	if (!file || fileSize - headerSize < uint64_t(meshletSize) * recordSize + uint64_t(meshletVertexSize) * sizeof(uint32_t) + uint64_t(meshletTriangleSize) * 3) {
+		std::cout << filename << " is broken" << std::endl;
+		return false;
+	}
+
+	*pOutMeshlets	       = new Meshlet[meshletSize];
+	*pOutMeshletVertices   = new uint32_t[meshletVertexSize];
+	*pOutMeshletTriangles = new uint8_t[3 * size_t(meshletTriangleSize)];
+
+	auto fail = [&](const char* const message) {
+		std::cout << message << filename << std::endl;
+		delete[] *pOutMeshlets;
+		delete[] *pOutMeshletVertices;
+		delete[] *pOutMeshletTriangles;
+		*pOutMeshlets	       = nullptr;
+		*pOutMeshletVertices   = nullptr;
+		*pOutMeshletTriangles = nullptr;
+		return false;
+	};
+
+	for (uint32_t i = 0; i < meshletSize; i++) {
+		Meshlet& m = (*pOutMeshlets)[i];
+		read(&m.vertexOffset, sizeof(uint32_t));
+		read(&m.triangleOffset, sizeof(uint32_t));
+		read(&m.vertexCount, sizeof(uint32_t));
+		read(&m.triangleCount, sizeof(uint32_t));
+		read(m.center.cmp, 3 * sizeof(float));
+		read(&m.radius, sizeof(float));
+		read(m.coneAxis.cmp, 3 * sizeof(float));
+		read(&m.coneCutoff, sizeof(float));
+	}
+
+	read(*pOutMeshletVertices, meshletVertexSize * sizeof(uint32_t));
+	read(*pOutMeshletTriangles, 3 * size_t(meshletTriangleSize) * sizeof(uint8_t));
+
+	if (!file)
+		return fail("failed to read ");
+
+	// meshlet が読んだ配列の外を指していないか
+	for (uint32_t i = 0; i < meshletSize; i++) {
+		const Meshlet& m = (*pOutMeshlets)[i];
+		if (m.vertexCount > MeshletMaxVertices || m.triangleCount > MeshletMaxTriangles
+		    || m.vertexOffset > meshletVertexSize || m.vertexCount > meshletVertexSize - m.vertexOffset
+		    || m.triangleOffset > meshletTriangleSize || m.triangleCount > meshletTriangleSize - m.triangleOffset)
+			return fail("broken meshlet in ");
+
+		const uint8_t* const triangles = *pOutMeshletTriangles + 3 * size_t(m.triangleOffset);
+		for (uint32_t j = 0; j < 3 * m.triangleCount; j++) {
+			if (triangles[j] >= m.vertexCount)
+				return fail("broken meshlet in ");
+		}
+	}
+
+	return true;
+}
@@ -2,6 +2,45 @@
 #include "src/utils/mathfunc/mathfunc.hpp"
 #include <cmath>
 
+// 立方体を 6 つの四面体に分ける表 (CubeTetrahedra の Ind0 から Ind7 の番号)
+constexpr uint32_t CubeTetrahedraCorner[6][4] = {
+	{ 0, 1, 2, 4 },
+	{ 6, 4, 2, 5 },
+	{ 4, 5, 1, 2 },
+	{ 1, 3, 2, 7 },
+	{ 5, 7, 1, 2 },
+	{ 5, 6, 7, 2 },
+};
+// Ind0 から Ind7 の (x, y, z) の格子上の位置
+constexpr fvec3 CubeTetrahedraCornerPosition[8] = {
+	fvec3(1.0f, 0.0f, 0.0f),
+	fvec3(0.0f, 0.0f, 0.0f),
+	fvec3(1.0f, 0.0f, 1.0f),
+	fvec3(0.0f, 0.0f, 1.0f),
+	fvec3(1.0f, 1.0f, 0.0f),
+	fvec3(0.0f, 1.0f, 0.0f),
+	fvec3(1.0f, 1.0f, 1.0f),
+	fvec3(0.0f, 1.0f, 1.0f),
+};
+
+// 全ての四面体が同じ向き (体積が正) で、体積の和が立方体の体積になるか
+constexpr bool IsCubeTetrahedraPartition()
+{
+	float sum = 0.0f;
+	for (const auto& tet : CubeTetrahedraCorner) {
+		const fvec3& p0	   = CubeTetrahedraCornerPosition[tet[0]];
+		const float volume6 = fvec3::STP(
+		    CubeTetrahedraCornerPosition[tet[1]] - p0,
+		    CubeTetrahedraCornerPosition[tet[2]] - p0,
+		    CubeTetrahedraCornerPosition[tet[3]] - p0);
+		if (!(volume6 > 0.0f))
+			return false;
+		sum += volume6;
+	}
+	return sum == 6.0f;
+}
+static_assert(IsCubeTetrahedraPartition(), "CubeTetrahedraCorner must split the cube into positively oriented tetrahedra");
+
 void CubeTetrahedra(
     const uint32_t N,
     const float L,
@@ -54,59 +93,11 @@ void CubeTetrahedra(
 				uint32_t Ind7 = N * N + Ind3;
 
 				uint32_t index				= (N - 1) * (N - 1) * y + (N - 1) * z + x;
-				(*ilistdata)[4 * 6 * index + 4 * 0 + 0] = Ind0;
-				(*ilistdata)[4 * 6 * index + 4 * 0 + 1] = Ind1;
-				(*ilistdata)[4 * 6 * index + 4 * 0 + 2] = Ind2;
-				(*ilistdata)[4 * 6 * index + 4 * 0 + 3] = Ind4;
-				//TetIndList.emplace_back(Ind1);
-				//TetIndList.emplace_back(Ind1);
-				//TetIndList.emplace_back(Ind2);
-				//TetIndList.emplace_back(Ind4);
-
-				(*ilistdata)[4 * 6 * index + 4 * 1 + 0] = Ind6;
-				(*ilistdata)[4 * 6 * index + 4 * 1 + 1] = Ind4;
-				(*ilistdata)[4 * 6 * index + 4 * 1 + 2] = Ind2;
-				(*ilistdata)[4 * 6 * index + 4 * 1 + 3] = Ind5;
-				//TetIndList.emplace_back(Ind6);
-				//TetIndList.emplace_back(Ind4);
-				//TetIndList.emplace_back(Ind2);
-				//TetIndList.emplace_back(Ind5);
-
-				(*ilistdata)[4 * 6 * index + 4 * 2 + 0] = Ind4;
-				(*ilistdata)[4 * 6 * index + 4 * 2 + 1] = Ind5;
-				(*ilistdata)[4 * 6 * index + 4 * 2 + 2] = Ind1;
-				(*ilistdata)[4 * 6 * index + 4 * 2 + 3] = Ind2;
-				//TetIndList.emplace_back(Ind4);
-				//TetIndList.emplace_back(Ind5);
-				//TetIndList.emplace_back(Ind1);
-				//TetIndList.emplace_back(Ind2);
-
-				(*ilistdata)[4 * 6 * index + 4 * 3 + 0] = Ind1;
-				(*ilistdata)[4 * 6 * index + 4 * 3 + 1] = Ind3;
-				(*ilistdata)[4 * 6 * index + 4 * 3 + 2] = Ind2;
-				(*ilistdata)[4 * 6 * index + 4 * 3 + 3] = Ind7;
-				//TetIndList.emplace_back(Ind1);
-				//TetIndList.emplace_back(Ind3);
-				//TetIndList.emplace_back(Ind2);
-				//TetIndList.emplace_back(Ind7);
-
-				(*ilistdata)[4 * 6 * index + 4 * 4 + 0] = Ind5;
-				(*ilistdata)[4 * 6 * index + 4 * 4 + 1] = Ind7;
-				(*ilistdata)[4 * 6 * index + 4 * 4 + 2] = Ind1;
-				(*ilistdata)[4 * 6 * index + 4 * 4 + 3] = Ind2;
-				//TetIndList.emplace_back(Ind5);
-				//TetIndList.emplace_back(Ind7);
-				//TetIndList.emplace_back(Ind1);
-				//TetIndList.emplace_back(Ind2);
-
-				(*ilistdata)[4 * 6 * index + 4 * 5 + 0] = Ind5;
-				(*ilistdata)[4 * 6 * index + 4 * 5 + 1] = Ind6;
-				(*ilistdata)[4 * 6 * index + 4 * 5 + 2] = Ind7;
-				(*ilistdata)[4 * 6 * index + 4 * 5 + 3] = Ind2;
-				//TetIndList.emplace_back(Ind5);
-				//TetIndList.emplace_back(Ind6);
-				//TetIndList.emplace_back(Ind7);
-				//TetIndList.emplace_back(Ind2);
+				const uint32_t Ind[8]			= { Ind0, Ind1, Ind2, Ind3, Ind4, Ind5, Ind6, Ind7 };
+				for (uint32_t t = 0; t < 6; t++) {
+					for (uint32_t k = 0; k < 4; k++)
+						(*ilistdata)[4 * 6 * index + 4 * t + k] = Ind[CubeTetrahedraCorner[t][k]];
+				}
 			}
 		}
 	}
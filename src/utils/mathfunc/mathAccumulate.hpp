@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+
+// 多くの値を足し合わせるときの丸め誤差を抑える accumulator
+// V は +, - が使える型 (float, double, vec3, mat3, floatx8, fvec3x8, fmat3x8 など)
+// 初期値 (0) は型ごとに作り方が違うので、コンストラクタで渡す
+//
+// n 個を順に足すと誤差は n * eps に比例して増える
+// KahanSum    : 足すたびに落ちた下位の桁を補正する。誤差は n によらず 2 eps 程度、1 回の add で + - が 4 回
+// PairwiseSum : 2 分木の順に足す。誤差は log2(n) * eps 程度、1 回の add で + が平均 2 回
+// float で値を作って double に足すとき (mixed precision) は、double への変換を呼ぶ側で明示する
+//	dvec3 x = static_cast<dvec3>(f); (3 回の変換、SoA の lane からなら 24 回)
+// 変換は安くないので、float で小さい塊ごとに和を取ってから変換して足す (IntOnMesh.hpp の double 版を参照)
+// -ffast-math (-fassociative-math) では補正の計算が消えるので使わない
+
+template <class V>
+class KahanSum {
+	V sum;
+	V compensation;
+
+public:
+	explicit KahanSum(const V& zero);
+
+	void add(const V& x);
+	V value() const;
+};
+
+template <class V>
+class PairwiseSum {
+	// count の k bit 目が立っているとき、partial[k] は 2^k 個の値の和
+	V partial[64];
+	uint64_t count;
+	V zero;
+
+public:
+	explicit PairwiseSum(const V& zero);
+
+	void add(const V& x);
+	V value() const;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+template <class V>
+inline KahanSum<V>::KahanSum(const V& zero)
+	: sum(zero)
+	, compensation(zero)
+{
+}
+
+template <class V>
+inline void KahanSum<V>::add(const V& x)
+{
+	const V y = x - compensation;
+	const V t = sum + y;
+	compensation = (t - sum) - y;
+	sum	     = t;
+}
+
+template <class V>
+inline V KahanSum<V>::value() const
+{
+	return sum;
+}
+
+template <class V>
+inline PairwiseSum<V>::PairwiseSum(const V& zero)
+	: count(0)
+	, zero(zero)
+{
+}
+
+template <class V>
+inline void PairwiseSum<V>::add(const V& x)
+{
+	// 2 進数の繰り上がりと同じように、同じ個数の和どうしをまとめる
+	V carry	   = x;
+	uint32_t k = 0;
+	for (; (count >> k) & 1; k++)
+		carry = partial[k] + carry;
+	partial[k] = carry;
+	count++;
+}
+
+template <class V>
+inline V PairwiseSum<V>::value() const
+{
+	V ret = zero;
+	for (uint32_t k = 0; k < 64; k++) {
+		if ((count >> k) & 1)
+			ret = partial[k] + ret;
+	}
+	return ret;
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstdint>
+
+#include "src/utils/mathfunc/mathfunc.hpp"
+
+// 4 成分の境界 (float なら 16 byte, double なら 32 byte) に揃えた vec3, vec4, mat3, mat4
+// GPU の std140, std430 の vec3, vec4, mat3, mat4 と同じ配置なので、構造体や配列を詰め直さずに memcpy できる
+//	vec3a の配列は 1 要素が 4 成分分 (最後は使わない), mat3a は 1 行 4 成分の 3 行
+//	GLSL で vec3 の直後に float を置いたところは、その float が vec3 の 4 成分目に入るので fvec3 + float のままにする
+// 行列は row major なので、shader (column major) に渡すときは今まで通り transpose したものを入れる
+// 配列の要素が cache line をまたがず、SIMD で 4 成分ずつ読める (mathSoA.hpp の fvec3x8::load, store)
+//
+// vec3a, vec4a, mat4a は vec3, vec4, mat4 を継承していて、そのまま引数に渡せる
+// 演算の結果は vec3, vec4, mat4 になり、vec3a などへは代入 (暗黙の変換) で戻す
+// mat3a は配置が違うので、mat3 との変換を通して使う
+// std::vector などで確保するときは TypeAllocator (allocator.hpp) か std::allocator が alignof を守る
+
+template <class T>
+class alignas(4 * sizeof(T)) vec3a : public vec3<T> {
+public:
+	explicit constexpr vec3a(const T x, const T y, const T z);
+	constexpr vec3a(const vec3<T>& v);
+	explicit constexpr vec3a();
+};
+
+template <class T>
+class alignas(4 * sizeof(T)) vec4a : public vec4<T> {
+public:
+	explicit constexpr vec4a(const T x, const T y, const T z, const T w);
+	constexpr vec4a(const vec4<T>& v);
+	explicit constexpr vec4a();
+};
+
+template <class T>
+class alignas(4 * sizeof(T)) mat3a {
+public:
+	T cmp[12];
+	//row major, 1 行 4 成分 (3, 7, 11 は 0)
+	//
+	// 0 1  2  3
+	// 4 5  6  7
+	// 8 9 10 11
+
+	constexpr mat3a(const mat3<T>& m);
+	explicit constexpr mat3a();
+
+	constexpr T& operator()(const uint32_t idxr, const uint32_t idxc)&;
+	constexpr const T& operator()(const uint32_t idxr, const uint32_t idxc) const&;
+
+	constexpr operator mat3<T>() const;
+};
+
+template <class T>
+class alignas(4 * sizeof(T)) mat4a : public mat4<T> {
+public:
+	constexpr mat4a(const mat4<T>& m);
+	explicit constexpr mat4a();
+};
+
+using fvec3a = vec3a<float>;
+using dvec3a = vec3a<double>;
+using fvec4a = vec4a<float>;
+using dvec4a = vec4a<double>;
+using fmat3a = mat3a<float>;
+using dmat3a = mat3a<double>;
+using fmat4a = mat4a<float>;
+using dmat4a = mat4a<double>;
+
+static_assert(sizeof(fvec3a) == 16 && alignof(fvec3a) == 16);
+static_assert(sizeof(fvec4a) == 16 && alignof(fvec4a) == 16);
+static_assert(sizeof(fmat3a) == 48 && alignof(fmat3a) == 16);
+static_assert(sizeof(fmat4a) == 64 && alignof(fmat4a) == 16);
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+template <class T>
+inline constexpr vec3a<T>::vec3a(const T x, const T y, const T z)
+	: vec3<T>(x, y, z)
+{
+}
+template <class T>
+inline constexpr vec3a<T>::vec3a(const vec3<T>& v)
+	: vec3<T>(v)
+{
+}
+template <class T>
+inline constexpr vec3a<T>::vec3a()
+	: vec3<T>()
+{
+}
+
+template <class T>
+inline constexpr vec4a<T>::vec4a(const T x, const T y, const T z, const T w)
+	: vec4<T>(x, y, z, w)
+{
+}
+template <class T>
+inline constexpr vec4a<T>::vec4a(const vec4<T>& v)
+	: vec4<T>(v)
+{
+}
+template <class T>
+inline constexpr vec4a<T>::vec4a()
+	: vec4<T>()
+{
+}
+
+template <class T>
+inline constexpr mat3a<T>::mat3a(const mat3<T>& m)
+	: cmp {
+		m.cmp[0], m.cmp[1], m.cmp[2], 0.0,
+		m.cmp[3], m.cmp[4], m.cmp[5], 0.0,
+		m.cmp[6], m.cmp[7], m.cmp[8], 0.0
+	}
+{
+}
+template <class T>
+inline constexpr mat3a<T>::mat3a()
+	: cmp {}
+{
+}
+
+template <class T>
+inline constexpr T& mat3a<T>::operator()(const uint32_t idxr, const uint32_t idxc)&
+{
+	return cmp[4 * idxr + idxc];
+}
+template <class T>
+inline constexpr const T& mat3a<T>::operator()(const uint32_t idxr, const uint32_t idxc) const&
+{
+	return cmp[4 * idxr + idxc];
+}
+
+template <class T>
+inline constexpr mat3a<T>::operator mat3<T>() const
+{
+	return mat3<T>(
+		cmp[0], cmp[1], cmp[2],
+		cmp[4], cmp[5], cmp[6],
+		cmp[8], cmp[9], cmp[10]);
+}
+
+template <class T>
+inline constexpr mat4a<T>::mat4a(const mat4<T>& m)
+	: mat4<T>(m)
+{
+}
+template <class T>
+inline constexpr mat4a<T>::mat4a()
+	: mat4<T>()
+{
+}
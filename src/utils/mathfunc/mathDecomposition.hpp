@@ -0,0 +1,342 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#include "src/utils/mathfunc/mathfunc.hpp"
+#include "src/utils/mathfunc/mathSoA.hpp"
+
+// 3x3 行列の分解
+// SymmetricEigen     : 対称行列 A = V diag(lambda) V^T (lambda は大きい順。慣性テンソルの主軸など)
+// SVD                : A = U diag(sigma) V^T (sigma は絶対値の大きい順)
+// PolarDecomposition : A = R S (R は回転, S は対称。co-rotational FEM や shape matching の回転)
+//
+// McAdams et al. "Computing the Singular Value Decomposition of 3x3 matrices with minimal branching
+// and elementary floating point operations" (2011) と同じ方法
+// 対称行列は近似 Givens 回転の Jacobi 法で対角化し、SVD は A^T A の固有ベクトル V から A V の列を大きさ順に並べ、
+// Givens 回転の QR 分解で U と sigma を求める
+// 反復回数は固定で、条件は全て lane ごとの選択にしてあるので、fmat3, dmat3 と fmat3x8 (8 個同時) で同じ code を使う
+//
+// U, V, R は常に回転 (行列式 +1)。A の行列式が負のときは sigma(2) が負になり、S は正定値でなくなる
+// (反転した四面体でも回転が鏡映にならない)
+
+// Jacobi 法の sweep 数 (1 sweep = 3 回の回転)
+// 対角成分が近いうちは pi/4 の固定回転になって収束が遅く、固有値が離れた行列ほど sweep が要る
+// 固有値 1e6, 1e3, 1 の対称行列と特異値 1e3, 1, 1e-3 の行列 10 万個で測ると、
+// float は 6, double は 8 でそれ以上増やしても誤差が減らなくなる
+// (double 6 では固有値分解に最大の固有値の 2e-8 程度, float 5 では 3e-5 程度の誤差が残る)
+// 条件の分岐を持たない fmat3x8 と lane ごとに同じ結果にするため、途中で打ち切らずに固定回数回す
+template <class S>
+constexpr uint32_t DecompJacobiSweeps = 6;
+template <>
+constexpr uint32_t DecompJacobiSweeps<double> = 8;
+
+// QR 分解で 0 とみなす列の長さ (成分の絶対値の最大を 1 にした行列での値)
+template <class S>
+constexpr float DecompEpsilon = 1.0e-6f;
+template <>
+constexpr double DecompEpsilon<double> = 1.0e-14;
+
+////////////////////
+// scalar と floatx8 で共通に使う演算
+
+inline float DecompSqrt(const float x)
+{
+	return std::sqrt(x);
+}
+inline double DecompSqrt(const double x)
+{
+	return std::sqrt(x);
+}
+inline floatx8 DecompSqrt(const floatx8& x)
+{
+	return floatx8(SimdSqrt8(x.v));
+}
+
+template <class T>
+inline bool DecompLess(const T a, const T b)
+{
+	return a < b;
+}
+inline floatx8 DecompLess(const floatx8& a, const floatx8& b)
+{
+	return floatx8(SimdLess8(a.v, b.v));
+}
+
+template <class T>
+inline T DecompSelect(const bool mask, const T a, const T b)
+{
+	return mask ? a : b;
+}
+inline floatx8 DecompSelect(const floatx8& mask, const floatx8& a, const floatx8& b)
+{
+	return floatx8(SimdSelect8(mask.v, a.v, b.v));
+}
+
+template <class S>
+inline S DecompAbs(const S& x)
+{
+	return DecompSelect(DecompLess(x, S(0.0)), -x, x);
+}
+template <class S>
+inline S DecompMax(const S& a, const S& b)
+{
+	return DecompSelect(DecompLess(a, b), b, a);
+}
+
+// mask なら (x, y) = (y, x)
+template <class S, class M>
+inline void DecompCondSwap(const M& mask, S& x, S& y)
+{
+	const S t = x;
+	x	  = DecompSelect(mask, y, x);
+	y	  = DecompSelect(mask, t, y);
+}
+// mask なら (x, y) = (y, -x) (列を入れ替えても行列式の符号が変わらない)
+template <class S, class M>
+inline void DecompCondNegSwap(const M& mask, S& x, S& y)
+{
+	const S t = -x;
+	x	  = DecompSelect(mask, y, x);
+	y	  = DecompSelect(mask, t, y);
+}
+
+////////////////////
+// 行列は row major の 9 成分
+
+// m <- G^T m (G は p, q 面の回転 [[c, -s], [s, c]]) の p, q 行
+template <class S>
+inline void DecompRotateRows(S (&m)[9], const uint32_t p, const uint32_t q, const S& c, const S& s)
+{
+	for (uint32_t k = 0; k < 3; k++) {
+		const S a    = m[3 * p + k];
+		const S b    = m[3 * q + k];
+		m[3 * p + k] = c * a + s * b;
+		m[3 * q + k] = c * b - s * a;
+	}
+}
+// m <- m G の p, q 列
+template <class S>
+inline void DecompRotateColumns(S (&m)[9], const uint32_t p, const uint32_t q, const S& c, const S& s)
+{
+	for (uint32_t k = 0; k < 3; k++) {
+		const S a    = m[3 * k + p];
+		const S b    = m[3 * k + q];
+		m[3 * k + p] = c * a + s * b;
+		m[3 * k + q] = c * b - s * a;
+	}
+}
+
+// 対称行列 s を Jacobi 法で対角化し、回転を v に右からかける
+// 回転角は (s_pp - s_qq, s_pq) から半角の tan を 1 次で近似して求める (sqrt 1 回, 三角関数なし)
+// s_pq が大きくて近似が外れるときは pi/4 回す
+template <class S>
+inline void DecompJacobi(S (&s)[9], S (&v)[9])
+{
+	const S gamma(5.828427124746190);   // 3 + 2 sqrt(2) = 1 / tan^2(pi/8)
+	const S cstar(0.9238795325112867);  // cos(pi/8)
+	const S sstar(0.38268343236508984); // sin(pi/8)
+
+	auto Rotate = [&](const uint32_t p, const uint32_t q) {
+		S ch = S(2.0) * (s[3 * p + p] - s[3 * q + q]);
+		S sh = s[3 * p + q];
+
+		const auto isapprox = DecompLess(gamma * sh * sh, ch * ch);
+		const S w	    = S(1.0) / DecompSqrt(ch * ch + sh * sh);
+		ch		    = DecompSelect(isapprox, w * ch, cstar);
+		sh		    = DecompSelect(isapprox, w * sh, sstar);
+
+		// 半角から回転角へ
+		const S c  = ch * ch - sh * sh;
+		const S sn = S(2.0) * ch * sh;
+		DecompRotateColumns(s, p, q, c, sn);
+		DecompRotateRows(s, p, q, c, sn);
+		DecompRotateColumns(v, p, q, c, sn);
+	};
+
+	for (uint32_t sweep = 0; sweep < DecompJacobiSweeps<S>; sweep++) {
+		Rotate(0, 1);
+		Rotate(1, 2);
+		Rotate(0, 2);
+	}
+}
+
+template <class S>
+inline void DecompIdentity(S (&m)[9])
+{
+	for (uint32_t i = 0; i < 9; i++)
+		m[i] = S((i % 4 == 0) ? 1.0 : 0.0);
+}
+
+// 対角成分 d (の値 key) が大きい順になるように、v の列と一緒に並べ替える
+template <class S>
+inline void DecompSortColumns(S (&key)[3], S (&d)[3], S (&b)[9], S (&v)[9], const bool hasb)
+{
+	auto Sort = [&](const uint32_t i, const uint32_t j) {
+		const auto isless = DecompLess(key[i], key[j]);
+		DecompCondSwap(isless, key[i], key[j]);
+		DecompCondSwap(isless, d[i], d[j]);
+		for (uint32_t k = 0; k < 3; k++) {
+			if (hasb)
+				DecompCondNegSwap(isless, b[3 * k + i], b[3 * k + j]);
+			DecompCondNegSwap(isless, v[3 * k + i], v[3 * k + j]);
+		}
+		// 負にした列に合わせる
+		d[j] = DecompSelect(isless, -d[j], d[j]);
+	};
+	Sort(0, 1);
+	Sort(0, 2);
+	Sort(1, 2);
+}
+
+template <class S>
+inline void DecompSymmetricEigen(const S (&a)[9], S (&v)[9], S (&lambda)[3])
+{
+	S s[9];
+	for (uint32_t i = 0; i < 9; i++)
+		s[i] = a[i];
+	DecompIdentity(v);
+	DecompJacobi(s, v);
+
+	// 固有値は列の符号に関係ないので、並べ替えで付いた符号は捨てる
+	S key[3] = { s[0], s[4], s[8] };
+	S sign[3] = { S(1.0), S(1.0), S(1.0) };
+	S unused[9];
+	DecompSortColumns(key, sign, unused, v, false);
+	for (uint32_t i = 0; i < 3; i++)
+		lambda[i] = key[i];
+}
+
+template <class S>
+inline void DecompSVD(const S (&a0)[9], S (&u)[9], S (&sigma)[3], S (&v)[9])
+{
+	// A^T A は成分が A の 2 乗の大きさになり、float では |a_ij| が 1e-19 程度より小さいと underflow する (大きいと overflow)
+	// 成分の絶対値の最大で割って 1 程度にしてから分解し、最後に sigma へかけ戻す (U, V は変わらない)
+	S scale = DecompAbs(a0[0]);
+	for (uint32_t i = 1; i < 9; i++)
+		scale = DecompMax(scale, DecompAbs(a0[i]));
+	scale = DecompSelect(DecompLess(S(0.0), scale), scale, S(1.0));
+	S a[9];
+	for (uint32_t i = 0; i < 9; i++)
+		a[i] = a0[i] / scale;
+
+	// A^T A の固有ベクトル
+	S s[9];
+	for (uint32_t i = 0; i < 3; i++) {
+		for (uint32_t j = 0; j < 3; j++)
+			s[3 * i + j] = a[0 + i] * a[0 + j] + a[3 + i] * a[3 + j] + a[6 + i] * a[6 + j];
+	}
+	DecompIdentity(v);
+	DecompJacobi(s, v);
+
+	// B = A V の列を長さの順に並べる
+	S b[9];
+	for (uint32_t i = 0; i < 3; i++) {
+		for (uint32_t j = 0; j < 3; j++)
+			b[3 * i + j] = a[3 * i + 0] * v[0 + j] + a[3 * i + 1] * v[3 + j] + a[3 * i + 2] * v[6 + j];
+	}
+	S rho[3];
+	for (uint32_t j = 0; j < 3; j++)
+		rho[j] = b[0 + j] * b[0 + j] + b[3 + j] * b[3 + j] + b[6 + j] * b[6 + j];
+	S unused[3] = { S(0.0), S(0.0), S(0.0) };
+	DecompSortColumns(rho, unused, b, v, true);
+
+	// B = U R を Givens 回転で求め、R の対角を sigma にする
+	const S epsilon(DecompEpsilon<S>);
+	DecompIdentity(u);
+	auto QR = [&](const uint32_t p, const uint32_t q) {
+		const S a1  = b[3 * p + p];
+		const S a2  = b[3 * q + p];
+		const S len = DecompSqrt(a1 * a1 + a2 * a2);
+
+		S sh = DecompSelect(DecompLess(epsilon, len), a2, S(0.0));
+		S ch = DecompAbs(a1) + DecompMax(len, epsilon);
+		DecompCondSwap(DecompLess(a1, S(0.0)), sh, ch);
+		const S w = S(1.0) / DecompSqrt(ch * ch + sh * sh);
+		ch	  = w * ch;
+		sh	  = w * sh;
+
+		const S c  = ch * ch - sh * sh;
+		const S sn = S(2.0) * ch * sh;
+		DecompRotateRows(b, p, q, c, sn);
+		DecompRotateColumns(u, p, q, c, sn);
+	};
+	QR(0, 1);
+	QR(0, 2);
+	QR(1, 2);
+
+	sigma[0] = b[0] * scale;
+	sigma[1] = b[4] * scale;
+	sigma[2] = b[8] * scale;
+}
+
+template <class S>
+inline void DecompPolar(const S (&a)[9], S (&r)[9], S (&s)[9])
+{
+	S u[9], v[9], sigma[3];
+	DecompSVD(a, u, sigma, v);
+
+	// R = U V^T, S = V diag(sigma) V^T
+	for (uint32_t i = 0; i < 3; i++) {
+		for (uint32_t j = 0; j < 3; j++) {
+			r[3 * i + j] = u[3 * i + 0] * v[3 * j + 0] + u[3 * i + 1] * v[3 * j + 1] + u[3 * i + 2] * v[3 * j + 2];
+			s[3 * i + j] = sigma[0] * v[3 * i + 0] * v[3 * j + 0] + sigma[1] * v[3 * i + 1] * v[3 * j + 1] + sigma[2] * v[3 * i + 2] * v[3 * j + 2];
+		}
+	}
+}
+
+////////////////////
+
+template <class T>
+inline void SymmetricEigen(const mat3<T>& a, mat3<T>& v, vec3<T>& lambda)
+{
+	DecompSymmetricEigen(a.cmp, v.cmp, lambda.cmp);
+}
+template <class T>
+inline void SVD(const mat3<T>& a, mat3<T>& u, vec3<T>& sigma, mat3<T>& v)
+{
+	DecompSVD(a.cmp, u.cmp, sigma.cmp, v.cmp);
+}
+template <class T>
+inline void PolarDecomposition(const mat3<T>& a, mat3<T>& r, mat3<T>& s)
+{
+	DecompPolar(a.cmp, r.cmp, s.cmp);
+}
+
+// fmat3x8 は成分を floatx8 の配列にして同じ kernel を通す
+inline void DecompToLanes(const fmat3x8& m, floatx8 (&out)[9])
+{
+	for (uint32_t i = 0; i < 9; i++)
+		out[i] = floatx8(m.cmp[i]);
+}
+inline void DecompFromLanes(const floatx8 (&m)[9], fmat3x8& out)
+{
+	for (uint32_t i = 0; i < 9; i++)
+		out.cmp[i] = m[i].v;
+}
+
+inline void SymmetricEigen(const fmat3x8& a, fmat3x8& v, fvec3x8& lambda)
+{
+	floatx8 la[9], lv[9], ll[3];
+	DecompToLanes(a, la);
+	DecompSymmetricEigen(la, lv, ll);
+	DecompFromLanes(lv, v);
+	lambda = fvec3x8(ll[0].v, ll[1].v, ll[2].v);
+}
+inline void SVD(const fmat3x8& a, fmat3x8& u, fvec3x8& sigma, fmat3x8& v)
+{
+	floatx8 la[9], lu[9], ls[3], lv[9];
+	DecompToLanes(a, la);
+	DecompSVD(la, lu, ls, lv);
+	DecompFromLanes(lu, u);
+	DecompFromLanes(lv, v);
+	sigma = fvec3x8(ls[0].v, ls[1].v, ls[2].v);
+}
+inline void PolarDecomposition(const fmat3x8& a, fmat3x8& r, fmat3x8& s)
+{
+	floatx8 la[9], lr[9], ls[9];
+	DecompToLanes(a, la);
+	DecompPolar(la, lr, ls);
+	DecompFromLanes(lr, r);
+	DecompFromLanes(ls, s);
+}
@@ -0,0 +1,448 @@
+#pragma once
+
+#include <cstdint>
+
+#include "src/utils/mathfunc/mathfunc.hpp"
+
+// vec3, mat3 の式を途中の vec3, mat3 を作らずに評価する (使う所だけ opt-in)
+// Lazy(a) で包んだ値から式を組み立てると、vec3<T>, mat3<T> に代入 (変換) されるときに成分ごとに 1 回だけ計算される
+//
+//	fmat3 I = s * (2.0f * d * Identity<float>() - 2.0f * TensorProduct(Lazy(r0), Lazy(r0)));
+//	Inertia += s * (...);
+//
+// 成分ごとの計算の順番は普通の演算子と同じなので、結果は bit 単位で一致する
+// 式は葉の参照を持つので、式を auto で変数に取っておくときは葉より長く生かさない (Lazy に一時変数を渡したときは値で持つ)
+// TensorProduct の引数が式のときは成分が 3 回ずつ計算されるので、葉か小さい式にする
+
+template <class E, class T>
+class Vec3Expr;
+template <class E, class T>
+class Mat3Expr;
+
+////////////////////
+// 要素ごとの演算
+
+struct ExprAdd {
+	template <class T>
+	static constexpr T apply(const T a, const T b)
+	{
+		return a + b;
+	}
+};
+struct ExprSub {
+	template <class T>
+	static constexpr T apply(const T a, const T b)
+	{
+		return a - b;
+	}
+};
+
+////////////////////
+// vec3 の式
+// 成分は at<i>() で取り出す (添字をコンパイル時に決めて、式全体が成分ごとの計算に展開されるようにする)
+
+template <class E, class T>
+class Vec3Expr {
+public:
+	using value_type = T;
+
+	constexpr const E& self() const
+	{
+		return static_cast<const E&>(*this);
+	}
+
+	constexpr vec3<T> eval() const
+	{
+		return vec3<T>(self().template at<0>(), self().template at<1>(), self().template at<2>());
+	}
+	constexpr operator vec3<T>() const
+	{
+		return eval();
+	}
+};
+
+template <class T>
+class Vec3Ref : public Vec3Expr<Vec3Ref<T>, T> {
+public:
+	const vec3<T>& v;
+
+	explicit constexpr Vec3Ref(const vec3<T>& v)
+	: v(v)
+	{
+	}
+	template <uint32_t i>
+	constexpr T at() const
+	{
+		if constexpr (i == 0)
+			return v.x;
+		else if constexpr (i == 1)
+			return v.y;
+		else
+			return v.z;
+	}
+};
+
+template <class T>
+class Vec3Value : public Vec3Expr<Vec3Value<T>, T> {
+public:
+	vec3<T> v;
+
+	explicit constexpr Vec3Value(const vec3<T>& v)
+	: v(v)
+	{
+	}
+	template <uint32_t i>
+	constexpr T at() const
+	{
+		if constexpr (i == 0)
+			return v.x;
+		else if constexpr (i == 1)
+			return v.y;
+		else
+			return v.z;
+	}
+};
+
+template <class L, class R, class Op, class T>
+class Vec3Binary : public Vec3Expr<Vec3Binary<L, R, Op, T>, T> {
+public:
+	L l;
+	R r;
+
+	explicit constexpr Vec3Binary(const L& l, const R& r)
+	: l(l)
+	, r(r)
+	{
+	}
+	template <uint32_t i>
+	constexpr T at() const
+	{
+		return Op::apply(l.template at<i>(), r.template at<i>());
+	}
+};
+
+template <class E, class T>
+class Vec3Negate : public Vec3Expr<Vec3Negate<E, T>, T> {
+public:
+	E e;
+
+	explicit constexpr Vec3Negate(const E& e)
+	: e(e)
+	{
+	}
+	template <uint32_t i>
+	constexpr T at() const
+	{
+		return -e.template at<i>();
+	}
+};
+
+// s * e (isDivide なら e / s)
+template <class E, class T, bool isDivide>
+class Vec3Scale : public Vec3Expr<Vec3Scale<E, T, isDivide>, T> {
+public:
+	E e;
+	T s;
+
+	explicit constexpr Vec3Scale(const E& e, const T s)
+	: e(e)
+	, s(s)
+	{
+	}
+	template <uint32_t i>
+	constexpr T at() const
+	{
+		if constexpr (isDivide)
+			return e.template at<i>() / s;
+		else
+			return s * e.template at<i>();
+	}
+};
+
+////////////////////
+// mat3 の式 (成分は row major の 0 から 8)
+
+template <class E, class T>
+class Mat3Expr {
+public:
+	using value_type = T;
+
+	constexpr const E& self() const
+	{
+		return static_cast<const E&>(*this);
+	}
+
+	constexpr mat3<T> eval() const
+	{
+		const E& e = self();
+		return mat3<T>(
+			e.template at<0>(), e.template at<1>(), e.template at<2>(),
+			e.template at<3>(), e.template at<4>(), e.template at<5>(),
+			e.template at<6>(), e.template at<7>(), e.template at<8>());
+	}
+	constexpr operator mat3<T>() const
+	{
+		return eval();
+	}
+};
+
+template <class T>
+class Mat3Ref : public Mat3Expr<Mat3Ref<T>, T> {
+public:
+	const mat3<T>& m;
+
+	explicit constexpr Mat3Ref(const mat3<T>& m)
+	: m(m)
+	{
+	}
+	template <uint32_t i>
+	constexpr T at() const
+	{
+		return m.cmp[i];
+	}
+};
+
+template <class T>
+class Mat3Value : public Mat3Expr<Mat3Value<T>, T> {
+public:
+	mat3<T> m;
+
+	explicit constexpr Mat3Value(const mat3<T>& m)
+	: m(m)
+	{
+	}
+	template <uint32_t i>
+	constexpr T at() const
+	{
+		return m.cmp[i];
+	}
+};
+
+template <class T>
+class Mat3Identity : public Mat3Expr<Mat3Identity<T>, T> {
+public:
+	template <uint32_t i>
+	constexpr T at() const
+	{
+		return (i % 4 == 0) ? T(1.0) : T(0.0);
+	}
+};
+
+template <class L, class R, class Op, class T>
+class Mat3Binary : public Mat3Expr<Mat3Binary<L, R, Op, T>, T> {
+public:
+	L l;
+	R r;
+
+	explicit constexpr Mat3Binary(const L& l, const R& r)
+	: l(l)
+	, r(r)
+	{
+	}
+	template <uint32_t i>
+	constexpr T at() const
+	{
+		return Op::apply(l.template at<i>(), r.template at<i>());
+	}
+};
+
+template <class E, class T>
+class Mat3Negate : public Mat3Expr<Mat3Negate<E, T>, T> {
+public:
+	E e;
+
+	explicit constexpr Mat3Negate(const E& e)
+	: e(e)
+	{
+	}
+	template <uint32_t i>
+	constexpr T at() const
+	{
+		return -e.template at<i>();
+	}
+};
+
+template <class E, class T, bool isDivide>
+class Mat3Scale : public Mat3Expr<Mat3Scale<E, T, isDivide>, T> {
+public:
+	E e;
+	T s;
+
+	explicit constexpr Mat3Scale(const E& e, const T s)
+	: e(e)
+	, s(s)
+	{
+	}
+	template <uint32_t i>
+	constexpr T at() const
+	{
+		if constexpr (isDivide)
+			return e.template at<i>() / s;
+		else
+			return s * e.template at<i>();
+	}
+};
+
+// l r^T
+template <class L, class R, class T>
+class Mat3Tensor : public Mat3Expr<Mat3Tensor<L, R, T>, T> {
+public:
+	L l;
+	R r;
+
+	explicit constexpr Mat3Tensor(const L& l, const R& r)
+	: l(l)
+	, r(r)
+	{
+	}
+	template <uint32_t i>
+	constexpr T at() const
+	{
+		return l.template at<i / 3>() * r.template at<i % 3>();
+	}
+};
+
+////////////////////
+// 式の始まり
+
+template <class T>
+constexpr Vec3Ref<T> Lazy(const vec3<T>& v)
+{
+	return Vec3Ref<T>(v);
+}
+template <class T>
+constexpr Vec3Value<T> Lazy(vec3<T>&& v)
+{
+	return Vec3Value<T>(v);
+}
+template <class T>
+constexpr Mat3Ref<T> Lazy(const mat3<T>& m)
+{
+	return Mat3Ref<T>(m);
+}
+template <class T>
+constexpr Mat3Value<T> Lazy(mat3<T>&& m)
+{
+	return Mat3Value<T>(m);
+}
+template <class T>
+constexpr Mat3Identity<T> Identity()
+{
+	return Mat3Identity<T>();
+}
+
+////////////////////
+// vec3 の式の演算子
+
+template <class L, class R, class T>
+constexpr Vec3Binary<L, R, ExprAdd, T> operator+(const Vec3Expr<L, T>& l, const Vec3Expr<R, T>& r)
+{
+	return Vec3Binary<L, R, ExprAdd, T>(l.self(), r.self());
+}
+template <class L, class R, class T>
+constexpr Vec3Binary<L, R, ExprSub, T> operator-(const Vec3Expr<L, T>& l, const Vec3Expr<R, T>& r)
+{
+	return Vec3Binary<L, R, ExprSub, T>(l.self(), r.self());
+}
+template <class E, class T>
+constexpr Vec3Negate<E, T> operator-(const Vec3Expr<E, T>& e)
+{
+	return Vec3Negate<E, T>(e.self());
+}
+template <class E, class T>
+constexpr Vec3Scale<E, T, false> operator*(const T s, const Vec3Expr<E, T>& e)
+{
+	return Vec3Scale<E, T, false>(e.self(), s);
+}
+template <class E, class T>
+constexpr Vec3Scale<E, T, false> operator*(const Vec3Expr<E, T>& e, const T s)
+{
+	return Vec3Scale<E, T, false>(e.self(), s);
+}
+template <class E, class T>
+constexpr Vec3Scale<E, T, true> operator/(const Vec3Expr<E, T>& e, const T s)
+{
+	return Vec3Scale<E, T, true>(e.self(), s);
+}
+
+template <class L, class R, class T>
+constexpr T Dot(const Vec3Expr<L, T>& l, const Vec3Expr<R, T>& r)
+{
+	return l.self().template at<0>() * r.self().template at<0>() + l.self().template at<1>() * r.self().template at<1>() + l.self().template at<2>() * r.self().template at<2>();
+}
+template <class L, class R, class T>
+constexpr Mat3Tensor<L, R, T> TensorProduct(const Vec3Expr<L, T>& l, const Vec3Expr<R, T>& r)
+{
+	return Mat3Tensor<L, R, T>(l.self(), r.self());
+}
+
+template <class E, class T>
+constexpr vec3<T>& operator+=(vec3<T>& v, const Vec3Expr<E, T>& e)
+{
+	const vec3<T> add = e.eval();
+	v.x += add.x;
+	v.y += add.y;
+	v.z += add.z;
+	return v;
+}
+template <class E, class T>
+constexpr vec3<T>& operator-=(vec3<T>& v, const Vec3Expr<E, T>& e)
+{
+	const vec3<T> sub = e.eval();
+	v.x -= sub.x;
+	v.y -= sub.y;
+	v.z -= sub.z;
+	return v;
+}
+
+////////////////////
+// mat3 の式の演算子
+
+template <class L, class R, class T>
+constexpr Mat3Binary<L, R, ExprAdd, T> operator+(const Mat3Expr<L, T>& l, const Mat3Expr<R, T>& r)
+{
+	return Mat3Binary<L, R, ExprAdd, T>(l.self(), r.self());
+}
+template <class L, class R, class T>
+constexpr Mat3Binary<L, R, ExprSub, T> operator-(const Mat3Expr<L, T>& l, const Mat3Expr<R, T>& r)
+{
+	return Mat3Binary<L, R, ExprSub, T>(l.self(), r.self());
+}
+template <class E, class T>
+constexpr Mat3Negate<E, T> operator-(const Mat3Expr<E, T>& e)
+{
+	return Mat3Negate<E, T>(e.self());
+}
+template <class E, class T>
+constexpr Mat3Scale<E, T, false> operator*(const T s, const Mat3Expr<E, T>& e)
+{
+	return Mat3Scale<E, T, false>(e.self(), s);
+}
+template <class E, class T>
+constexpr Mat3Scale<E, T, false> operator*(const Mat3Expr<E, T>& e, const T s)
+{
+	return Mat3Scale<E, T, false>(e.self(), s);
+}
+template <class E, class T>
+constexpr Mat3Scale<E, T, true> operator/(const Mat3Expr<E, T>& e, const T s)
+{
+	return Mat3Scale<E, T, true>(e.self(), s);
+}
+
+// 右辺を全て計算してから足す (右辺が左辺の行列を参照していてもよい)
+template <class E, class T>
+constexpr mat3<T>& operator+=(mat3<T>& m, const Mat3Expr<E, T>& e)
+{
+	const mat3<T> add = e.eval();
+	for (uint32_t i = 0; i < 9; i++)
+		m.cmp[i] += add.cmp[i];
+	return m;
+}
+template <class E, class T>
+constexpr mat3<T>& operator-=(mat3<T>& m, const Mat3Expr<E, T>& e)
+{
+	const mat3<T> sub = e.eval();
+	for (uint32_t i = 0; i < 9; i++)
+		m.cmp[i] -= sub.cmp[i];
+	return m;
+}
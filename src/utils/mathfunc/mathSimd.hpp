@@ -0,0 +1,790 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+// mathfunc.hpp の float 版 (fvec4, fquaternion, fmat3, fmat4) の SIMD の kernel
+// SSE (x86-64 では常に使える), AVX (-mavx 以上) と AArch64 の NEON を SimdFloat4 を通して使う
+// kernel は scalar 版と同じ順序で同じ演算をするので結果は bit 単位で一致する (lane ごとの積和の順序を変えない)
+// ただし積和が FMA に縮約されると一致しなくなるので、比べるときは -ffp-contract=off で build する
+//
+// mathfunc.hpp は MATHFUNC_SIMD が定義されているときだけ kernel を使う
+// 使うのは 4 成分がそろっている fvec4::normalized, fquaternion の積, fmat4 と行列・ベクトルの積, 転置と逆行列だけ
+// (fvec4::dot は足す順序を変えられないので速くならない。fmat3, fvec3 は 1 行 12 byte で、compiler が scalar 版から作るコードの方が速い
+//  SimdVec3Cross, SimdMat3Inverse, SimdMat4AffineInverse (3x3 の逆行列が中心) も同じ理由で kernel だけを置いてある)
+// MATHFUNC_SCALAR を定義してから include すると、SIMD の使える環境でも scalar 版のままになる (kernel 自体は使える)
+// 末尾の SimdFloat8 は mathSoA.hpp の 8 lane の型が使う
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MATHFUNC_SIMD_SSE
+#include <immintrin.h>
+#if defined(__AVX__)
+#define MATHFUNC_SIMD_AVX
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define MATHFUNC_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+#if (defined(MATHFUNC_SIMD_SSE) || defined(MATHFUNC_SIMD_NEON)) && !defined(MATHFUNC_SCALAR)
+#define MATHFUNC_SIMD
+#endif
+
+#if defined(MATHFUNC_SIMD_SSE) || defined(MATHFUNC_SIMD_NEON)
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// 4 lane の float
+
+#if defined(MATHFUNC_SIMD_SSE)
+
+using SimdFloat4 = __m128;
+
+inline SimdFloat4 SimdLoad4(const float* const p)
+{
+	return _mm_loadu_ps(p);
+}
+// w は 0 (p[3] は読まない)
+// 2 成分は __m64 で読み書きする (double* 経由だと float の配列と別名にならず、最適化で順序が崩れる)
+inline SimdFloat4 SimdLoad3(const float* const p)
+{
+	return _mm_movelh_ps(_mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(p)), _mm_load_ss(p + 2));
+}
+inline void SimdStore4(float* const p, const SimdFloat4 v)
+{
+	_mm_storeu_ps(p, v);
+}
+// p[3] には書かない
+inline void SimdStore3(float* const p, const SimdFloat4 v)
+{
+	_mm_storel_pi(reinterpret_cast<__m64*>(p), v);
+	_mm_store_ss(p + 2, _mm_movehl_ps(v, v));
+}
+inline SimdFloat4 SimdSet(const float x, const float y, const float z, const float w)
+{
+	return _mm_setr_ps(x, y, z, w);
+}
+inline SimdFloat4 SimdSplat(const float s)
+{
+	return _mm_set1_ps(s);
+}
+inline SimdFloat4 SimdAdd(const SimdFloat4 a, const SimdFloat4 b)
+{
+	return _mm_add_ps(a, b);
+}
+inline SimdFloat4 SimdSub(const SimdFloat4 a, const SimdFloat4 b)
+{
+	return _mm_sub_ps(a, b);
+}
+inline SimdFloat4 SimdMul(const SimdFloat4 a, const SimdFloat4 b)
+{
+	return _mm_mul_ps(a, b);
+}
+inline SimdFloat4 SimdDiv(const SimdFloat4 a, const SimdFloat4 b)
+{
+	return _mm_div_ps(a, b);
+}
+// mask の lane が -0.0f なら符号を反転する (scalar の単項 - と同じ)
+inline SimdFloat4 SimdXor(const SimdFloat4 a, const SimdFloat4 mask)
+{
+	return _mm_xor_ps(a, mask);
+}
+inline SimdFloat4 SimdSqrt(const SimdFloat4 a)
+{
+	return _mm_sqrt_ps(a);
+}
+// 1 / sqrt(a) の近似 (相対誤差 1.5 * 2^-12 以下)
+inline SimdFloat4 SimdRsqrt(const SimdFloat4 a)
+{
+	return _mm_rsqrt_ps(a);
+}
+// a < b の lane は全 bit 1
+inline SimdFloat4 SimdLess(const SimdFloat4 a, const SimdFloat4 b)
+{
+	return _mm_cmplt_ps(a, b);
+}
+// mask の lane が全 bit 1 なら a, 0 なら b
+inline SimdFloat4 SimdSelect(const SimdFloat4 mask, const SimdFloat4 a, const SimdFloat4 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+template <uint32_t i0, uint32_t i1, uint32_t i2, uint32_t i3>
+inline SimdFloat4 SimdShuffle(const SimdFloat4 v)
+{
+	return _mm_shuffle_ps(v, v, _MM_SHUFFLE(i3, i2, i1, i0));
+}
+// (a[i0], a[i1], b[i2], b[i3])
+template <uint32_t i0, uint32_t i1, uint32_t i2, uint32_t i3>
+inline SimdFloat4 SimdShuffle(const SimdFloat4 a, const SimdFloat4 b)
+{
+	return _mm_shuffle_ps(a, b, _MM_SHUFFLE(i3, i2, i1, i0));
+}
+template <uint32_t i>
+inline float SimdLane(const SimdFloat4 v)
+{
+	return _mm_cvtss_f32(SimdShuffle<i, i, i, i>(v));
+}
+inline void SimdTranspose(SimdFloat4& r0, SimdFloat4& r1, SimdFloat4& r2, SimdFloat4& r3)
+{
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+}
+
+#elif defined(MATHFUNC_SIMD_NEON)
+
+using SimdFloat4 = float32x4_t;
+
+inline SimdFloat4 SimdLoad4(const float* const p)
+{
+	return vld1q_f32(p);
+}
+inline SimdFloat4 SimdLoad3(const float* const p)
+{
+	return vcombine_f32(vld1_f32(p), vld1_lane_f32(p + 2, vdup_n_f32(0.0f), 0));
+}
+inline void SimdStore4(float* const p, const SimdFloat4 v)
+{
+	vst1q_f32(p, v);
+}
+inline void SimdStore3(float* const p, const SimdFloat4 v)
+{
+	vst1_f32(p, vget_low_f32(v));
+	vst1q_lane_f32(p + 2, v, 2);
+}
+inline SimdFloat4 SimdSet(const float x, const float y, const float z, const float w)
+{
+	const float array[4] = { x, y, z, w };
+	return vld1q_f32(array);
+}
+inline SimdFloat4 SimdSplat(const float s)
+{
+	return vdupq_n_f32(s);
+}
+inline SimdFloat4 SimdAdd(const SimdFloat4 a, const SimdFloat4 b)
+{
+	return vaddq_f32(a, b);
+}
+inline SimdFloat4 SimdSub(const SimdFloat4 a, const SimdFloat4 b)
+{
+	return vsubq_f32(a, b);
+}
+inline SimdFloat4 SimdMul(const SimdFloat4 a, const SimdFloat4 b)
+{
+	return vmulq_f32(a, b);
+}
+inline SimdFloat4 SimdDiv(const SimdFloat4 a, const SimdFloat4 b)
+{
+	return vdivq_f32(a, b);
+}
+inline SimdFloat4 SimdXor(const SimdFloat4 a, const SimdFloat4 mask)
+{
+	return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(mask)));
+}
+inline SimdFloat4 SimdSqrt(const SimdFloat4 a)
+{
+	return vsqrtq_f32(a);
+}
+// vrsqrte の推定値 (8 bit 程度) を 1 回改良して SSE と同じくらいにする
+inline SimdFloat4 SimdRsqrt(const SimdFloat4 a)
+{
+	const SimdFloat4 e = vrsqrteq_f32(a);
+	return vmulq_f32(e, vrsqrtsq_f32(vmulq_f32(a, e), e));
+}
+inline SimdFloat4 SimdLess(const SimdFloat4 a, const SimdFloat4 b)
+{
+	return vreinterpretq_f32_u32(vcltq_f32(a, b));
+}
+inline SimdFloat4 SimdSelect(const SimdFloat4 mask, const SimdFloat4 a, const SimdFloat4 b)
+{
+	return vbslq_f32(vreinterpretq_u32_f32(mask), a, b);
+}
+template <uint32_t i0, uint32_t i1, uint32_t i2, uint32_t i3>
+inline SimdFloat4 SimdShuffle(const SimdFloat4 v)
+{
+	SimdFloat4 r = vdupq_laneq_f32(v, i0);
+	r = vsetq_lane_f32(vgetq_lane_f32(v, i1), r, 1);
+	r = vsetq_lane_f32(vgetq_lane_f32(v, i2), r, 2);
+	r = vsetq_lane_f32(vgetq_lane_f32(v, i3), r, 3);
+	return r;
+}
+template <uint32_t i0, uint32_t i1, uint32_t i2, uint32_t i3>
+inline SimdFloat4 SimdShuffle(const SimdFloat4 a, const SimdFloat4 b)
+{
+	SimdFloat4 r = vdupq_laneq_f32(a, i0);
+	r = vsetq_lane_f32(vgetq_lane_f32(a, i1), r, 1);
+	r = vsetq_lane_f32(vgetq_lane_f32(b, i2), r, 2);
+	r = vsetq_lane_f32(vgetq_lane_f32(b, i3), r, 3);
+	return r;
+}
+template <uint32_t i>
+inline float SimdLane(const SimdFloat4 v)
+{
+	return vgetq_lane_f32(v, i);
+}
+inline void SimdTranspose(SimdFloat4& r0, SimdFloat4& r1, SimdFloat4& r2, SimdFloat4& r3)
+{
+	const SimdFloat4 t0 = vzip1q_f32(r0, r2);
+	const SimdFloat4 t1 = vzip1q_f32(r1, r3);
+	const SimdFloat4 t2 = vzip2q_f32(r0, r2);
+	const SimdFloat4 t3 = vzip2q_f32(r1, r3);
+	r0 = vzip1q_f32(t0, t1);
+	r1 = vzip2q_f32(t0, t1);
+	r2 = vzip1q_f32(t2, t3);
+	r3 = vzip2q_f32(t2, t3);
+}
+
+#endif
+
+// mat3 の 3 行 (各 lane 0-2) を 16 byte x 2 と 4 byte で書く
+// 行ごとに重なるように書くと、直後に読むときに store forwarding が効かず遅くなる
+inline void SimdStoreMat3(float* const p, const SimdFloat4 r0, const SimdFloat4 r1, const SimdFloat4 r2)
+{
+	SimdStore4(p + 0, SimdShuffle<0, 1, 0, 2>(r0, SimdShuffle<2, 2, 0, 0>(r0, r1)));
+	SimdStore4(p + 4, SimdShuffle<1, 2, 0, 1>(r1, r2));
+	p[8] = SimdLane<2>(r2);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// kernel
+// 引数は mathfunc.hpp の cmp (vec4 は x y z w, quaternion は x y z w (w が実部), 行列は row major)
+
+// ((x + y) + z) + w の順で足す
+inline float SimdVec4Dot(const float* const a, const float* const b)
+{
+	const SimdFloat4 m = SimdMul(SimdLoad4(a), SimdLoad4(b));
+	return ((SimdLane<0>(m) + SimdLane<1>(m)) + SimdLane<2>(m)) + SimdLane<3>(m);
+}
+
+// vec4::normalized と同じく、長さが小さいものは 0 にする
+inline void SimdVec4Normalized(const float* const a, float* const out)
+{
+	const float t = SimdVec4Dot(a, a);
+	const float norm = (t < 0.0000001) ? 0.0f : std::sqrt(t);
+	if (norm < 0.0000001)
+		SimdStore4(out, SimdSplat(0.0f));
+	else
+		SimdStore4(out, SimdDiv(SimdLoad4(a), SimdSplat(norm)));
+}
+
+// (s0 s1 - v0.v1, s0 v1 + s1 v0 + v0 x v1)
+inline void SimdQuaternionMul(const float* const a, const float* const b, float* const out)
+{
+	const SimdFloat4 qa = SimdLoad4(a);
+	const SimdFloat4 qb = SimdLoad4(b);
+	const float s0 = a[3];
+	const float s1 = b[3];
+
+	const SimdFloat4 cross0 = SimdMul(SimdShuffle<1, 2, 0, 3>(qa), SimdShuffle<2, 0, 1, 3>(qb));
+	const SimdFloat4 cross1 = SimdMul(SimdShuffle<2, 0, 1, 3>(qa), SimdShuffle<1, 2, 0, 3>(qb));
+	const SimdFloat4 cross = SimdSub(cross0, cross1);
+	const SimdFloat4 v = SimdAdd(SimdAdd(SimdMul(SimdSplat(s0), qb), SimdMul(SimdSplat(s1), qa)), cross);
+
+	const SimdFloat4 m = SimdMul(qa, qb);
+	const float s = s0 * s1 - ((SimdLane<0>(m) + SimdLane<1>(m)) + SimdLane<2>(m));
+
+	SimdStore3(out, v);
+	out[3] = s;
+}
+
+// (y z' - z y', z x' - x z', x y' - y x')
+inline void SimdVec3Cross(const float* const a, const float* const b, float* const out)
+{
+	const SimdFloat4 va = SimdLoad3(a);
+	const SimdFloat4 vb = SimdLoad3(b);
+	const SimdFloat4 cross0 = SimdMul(SimdShuffle<1, 2, 0, 3>(va), SimdShuffle<2, 0, 1, 3>(vb));
+	const SimdFloat4 cross1 = SimdMul(SimdShuffle<2, 0, 1, 3>(va), SimdShuffle<1, 2, 0, 3>(vb));
+	SimdStore3(out, SimdSub(cross0, cross1));
+}
+
+// 結果の i 行目 = ((a(i,0) b の 0 行目 + a(i,1) b の 1 行目) + a(i,2) b の 2 行目)
+inline void SimdMat3Mul(const float* const a, const float* const b, float* const out)
+{
+	// 0, 1 行目は 4 成分で読む (4 つ目は次の行の先頭で、使わない)
+	const SimdFloat4 b0 = SimdLoad4(b + 0);
+	const SimdFloat4 b1 = SimdLoad4(b + 3);
+	const SimdFloat4 b2 = SimdLoad3(b + 6);
+	SimdFloat4 r[3];
+	for (uint32_t i = 0; i < 3; i++) {
+		r[i] = SimdMul(SimdSplat(a[3 * i + 0]), b0);
+		r[i] = SimdAdd(r[i], SimdMul(SimdSplat(a[3 * i + 1]), b1));
+		r[i] = SimdAdd(r[i], SimdMul(SimdSplat(a[3 * i + 2]), b2));
+	}
+	SimdStoreMat3(out, r[0], r[1], r[2]);
+}
+
+// 転置して列ごとに掛けて足す
+inline void SimdMat3MulVec3(const float* const a, const float* const v, float* const out)
+{
+	SimdFloat4 c0 = SimdLoad4(a + 0);
+	SimdFloat4 c1 = SimdLoad4(a + 3);
+	SimdFloat4 c2 = SimdLoad3(a + 6);
+	SimdFloat4 c3 = SimdSplat(0.0f);
+	SimdTranspose(c0, c1, c2, c3);
+
+	SimdFloat4 r = SimdMul(c0, SimdSplat(v[0]));
+	r = SimdAdd(r, SimdMul(c1, SimdSplat(v[1])));
+	r = SimdAdd(r, SimdMul(c2, SimdSplat(v[2])));
+	SimdStore3(out, r);
+}
+
+inline void SimdMat3Transpose(const float* const a, float* const out)
+{
+	SimdFloat4 r0 = SimdLoad4(a + 0);
+	SimdFloat4 r1 = SimdLoad4(a + 3);
+	SimdFloat4 r2 = SimdLoad3(a + 6);
+	SimdFloat4 r3 = SimdSplat(0.0f);
+	SimdTranspose(r0, r1, r2, r3);
+	SimdStoreMat3(out, r0, r1, r2);
+}
+
+// adjugate / determinant
+// 行列式は mat3::determinant と同じ式で求める (余因子と共有すると 0 の符号が変わることがある)
+inline void SimdMat3Inverse(const float* const c, float* const out)
+{
+	const float det = c[2] * (c[3] * c[7] - c[6] * c[4]) + c[5] * (c[6] * c[1] - c[0] * c[7]) + c[8] * (c[0] * c[4] - c[3] * c[1]);
+
+	const SimdFloat4 sign = SimdSet(0.0f, -0.0f, 0.0f, -0.0f);
+	const SimdFloat4 p0 = SimdMul(SimdSet(c[4], c[1], c[1], c[3]), SimdSet(c[8], c[8], c[5], c[8]));
+	const SimdFloat4 q0 = SimdMul(SimdSet(c[5], c[2], c[2], c[6]), SimdSet(c[7], c[7], c[4], c[5]));
+	const SimdFloat4 p4 = SimdMul(SimdSet(c[0], c[0], c[3], c[0]), SimdSet(c[8], c[5], c[7], c[7]));
+	const SimdFloat4 q4 = SimdMul(SimdSet(c[2], c[2], c[4], c[1]), SimdSet(c[6], c[3], c[6], c[6]));
+	const SimdFloat4 adj0 = SimdXor(SimdSub(p0, q0), sign);
+	const SimdFloat4 adj4 = SimdXor(SimdSub(p4, q4), sign);
+	const float adj8 = c[0] * c[4] - c[1] * c[3];
+
+	const SimdFloat4 d = SimdSplat(det);
+	SimdStore4(out + 0, SimdDiv(adj0, d));
+	SimdStore4(out + 4, SimdDiv(adj4, d));
+	out[8] = adj8 / det;
+}
+
+// 結果の i 行目 = a(i,0) b の 0 行目 + ... + a(i,3) b の 3 行目 (左から順に足す)
+// AVX があれば 2 行ずつ計算する
+inline void SimdMat4Mul(const float* const a, const float* const b, float* const out)
+{
+#if defined(MATHFUNC_SIMD_AVX)
+	const __m256 b0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b + 0));
+	const __m256 b1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b + 4));
+	const __m256 b2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b + 8));
+	const __m256 b3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b + 12));
+	for (uint32_t i = 0; i < 4; i += 2) {
+		const __m256 rows = _mm256_loadu_ps(a + 4 * i);
+		__m256 r = _mm256_mul_ps(_mm256_permute_ps(rows, 0x00), b0);
+		r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_permute_ps(rows, 0x55), b1));
+		r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_permute_ps(rows, 0xaa), b2));
+		r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_permute_ps(rows, 0xff), b3));
+		_mm256_storeu_ps(out + 4 * i, r);
+	}
+#else
+	const SimdFloat4 b0 = SimdLoad4(b + 0);
+	const SimdFloat4 b1 = SimdLoad4(b + 4);
+	const SimdFloat4 b2 = SimdLoad4(b + 8);
+	const SimdFloat4 b3 = SimdLoad4(b + 12);
+	for (uint32_t i = 0; i < 4; i++) {
+		const SimdFloat4 row = SimdLoad4(a + 4 * i);
+		SimdFloat4 r = SimdMul(SimdShuffle<0, 0, 0, 0>(row), b0);
+		r = SimdAdd(r, SimdMul(SimdShuffle<1, 1, 1, 1>(row), b1));
+		r = SimdAdd(r, SimdMul(SimdShuffle<2, 2, 2, 2>(row), b2));
+		r = SimdAdd(r, SimdMul(SimdShuffle<3, 3, 3, 3>(row), b3));
+		SimdStore4(out + 4 * i, r);
+	}
+#endif
+}
+
+inline void SimdMat4MulVec4(const float* const a, const float* const v, float* const out)
+{
+	SimdFloat4 c0 = SimdLoad4(a + 0);
+	SimdFloat4 c1 = SimdLoad4(a + 4);
+	SimdFloat4 c2 = SimdLoad4(a + 8);
+	SimdFloat4 c3 = SimdLoad4(a + 12);
+	SimdTranspose(c0, c1, c2, c3);
+
+	SimdFloat4 r = SimdMul(c0, SimdSplat(v[0]));
+	r = SimdAdd(r, SimdMul(c1, SimdSplat(v[1])));
+	r = SimdAdd(r, SimdMul(c2, SimdSplat(v[2])));
+	r = SimdAdd(r, SimdMul(c3, SimdSplat(v[3])));
+	SimdStore4(out, r);
+}
+
+inline void SimdMat4Transpose(const float* const a, float* const out)
+{
+	SimdFloat4 r0 = SimdLoad4(a + 0);
+	SimdFloat4 r1 = SimdLoad4(a + 4);
+	SimdFloat4 r2 = SimdLoad4(a + 8);
+	SimdFloat4 r3 = SimdLoad4(a + 12);
+	SimdTranspose(r0, r1, r2, r3);
+	SimdStore4(out + 0, r0);
+	SimdStore4(out + 4, r1);
+	SimdStore4(out + 8, r2);
+	SimdStore4(out + 12, r3);
+}
+
+// adjugate / determinant (mat4::adjugate, mat4::determinant と同じ式)
+// 2x2 の小行列式 s (上 2 行), c (下 2 行) を 4 lane ずつ作り、余因子を 1 行 4 lane で求める
+// 余因子の 1 行 = ±((p1 x - p2 y) + p3 z) の形で、p は行を (1, 0, 3, 2) の順に並べて転置したもの
+inline void SimdMat4Inverse(const float* const a, float* const out)
+{
+	const SimdFloat4 r0 = SimdLoad4(a + 0);
+	const SimdFloat4 r1 = SimdLoad4(a + 4);
+	const SimdFloat4 r2 = SimdLoad4(a + 8);
+	const SimdFloat4 r3 = SimdLoad4(a + 12);
+
+	// (s0, s1, s2, s3), (c0, c1, c2, c3), (s4, s5, c4, c5)
+	const SimdFloat4 s = SimdSub(SimdMul(SimdShuffle<0, 0, 0, 1>(r0), SimdShuffle<1, 2, 3, 2>(r1)), SimdMul(SimdShuffle<0, 0, 0, 1>(r1), SimdShuffle<1, 2, 3, 2>(r0)));
+	const SimdFloat4 c = SimdSub(SimdMul(SimdShuffle<0, 0, 0, 1>(r2), SimdShuffle<1, 2, 3, 2>(r3)), SimdMul(SimdShuffle<0, 0, 0, 1>(r3), SimdShuffle<1, 2, 3, 2>(r2)));
+	const SimdFloat4 sc = SimdSub(SimdMul(SimdShuffle<1, 2, 1, 2>(r0, r2), SimdShuffle<3, 3, 3, 3>(r1, r3)), SimdMul(SimdShuffle<1, 2, 1, 2>(r1, r3), SimdShuffle<3, 3, 3, 3>(r0, r2)));
+
+	// s0 c5 - s1 c4 + s2 c3 + s3 c2 - s4 c1 + s5 c0
+	const SimdFloat4 d0 = SimdMul(s, SimdShuffle<3, 2, 3, 2>(sc, c));
+	const SimdFloat4 d1 = SimdMul(sc, SimdShuffle<1, 0, 1, 0>(c, c));
+	const float det = ((((SimdLane<0>(d0) - SimdLane<1>(d0)) + SimdLane<2>(d0)) + SimdLane<3>(d0)) - SimdLane<0>(d1)) + SimdLane<1>(d1);
+
+	SimdFloat4 p0 = r1;
+	SimdFloat4 p1 = r0;
+	SimdFloat4 p2 = r3;
+	SimdFloat4 p3 = r2;
+	SimdTranspose(p0, p1, p2, p3);
+
+	// 左 2 列は c, 右 2 列は s を使う
+	const SimdFloat4 k5 = SimdShuffle<3, 3, 1, 1>(sc);
+	const SimdFloat4 k4 = SimdShuffle<2, 2, 0, 0>(sc);
+	const SimdFloat4 k3 = SimdShuffle<3, 3, 3, 3>(c, s);
+	const SimdFloat4 k2 = SimdShuffle<2, 2, 2, 2>(c, s);
+	const SimdFloat4 k1 = SimdShuffle<1, 1, 1, 1>(c, s);
+	const SimdFloat4 k0 = SimdShuffle<0, 0, 0, 0>(c, s);
+
+	const SimdFloat4 sign0 = SimdSet(0.0f, -0.0f, 0.0f, -0.0f);
+	const SimdFloat4 sign1 = SimdSet(-0.0f, 0.0f, -0.0f, 0.0f);
+	const SimdFloat4 adj0 = SimdXor(SimdAdd(SimdSub(SimdMul(p1, k5), SimdMul(p2, k4)), SimdMul(p3, k3)), sign0);
+	const SimdFloat4 adj1 = SimdXor(SimdAdd(SimdSub(SimdMul(p0, k5), SimdMul(p2, k2)), SimdMul(p3, k1)), sign1);
+	const SimdFloat4 adj2 = SimdXor(SimdAdd(SimdSub(SimdMul(p0, k4), SimdMul(p1, k2)), SimdMul(p3, k0)), sign0);
+	const SimdFloat4 adj3 = SimdXor(SimdAdd(SimdSub(SimdMul(p0, k3), SimdMul(p1, k1)), SimdMul(p2, k0)), sign1);
+
+	const SimdFloat4 d = SimdSplat(det);
+	SimdStore4(out + 0, SimdDiv(adj0, d));
+	SimdStore4(out + 4, SimdDiv(adj1, d));
+	SimdStore4(out + 8, SimdDiv(adj2, d));
+	SimdStore4(out + 12, SimdDiv(adj3, d));
+}
+
+// mat4::affineinverse と同じく、左上 3x3 の逆行列 L^-1 と -(L^-1 t) を並べる
+// L^-1 の行は SimdMat3Inverse と同じ式で作り、転置した列で L^-1 t を求めてからもう一度転置して t の列を足す
+inline void SimdMat4AffineInverse(const float* const a, float* const out)
+{
+	const float det = a[2] * (a[4] * a[9] - a[8] * a[5]) + a[6] * (a[8] * a[1] - a[0] * a[9]) + a[10] * (a[0] * a[5] - a[4] * a[1]);
+
+	const SimdFloat4 sign0 = SimdSet(0.0f, -0.0f, 0.0f, 0.0f);
+	const SimdFloat4 sign1 = SimdSet(-0.0f, 0.0f, -0.0f, 0.0f);
+	const SimdFloat4 adj0 = SimdXor(SimdSub(SimdMul(SimdSet(a[5], a[1], a[1], 0.0f), SimdSet(a[10], a[10], a[6], 0.0f)), SimdMul(SimdSet(a[6], a[2], a[2], 0.0f), SimdSet(a[9], a[9], a[5], 0.0f))), sign0);
+	const SimdFloat4 adj1 = SimdXor(SimdSub(SimdMul(SimdSet(a[4], a[0], a[0], 0.0f), SimdSet(a[10], a[10], a[6], 0.0f)), SimdMul(SimdSet(a[8], a[2], a[2], 0.0f), SimdSet(a[6], a[8], a[4], 0.0f))), sign1);
+	const SimdFloat4 adj2 = SimdXor(SimdSub(SimdMul(SimdSet(a[4], a[0], a[0], 0.0f), SimdSet(a[9], a[9], a[5], 0.0f)), SimdMul(SimdSet(a[5], a[1], a[1], 0.0f), SimdSet(a[8], a[8], a[4], 0.0f))), sign0);
+
+	const SimdFloat4 d = SimdSplat(det);
+	SimdFloat4 x0 = SimdDiv(adj0, d);
+	SimdFloat4 x1 = SimdDiv(adj1, d);
+	SimdFloat4 x2 = SimdDiv(adj2, d);
+	SimdFloat4 x3 = SimdSplat(0.0f);
+	SimdTranspose(x0, x1, x2, x3);
+
+	const SimdFloat4 t = SimdAdd(SimdAdd(SimdMul(x0, SimdSplat(a[3])), SimdMul(x1, SimdSplat(a[7]))), SimdMul(x2, SimdSplat(a[11])));
+	x3 = SimdXor(t, SimdSplat(-0.0f));
+	SimdTranspose(x0, x1, x2, x3);
+
+	SimdStore4(out + 0, x0);
+	SimdStore4(out + 4, x1);
+	SimdStore4(out + 8, x2);
+	SimdStore4(out + 12, SimdSet(0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// 8 lane の float (mathSoA.hpp の floatx8, fvec3x8, fmat3x8 の 1 成分)
+// AVX なら __m256 1 本, SSE と NEON では SimdFloat4 2 本, どちらもなければ float 8 個の配列
+// lane ごとの演算しかないので、MATHFUNC_SCALAR に関係なく使える SIMD を使う
+
+#if defined(MATHFUNC_SIMD_AVX)
+
+using SimdFloat8 = __m256;
+
+inline SimdFloat8 SimdLoad8(const float* const p)
+{
+	return _mm256_loadu_ps(p);
+}
+inline void SimdStore8(float* const p, const SimdFloat8 v)
+{
+	_mm256_storeu_ps(p, v);
+}
+// 散らばった値から直接組み立てる (配列に 1 個ずつ書いてから読むと store forwarding が効かない)
+inline SimdFloat8 SimdSet8(const float s0, const float s1, const float s2, const float s3, const float s4, const float s5, const float s6, const float s7)
+{
+	return _mm256_setr_ps(s0, s1, s2, s3, s4, s5, s6, s7);
+}
+inline SimdFloat8 SimdSplat8(const float s)
+{
+	return _mm256_set1_ps(s);
+}
+inline SimdFloat8 SimdAdd8(const SimdFloat8 a, const SimdFloat8 b)
+{
+	return _mm256_add_ps(a, b);
+}
+inline SimdFloat8 SimdSub8(const SimdFloat8 a, const SimdFloat8 b)
+{
+	return _mm256_sub_ps(a, b);
+}
+inline SimdFloat8 SimdMul8(const SimdFloat8 a, const SimdFloat8 b)
+{
+	return _mm256_mul_ps(a, b);
+}
+inline SimdFloat8 SimdDiv8(const SimdFloat8 a, const SimdFloat8 b)
+{
+	return _mm256_div_ps(a, b);
+}
+inline SimdFloat8 SimdSqrt8(const SimdFloat8 a)
+{
+	return _mm256_sqrt_ps(a);
+}
+// 1 / sqrt(a) の近似 (相対誤差 1.5 * 2^-12 以下)
+inline SimdFloat8 SimdRsqrt8(const SimdFloat8 a)
+{
+	return _mm256_rsqrt_ps(a);
+}
+inline SimdFloat8 SimdNeg8(const SimdFloat8 a)
+{
+	return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f));
+}
+inline SimdFloat8 SimdLess8(const SimdFloat8 a, const SimdFloat8 b)
+{
+	return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+}
+inline SimdFloat8 SimdSelect8(const SimdFloat8 mask, const SimdFloat8 a, const SimdFloat8 b)
+{
+	return _mm256_blendv_ps(b, a, mask);
+}
+// 128 bit の lane ごとに 4x4 の転置をする (SimdTranspose を 2 つ同時に)
+inline void SimdTranspose8(SimdFloat8& r0, SimdFloat8& r1, SimdFloat8& r2, SimdFloat8& r3)
+{
+	const SimdFloat8 t0 = _mm256_unpacklo_ps(r0, r1);
+	const SimdFloat8 t1 = _mm256_unpackhi_ps(r0, r1);
+	const SimdFloat8 t2 = _mm256_unpacklo_ps(r2, r3);
+	const SimdFloat8 t3 = _mm256_unpackhi_ps(r2, r3);
+	r0		    = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+	r1		    = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+	r2		    = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+	r3		    = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+// a, b, c, d の lane l を p + stride * l からの 4 成分に書く (SoA から AoS への転置, count 以降の lane は書かない)
+// 要素 l と l + 4 を 1 本の __m256 にまとめて、転置を 128 bit の lane の中で済ませる
+inline void SimdStoreTransposed8(float* const p, const uint32_t stride, const SimdFloat8 a, const SimdFloat8 b, const SimdFloat8 c, const SimdFloat8 d, const uint32_t count)
+{
+	SimdFloat8 r[4] = { a, b, c, d };
+	SimdTranspose8(r[0], r[1], r[2], r[3]);
+	for (uint32_t l = 0; l < 4; l++) {
+		if (count >= 8 || l < count)
+			_mm_storeu_ps(p + stride * l, _mm256_castps256_ps128(r[l]));
+		if (count >= 8 || l + 4 < count)
+			_mm_storeu_ps(p + stride * (l + 4), _mm256_extractf128_ps(r[l], 1));
+	}
+}
+// p + stride * l からの 4 成分を a, b, c, d の lane l に読む (上の逆, count 以降の lane は 0)
+inline void SimdLoadTransposed8(const float* const p, const uint32_t stride, SimdFloat8& a, SimdFloat8& b, SimdFloat8& c, SimdFloat8& d, const uint32_t count)
+{
+	const float zero[4] = {};
+	SimdFloat8 r[4];
+	for (uint32_t l = 0; l < 4; l++) {
+		const float* const lo = (count >= 8 || l < count) ? p + stride * l : zero;
+		const float* const hi = (count >= 8 || l + 4 < count) ? p + stride * (l + 4) : zero;
+		r[l]		      = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(lo)), _mm_loadu_ps(hi), 1);
+	}
+	SimdTranspose8(r[0], r[1], r[2], r[3]);
+	a = r[0];
+	b = r[1];
+	c = r[2];
+	d = r[3];
+}
+
+#elif defined(MATHFUNC_SIMD_SSE) || defined(MATHFUNC_SIMD_NEON)
+
+struct SimdFloat8 {
+	SimdFloat4 lo, hi;
+};
+
+inline SimdFloat8 SimdLoad8(const float* const p)
+{
+	return { SimdLoad4(p), SimdLoad4(p + 4) };
+}
+inline void SimdStore8(float* const p, const SimdFloat8 v)
+{
+	SimdStore4(p, v.lo);
+	SimdStore4(p + 4, v.hi);
+}
+inline SimdFloat8 SimdSet8(const float s0, const float s1, const float s2, const float s3, const float s4, const float s5, const float s6, const float s7)
+{
+	return { SimdSet(s0, s1, s2, s3), SimdSet(s4, s5, s6, s7) };
+}
+inline SimdFloat8 SimdSplat8(const float s)
+{
+	return { SimdSplat(s), SimdSplat(s) };
+}
+inline SimdFloat8 SimdAdd8(const SimdFloat8 a, const SimdFloat8 b)
+{
+	return { SimdAdd(a.lo, b.lo), SimdAdd(a.hi, b.hi) };
+}
+inline SimdFloat8 SimdSub8(const SimdFloat8 a, const SimdFloat8 b)
+{
+	return { SimdSub(a.lo, b.lo), SimdSub(a.hi, b.hi) };
+}
+inline SimdFloat8 SimdMul8(const SimdFloat8 a, const SimdFloat8 b)
+{
+	return { SimdMul(a.lo, b.lo), SimdMul(a.hi, b.hi) };
+}
+inline SimdFloat8 SimdDiv8(const SimdFloat8 a, const SimdFloat8 b)
+{
+	return { SimdDiv(a.lo, b.lo), SimdDiv(a.hi, b.hi) };
+}
+inline SimdFloat8 SimdSqrt8(const SimdFloat8 a)
+{
+	return { SimdSqrt(a.lo), SimdSqrt(a.hi) };
+}
+inline SimdFloat8 SimdRsqrt8(const SimdFloat8 a)
+{
+	return { SimdRsqrt(a.lo), SimdRsqrt(a.hi) };
+}
+inline SimdFloat8 SimdNeg8(const SimdFloat8 a)
+{
+	return { SimdXor(a.lo, SimdSplat(-0.0f)), SimdXor(a.hi, SimdSplat(-0.0f)) };
+}
+inline SimdFloat8 SimdLess8(const SimdFloat8 a, const SimdFloat8 b)
+{
+	return { SimdLess(a.lo, b.lo), SimdLess(a.hi, b.hi) };
+}
+inline SimdFloat8 SimdSelect8(const SimdFloat8 mask, const SimdFloat8 a, const SimdFloat8 b)
+{
+	return { SimdSelect(mask.lo, a.lo, b.lo), SimdSelect(mask.hi, a.hi, b.hi) };
+}
+inline void SimdStoreTransposed8(float* const p, const uint32_t stride, const SimdFloat8 a, const SimdFloat8 b, const SimdFloat8 c, const SimdFloat8 d, const uint32_t count)
+{
+	SimdFloat4 r[8] = { a.lo, b.lo, c.lo, d.lo, a.hi, b.hi, c.hi, d.hi };
+	SimdTranspose(r[0], r[1], r[2], r[3]);
+	SimdTranspose(r[4], r[5], r[6], r[7]);
+	for (uint32_t l = 0; l < count && l < 8; l++)
+		SimdStore4(p + stride * l, r[l]);
+}
+inline void SimdLoadTransposed8(const float* const p, const uint32_t stride, SimdFloat8& a, SimdFloat8& b, SimdFloat8& c, SimdFloat8& d, const uint32_t count)
+{
+	SimdFloat4 r[8];
+	for (uint32_t l = 0; l < 8; l++)
+		r[l] = (count >= 8 || l < count) ? SimdLoad4(p + stride * l) : SimdSplat(0.0f);
+	SimdTranspose(r[0], r[1], r[2], r[3]);
+	SimdTranspose(r[4], r[5], r[6], r[7]);
+	a = { r[0], r[4] };
+	b = { r[1], r[5] };
+	c = { r[2], r[6] };
+	d = { r[3], r[7] };
+}
+
+#else
+
+struct SimdFloat8 {
+	float v[8];
+};
+
+inline SimdFloat8 SimdLoad8(const float* const p)
+{
+	return { { p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7] } };
+}
+inline void SimdStore8(float* const p, const SimdFloat8 v)
+{
+	for (uint32_t l = 0; l < 8; l++)
+		p[l] = v.v[l];
+}
+inline SimdFloat8 SimdSet8(const float s0, const float s1, const float s2, const float s3, const float s4, const float s5, const float s6, const float s7)
+{
+	return { { s0, s1, s2, s3, s4, s5, s6, s7 } };
+}
+inline SimdFloat8 SimdSplat8(const float s)
+{
+	return { { s, s, s, s, s, s, s, s } };
+}
+inline SimdFloat8 SimdAdd8(const SimdFloat8 a, const SimdFloat8 b)
+{
+	SimdFloat8 r;
+	for (uint32_t l = 0; l < 8; l++)
+		r.v[l] = a.v[l] + b.v[l];
+	return r;
+}
+inline SimdFloat8 SimdSub8(const SimdFloat8 a, const SimdFloat8 b)
+{
+	SimdFloat8 r;
+	for (uint32_t l = 0; l < 8; l++)
+		r.v[l] = a.v[l] - b.v[l];
+	return r;
+}
+inline SimdFloat8 SimdMul8(const SimdFloat8 a, const SimdFloat8 b)
+{
+	SimdFloat8 r;
+	for (uint32_t l = 0; l < 8; l++)
+		r.v[l] = a.v[l] * b.v[l];
+	return r;
+}
+inline SimdFloat8 SimdDiv8(const SimdFloat8 a, const SimdFloat8 b)
+{
+	SimdFloat8 r;
+	for (uint32_t l = 0; l < 8; l++)
+		r.v[l] = a.v[l] / b.v[l];
+	return r;
+}
+inline SimdFloat8 SimdSqrt8(const SimdFloat8 a)
+{
+	SimdFloat8 r;
+	for (uint32_t l = 0; l < 8; l++)
+		r.v[l] = std::sqrt(a.v[l]);
+	return r;
+}
+inline SimdFloat8 SimdRsqrt8(const SimdFloat8 a)
+{
+	SimdFloat8 r;
+	for (uint32_t l = 0; l < 8; l++)
+		r.v[l] = 1.0f / std::sqrt(a.v[l]);
+	return r;
+}
+inline SimdFloat8 SimdNeg8(const SimdFloat8 a)
+{
+	SimdFloat8 r;
+	for (uint32_t l = 0; l < 8; l++)
+		r.v[l] = -a.v[l];
+	return r;
+}
+// mask は 1.0f か 0.0f
+inline SimdFloat8 SimdLess8(const SimdFloat8 a, const SimdFloat8 b)
+{
+	SimdFloat8 r;
+	for (uint32_t l = 0; l < 8; l++)
+		r.v[l] = (a.v[l] < b.v[l]) ? 1.0f : 0.0f;
+	return r;
+}
+inline SimdFloat8 SimdSelect8(const SimdFloat8 mask, const SimdFloat8 a, const SimdFloat8 b)
+{
+	SimdFloat8 r;
+	for (uint32_t l = 0; l < 8; l++)
+		r.v[l] = (mask.v[l] != 0.0f) ? a.v[l] : b.v[l];
+	return r;
+}
+inline void SimdStoreTransposed8(float* const p, const uint32_t stride, const SimdFloat8 a, const SimdFloat8 b, const SimdFloat8 c, const SimdFloat8 d, const uint32_t count)
+{
+	for (uint32_t l = 0; l < count && l < 8; l++) {
+		p[stride * l + 0] = a.v[l];
+		p[stride * l + 1] = b.v[l];
+		p[stride * l + 2] = c.v[l];
+		p[stride * l + 3] = d.v[l];
+	}
+}
+inline void SimdLoadTransposed8(const float* const p, const uint32_t stride, SimdFloat8& a, SimdFloat8& b, SimdFloat8& c, SimdFloat8& d, const uint32_t count)
+{
+	for (uint32_t l = 0; l < 8; l++) {
+		a.v[l] = (l < count) ? p[stride * l + 0] : 0.0f;
+		b.v[l] = (l < count) ? p[stride * l + 1] : 0.0f;
+		c.v[l] = (l < count) ? p[stride * l + 2] : 0.0f;
+		d.v[l] = (l < count) ? p[stride * l + 3] : 0.0f;
+	}
+}
+
+#endif
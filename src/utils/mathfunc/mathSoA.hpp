@@ -0,0 +1,1098 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#include "src/utils/mathfunc/mathfunc.hpp"
+#include "src/utils/mathfunc/mathAligned.hpp"
+#include "src/utils/mathfunc/mathSimd.hpp"
+
+// fvec3, fmat3, fquaternion を SoAWidth 個ずつ成分ごとにまとめた型 (structure of arrays)
+// 成分 1 つが SimdFloat8 (AVX なら 1 命令で 8 lane) で、演算は全て lane ごと
+// lane ごとに scalar 版と同じ式を同じ順序で計算するので、積和が FMA に縮約されなければ結果は bit 単位で一致する
+//
+// mesh の処理では、頂点や三角形を gather で 8 個ずつ集めて計算し、scatter で書き戻すか sum で 1 つにまとめる
+// 端数の lane は gather, load が 0 で埋めるので、0 が結果に効かない計算 (体積で重みを付けた和など) はそのまま足してよい
+// SIMD の幅に合わせるため float だけ用意する
+
+constexpr uint32_t SoAWidth = 8;
+
+class floatx8;
+class fvec3x8;
+class fmat3x8;
+class fquaternionx8;
+template <class V>
+class SoAArray;
+
+////////////////////
+
+class floatx8 {
+public:
+	SimdFloat8 v;
+
+	explicit floatx8(const SimdFloat8 v);
+	explicit floatx8(const float s);
+	explicit floatx8();
+
+	float lane(const uint32_t lane) const;
+	float sum() const;
+
+	floatx8& operator+=(const floatx8& s)&;
+	floatx8& operator-=(const floatx8& s)&;
+	floatx8& operator*=(const floatx8& s)&;
+
+	inline static floatx8 zero()
+	{
+		return floatx8(0.0f);
+	}
+};
+
+floatx8 operator+(const floatx8& a, const floatx8& b);
+floatx8 operator-(const floatx8& a, const floatx8& b);
+floatx8 operator-(const floatx8& a);
+floatx8 operator*(const floatx8& a, const floatx8& b);
+floatx8 operator*(const float a, const floatx8& b);
+floatx8 operator*(const floatx8& a, const float b);
+floatx8 operator/(const floatx8& a, const floatx8& b);
+floatx8 operator/(const floatx8& a, const float b);
+
+////////////////////
+
+class fvec3x8 {
+public:
+	SimdFloat8 x, y, z;
+
+	explicit fvec3x8(const SimdFloat8 x, const SimdFloat8 y, const SimdFloat8 z);
+	explicit fvec3x8(const fvec3& v);
+	explicit fvec3x8();
+
+	floatx8 dot(const fvec3x8& v) const;
+	fvec3x8 cross(const fvec3x8& v) const;
+	floatx8 norm() const;
+	floatx8 sqnorm() const;
+	fvec3x8 normalized() const;
+	fmat3x8 tensorproduct(const fvec3x8& v) const;
+
+	fvec3 lane(const uint32_t lane) const;
+	fvec3 sum() const;
+
+	// AoS の配列との受け渡し
+	// load, gather は count 以降の lane を 0 にする。gather は p[idx[stride * l]] を lane l に読む
+	// scatter で idx に同じ頂点が複数あるときは、後の lane の値が残る
+	void load(const fvec3* const p, const uint32_t count = SoAWidth);
+	void store(fvec3* const p, const uint32_t count = SoAWidth) const;
+	// fvec3a は 1 要素 16 byte なので、4 成分ずつ読み書きして転置する (store は 4 成分目に 0 を書く)
+	void load(const fvec3a* const p, const uint32_t count = SoAWidth);
+	void store(fvec3a* const p, const uint32_t count = SoAWidth) const;
+	void gather(const fvec3* const p, const uint32_t* const idx, const uint32_t stride = 1, const uint32_t count = SoAWidth);
+	void scatter(fvec3* const p, const uint32_t* const idx, const uint32_t stride = 1, const uint32_t count = SoAWidth) const;
+
+	fvec3x8& operator+=(const fvec3x8& v)&;
+	fvec3x8& operator-=(const fvec3x8& v)&;
+	fvec3x8& operator*=(const float s)&;
+
+	inline static fvec3x8 zero()
+	{
+		return fvec3x8(fvec3::zero());
+	}
+
+	inline static floatx8 STP(const fvec3x8& a, const fvec3x8& b, const fvec3x8& c)
+	{
+		return a.dot(b.cross(c));
+	}
+};
+
+fvec3x8 operator+(const fvec3x8& a, const fvec3x8& b);
+fvec3x8 operator-(const fvec3x8& a, const fvec3x8& b);
+fvec3x8 operator-(const fvec3x8& a);
+fvec3x8 operator*(const float a, const fvec3x8& b);
+fvec3x8 operator*(const fvec3x8& a, const float b);
+fvec3x8 operator*(const floatx8& a, const fvec3x8& b);
+fvec3x8 operator*(const fvec3x8& a, const floatx8& b);
+fvec3x8 operator/(const fvec3x8& a, const float b);
+fvec3x8 operator/(const fvec3x8& a, const floatx8& b);
+
+////////////////////
+
+class fmat3x8 {
+public:
+	SimdFloat8 cmp[9];
+	//row major (fmat3 と同じ順)
+
+	explicit fmat3x8(const fmat3& m);
+	explicit fmat3x8();
+
+	floatx8 dot(const fmat3x8& m) const;
+	floatx8 sqnorm() const;
+	fmat3x8 transpose() const;
+	floatx8 trace() const;
+	floatx8 determinant() const;
+	fmat3x8 adjugate() const;
+	fmat3x8 inverse() const;
+
+	fmat3 lane(const uint32_t lane) const;
+	fmat3 sum() const;
+
+	// AoS の配列との受け渡し (load は count 以降の lane を 0 にする)
+	void load(const fmat3* const p, const uint32_t count = SoAWidth);
+	void store(fmat3* const p, const uint32_t count = SoAWidth) const;
+
+	fmat3x8& operator+=(const fmat3x8& m)&;
+	fmat3x8& operator-=(const fmat3x8& m)&;
+	fmat3x8& operator*=(const float s)&;
+
+	inline static fmat3x8 identity()
+	{
+		return fmat3x8(fmat3::identity());
+	}
+	inline static fmat3x8 zero()
+	{
+		return fmat3x8(fmat3::zero());
+	}
+};
+
+fmat3x8 operator+(const fmat3x8& a, const fmat3x8& b);
+fmat3x8 operator-(const fmat3x8& a, const fmat3x8& b);
+fmat3x8 operator-(const fmat3x8& a);
+fmat3x8 operator*(const float a, const fmat3x8& b);
+fmat3x8 operator*(const fmat3x8& a, const float b);
+fmat3x8 operator*(const floatx8& a, const fmat3x8& b);
+fmat3x8 operator*(const fmat3x8& a, const fmat3x8& b);
+fvec3x8 operator*(const fmat3x8& a, const fvec3x8& b);
+fmat3x8 operator/(const fmat3x8& a, const float b);
+fmat3x8 operator/(const fmat3x8& a, const floatx8& b);
+
+////////////////////
+
+// 剛体の姿勢などの単位 quaternion を 8 個まとめて更新する
+// rotatevector, torotation, 積は fquaternion と同じ式なので bit 単位で一致する
+// fastnormalized, integrate, nlerp, slerp は速さのために近似を含む (誤差はそれぞれの定義を参照)
+class fquaternionx8 {
+public:
+	SimdFloat8 x, y, z, w;
+	// q = w + xi + yj + zk
+
+	explicit fquaternionx8(const SimdFloat8 x, const SimdFloat8 y, const SimdFloat8 z, const SimdFloat8 w);
+	explicit fquaternionx8(const floatx8& s, const fvec3x8& v);
+	explicit fquaternionx8(const fquaternion& q);
+	explicit fquaternionx8();
+
+	floatx8 gets() const;
+	fvec3x8 getv() const;
+	floatx8 dot(const fquaternionx8& q) const;
+	floatx8 sqnorm() const;
+	floatx8 norm() const;
+	fquaternionx8 conjugate() const;
+	fquaternionx8 normalized() const;
+	fquaternionx8 fastnormalized() const;
+	fvec3x8 rotatevector(const fvec3x8& v) const;
+	// 単位 quaternion の回転行列
+	fmat3x8 torotation() const;
+	// 角速度 omega (world 座標) で dt だけ回した姿勢 (1 次の積分をして fastnormalized)
+	fquaternionx8 integrate(const fvec3x8& omega, const float dt) const;
+
+	fquaternion lane(const uint32_t lane) const;
+
+	// AoS の配列との受け渡し (load は count 以降の lane を 0 にする)
+	void load(const fquaternion* const p, const uint32_t count = SoAWidth);
+	void store(fquaternion* const p, const uint32_t count = SoAWidth) const;
+	// 回転 torotation() と平行移動 translation をまとめた fmat4 を p[l] に書く
+	void storetransform(fmat4* const p, const fvec3x8& translation, const uint32_t count = SoAWidth) const;
+
+	// 単位 quaternion の補間 (t は 0 から 1, 内積が負のときは q1 の符号を反転して近い方を通る)
+	static fquaternionx8 nlerp(const fquaternionx8& q0, const fquaternionx8& q1, const floatx8& t);
+	static fquaternionx8 slerp(const fquaternionx8& q0, const fquaternionx8& q1, const floatx8& t);
+
+	inline static fquaternionx8 unit()
+	{
+		return fquaternionx8(fquaternion::unit());
+	}
+};
+
+fquaternionx8 operator+(const fquaternionx8& a, const fquaternionx8& b);
+fquaternionx8 operator-(const fquaternionx8& a, const fquaternionx8& b);
+fquaternionx8 operator-(const fquaternionx8& a);
+fquaternionx8 operator*(const fquaternionx8& a, const fquaternionx8& b);
+fquaternionx8 operator*(const float a, const fquaternionx8& b);
+fquaternionx8 operator*(const floatx8& a, const fquaternionx8& b);
+
+////////////////////
+
+// fvec3 の列を成分ごとの配列 x, y, z に分けて持つ
+// 配列の長さは SoAWidth の倍数に切り上げ、余った要素は resize, load のときに 0 にする
+template <>
+class SoAArray<fvec3> {
+public:
+	std::vector<float> x, y, z;
+
+	explicit SoAArray(const fvec3* const p, const uint32_t size);
+	explicit SoAArray(const uint32_t size);
+	explicit SoAArray();
+
+	uint32_t size() const;
+	uint32_t batchsize() const;
+	void resize(const uint32_t size);
+
+	fvec3 get(const uint32_t index) const;
+	void set(const uint32_t index, const fvec3& v);
+
+	// b 番目の SoAWidth 個
+	fvec3x8 batch(const uint32_t b) const;
+	void setbatch(const uint32_t b, const fvec3x8& v);
+
+	// AoS の配列との受け渡し
+	void load(const fvec3* const p, const uint32_t size);
+	void store(fvec3* const p) const;
+
+	// idx[stride * l] 番目の要素を lane l に集める / lane l を idx[stride * l] 番目に書く (count 以降の lane は 0)
+	fvec3x8 gather(const uint32_t* const idx, const uint32_t stride = 1, const uint32_t count = SoAWidth) const;
+	void scatter(const fvec3x8& v, const uint32_t* const idx, const uint32_t stride = 1, const uint32_t count = SoAWidth);
+
+private:
+	uint32_t count = 0;
+};
+
+////////////////////
+
+// lane の総和。半分ずつ畳む (SIMD の水平加算と同じ順序)
+inline float SoALaneSum(const SimdFloat8 v)
+{
+	float lanes[SoAWidth];
+	SimdStore8(lanes, v);
+	float t[SoAWidth / 2];
+	for (uint32_t l = 0; l < SoAWidth / 2; l++)
+		t[l] = lanes[l] + lanes[l + SoAWidth / 2];
+	return (t[0] + t[2]) + (t[1] + t[3]);
+}
+inline float SoALane(const SimdFloat8 v, const uint32_t lane)
+{
+	float lanes[SoAWidth];
+	SimdStore8(lanes, v);
+	return lanes[lane];
+}
+
+// p[idx[stride * l]] を lane l に集める
+// 1 lane ずつ配列に書いてから読むと store forwarding が効かないので、全 lane そろうときは register の上で組み立てる
+template <class Load>
+inline SimdFloat8 SoAGather(const Load& load, const uint32_t* const idx, const uint32_t stride, const uint32_t count)
+{
+	if (count >= SoAWidth) {
+		return SimdSet8(
+		    load(idx[stride * 0]), load(idx[stride * 1]), load(idx[stride * 2]), load(idx[stride * 3]),
+		    load(idx[stride * 4]), load(idx[stride * 5]), load(idx[stride * 6]), load(idx[stride * 7]));
+	}
+
+	float lanes[SoAWidth] = {};
+	for (uint32_t l = 0; l < count; l++)
+		lanes[l] = load(idx[stride * l]);
+	return SimdLoad8(lanes);
+}
+
+inline floatx8::floatx8(const SimdFloat8 v)
+    : v(v)
+{
+}
+inline floatx8::floatx8(const float s)
+    : v(SimdSplat8(s))
+{
+}
+inline floatx8::floatx8()
+{
+}
+inline float floatx8::lane(const uint32_t lane) const
+{
+	return SoALane(v, lane);
+}
+inline float floatx8::sum() const
+{
+	return SoALaneSum(v);
+}
+inline floatx8& floatx8::operator+=(const floatx8& s)&
+{
+	v = SimdAdd8(v, s.v);
+	return *this;
+}
+inline floatx8& floatx8::operator-=(const floatx8& s)&
+{
+	v = SimdSub8(v, s.v);
+	return *this;
+}
+inline floatx8& floatx8::operator*=(const floatx8& s)&
+{
+	v = SimdMul8(v, s.v);
+	return *this;
+}
+
+inline floatx8 operator+(const floatx8& a, const floatx8& b)
+{
+	return floatx8(SimdAdd8(a.v, b.v));
+}
+inline floatx8 operator-(const floatx8& a, const floatx8& b)
+{
+	return floatx8(SimdSub8(a.v, b.v));
+}
+inline floatx8 operator-(const floatx8& a)
+{
+	return floatx8(SimdNeg8(a.v));
+}
+inline floatx8 operator*(const floatx8& a, const floatx8& b)
+{
+	return floatx8(SimdMul8(a.v, b.v));
+}
+inline floatx8 operator*(const float a, const floatx8& b)
+{
+	return floatx8(SimdMul8(SimdSplat8(a), b.v));
+}
+inline floatx8 operator*(const floatx8& a, const float b)
+{
+	return floatx8(SimdMul8(a.v, SimdSplat8(b)));
+}
+inline floatx8 operator/(const floatx8& a, const floatx8& b)
+{
+	return floatx8(SimdDiv8(a.v, b.v));
+}
+inline floatx8 operator/(const floatx8& a, const float b)
+{
+	return floatx8(SimdDiv8(a.v, SimdSplat8(b)));
+}
+
+////////////////////
+
+inline fvec3x8::fvec3x8(const SimdFloat8 x, const SimdFloat8 y, const SimdFloat8 z)
+    : x(x)
+    , y(y)
+    , z(z)
+{
+}
+inline fvec3x8::fvec3x8(const fvec3& v)
+    : x(SimdSplat8(v.x))
+    , y(SimdSplat8(v.y))
+    , z(SimdSplat8(v.z))
+{
+}
+inline fvec3x8::fvec3x8()
+{
+}
+
+inline floatx8 fvec3x8::dot(const fvec3x8& v) const
+{
+	return floatx8(SimdAdd8(SimdAdd8(SimdMul8(x, v.x), SimdMul8(y, v.y)), SimdMul8(z, v.z)));
+}
+inline fvec3x8 fvec3x8::cross(const fvec3x8& v) const
+{
+	return fvec3x8(
+	    SimdSub8(SimdMul8(y, v.z), SimdMul8(z, v.y)),
+	    SimdSub8(SimdMul8(z, v.x), SimdMul8(x, v.z)),
+	    SimdSub8(SimdMul8(x, v.y), SimdMul8(y, v.x)));
+}
+inline floatx8 fvec3x8::sqnorm() const
+{
+	return this->dot(*this);
+}
+// fvec3::norm, normalized の分岐は lane ごとの選択にする
+// (しきい値を float に丸めても float の比較結果は変わらない)
+inline floatx8 fvec3x8::norm() const
+{
+	const SimdFloat8 t = this->sqnorm().v;
+	return floatx8(SimdSelect8(SimdLess8(t, SimdSplat8(0.0000001f)), SimdSplat8(0.0f), SimdSqrt8(t)));
+}
+inline fvec3x8 fvec3x8::normalized() const
+{
+	const SimdFloat8 norm	= this->norm().v;
+	const SimdFloat8 iszero = SimdLess8(norm, SimdSplat8(0.0000001f));
+	const SimdFloat8 zero	= SimdSplat8(0.0f);
+	return fvec3x8(
+	    SimdSelect8(iszero, zero, SimdDiv8(x, norm)),
+	    SimdSelect8(iszero, zero, SimdDiv8(y, norm)),
+	    SimdSelect8(iszero, zero, SimdDiv8(z, norm)));
+}
+inline fmat3x8 fvec3x8::tensorproduct(const fvec3x8& v) const
+{
+	fmat3x8 ret;
+	ret.cmp[0] = SimdMul8(x, v.x);
+	ret.cmp[1] = SimdMul8(x, v.y);
+	ret.cmp[2] = SimdMul8(x, v.z);
+	ret.cmp[3] = SimdMul8(y, v.x);
+	ret.cmp[4] = SimdMul8(y, v.y);
+	ret.cmp[5] = SimdMul8(y, v.z);
+	ret.cmp[6] = SimdMul8(z, v.x);
+	ret.cmp[7] = SimdMul8(z, v.y);
+	ret.cmp[8] = SimdMul8(z, v.z);
+	return ret;
+}
+
+inline fvec3 fvec3x8::lane(const uint32_t lane) const
+{
+	return fvec3(SoALane(x, lane), SoALane(y, lane), SoALane(z, lane));
+}
+inline fvec3 fvec3x8::sum() const
+{
+	return fvec3(SoALaneSum(x), SoALaneSum(y), SoALaneSum(z));
+}
+
+inline void fvec3x8::load(const fvec3* const p, const uint32_t count)
+{
+	float lanes[3][SoAWidth] = {};
+	for (uint32_t l = 0; l < std::min(count, SoAWidth); l++) {
+		lanes[0][l] = p[l].x;
+		lanes[1][l] = p[l].y;
+		lanes[2][l] = p[l].z;
+	}
+	x = SimdLoad8(lanes[0]);
+	y = SimdLoad8(lanes[1]);
+	z = SimdLoad8(lanes[2]);
+}
+inline void fvec3x8::store(fvec3* const p, const uint32_t count) const
+{
+	float lanes[3][SoAWidth];
+	SimdStore8(lanes[0], x);
+	SimdStore8(lanes[1], y);
+	SimdStore8(lanes[2], z);
+	for (uint32_t l = 0; l < std::min(count, SoAWidth); l++)
+		p[l] = fvec3(lanes[0][l], lanes[1][l], lanes[2][l]);
+}
+inline void fvec3x8::load(const fvec3a* const p, const uint32_t count)
+{
+	SimdFloat8 w;
+	SimdLoadTransposed8(reinterpret_cast<const float*>(p), 4, x, y, z, w, count);
+}
+inline void fvec3x8::store(fvec3a* const p, const uint32_t count) const
+{
+	SimdStoreTransposed8(reinterpret_cast<float*>(p), 4, x, y, z, SimdSplat8(0.0f), count);
+}
+inline void fvec3x8::gather(const fvec3* const p, const uint32_t* const idx, const uint32_t stride, const uint32_t count)
+{
+	x = SoAGather([p](const uint32_t i) { return p[i].x; }, idx, stride, count);
+	y = SoAGather([p](const uint32_t i) { return p[i].y; }, idx, stride, count);
+	z = SoAGather([p](const uint32_t i) { return p[i].z; }, idx, stride, count);
+}
+inline void fvec3x8::scatter(fvec3* const p, const uint32_t* const idx, const uint32_t stride, const uint32_t count) const
+{
+	float lanes[3][SoAWidth];
+	SimdStore8(lanes[0], x);
+	SimdStore8(lanes[1], y);
+	SimdStore8(lanes[2], z);
+	for (uint32_t l = 0; l < std::min(count, SoAWidth); l++)
+		p[idx[stride * l]] = fvec3(lanes[0][l], lanes[1][l], lanes[2][l]);
+}
+
+inline fvec3x8& fvec3x8::operator+=(const fvec3x8& v)&
+{
+	x = SimdAdd8(x, v.x);
+	y = SimdAdd8(y, v.y);
+	z = SimdAdd8(z, v.z);
+	return *this;
+}
+inline fvec3x8& fvec3x8::operator-=(const fvec3x8& v)&
+{
+	x = SimdSub8(x, v.x);
+	y = SimdSub8(y, v.y);
+	z = SimdSub8(z, v.z);
+	return *this;
+}
+inline fvec3x8& fvec3x8::operator*=(const float s)&
+{
+	const SimdFloat8 t = SimdSplat8(s);
+	x		   = SimdMul8(x, t);
+	y		   = SimdMul8(y, t);
+	z		   = SimdMul8(z, t);
+	return *this;
+}
+
+inline fvec3x8 operator+(const fvec3x8& a, const fvec3x8& b)
+{
+	return fvec3x8(SimdAdd8(a.x, b.x), SimdAdd8(a.y, b.y), SimdAdd8(a.z, b.z));
+}
+inline fvec3x8 operator-(const fvec3x8& a, const fvec3x8& b)
+{
+	return fvec3x8(SimdSub8(a.x, b.x), SimdSub8(a.y, b.y), SimdSub8(a.z, b.z));
+}
+inline fvec3x8 operator-(const fvec3x8& a)
+{
+	return fvec3x8(SimdNeg8(a.x), SimdNeg8(a.y), SimdNeg8(a.z));
+}
+inline fvec3x8 operator*(const float a, const fvec3x8& b)
+{
+	return floatx8(a) * b;
+}
+inline fvec3x8 operator*(const fvec3x8& a, const float b)
+{
+	return floatx8(b) * a;
+}
+inline fvec3x8 operator*(const floatx8& a, const fvec3x8& b)
+{
+	return fvec3x8(SimdMul8(a.v, b.x), SimdMul8(a.v, b.y), SimdMul8(a.v, b.z));
+}
+inline fvec3x8 operator*(const fvec3x8& a, const floatx8& b)
+{
+	return b * a;
+}
+inline fvec3x8 operator/(const fvec3x8& a, const float b)
+{
+	return a / floatx8(b);
+}
+inline fvec3x8 operator/(const fvec3x8& a, const floatx8& b)
+{
+	return fvec3x8(SimdDiv8(a.x, b.v), SimdDiv8(a.y, b.v), SimdDiv8(a.z, b.v));
+}
+
+////////////////////
+
+inline fmat3x8::fmat3x8(const fmat3& m)
+{
+	for (uint32_t i = 0; i < 9; i++)
+		cmp[i] = SimdSplat8(m.cmp[i]);
+}
+inline fmat3x8::fmat3x8()
+{
+	for (uint32_t i = 0; i < 9; i++)
+		cmp[i] = SimdSplat8(0.0f);
+}
+
+inline floatx8 fmat3x8::dot(const fmat3x8& m) const
+{
+	SimdFloat8 t = SimdMul8(cmp[0], m.cmp[0]);
+	for (uint32_t i = 1; i < 9; i++)
+		t = SimdAdd8(t, SimdMul8(cmp[i], m.cmp[i]));
+	return floatx8(t);
+}
+inline floatx8 fmat3x8::sqnorm() const
+{
+	return this->dot(*this);
+}
+inline fmat3x8 fmat3x8::transpose() const
+{
+	fmat3x8 ret;
+	ret.cmp[0] = cmp[0];
+	ret.cmp[1] = cmp[3];
+	ret.cmp[2] = cmp[6];
+	ret.cmp[3] = cmp[1];
+	ret.cmp[4] = cmp[4];
+	ret.cmp[5] = cmp[7];
+	ret.cmp[6] = cmp[2];
+	ret.cmp[7] = cmp[5];
+	ret.cmp[8] = cmp[8];
+	return ret;
+}
+inline floatx8 fmat3x8::trace() const
+{
+	return floatx8(SimdAdd8(SimdAdd8(cmp[0], cmp[4]), cmp[8]));
+}
+inline floatx8 fmat3x8::determinant() const
+{
+	const SimdFloat8 t0 = SimdMul8(cmp[2], SimdSub8(SimdMul8(cmp[3], cmp[7]), SimdMul8(cmp[6], cmp[4])));
+	const SimdFloat8 t1 = SimdMul8(cmp[5], SimdSub8(SimdMul8(cmp[6], cmp[1]), SimdMul8(cmp[0], cmp[7])));
+	const SimdFloat8 t2 = SimdMul8(cmp[8], SimdSub8(SimdMul8(cmp[0], cmp[4]), SimdMul8(cmp[3], cmp[1])));
+	return floatx8(SimdAdd8(SimdAdd8(t0, t1), t2));
+}
+inline fmat3x8 fmat3x8::adjugate() const
+{
+	// a * b - c * d
+	auto Minor = [](const SimdFloat8 a, const SimdFloat8 b, const SimdFloat8 c, const SimdFloat8 d) {
+		return SimdSub8(SimdMul8(a, b), SimdMul8(c, d));
+	};
+
+	fmat3x8 ret;
+	ret.cmp[0] = Minor(cmp[4], cmp[8], cmp[5], cmp[7]);
+	ret.cmp[1] = SimdNeg8(Minor(cmp[1], cmp[8], cmp[2], cmp[7]));
+	ret.cmp[2] = Minor(cmp[1], cmp[5], cmp[2], cmp[4]);
+	ret.cmp[3] = SimdNeg8(Minor(cmp[3], cmp[8], cmp[6], cmp[5]));
+	ret.cmp[4] = Minor(cmp[0], cmp[8], cmp[2], cmp[6]);
+	ret.cmp[5] = SimdNeg8(Minor(cmp[0], cmp[5], cmp[2], cmp[3]));
+	ret.cmp[6] = Minor(cmp[3], cmp[7], cmp[4], cmp[6]);
+	ret.cmp[7] = SimdNeg8(Minor(cmp[0], cmp[7], cmp[1], cmp[6]));
+	ret.cmp[8] = Minor(cmp[0], cmp[4], cmp[1], cmp[3]);
+	return ret;
+}
+inline fmat3x8 fmat3x8::inverse() const
+{
+	return (this->adjugate()) / this->determinant();
+}
+
+inline fmat3 fmat3x8::lane(const uint32_t lane) const
+{
+	fmat3 ret;
+	for (uint32_t i = 0; i < 9; i++)
+		ret.cmp[i] = SoALane(cmp[i], lane);
+	return ret;
+}
+inline fmat3 fmat3x8::sum() const
+{
+	fmat3 ret;
+	for (uint32_t i = 0; i < 9; i++)
+		ret.cmp[i] = SoALaneSum(cmp[i]);
+	return ret;
+}
+
+inline void fmat3x8::load(const fmat3* const p, const uint32_t count)
+{
+	float lanes[9][SoAWidth] = {};
+	for (uint32_t l = 0; l < std::min(count, SoAWidth); l++) {
+		for (uint32_t i = 0; i < 9; i++)
+			lanes[i][l] = p[l].cmp[i];
+	}
+	for (uint32_t i = 0; i < 9; i++)
+		cmp[i] = SimdLoad8(lanes[i]);
+}
+inline void fmat3x8::store(fmat3* const p, const uint32_t count) const
+{
+	float lanes[9][SoAWidth];
+	for (uint32_t i = 0; i < 9; i++)
+		SimdStore8(lanes[i], cmp[i]);
+	for (uint32_t l = 0; l < std::min(count, SoAWidth); l++) {
+		for (uint32_t i = 0; i < 9; i++)
+			p[l].cmp[i] = lanes[i][l];
+	}
+}
+
+inline fmat3x8& fmat3x8::operator+=(const fmat3x8& m)&
+{
+	for (uint32_t i = 0; i < 9; i++)
+		cmp[i] = SimdAdd8(cmp[i], m.cmp[i]);
+	return *this;
+}
+inline fmat3x8& fmat3x8::operator-=(const fmat3x8& m)&
+{
+	for (uint32_t i = 0; i < 9; i++)
+		cmp[i] = SimdSub8(cmp[i], m.cmp[i]);
+	return *this;
+}
+inline fmat3x8& fmat3x8::operator*=(const float s)&
+{
+	const SimdFloat8 t = SimdSplat8(s);
+	for (uint32_t i = 0; i < 9; i++)
+		cmp[i] = SimdMul8(cmp[i], t);
+	return *this;
+}
+
+inline fmat3x8 operator+(const fmat3x8& a, const fmat3x8& b)
+{
+	fmat3x8 ret(a);
+	ret += b;
+	return ret;
+}
+inline fmat3x8 operator-(const fmat3x8& a, const fmat3x8& b)
+{
+	fmat3x8 ret(a);
+	ret -= b;
+	return ret;
+}
+inline fmat3x8 operator-(const fmat3x8& a)
+{
+	fmat3x8 ret;
+	for (uint32_t i = 0; i < 9; i++)
+		ret.cmp[i] = SimdNeg8(a.cmp[i]);
+	return ret;
+}
+inline fmat3x8 operator*(const float a, const fmat3x8& b)
+{
+	return floatx8(a) * b;
+}
+inline fmat3x8 operator*(const fmat3x8& a, const float b)
+{
+	return floatx8(b) * a;
+}
+inline fmat3x8 operator*(const floatx8& a, const fmat3x8& b)
+{
+	fmat3x8 ret;
+	for (uint32_t i = 0; i < 9; i++)
+		ret.cmp[i] = SimdMul8(a.v, b.cmp[i]);
+	return ret;
+}
+inline fmat3x8 operator*(const fmat3x8& a, const fmat3x8& b)
+{
+	fmat3x8 ret;
+	for (uint32_t r = 0; r < 3; r++) {
+		for (uint32_t c = 0; c < 3; c++) {
+			const SimdFloat8 t = SimdAdd8(SimdMul8(a.cmp[3 * r + 0], b.cmp[c + 0]), SimdMul8(a.cmp[3 * r + 1], b.cmp[c + 3]));
+			ret.cmp[3 * r + c] = SimdAdd8(t, SimdMul8(a.cmp[3 * r + 2], b.cmp[c + 6]));
+		}
+	}
+	return ret;
+}
+inline fvec3x8 operator*(const fmat3x8& a, const fvec3x8& b)
+{
+	fvec3x8 ret;
+	ret.x = SimdAdd8(SimdAdd8(SimdMul8(a.cmp[0], b.x), SimdMul8(a.cmp[1], b.y)), SimdMul8(a.cmp[2], b.z));
+	ret.y = SimdAdd8(SimdAdd8(SimdMul8(a.cmp[3], b.x), SimdMul8(a.cmp[4], b.y)), SimdMul8(a.cmp[5], b.z));
+	ret.z = SimdAdd8(SimdAdd8(SimdMul8(a.cmp[6], b.x), SimdMul8(a.cmp[7], b.y)), SimdMul8(a.cmp[8], b.z));
+	return ret;
+}
+inline fmat3x8 operator/(const fmat3x8& a, const float b)
+{
+	return a / floatx8(b);
+}
+inline fmat3x8 operator/(const fmat3x8& a, const floatx8& b)
+{
+	fmat3x8 ret;
+	for (uint32_t i = 0; i < 9; i++)
+		ret.cmp[i] = SimdDiv8(a.cmp[i], b.v);
+	return ret;
+}
+
+////////////////////
+
+// slerp のための acos, sin の多項式近似 (lane ごとに std::acos, std::sin を呼ぶと SIMD にならない)
+// SoAAcos : x は 0 から 1, 絶対誤差 2e-8 程度 (Abramowitz, Stegun 4.4.46) に float の丸めが乗る
+// SoASin  : x は 0 から pi / 2, x^11 までの Taylor 展開で打ち切り誤差 6e-8 以下
+inline SimdFloat8 SoAAcos(const SimdFloat8 x)
+{
+	SimdFloat8 p = SimdSplat8(-0.0012624911f);
+	p	     = SimdAdd8(SimdMul8(p, x), SimdSplat8(0.0066700901f));
+	p	     = SimdAdd8(SimdMul8(p, x), SimdSplat8(-0.0170881256f));
+	p	     = SimdAdd8(SimdMul8(p, x), SimdSplat8(0.0308918810f));
+	p	     = SimdAdd8(SimdMul8(p, x), SimdSplat8(-0.0501743046f));
+	p	     = SimdAdd8(SimdMul8(p, x), SimdSplat8(0.0889789874f));
+	p	     = SimdAdd8(SimdMul8(p, x), SimdSplat8(-0.2145988016f));
+	p	     = SimdAdd8(SimdMul8(p, x), SimdSplat8(1.5707963050f));
+	return SimdMul8(SimdSqrt8(SimdSub8(SimdSplat8(1.0f), x)), p);
+}
+inline SimdFloat8 SoASin(const SimdFloat8 x)
+{
+	const SimdFloat8 x2 = SimdMul8(x, x);
+	SimdFloat8 p	    = SimdSplat8(-1.0f / 39916800.0f);
+	p		    = SimdAdd8(SimdMul8(p, x2), SimdSplat8(1.0f / 362880.0f));
+	p		    = SimdAdd8(SimdMul8(p, x2), SimdSplat8(-1.0f / 5040.0f));
+	p		    = SimdAdd8(SimdMul8(p, x2), SimdSplat8(1.0f / 120.0f));
+	p		    = SimdAdd8(SimdMul8(p, x2), SimdSplat8(-1.0f / 6.0f));
+	p		    = SimdAdd8(SimdMul8(p, x2), SimdSplat8(1.0f));
+	return SimdMul8(x, p);
+}
+
+inline fquaternionx8::fquaternionx8(const SimdFloat8 x, const SimdFloat8 y, const SimdFloat8 z, const SimdFloat8 w)
+    : x(x)
+    , y(y)
+    , z(z)
+    , w(w)
+{
+}
+inline fquaternionx8::fquaternionx8(const floatx8& s, const fvec3x8& v)
+    : x(v.x)
+    , y(v.y)
+    , z(v.z)
+    , w(s.v)
+{
+}
+inline fquaternionx8::fquaternionx8(const fquaternion& q)
+    : x(SimdSplat8(q.x))
+    , y(SimdSplat8(q.y))
+    , z(SimdSplat8(q.z))
+    , w(SimdSplat8(q.w))
+{
+}
+inline fquaternionx8::fquaternionx8()
+{
+}
+
+inline floatx8 fquaternionx8::gets() const
+{
+	return floatx8(w);
+}
+inline fvec3x8 fquaternionx8::getv() const
+{
+	return fvec3x8(x, y, z);
+}
+inline floatx8 fquaternionx8::dot(const fquaternionx8& q) const
+{
+	return floatx8(SimdAdd8(SimdAdd8(SimdAdd8(SimdMul8(x, q.x), SimdMul8(y, q.y)), SimdMul8(z, q.z)), SimdMul8(w, q.w)));
+}
+inline floatx8 fquaternionx8::sqnorm() const
+{
+	return this->dot(*this);
+}
+// fvec4::norm, normalized と同じく、ノルムが小さい lane は 0 にする
+inline floatx8 fquaternionx8::norm() const
+{
+	const SimdFloat8 t = this->sqnorm().v;
+	return floatx8(SimdSelect8(SimdLess8(t, SimdSplat8(0.0000001f)), SimdSplat8(0.0f), SimdSqrt8(t)));
+}
+inline fquaternionx8 fquaternionx8::conjugate() const
+{
+	return fquaternionx8(SimdNeg8(x), SimdNeg8(y), SimdNeg8(z), w);
+}
+inline fquaternionx8 fquaternionx8::normalized() const
+{
+	const SimdFloat8 norm	= this->norm().v;
+	const SimdFloat8 iszero = SimdLess8(norm, SimdSplat8(0.0000001f));
+	const SimdFloat8 zero	= SimdSplat8(0.0f);
+	return fquaternionx8(
+	    SimdSelect8(iszero, zero, SimdDiv8(x, norm)),
+	    SimdSelect8(iszero, zero, SimdDiv8(y, norm)),
+	    SimdSelect8(iszero, zero, SimdDiv8(z, norm)),
+	    SimdSelect8(iszero, zero, SimdDiv8(w, norm)));
+}
+// sqrt と除算の代わりに SimdRsqrt8 の近似を Newton 法で 1 回改善したものを掛ける
+// 結果のノルムと 1 との差は 1e-6 以下 (rsqrt の相対誤差 e が 1.5 e^2 になり、残りは float の丸め)
+// 積分のたびに正規化し直す姿勢なら、この誤差は次の正規化で消えるので溜まらない
+inline fquaternionx8 fquaternionx8::fastnormalized() const
+{
+	const SimdFloat8 t	= this->sqnorm().v;
+	const SimdFloat8 r	= SimdRsqrt8(t);
+	const SimdFloat8 half	= SimdMul8(SimdSplat8(0.5f), t);
+	const SimdFloat8 inv	= SimdMul8(r, SimdSub8(SimdSplat8(1.5f), SimdMul8(SimdMul8(half, r), r)));
+	const SimdFloat8 iszero = SimdLess8(t, SimdSplat8(0.0000001f));
+	const SimdFloat8 scale	= SimdSelect8(iszero, SimdSplat8(0.0f), inv);
+	return fquaternionx8(SimdMul8(x, scale), SimdMul8(y, scale), SimdMul8(z, scale), SimdMul8(w, scale));
+}
+inline fvec3x8 fquaternionx8::rotatevector(const fvec3x8& v) const
+{
+	const fvec3x8 u = this->getv();
+	const floatx8 s = this->gets();
+	return (2.0f * u.dot(v)) * u + (s * s - u.sqnorm()) * v + (2.0f * s) * u.cross(v);
+}
+inline fmat3x8 fquaternionx8::torotation() const
+{
+	const SimdFloat8 one = SimdSplat8(1.0f);
+	const SimdFloat8 two = SimdSplat8(2.0f);
+	const SimdFloat8 xx  = SimdMul8(x, x);
+	const SimdFloat8 yy  = SimdMul8(y, y);
+	const SimdFloat8 zz  = SimdMul8(z, z);
+	const SimdFloat8 xy  = SimdMul8(x, y);
+	const SimdFloat8 xz  = SimdMul8(x, z);
+	const SimdFloat8 yz  = SimdMul8(y, z);
+	const SimdFloat8 wx  = SimdMul8(w, x);
+	const SimdFloat8 wy  = SimdMul8(w, y);
+	const SimdFloat8 wz  = SimdMul8(w, z);
+
+	fmat3x8 ret;
+	ret.cmp[0] = SimdSub8(one, SimdMul8(two, SimdAdd8(yy, zz)));
+	ret.cmp[1] = SimdMul8(two, SimdSub8(xy, wz));
+	ret.cmp[2] = SimdMul8(two, SimdAdd8(xz, wy));
+	ret.cmp[3] = SimdMul8(two, SimdAdd8(xy, wz));
+	ret.cmp[4] = SimdSub8(one, SimdMul8(two, SimdAdd8(xx, zz)));
+	ret.cmp[5] = SimdMul8(two, SimdSub8(yz, wx));
+	ret.cmp[6] = SimdMul8(two, SimdSub8(xz, wy));
+	ret.cmp[7] = SimdMul8(two, SimdAdd8(yz, wx));
+	ret.cmp[8] = SimdSub8(one, SimdMul8(two, SimdAdd8(xx, yy)));
+	return ret;
+}
+// dq/dt = (0, omega) q / 2 を 1 次で積分する
+// (0, omega) q の実部の 0 * w, 虚部の 0 * v は計算しない
+// 1 step の回転角 |omega| dt が小さいほど正確 (角度の誤差は (|omega| dt)^3 に比例する)
+inline fquaternionx8 fquaternionx8::integrate(const fvec3x8& omega, const float dt) const
+{
+	const fvec3x8 v = this->getv();
+	const floatx8 s = this->gets();
+	const floatx8 h(0.5f * dt);
+
+	const floatx8 ds = -(omega.dot(v));
+	const fvec3x8 dv = s * omega + omega.cross(v);
+	return fquaternionx8(s + h * ds, v + h * dv).fastnormalized();
+}
+
+inline fquaternion fquaternionx8::lane(const uint32_t lane) const
+{
+	return fquaternion(SoALane(x, lane), SoALane(y, lane), SoALane(z, lane), SoALane(w, lane));
+}
+
+inline void fquaternionx8::load(const fquaternion* const p, const uint32_t count)
+{
+	float lanes[4][SoAWidth] = {};
+	for (uint32_t l = 0; l < std::min(count, SoAWidth); l++) {
+		lanes[0][l] = p[l].x;
+		lanes[1][l] = p[l].y;
+		lanes[2][l] = p[l].z;
+		lanes[3][l] = p[l].w;
+	}
+	x = SimdLoad8(lanes[0]);
+	y = SimdLoad8(lanes[1]);
+	z = SimdLoad8(lanes[2]);
+	w = SimdLoad8(lanes[3]);
+}
+inline void fquaternionx8::store(fquaternion* const p, const uint32_t count) const
+{
+	float lanes[4][SoAWidth];
+	SimdStore8(lanes[0], x);
+	SimdStore8(lanes[1], y);
+	SimdStore8(lanes[2], z);
+	SimdStore8(lanes[3], w);
+	for (uint32_t l = 0; l < std::min(count, SoAWidth); l++)
+		p[l] = fquaternion(lanes[0][l], lanes[1][l], lanes[2][l], lanes[3][l]);
+}
+inline void fquaternionx8::storetransform(fmat4* const p, const fvec3x8& translation, const uint32_t count) const
+{
+	const fmat3x8 r = this->torotation();
+
+	// 1 行 4 成分ずつ転置して書く
+	float* const out = reinterpret_cast<float*>(p);
+	SimdStoreTransposed8(out + 0, 16, r.cmp[0], r.cmp[1], r.cmp[2], translation.x, count);
+	SimdStoreTransposed8(out + 4, 16, r.cmp[3], r.cmp[4], r.cmp[5], translation.y, count);
+	SimdStoreTransposed8(out + 8, 16, r.cmp[6], r.cmp[7], r.cmp[8], translation.z, count);
+	for (uint32_t l = 0; l < std::min(count, SoAWidth); l++) {
+		p[l].cmp[12] = 0.0f;
+		p[l].cmp[13] = 0.0f;
+		p[l].cmp[14] = 0.0f;
+		p[l].cmp[15] = 1.0f;
+	}
+}
+
+// q0 + t (q1 - q0) を fastnormalized する
+// 角速度は一定にならない (t = 0, 1 の近くで遅く, 0.5 の近くで速い)
+// slerp との回転角の差は q0 から q1 への回転角が 30 度で 0.03 度, 90 度で 0.9 度程度
+inline fquaternionx8 fquaternionx8::nlerp(const fquaternionx8& q0, const fquaternionx8& q1, const floatx8& t)
+{
+	const SimdFloat8 flip = SimdLess8(q0.dot(q1).v, SimdSplat8(0.0f));
+	const fquaternionx8 q(
+	    SimdSelect8(flip, SimdNeg8(q1.x), q1.x),
+	    SimdSelect8(flip, SimdNeg8(q1.y), q1.y),
+	    SimdSelect8(flip, SimdNeg8(q1.z), q1.z),
+	    SimdSelect8(flip, SimdNeg8(q1.w), q1.w));
+	return (q0 + t * (q - q0)).fastnormalized();
+}
+// sin((1 - t) theta) / sin(theta) q0 + sin(t theta) / sin(theta) q1 (cos(theta) = q0 . q1)
+// theta が小さくて sin(theta) で割れない lane は nlerp にする (その範囲では nlerp との差は 1e-7 以下)
+// 成分の誤差は 1e-6 程度
+inline fquaternionx8 fquaternionx8::slerp(const fquaternionx8& q0, const fquaternionx8& q1, const floatx8& t)
+{
+	const SimdFloat8 zero = SimdSplat8(0.0f);
+	const SimdFloat8 one  = SimdSplat8(1.0f);
+
+	SimdFloat8 d	      = q0.dot(q1).v;
+	const SimdFloat8 flip = SimdLess8(d, zero);
+	const fquaternionx8 q(
+	    SimdSelect8(flip, SimdNeg8(q1.x), q1.x),
+	    SimdSelect8(flip, SimdNeg8(q1.y), q1.y),
+	    SimdSelect8(flip, SimdNeg8(q1.z), q1.z),
+	    SimdSelect8(flip, SimdNeg8(q1.w), q1.w));
+	d = SimdSelect8(flip, SimdNeg8(d), d);
+	d = SimdSelect8(SimdLess8(one, d), one, d);
+
+	const SimdFloat8 theta	= SoAAcos(d);
+	const SimdFloat8 ttheta = SimdMul8(t.v, theta);
+	const SimdFloat8 inv	= SimdDiv8(one, SoASin(theta));
+	const floatx8 w0(SimdMul8(SoASin(SimdSub8(theta, ttheta)), inv));
+	const floatx8 w1(SimdMul8(SoASin(ttheta), inv));
+	const fquaternionx8 s = w0 * q0 + w1 * q;
+
+	const fquaternionx8 n	 = (q0 + t * (q - q0)).fastnormalized();
+	const SimdFloat8 isnlerp = SimdLess8(SimdSplat8(0.9999f), d);
+	return fquaternionx8(
+	    SimdSelect8(isnlerp, n.x, s.x),
+	    SimdSelect8(isnlerp, n.y, s.y),
+	    SimdSelect8(isnlerp, n.z, s.z),
+	    SimdSelect8(isnlerp, n.w, s.w));
+}
+
+inline fquaternionx8 operator+(const fquaternionx8& a, const fquaternionx8& b)
+{
+	return fquaternionx8(SimdAdd8(a.x, b.x), SimdAdd8(a.y, b.y), SimdAdd8(a.z, b.z), SimdAdd8(a.w, b.w));
+}
+inline fquaternionx8 operator-(const fquaternionx8& a, const fquaternionx8& b)
+{
+	return fquaternionx8(SimdSub8(a.x, b.x), SimdSub8(a.y, b.y), SimdSub8(a.z, b.z), SimdSub8(a.w, b.w));
+}
+inline fquaternionx8 operator-(const fquaternionx8& a)
+{
+	return fquaternionx8(SimdNeg8(a.x), SimdNeg8(a.y), SimdNeg8(a.z), SimdNeg8(a.w));
+}
+// fquaternion の operator* (MATHFUNC_SCALAR のとき) と同じ順で計算する
+inline fquaternionx8 operator*(const fquaternionx8& a, const fquaternionx8& b)
+{
+	const floatx8 s0 = a.gets();
+	const floatx8 s1 = b.gets();
+	const fvec3x8 v0 = a.getv();
+	const fvec3x8 v1 = b.getv();
+	const floatx8 s	 = s0 * s1 - v0.dot(v1);
+	const fvec3x8 v	 = s0 * v1 + s1 * v0 + v0.cross(v1);
+	return fquaternionx8(s, v);
+}
+inline fquaternionx8 operator*(const float a, const fquaternionx8& b)
+{
+	return floatx8(a) * b;
+}
+inline fquaternionx8 operator*(const floatx8& a, const fquaternionx8& b)
+{
+	return fquaternionx8(SimdMul8(a.v, b.x), SimdMul8(a.v, b.y), SimdMul8(a.v, b.z), SimdMul8(a.v, b.w));
+}
+
+////////////////////
+
+inline SoAArray<fvec3>::SoAArray(const fvec3* const p, const uint32_t size)
+{
+	this->load(p, size);
+}
+inline SoAArray<fvec3>::SoAArray(const uint32_t size)
+{
+	this->resize(size);
+}
+inline SoAArray<fvec3>::SoAArray()
+{
+}
+
+inline uint32_t SoAArray<fvec3>::size() const
+{
+	return count;
+}
+inline uint32_t SoAArray<fvec3>::batchsize() const
+{
+	return x.size() / SoAWidth;
+}
+inline void SoAArray<fvec3>::resize(const uint32_t size)
+{
+	const uint32_t padded = (size + SoAWidth - 1) / SoAWidth * SoAWidth;
+	// 縮めたときに残る要素も 0 に戻す
+	for (std::vector<float>* cmp : { &x, &y, &z }) {
+		cmp->resize(padded, 0.0f);
+		std::fill(cmp->begin() + std::min(size, count), cmp->end(), 0.0f);
+	}
+	count = size;
+}
+
+inline fvec3 SoAArray<fvec3>::get(const uint32_t index) const
+{
+	return fvec3(x[index], y[index], z[index]);
+}
+inline void SoAArray<fvec3>::set(const uint32_t index, const fvec3& v)
+{
+	x[index] = v.x;
+	y[index] = v.y;
+	z[index] = v.z;
+}
+
+inline fvec3x8 SoAArray<fvec3>::batch(const uint32_t b) const
+{
+	return fvec3x8(SimdLoad8(x.data() + SoAWidth * b), SimdLoad8(y.data() + SoAWidth * b), SimdLoad8(z.data() + SoAWidth * b));
+}
+inline void SoAArray<fvec3>::setbatch(const uint32_t b, const fvec3x8& v)
+{
+	SimdStore8(x.data() + SoAWidth * b, v.x);
+	SimdStore8(y.data() + SoAWidth * b, v.y);
+	SimdStore8(z.data() + SoAWidth * b, v.z);
+}
+
+inline void SoAArray<fvec3>::load(const fvec3* const p, const uint32_t size)
+{
+	this->resize(0);
+	this->resize(size);
+	for (uint32_t i = 0; i < size; i++)
+		this->set(i, p[i]);
+}
+inline void SoAArray<fvec3>::store(fvec3* const p) const
+{
+	for (uint32_t i = 0; i < count; i++)
+		p[i] = this->get(i);
+}
+
+inline fvec3x8 SoAArray<fvec3>::gather(const uint32_t* const idx, const uint32_t stride, const uint32_t count) const
+{
+	const float* const px = x.data();
+	const float* const py = y.data();
+	const float* const pz = z.data();
+	return fvec3x8(
+	    SoAGather([px](const uint32_t i) { return px[i]; }, idx, stride, count),
+	    SoAGather([py](const uint32_t i) { return py[i]; }, idx, stride, count),
+	    SoAGather([pz](const uint32_t i) { return pz[i]; }, idx, stride, count));
+}
+inline void SoAArray<fvec3>::scatter(const fvec3x8& v, const uint32_t* const idx, const uint32_t stride, const uint32_t count)
+{
+	float lanes[3][SoAWidth];
+	SimdStore8(lanes[0], v.x);
+	SimdStore8(lanes[1], v.y);
+	SimdStore8(lanes[2], v.z);
+	for (uint32_t l = 0; l < std::min(count, SoAWidth); l++) {
+		x[idx[stride * l]] = lanes[0][l];
+		y[idx[stride * l]] = lanes[1][l];
+		z[idx[stride * l]] = lanes[2][l];
+	}
+}
@@ -2,7 +2,7 @@
 
 #include "src/utils/mathfunc/mathfunc.hpp"
 
-inline fmat4 makeProjectionMatrix(const float& near, const float& far, const float& right, const float& left, const float& top,
+inline constexpr fmat4 makeProjectionMatrix(const float& near, const float& far, const float& right, const float& left, const float& top,
 	const float& bottom)
 {
 	fmat4 ret = fmat4::zero();
@@ -16,8 +16,8 @@ inline fmat4 makeProjectionMatrix(const float& near, const float& far, const flo
 	return ret;
 }
 
-// p[^ׂ͂Đ
-inline fmat4 makeProjectionMatrixVk(const float& near, const float& far, const float& right, const float& left, const float& top,
+// パラメータはすべて正
+inline constexpr fmat4 makeProjectionMatrixVk(const float& near, const float& far, const float& right, const float& left, const float& top,
 	const float& bottom)
 {
 	fmat4 ret = fmat4::zero();
@@ -31,7 +31,7 @@ inline fmat4 makeProjectionMatrixVk(const float& near, const float& far, const f
 	return ret;
 }
 
-// p[^ׂ͂Đ
+// パラメータはすべて正
 inline fmat4 makeProjectionMatrixVk(const float& near, const float& far, const float& fovY, const float& aspect)
 {
 	const float top = near * tanf(fovY * 0.5f);
@@ -41,7 +41,7 @@ inline fmat4 makeProjectionMatrixVk(const float& near, const float& far, const f
 	return makeProjectionMatrixVk(near, far, right, left, top, bottom);
 }
 
-inline fmat4 makeCameraMatrix(const fvec3& eye, const fvec3& center, const fvec3& up)
+inline constexpr fmat4 makeCameraMatrix(const fvec3& eye, const fvec3& center, const fvec3& up)
 {
 	fvec3 z = -(eye - center).normalized();
 	fvec3 x = up.cross(z).normalized();
@@ -2,7 +2,68 @@
 
 #include <iostream>
 #include <cstdint>
+#include <bit>
 #include <cmath>
+#include <limits>
+#include <type_traits>
+
+#include "src/utils/mathfunc/mathSimd.hpp"
+
+// 全ての型と演算は constexpr で、コンパイル時に表や行列を作れる
+// (三角関数を使う quaternion::exp, log, slerp, vec3::torotation は除く)
+// コンパイル時には SIMD の kernel を通らず、scalar の式で計算する
+
+// constexpr の評価中は std::sqrt が使えないので、double の Newton 法で求める
+// Newton 法は 1 ulp ずれて止まることがあるので、y^2 を誤差なしで求めて (Dekker の方法) 最も近い double に直す
+// double で正しく丸めてあれば float に丸めても std::sqrt と一致する
+// 実行時は std::sqrt のまま
+template <class T>
+inline constexpr T MathSqrt(const T x)
+{
+	if (std::is_constant_evaluated()) {
+		const double d = static_cast<double>(x);
+		if (d == 0.0 || d == std::numeric_limits<double>::infinity())
+			return x;
+		if (!(d > 0.0))
+			return std::numeric_limits<T>::quiet_NaN();
+
+		// 上から近づけると単調に減るので、減らなくなったら終わり
+		double y = d > 1.0 ? d : 1.0;
+		while (true) {
+			const double next = 0.5 * (y + d / y);
+			if (next >= y)
+				break;
+			y = next;
+		}
+
+		// 残差 d - y^2 が y の ulp の半分 * 2y を超えたら隣の double にする
+		// (split で溢れる大きさと非正規化数の近くは Newton 法のまま)
+		if (d > 1.0e-290 && d < 1.0e290) {
+			auto Split = [](const double a, double& hi, double& lo) {
+				const double t = 134217729.0 * a; // 2^27 + 1
+				hi	       = t - (t - a);
+				lo	       = a - hi;
+			};
+			for (uint32_t i = 0; i < 2; i++) {
+				double hi = 0.0, lo = 0.0;
+				Split(y, hi, lo);
+				const double p	  = y * y;
+				const double e	  = ((hi * hi - p) + 2.0 * hi * lo) + lo * lo;
+				const double r	  = (d - p) - e;
+				const double ulp  = std::bit_cast<double>(std::bit_cast<uint64_t>(y) + 1) - y;
+				const double half = y * ulp;
+				if (r > half)
+					y += ulp;
+				else if (r < -half)
+					y -= ulp;
+				else
+					break;
+			}
+		}
+		return static_cast<T>(y);
+	}
+	return std::sqrt(x);
+}
 
 template <class T>
 class vec2;
@@ -63,54 +124,54 @@ public:
 		};
 	};
 
-	explicit vec2(const T x, const T y);
-	explicit vec2(const T array[2]);
-	explicit vec2();
+	explicit constexpr vec2(const T x, const T y);
+	explicit constexpr vec2(const T array[2]);
+	explicit constexpr vec2();
 
-	T dot(const vec2<T> v) const;
-	T cross(const vec2<T> v) const;
-	T norm() const;
-	T sqnorm() const;
-	vec2<T> normalized() const;
-	vec2<T> rotated() const;
-	mat2<T> tensorproduct(const vec2<T> v) const;
+	constexpr T dot(const vec2<T>& v) const;
+	constexpr T cross(const vec2<T>& v) const;
+	constexpr T norm() const;
+	constexpr T sqnorm() const;
+	constexpr vec2<T> normalized() const;
+	constexpr vec2<T> rotated() const;
+	constexpr mat2<T> tensorproduct(const vec2<T>& v) const;
 
-	T& operator()(const uint32_t idx)&;
-	const T& operator()(const uint32_t idx) const&;
-	const T operator()(const uint32_t idx)&&;
+	constexpr T& operator()(const uint32_t idx)&;
+	constexpr const T& operator()(const uint32_t idx) const&;
+	constexpr const T operator()(const uint32_t idx)&&;
 
-	vec2<T>& operator=(const vec2<T> v)&;
-	vec2<T>& operator+=(const vec2<T> v)&;
-	vec2<T>& operator-=(const vec2<T> v)&;
-	vec2<T>& operator*=(const T s)&;
-	vec2<T>& operator/=(const T s)&;
+	constexpr vec2<T>& operator=(const vec2<T>& v)&;
+	constexpr vec2<T>& operator+=(const vec2<T>& v)&;
+	constexpr vec2<T>& operator-=(const vec2<T>& v)&;
+	constexpr vec2<T>& operator*=(const T s)&;
+	constexpr vec2<T>& operator/=(const T s)&;
 
 	template <class U>
-	operator vec2<U>() const;
+	constexpr operator vec2<U>() const;
 
-	inline static vec2<T> zero()
+	inline static constexpr vec2<T> zero()
 	{
 		return vec2<T>(0.0, 0.0);
 	}
 };
 
 template <class T>
-const vec2<T> operator+(const vec2<T> a, const vec2<T> b);
+constexpr vec2<T> operator+(const vec2<T>& a, const vec2<T>& b);
 template <class T>
-const vec2<T> operator-(const vec2<T> a, const vec2<T> b);
+constexpr vec2<T> operator-(const vec2<T>& a, const vec2<T>& b);
 template <class T>
-const vec2<T> operator*(const vec2<T> a, const vec2<T> b);
+constexpr vec2<T> operator*(const vec2<T>& a, const vec2<T>& b);
 template <class T>
-const vec2<T> operator-(const vec2<T> a);
+constexpr vec2<T> operator-(const vec2<T>& a);
 template <class T>
-const vec2<T> operator*(const T a, const vec2<T> b);
+constexpr vec2<T> operator*(const T a, const vec2<T>& b);
 template <class T>
-const vec2<T> operator*(const vec2<T> a, const T b);
+constexpr vec2<T> operator*(const vec2<T>& a, const T b);
 template <class T>
-const vec2<T> operator/(const vec2<T> a, const T b);
+constexpr vec2<T> operator/(const vec2<T>& a, const T b);
 
 template <class T>
-std::ostream& operator<<(std::ostream& os, const vec2<T> vec);
+std::ostream& operator<<(std::ostream& os, const vec2<T>& vec);
 
 ////////////////////
 
@@ -124,60 +185,60 @@ public:
 		};
 	};
 
-	explicit vec3(const T x, const T y, const T z);
-	explicit vec3(const T array[3]);
-	explicit vec3();
+	explicit constexpr vec3(const T x, const T y, const T z);
+	explicit constexpr vec3(const T array[3]);
+	explicit constexpr vec3();
 
-	T dot(const vec3<T> v) const;
-	vec3<T> cross(const vec3<T> v) const;
-	T norm() const;
-	T sqnorm() const;
-	vec3<T> normalized() const;
+	constexpr T dot(const vec3<T>& v) const;
+	constexpr vec3<T> cross(const vec3<T>& v) const;
+	constexpr T norm() const;
+	constexpr T sqnorm() const;
+	constexpr vec3<T> normalized() const;
 	mat3<T> torotation() const;
-	mat3<T> skew() const;
-	mat3<T> tensorproduct(const vec3<T> v) const;
+	constexpr mat3<T> skew() const;
+	constexpr mat3<T> tensorproduct(const vec3<T>& v) const;
 
-	T& operator()(const uint32_t idx)&;
-	const T& operator()(const uint32_t idx) const&;
-	const T operator()(const uint32_t idx)&&;
+	constexpr T& operator()(const uint32_t idx)&;
+	constexpr const T& operator()(const uint32_t idx) const&;
+	constexpr const T operator()(const uint32_t idx)&&;
 
-	vec3<T>& operator=(const vec3<T> v)&;
-	vec3<T>& operator+=(const vec3<T> v)&;
-	vec3<T>& operator-=(const vec3<T> v)&;
-	vec3<T>& operator*=(const T s)&;
-	vec3<T>& operator/=(const T s)&;
+	constexpr vec3<T>& operator=(const vec3<T>& v)&;
+	constexpr vec3<T>& operator+=(const vec3<T>& v)&;
+	constexpr vec3<T>& operator-=(const vec3<T>& v)&;
+	constexpr vec3<T>& operator*=(const T s)&;
+	constexpr vec3<T>& operator/=(const T s)&;
 
 	template <class U>
-	operator vec3<U>() const;
+	constexpr operator vec3<U>() const;
 
-	inline static vec3<T> zero()
+	inline static constexpr vec3<T> zero()
 	{
 		return vec3<T>(0.0, 0.0, 0.0);
 	}
 
-	inline static T STP(const vec3<T>& a, const vec3<T>& b, const vec3<T>& c)
+	inline static constexpr T STP(const vec3<T>& a, const vec3<T>& b, const vec3<T>& c)
 	{
 		return a.dot(b.cross(c));
 	}
 };
 
 template <class T>
-const vec3<T> operator+(const vec3<T> a, const vec3<T> b);
+constexpr vec3<T> operator+(const vec3<T>& a, const vec3<T>& b);
 template <class T>
-const vec3<T> operator-(const vec3<T> a, const vec3<T> b);
+constexpr vec3<T> operator-(const vec3<T>& a, const vec3<T>& b);
 template <class T>
-const vec3<T> operator*(const vec3<T> a, const vec3<T> b);
+constexpr vec3<T> operator*(const vec3<T>& a, const vec3<T>& b);
 template <class T>
-const vec3<T> operator-(const vec3<T> a);
+constexpr vec3<T> operator-(const vec3<T>& a);
 template <class T>
-const vec3<T> operator*(const T a, const vec3<T> b);
+constexpr vec3<T> operator*(const T a, const vec3<T>& b);
 template <class T>
-const vec3<T> operator*(const vec3<T> a, const T b);
+constexpr vec3<T> operator*(const vec3<T>& a, const T b);
 template <class T>
-const vec3<T> operator/(const vec3<T> a, const T b);
+constexpr vec3<T> operator/(const vec3<T>& a, const T b);
 
 template <class T>
-std::ostream& operator<<(std::ostream& os, const vec3<T> vec);
+std::ostream& operator<<(std::ostream& os, const vec3<T>& vec);
 
 ////////////////////
 
@@ -191,51 +252,51 @@ public:
 		};
 	};
 
-	explicit vec4(const T x, const T y, const T z, const T w);
-	explicit vec4(const T array[4]);
-	explicit vec4();
+	explicit constexpr vec4(const T x, const T y, const T z, const T w);
+	explicit constexpr vec4(const T array[4]);
+	explicit constexpr vec4();
 
-	T dot(const vec4<T> v) const;
-	T norm() const;
-	T sqnorm() const;
-	vec4<T> normalized() const;
+	constexpr T dot(const vec4<T>& v) const;
+	constexpr T norm() const;
+	constexpr T sqnorm() const;
+	constexpr vec4<T> normalized() const;
 
-	T& operator()(const uint32_t idx)&;
-	const T& operator()(const uint32_t idx) const&;
-	const T operator()(const uint32_t idx)&&;
+	constexpr T& operator()(const uint32_t idx)&;
+	constexpr const T& operator()(const uint32_t idx) const&;
+	constexpr const T operator()(const uint32_t idx)&&;
 
-	vec4<T>& operator=(const vec4<T> v)&;
-	vec4<T>& operator+=(const vec4<T> v)&;
-	vec4<T>& operator-=(const vec4<T> v)&;
-	vec4<T>& operator*=(const T s)&;
-	vec4<T>& operator/=(const T s)&;
+	constexpr vec4<T>& operator=(const vec4<T>& v)&;
+	constexpr vec4<T>& operator+=(const vec4<T>& v)&;
+	constexpr vec4<T>& operator-=(const vec4<T>& v)&;
+	constexpr vec4<T>& operator*=(const T s)&;
+	constexpr vec4<T>& operator/=(const T s)&;
 
 	template <class U>
-	operator vec4<U>() const;
+	constexpr operator vec4<U>() const;
 
-	inline static vec4<T> zero()
+	inline static constexpr vec4<T> zero()
 	{
 		return vec4<T>(0.0, 0.0, 0.0, 0.0);
 	}
 };
 
 template <class T>
-const vec4<T> operator+(const vec4<T> a, const vec4<T> b);
+constexpr vec4<T> operator+(const vec4<T>& a, const vec4<T>& b);
 template <class T>
-const vec4<T> operator-(const vec4<T> a, const vec4<T> b);
+constexpr vec4<T> operator-(const vec4<T>& a, const vec4<T>& b);
 template <class T>
-const vec4<T> operator*(const vec4<T> a, const vec4<T> b);
+constexpr vec4<T> operator*(const vec4<T>& a, const vec4<T>& b);
 template <class T>
-const vec4<T> operator-(const vec4<T> a);
+constexpr vec4<T> operator-(const vec4<T>& a);
 template <class T>
-const vec4<T> operator*(const T a, const vec4<T> b);
+constexpr vec4<T> operator*(const T a, const vec4<T>& b);
 template <class T>
-const vec4<T> operator*(const vec4<T> a, const T b);
+constexpr vec4<T> operator*(const vec4<T>& a, const T b);
 template <class T>
-const vec4<T> operator/(const vec4<T> a, const T b);
+constexpr vec4<T> operator/(const vec4<T>& a, const T b);
 
 template <class T>
-std::ostream& operator<<(std::ostream& os, const vec4<T> vec);
+std::ostream& operator<<(std::ostream& os, const vec4<T>& vec);
 
 ////////////////////
 
@@ -243,25 +304,27 @@ template <class T>
 class quaternion : public vec4<T> {
 public:
 	// q = w + xi + yj + zk
-	explicit quaternion(const T x, const T y, const T z, const T w);
-	explicit quaternion(const T array[4]);
-	explicit quaternion(const T s, const vec3<T> v);
-	explicit quaternion() {}
-	explicit quaternion(const vec3<T> v);
-
-	T gets() const;
-	vec3<T> getv() const;
-	quaternion<T> conjugate() const;
-	vec3<T> rotatevector(const vec3<T> x) const;
+	explicit constexpr quaternion(const T x, const T y, const T z, const T w);
+	explicit constexpr quaternion(const T array[4]);
+	explicit constexpr quaternion(const T s, const vec3<T>& v);
+	explicit constexpr quaternion() {}
+	explicit quaternion(const vec3<T>& v);
+
+	constexpr T gets() const;
+	constexpr vec3<T> getv() const;
+	constexpr quaternion<T> conjugate() const;
+	constexpr vec3<T> rotatevector(const vec3<T>& x) const;
+	// 単位 quaternion の回転行列
+	constexpr mat3<T> torotation() const;
 
 	// quaternion to rotation vector
-	inline static vec3<T> log(const quaternion<T> q)
+	inline static vec3<T> log(const quaternion<T>& q)
 	{
 		return std::acos(q.gets()) * q.getv().normalized();
 	}
 
 	// rotation vector to quaternion
-	inline static quaternion<T> exp(const vec3<T> w)
+	inline static quaternion<T> exp(const vec3<T>& w)
 	{
 		T halftheta = w.norm() * 0.5;
 		T sin = std::sin(halftheta);
@@ -270,38 +333,46 @@ public:
 		return quaternion<T>(n.x * sin, n.y * sin, n.z * sin, cos);
 	}
 
-	inline static quaternion<T> slerp(const quaternion<T> q0, quaternion<T> q1, T t)
+	// t = 0 で q0, t = 1 で q1
+	// q0, q1 がほぼ同じ向きのときは sin(halfTheta) で割れないので、正規化した線形補間にする
+	inline static quaternion<T> slerp(const quaternion<T>& q0, quaternion<T> q1, T t)
 	{
-		if (q0.dot(q1) < 0.0)
-			q1 *= -1.0;
-		quaternion<T> delta = q1 * q0.conjugate();
-		T halfTheta = std::acos(delta.w);
-		return (std::sin(t * halfTheta) / std::sin(halfTheta)) * q0 + (std::sin(halfTheta - t * halfTheta) / std::sin(halfTheta)) * q1;
+		T d = q0.dot(q1);
+		if (d < 0.0) {
+			q1 = -q1;
+			d = -d;
+		}
+		if (d > 0.9999) {
+			const quaternion<T> q = q0 + t * (q1 - q0);
+			return q / q.norm();
+		}
+		T halfTheta = std::acos(d);
+		return (std::sin(halfTheta - t * halfTheta) / std::sin(halfTheta)) * q0 + (std::sin(t * halfTheta) / std::sin(halfTheta)) * q1;
 	}
 
-	inline static quaternion<T> unit()
+	inline static constexpr quaternion<T> unit()
 	{
 		return quaternion<T>(0.0, 0.0, 0.0, 1.0);
 	}
 };
 
 template <class T>
-const quaternion<T> operator+(const quaternion<T> a, const quaternion<T> b);
+constexpr quaternion<T> operator+(const quaternion<T>& a, const quaternion<T>& b);
 template <class T>
-const quaternion<T> operator-(const quaternion<T> a, const quaternion<T> b);
+constexpr quaternion<T> operator-(const quaternion<T>& a, const quaternion<T>& b);
 template <class T>
-const quaternion<T> operator-(const quaternion<T> a);
+constexpr quaternion<T> operator-(const quaternion<T>& a);
 template <class T>
-const quaternion<T> operator*(const quaternion<T> a, const quaternion<T> b);
+constexpr quaternion<T> operator*(const quaternion<T>& a, const quaternion<T>& b);
 template <class T>
-const quaternion<T> operator*(const T a, const quaternion<T> b);
+constexpr quaternion<T> operator*(const T a, const quaternion<T>& b);
 template <class T>
-const quaternion<T> operator*(const quaternion<T> a, const T b);
+constexpr quaternion<T> operator*(const quaternion<T>& a, const T b);
 template <class T>
-const quaternion<T> operator/(const quaternion<T> a, const T b);
+constexpr quaternion<T> operator/(const quaternion<T>& a, const T b);
 
 template <class T>
-std::ostream& operator<<(std::ostream& os, const quaternion<T> vec);
+std::ostream& operator<<(std::ostream& os, const quaternion<T>& vec);
 
 ////////////////////
 
@@ -314,32 +385,32 @@ public:
 	// 0 1
 	// 2 3
 
-	explicit mat2(const T m00, const T m01, const T m10, const T m11);
-	explicit mat2(const vec2<T> row0, const vec2<T> row1);
-	explicit mat2(const T array[4]);
-	explicit mat2();
-
-	T dot(const mat2<T> m) const;
-	T norm() const;
-	T sqnorm() const;
-	mat2<T> transpose() const;
-	T trace() const;
-	T determinant() const;
-	mat2<T> adjugate() const;
-	mat2<T> inverse() const;
-
-	T& operator()(const uint32_t idxr, const uint32_t idxc)&;
-	const T& operator()(const uint32_t idxr, const uint32_t idxc) const&;
-	const T operator()(const uint32_t idxr, const uint32_t idxc)&&;
-
-	mat2<T>& operator=(const mat2<T> m)&;
-	mat2<T>& operator+=(const mat2<T> m)&;
-	mat2<T>& operator-=(const mat2<T> m)&;
-	mat2<T>& operator*=(const T s)&;
-	mat2<T>& operator/=(const T s)&;
+	explicit constexpr mat2(const T m00, const T m01, const T m10, const T m11);
+	explicit constexpr mat2(const vec2<T>& row0, const vec2<T>& row1);
+	explicit constexpr mat2(const T array[4]);
+	explicit constexpr mat2();
+
+	constexpr T dot(const mat2<T>& m) const;
+	constexpr T norm() const;
+	constexpr T sqnorm() const;
+	constexpr mat2<T> transpose() const;
+	constexpr T trace() const;
+	constexpr T determinant() const;
+	constexpr mat2<T> adjugate() const;
+	constexpr mat2<T> inverse() const;
+
+	constexpr T& operator()(const uint32_t idxr, const uint32_t idxc)&;
+	constexpr const T& operator()(const uint32_t idxr, const uint32_t idxc) const&;
+	constexpr const T operator()(const uint32_t idxr, const uint32_t idxc)&&;
+
+	constexpr mat2<T>& operator=(const mat2<T>& m)&;
+	constexpr mat2<T>& operator+=(const mat2<T>& m)&;
+	constexpr mat2<T>& operator-=(const mat2<T>& m)&;
+	constexpr mat2<T>& operator*=(const T s)&;
+	constexpr mat2<T>& operator/=(const T s)&;
 
 	template <class U>
-	operator mat2<U>() const;
+	constexpr operator mat2<U>() const;
 
 	inline constexpr static mat2<T> identity()
 	{
@@ -352,24 +423,24 @@ public:
 };
 
 template <class T>
-const mat2<T> operator+(const mat2<T> a, const mat2<T> b);
+constexpr mat2<T> operator+(const mat2<T>& a, const mat2<T>& b);
 template <class T>
-const mat2<T> operator-(const mat2<T> a, const mat2<T> b);
+constexpr mat2<T> operator-(const mat2<T>& a, const mat2<T>& b);
 template <class T>
-const mat2<T> operator-(const mat2<T> a);
+constexpr mat2<T> operator-(const mat2<T>& a);
 template <class T>
-const mat2<T> operator*(const T a, const mat2<T> b);
+constexpr mat2<T> operator*(const T a, const mat2<T>& b);
 template <class T>
-const mat2<T> operator*(const mat2<T> a, const T b);
+constexpr mat2<T> operator*(const mat2<T>& a, const T b);
 template <class T>
-const mat2<T> operator*(const mat2<T> a, const mat2<T> b);
+constexpr mat2<T> operator*(const mat2<T>& a, const mat2<T>& b);
 template <class T>
-const mat2<T> operator*(const mat2<T> a, const vec2<T> b);
+constexpr vec2<T> operator*(const mat2<T>& a, const vec2<T>& b);
 template <class T>
-const mat2<T> operator/(const mat2<T> a, const T b);
+constexpr mat2<T> operator/(const mat2<T>& a, const T b);
 
 template <class T>
-std::ostream& operator<<(std::ostream& os, const mat2<T> mat);
+std::ostream& operator<<(std::ostream& os, const mat2<T>& mat);
 
 ////////////////////
 
@@ -383,32 +454,32 @@ public:
 	// 3 4 5
 	// 6 7 8
 
-	explicit mat3(const T m00, const T m01, const T m02, const T m10, const T m11, const T m12, const T m20, const T m21, const T m22);
-	explicit mat3(const T array[9]);
-	explicit mat3(const vec3<T> row0, const vec3<T> row1, const vec3<T> row2);
-	explicit mat3();
-
-	T dot(const mat3<T> m) const;
-	T norm() const;
-	T sqnorm() const;
-	mat3<T> transpose() const;
-	T trace() const;
-	T determinant() const;
-	mat3<T> adjugate() const;
-	mat3<T> inverse() const;
-
-	T& operator()(const uint32_t idxr, const uint32_t idxc)&;
-	const T& operator()(const uint32_t idxr, const uint32_t idxc) const&;
-	const T operator()(const uint32_t idxr, const uint32_t idxc)&&;
-
-	mat3<T>& operator=(const mat3<T> m)&;
-	mat3<T>& operator+=(const mat3<T> m)&;
-	mat3<T>& operator-=(const mat3<T> m)&;
-	mat3<T>& operator*=(const T s)&;
-	mat3<T>& operator/=(const T s)&;
+	explicit constexpr mat3(const T m00, const T m01, const T m02, const T m10, const T m11, const T m12, const T m20, const T m21, const T m22);
+	explicit constexpr mat3(const T array[9]);
+	explicit constexpr mat3(const vec3<T>& row0, const vec3<T>& row1, const vec3<T>& row2);
+	explicit constexpr mat3();
+
+	constexpr T dot(const mat3<T>& m) const;
+	constexpr T norm() const;
+	constexpr T sqnorm() const;
+	constexpr mat3<T> transpose() const;
+	constexpr T trace() const;
+	constexpr T determinant() const;
+	constexpr mat3<T> adjugate() const;
+	constexpr mat3<T> inverse() const;
+
+	constexpr T& operator()(const uint32_t idxr, const uint32_t idxc)&;
+	constexpr const T& operator()(const uint32_t idxr, const uint32_t idxc) const&;
+	constexpr const T operator()(const uint32_t idxr, const uint32_t idxc)&&;
+
+	constexpr mat3<T>& operator=(const mat3<T>& m)&;
+	constexpr mat3<T>& operator+=(const mat3<T>& m)&;
+	constexpr mat3<T>& operator-=(const mat3<T>& m)&;
+	constexpr mat3<T>& operator*=(const T s)&;
+	constexpr mat3<T>& operator/=(const T s)&;
 
 	template <class U>
-	operator mat3<U>() const;
+	constexpr operator mat3<U>() const;
 
 	inline constexpr static mat3<T> identity()
 	{
@@ -421,24 +492,24 @@ public:
 };
 
 template <class T>
-const mat3<T> operator+(const mat3<T> a, const mat3<T> b);
+constexpr mat3<T> operator+(const mat3<T>& a, const mat3<T>& b);
 template <class T>
-const mat3<T> operator-(const mat3<T> a, const mat3<T> b);
+constexpr mat3<T> operator-(const mat3<T>& a, const mat3<T>& b);
 template <class T>
-const mat3<T> operator-(const mat3<T> a);
+constexpr mat3<T> operator-(const mat3<T>& a);
 template <class T>
-const mat3<T> operator*(const T a, const mat3<T> b);
+constexpr mat3<T> operator*(const T a, const mat3<T>& b);
 template <class T>
-const mat3<T> operator*(const mat3<T> a, const T b);
+constexpr mat3<T> operator*(const mat3<T>& a, const T b);
 template <class T>
-const mat3<T> operator*(const mat3<T> a, const mat3<T> b);
+constexpr mat3<T> operator*(const mat3<T>& a, const mat3<T>& b);
 template <class T>
-const mat3<T> operator*(const mat3<T> a, const vec3<T> b);
+constexpr vec3<T> operator*(const mat3<T>& a, const vec3<T>& b);
 template <class T>
-const mat3<T> operator/(const mat3<T> a, const T b);
+constexpr mat3<T> operator/(const mat3<T>& a, const T b);
 
 template <class T>
-std::ostream& operator<<(std::ostream& os, const mat3<T> mat);
+std::ostream& operator<<(std::ostream& os, const mat3<T>& mat);
 
 ////////////////////
 
@@ -454,28 +525,33 @@ public:
 	// 8  9 10 11
 	//12 13 14 15
 
-	explicit mat4(const T m00, const T m01, const T m02, const T m03,
+	explicit constexpr mat4(const T m00, const T m01, const T m02, const T m03,
 		const T m10, const T m11, const T m12, const T m13,
 		const T m20, const T m21, const T m22, const T m23,
 		const T m30, const T m31, const T m32, const T m33);
-	explicit mat4(const T array[16]);
-	explicit mat4(const mat3<T> mat, const vec3<T> vec);
-	explicit mat4();
-
-	mat4<T> transpose() const;
-
-	T& operator()(const uint32_t idxr, const uint32_t idxc)&;
-	const T& operator()(const uint32_t idxr, const uint32_t idxc) const&;
-	const T operator()(const uint32_t idxr, const uint32_t idxc)&&;
-
-	mat4<T>& operator=(const mat4<T> m)&;
-	mat4<T>& operator+=(const mat4<T> m)&;
-	mat4<T>& operator-=(const mat4<T> m)&;
-	mat4<T>& operator*=(const T s)&;
-	mat4<T>& operator/=(const T s)&;
+	explicit constexpr mat4(const T array[16]);
+	explicit constexpr mat4(const mat3<T>& mat, const vec3<T>& vec);
+	explicit constexpr mat4();
+
+	constexpr mat4<T> transpose() const;
+	constexpr T determinant() const;
+	constexpr mat4<T> adjugate() const;
+	constexpr mat4<T> inverse() const;
+	// 最後の行が (0, 0, 0, 1) の行列の逆行列 (左上 3x3 の逆行列と平行移動だけで求める)
+	constexpr mat4<T> affineinverse() const;
+
+	constexpr T& operator()(const uint32_t idxr, const uint32_t idxc)&;
+	constexpr const T& operator()(const uint32_t idxr, const uint32_t idxc) const&;
+	constexpr const T operator()(const uint32_t idxr, const uint32_t idxc)&&;
+
+	constexpr mat4<T>& operator=(const mat4<T>& m)&;
+	constexpr mat4<T>& operator+=(const mat4<T>& m)&;
+	constexpr mat4<T>& operator-=(const mat4<T>& m)&;
+	constexpr mat4<T>& operator*=(const T s)&;
+	constexpr mat4<T>& operator/=(const T s)&;
 
 	template <class U>
-	operator mat4<U>() const;
+	constexpr operator mat4<U>() const;
 
 	inline static constexpr mat4<T> identity()
 	{
@@ -494,72 +570,72 @@ public:
 };
 
 template <class T>
-const mat4<T> operator+(const mat4<T> a, const mat4<T> b);
+constexpr mat4<T> operator+(const mat4<T>& a, const mat4<T>& b);
 template <class T>
-const mat4<T> operator-(const mat4<T> a, const mat4<T> b);
+constexpr mat4<T> operator-(const mat4<T>& a, const mat4<T>& b);
 template <class T>
-const mat4<T> operator-(const mat4<T> a);
+constexpr mat4<T> operator-(const mat4<T>& a);
 template <class T>
-const mat4<T> operator*(const T a, const mat4<T> b);
+constexpr mat4<T> operator*(const T a, const mat4<T>& b);
 template <class T>
-const mat4<T> operator*(const mat4<T> a, const T b);
+constexpr mat4<T> operator*(const mat4<T>& a, const T b);
 template <class T>
-const mat4<T> operator*(const mat4<T> a, const mat4<T> b);
+constexpr mat4<T> operator*(const mat4<T>& a, const mat4<T>& b);
 template <class T>
-const mat4<T> operator*(const mat4<T> a, const vec4<T> b);
+constexpr vec4<T> operator*(const mat4<T>& a, const vec4<T>& b);
 template <class T>
-const mat4<T> operator/(const mat4<T> a, const T b);
+constexpr mat4<T> operator/(const mat4<T>& a, const T b);
 
 template <class T>
-std::ostream& operator<<(std::ostream& os, const mat4<T> mat);
+std::ostream& operator<<(std::ostream& os, const mat4<T>& mat);
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
 template <class T>
-inline vec2<T>::vec2(const T x, const T y)
+inline constexpr vec2<T>::vec2(const T x, const T y)
 	: x(x)
 	, y(y)
 {
 }
 template <class T>
-inline vec2<T>::vec2(const T array[2])
+inline constexpr vec2<T>::vec2(const T array[2])
 	: x(array[0])
 	, y(array[1])
 {
 }
 template <class T>
-inline vec2<T>::vec2()
+inline constexpr vec2<T>::vec2()
 {
 }
 
 template <class T>
-inline T vec2<T>::dot(const vec2<T> v) const
+inline constexpr T vec2<T>::dot(const vec2<T>& v) const
 {
 	return x * v.x + y * v.y;
 }
 template <class T>
-inline T vec2<T>::cross(const vec2<T> v) const
+inline constexpr T vec2<T>::cross(const vec2<T>& v) const
 {
 	return x * v.y - y * v.x;
 }
 template <class T>
-inline T vec2<T>::sqnorm() const
+inline constexpr T vec2<T>::sqnorm() const
 {
 	return x * x + y * y;
 }
 template <class T>
-inline T vec2<T>::norm() const
+inline constexpr T vec2<T>::norm() const
 {
 	T t = x * x + y * y;
 	if (t < 0.0000001)
 		return 0.0;
 	else
-		return std::sqrt(t);
+		return MathSqrt(t);
 }
 template <class T>
-inline vec2<T> vec2<T>::normalized() const
+inline constexpr vec2<T> vec2<T>::normalized() const
 {
 	T norm = this->norm();
 	if (norm < 0.0000001)
@@ -568,57 +644,63 @@ inline vec2<T> vec2<T>::normalized() const
 		return (*this) / norm;
 }
 template <class T>
-inline vec2<T> vec2<T>::rotated() const
+inline constexpr vec2<T> vec2<T>::rotated() const
 {
 	return vec2<T>(-y, x);
 }
 
 template <class T>
-inline T& vec2<T>::operator()(const uint32_t idx)&
+inline constexpr T& vec2<T>::operator()(const uint32_t idx)&
 {
+	if (std::is_constant_evaluated())
+		return idx == 0 ? x : y;
 	return cmp[idx];
 }
 template <class T>
-inline const T& vec2<T>::operator()(const uint32_t idx) const&
+inline constexpr const T& vec2<T>::operator()(const uint32_t idx) const&
 {
+	if (std::is_constant_evaluated())
+		return idx == 0 ? x : y;
 	return cmp[idx];
 }
 template <class T>
-inline const T vec2<T>::operator()(const uint32_t idx)&&
+inline constexpr const T vec2<T>::operator()(const uint32_t idx)&&
 {
+	if (std::is_constant_evaluated())
+		return idx == 0 ? x : y;
 	return cmp[idx];
 }
 
 template <class T>
-inline vec2<T>& vec2<T>::operator=(const vec2<T> v)&
+inline constexpr vec2<T>& vec2<T>::operator=(const vec2<T>& v)&
 {
 	x = v.x;
 	y = v.y;
 	return *this;
 }
 template <class T>
-inline vec2<T>& vec2<T>::operator+=(const vec2<T> v)&
+inline constexpr vec2<T>& vec2<T>::operator+=(const vec2<T>& v)&
 {
 	x += v.x;
 	y += v.y;
 	return *this;
 }
 template <class T>
-inline vec2<T>& vec2<T>::operator-=(const vec2<T> v)&
+inline constexpr vec2<T>& vec2<T>::operator-=(const vec2<T>& v)&
 {
 	x -= v.x;
 	y -= v.y;
 	return *this;
 }
 template <class T>
-inline vec2<T>& vec2<T>::operator*=(const T s)&
+inline constexpr vec2<T>& vec2<T>::operator*=(const T s)&
 {
 	x *= s;
 	y *= s;
 	return *this;
 }
 template <class T>
-inline vec2<T>& vec2<T>::operator/=(const T s)&
+inline constexpr vec2<T>& vec2<T>::operator/=(const T s)&
 {
 	x /= s;
 	y /= s;
@@ -627,7 +709,7 @@ inline vec2<T>& vec2<T>::operator/=(const T s)&
 
 template <class T>
 template <class U>
-inline vec2<T>::operator vec2<U>() const
+inline constexpr vec2<T>::operator vec2<U>() const
 {
 	return vec2<U>(
 		static_cast<U>(x),
@@ -635,49 +717,49 @@ inline vec2<T>::operator vec2<U>() const
 }
 
 template <class T>
-inline const vec2<T> operator+(const vec2<T> a, const vec2<T> b)
+inline constexpr vec2<T> operator+(const vec2<T>& a, const vec2<T>& b)
 {
 	return vec2<T>(
 		a.x + b.x,
 		a.y + b.y);
 }
 template <class T>
-inline const vec2<T> operator-(const vec2<T> a, const vec2<T> b)
+inline constexpr vec2<T> operator-(const vec2<T>& a, const vec2<T>& b)
 {
 	return vec2<T>(
 		a.x - b.x,
 		a.y - b.y);
 }
 template <class T>
-inline const vec2<T> operator*(const vec2<T> a, const vec2<T> b)
+inline constexpr vec2<T> operator*(const vec2<T>& a, const vec2<T>& b)
 {
 	return vec2<T>(
 		a.x * b.x,
 		a.y * b.y);
 }
 template <class T>
-inline const vec2<T> operator-(const vec2<T> a)
+inline constexpr vec2<T> operator-(const vec2<T>& a)
 {
 	return vec2<T>(
 		-a.x,
 		-a.y);
 }
 template <class T>
-inline const vec2<T> operator*(const T a, const vec2<T> b)
+inline constexpr vec2<T> operator*(const T a, const vec2<T>& b)
 {
 	return vec2<T>(
 		a * b.x,
 		a * b.y);
 }
 template <class T>
-inline const vec2<T> operator*(const vec2<T> a, const T b)
+inline constexpr vec2<T> operator*(const vec2<T>& a, const T b)
 {
 	return vec2<T>(
 		b * a.x,
 		b * a.y);
 }
 template <class T>
-inline const vec2<T> operator/(const vec2<T> a, const T b)
+inline constexpr vec2<T> operator/(const vec2<T>& a, const T b)
 {
 	return vec2<T>(
 		a.x / b,
@@ -685,7 +767,7 @@ inline const vec2<T> operator/(const vec2<T> a, const T b)
 }
 
 template <class T>
-inline std::ostream& operator<<(std::ostream& os, const vec2<T> vec)
+inline std::ostream& operator<<(std::ostream& os, const vec2<T>& vec)
 {
 	os << vec.x << " " << vec.y;
 	return os;
@@ -694,31 +776,31 @@ inline std::ostream& operator<<(std::ostream& os, const vec2<T> vec)
 ////////////////////
 
 template <class T>
-inline vec3<T>::vec3(const T x, const T y, const T z)
+inline constexpr vec3<T>::vec3(const T x, const T y, const T z)
 	: x(x)
 	, y(y)
 	, z(z)
 {
 }
 template <class T>
-inline vec3<T>::vec3(const T array[3])
+inline constexpr vec3<T>::vec3(const T array[3])
 	: x(array[0])
 	, y(array[1])
 	, z(array[2])
 {
 }
 template <class T>
-inline vec3<T>::vec3()
+inline constexpr vec3<T>::vec3()
 {
 }
 
 template <class T>
-inline T vec3<T>::dot(const vec3<T> v) const
+inline constexpr T vec3<T>::dot(const vec3<T>& v) const
 {
 	return x * v.x + y * v.y + z * v.z;
 }
 template <class T>
-inline vec3<T> vec3<T>::cross(const vec3<T> v) const
+inline constexpr vec3<T> vec3<T>::cross(const vec3<T>& v) const
 {
 	return vec3<T>(
 		y * v.z - z * v.y,
@@ -726,21 +808,21 @@ inline vec3<T> vec3<T>::cross(const vec3<T> v) const
 		x * v.y - y * v.x);
 }
 template <class T>
-inline T vec3<T>::sqnorm() const
+inline constexpr T vec3<T>::sqnorm() const
 {
 	return x * x + y * y + z * z;
 }
 template <class T>
-inline T vec3<T>::norm() const
+inline constexpr T vec3<T>::norm() const
 {
 	T t = x * x + y * y + z * z;
 	if (t < 0.0000001)
 		return 0.0;
 	else
-		return std::sqrt(t);
+		return MathSqrt(t);
 }
 template <class T>
-inline vec3<T> vec3<T>::normalized() const
+inline constexpr vec3<T> vec3<T>::normalized() const
 {
 	T norm = this->norm();
 	if (norm < 0.0000001)
@@ -761,7 +843,7 @@ inline mat3<T> vec3<T>::torotation() const
 	return cos * mat3<T>::identity() + ((1 - cos) / omega2) * this->tensorproduct(*this) + (sin / omega) * this->skew();
 }
 template <class T>
-inline mat3<T> vec3<T>::skew() const
+inline constexpr mat3<T> vec3<T>::skew() const
 {
 	return mat3<T>(
 		vec3(0.0, -z, y),
@@ -769,7 +851,7 @@ inline mat3<T> vec3<T>::skew() const
 		vec3(-y, x, 0.0));
 }
 template <class T>
-inline mat3<T> vec3<T>::tensorproduct(const vec3<T> v) const
+inline constexpr mat3<T> vec3<T>::tensorproduct(const vec3<T>& v) const
 {
 	return mat3<T>(
 		vec3(x * v.x, x * v.y, x * v.z),
@@ -778,23 +860,29 @@ inline mat3<T> vec3<T>::tensorproduct(const vec3<T> v) const
 }
 
 template <class T>
-inline T& vec3<T>::operator()(const uint32_t idx)&
+inline constexpr T& vec3<T>::operator()(const uint32_t idx)&
 {
+	if (std::is_constant_evaluated())
+		return idx == 0 ? x : (idx == 1 ? y : z);
 	return cmp[idx];
 }
 template <class T>
-inline const T& vec3<T>::operator()(const uint32_t idx) const&
+inline constexpr const T& vec3<T>::operator()(const uint32_t idx) const&
 {
+	if (std::is_constant_evaluated())
+		return idx == 0 ? x : (idx == 1 ? y : z);
 	return cmp[idx];
 }
 template <class T>
-inline const T vec3<T>::operator()(const uint32_t idx)&&
+inline constexpr const T vec3<T>::operator()(const uint32_t idx)&&
 {
+	if (std::is_constant_evaluated())
+		return idx == 0 ? x : (idx == 1 ? y : z);
 	return cmp[idx];
 }
 
 template <class T>
-inline vec3<T>& vec3<T>::operator=(const vec3<T> v)&
+inline constexpr vec3<T>& vec3<T>::operator=(const vec3<T>& v)&
 {
 	x = v.x;
 	y = v.y;
@@ -802,7 +890,7 @@ inline vec3<T>& vec3<T>::operator=(const vec3<T> v)&
 	return *this;
 }
 template <class T>
-inline vec3<T>& vec3<T>::operator+=(const vec3<T> v)&
+inline constexpr vec3<T>& vec3<T>::operator+=(const vec3<T>& v)&
 {
 	x += v.x;
 	y += v.y;
@@ -810,7 +898,7 @@ inline vec3<T>& vec3<T>::operator+=(const vec3<T> v)&
 	return *this;
 }
 template <class T>
-inline vec3<T>& vec3<T>::operator-=(const vec3<T> v)&
+inline constexpr vec3<T>& vec3<T>::operator-=(const vec3<T>& v)&
 {
 	x -= v.x;
 	y -= v.y;
@@ -818,7 +906,7 @@ inline vec3<T>& vec3<T>::operator-=(const vec3<T> v)&
 	return *this;
 }
 template <class T>
-inline vec3<T>& vec3<T>::operator*=(const T s)&
+inline constexpr vec3<T>& vec3<T>::operator*=(const T s)&
 {
 	x *= s;
 	y *= s;
@@ -826,7 +914,7 @@ inline vec3<T>& vec3<T>::operator*=(const T s)&
 	return *this;
 }
 template <class T>
-inline vec3<T>& vec3<T>::operator/=(const T s)&
+inline constexpr vec3<T>& vec3<T>::operator/=(const T s)&
 {
 	x /= s;
 	y /= s;
@@ -836,7 +924,7 @@ inline vec3<T>& vec3<T>::operator/=(const T s)&
 
 template <class T>
 template <class U>
-inline vec3<T>::operator vec3<U>() const
+inline constexpr vec3<T>::operator vec3<U>() const
 {
 	return vec3<U>(
 		static_cast<U>(x),
@@ -845,7 +933,7 @@ inline vec3<T>::operator vec3<U>() const
 }
 
 template <class T>
-inline const vec3<T> operator+(const vec3<T> a, const vec3<T> b)
+inline constexpr vec3<T> operator+(const vec3<T>& a, const vec3<T>& b)
 {
 	return vec3<T>(
 		a.x + b.x,
@@ -853,7 +941,7 @@ inline const vec3<T> operator+(const vec3<T> a, const vec3<T> b)
 		a.z + b.z);
 }
 template <class T>
-inline const vec3<T> operator-(const vec3<T> a, const vec3<T> b)
+inline constexpr vec3<T> operator-(const vec3<T>& a, const vec3<T>& b)
 {
 	return vec3<T>(
 		a.x - b.x,
@@ -861,7 +949,7 @@ inline const vec3<T> operator-(const vec3<T> a, const vec3<T> b)
 		a.z - b.z);
 }
 template <class T>
-inline const vec3<T> operator*(const vec3<T> a, const vec3<T> b)
+inline constexpr vec3<T> operator*(const vec3<T>& a, const vec3<T>& b)
 {
 	return vec3<T>(
 		a.x * b.x,
@@ -869,7 +957,7 @@ inline const vec3<T> operator*(const vec3<T> a, const vec3<T> b)
 		a.z * b.z);
 }
 template <class T>
-inline const vec3<T> operator-(const vec3<T> a)
+inline constexpr vec3<T> operator-(const vec3<T>& a)
 {
 	return vec3<T>(
 		-a.x,
@@ -877,7 +965,7 @@ inline const vec3<T> operator-(const vec3<T> a)
 		-a.z);
 }
 template <class T>
-inline const vec3<T> operator*(const T a, const vec3<T> b)
+inline constexpr vec3<T> operator*(const T a, const vec3<T>& b)
 {
 	return vec3<T>(
 		a * b.x,
@@ -885,7 +973,7 @@ inline const vec3<T> operator*(const T a, const vec3<T> b)
 		a * b.z);
 }
 template <class T>
-inline const vec3<T> operator*(const vec3<T> a, const T b)
+inline constexpr vec3<T> operator*(const vec3<T>& a, const T b)
 {
 	return vec3<T>(
 		b * a.x,
@@ -893,7 +981,7 @@ inline const vec3<T> operator*(const vec3<T> a, const T b)
 		b * a.z);
 }
 template <class T>
-inline const vec3<T> operator/(const vec3<T> a, const T b)
+inline constexpr vec3<T> operator/(const vec3<T>& a, const T b)
 {
 	return vec3<T>(
 		a.x / b,
@@ -902,7 +990,7 @@ inline const vec3<T> operator/(const vec3<T> a, const T b)
 }
 
 template <class T>
-inline std::ostream& operator<<(std::ostream& os, const vec3<T> vec)
+inline std::ostream& operator<<(std::ostream& os, const vec3<T>& vec)
 {
 	os << vec.x << " " << vec.y << " " << vec.z;
 	return os;
@@ -911,7 +999,7 @@ inline std::ostream& operator<<(std::ostream& os, const vec3<T> vec)
 ////////////////////
 //
 template <class T>
-inline vec4<T>::vec4(const T x, const T y, const T z, const T w)
+inline constexpr vec4<T>::vec4(const T x, const T y, const T z, const T w)
 	: x(x)
 	, y(y)
 	, z(z)
@@ -919,7 +1007,7 @@ inline vec4<T>::vec4(const T x, const T y, const T z, const T w)
 {
 }
 template <class T>
-inline vec4<T>::vec4(const T array[4])
+inline constexpr vec4<T>::vec4(const T array[4])
 	: x(array[0])
 	, y(array[1])
 	, z(array[2])
@@ -927,32 +1015,41 @@ inline vec4<T>::vec4(const T array[4])
 {
 }
 template <class T>
-inline vec4<T>::vec4()
+inline constexpr vec4<T>::vec4()
 {
 }
 
 template <class T>
-inline T vec4<T>::dot(const vec4<T> v) const
+inline constexpr T vec4<T>::dot(const vec4<T>& v) const
 {
 	return x * v.x + y * v.y + z * v.z + w * v.w;
 }
 template <class T>
-inline T vec4<T>::sqnorm() const
+inline constexpr T vec4<T>::sqnorm() const
 {
 	return x * x + y * y + z * z + w * w;
 }
 template <class T>
-inline T vec4<T>::norm() const
+inline constexpr T vec4<T>::norm() const
 {
 	T t = x * x + y * y + z * z + w * w;
 	if (t < 0.0000001)
 		return 0.0;
 	else
-		return std::sqrt(t);
+		return MathSqrt(t);
 }
 template <class T>
-inline vec4<T> vec4<T>::normalized() const
+inline constexpr vec4<T> vec4<T>::normalized() const
 {
+#if defined(MATHFUNC_SIMD)
+	if constexpr (std::is_same_v<T, float>) {
+		if (!std::is_constant_evaluated()) {
+			vec4<T> ret;
+			SimdVec4Normalized(cmp, ret.cmp);
+			return ret;
+		}
+	}
+#endif
 	T norm = this->norm();
 	if (norm < 0.0000001)
 		return vec4<T>::zero();
@@ -961,23 +1058,29 @@ inline vec4<T> vec4<T>::normalized() const
 }
 
 template <class T>
-inline T& vec4<T>::operator()(const uint32_t idx)&
+inline constexpr T& vec4<T>::operator()(const uint32_t idx)&
 {
+	if (std::is_constant_evaluated())
+		return idx == 0 ? x : (idx == 1 ? y : (idx == 2 ? z : w));
 	return cmp[idx];
 }
 template <class T>
-inline const T& vec4<T>::operator()(const uint32_t idx) const&
+inline constexpr const T& vec4<T>::operator()(const uint32_t idx) const&
 {
+	if (std::is_constant_evaluated())
+		return idx == 0 ? x : (idx == 1 ? y : (idx == 2 ? z : w));
 	return cmp[idx];
 }
 template <class T>
-inline const T vec4<T>::operator()(const uint32_t idx)&&
+inline constexpr const T vec4<T>::operator()(const uint32_t idx)&&
 {
+	if (std::is_constant_evaluated())
+		return idx == 0 ? x : (idx == 1 ? y : (idx == 2 ? z : w));
 	return cmp[idx];
 }
 
 template <class T>
-inline vec4<T>& vec4<T>::operator=(const vec4<T> v)&
+inline constexpr vec4<T>& vec4<T>::operator=(const vec4<T>& v)&
 {
 	x = v.x;
 	y = v.y;
@@ -986,7 +1089,7 @@ inline vec4<T>& vec4<T>::operator=(const vec4<T> v)&
 	return *this;
 }
 template <class T>
-inline vec4<T>& vec4<T>::operator+=(const vec4<T> v)&
+inline constexpr vec4<T>& vec4<T>::operator+=(const vec4<T>& v)&
 {
 	x += v.x;
 	y += v.y;
@@ -995,7 +1098,7 @@ inline vec4<T>& vec4<T>::operator+=(const vec4<T> v)&
 	return *this;
 }
 template <class T>
-inline vec4<T>& vec4<T>::operator-=(const vec4<T> v)&
+inline constexpr vec4<T>& vec4<T>::operator-=(const vec4<T>& v)&
 {
 	x -= v.x;
 	y -= v.y;
@@ -1004,7 +1107,7 @@ inline vec4<T>& vec4<T>::operator-=(const vec4<T> v)&
 	return *this;
 }
 template <class T>
-inline vec4<T>& vec4<T>::operator*=(const T s)&
+inline constexpr vec4<T>& vec4<T>::operator*=(const T s)&
 {
 	x *= s;
 	y *= s;
@@ -1013,7 +1116,7 @@ inline vec4<T>& vec4<T>::operator*=(const T s)&
 	return *this;
 }
 template <class T>
-inline vec4<T>& vec4<T>::operator/=(const T s)&
+inline constexpr vec4<T>& vec4<T>::operator/=(const T s)&
 {
 	x /= s;
 	y /= s;
@@ -1024,7 +1127,7 @@ inline vec4<T>& vec4<T>::operator/=(const T s)&
 
 template <class T>
 template <class U>
-inline vec4<T>::operator vec4<U>() const
+inline constexpr vec4<T>::operator vec4<U>() const
 {
 	return vec4<U>(
 		static_cast<U>(x),
@@ -1034,7 +1137,7 @@ inline vec4<T>::operator vec4<U>() const
 }
 
 template <class T>
-inline const vec4<T> operator+(const vec4<T> a, const vec4<T> b)
+inline constexpr vec4<T> operator+(const vec4<T>& a, const vec4<T>& b)
 {
 	return vec4<T>(
 		a.x + b.x,
@@ -1043,7 +1146,7 @@ inline const vec4<T> operator+(const vec4<T> a, const vec4<T> b)
 		a.w + b.w);
 }
 template <class T>
-inline const vec4<T> operator-(const vec4<T> a, const vec4<T> b)
+inline constexpr vec4<T> operator-(const vec4<T>& a, const vec4<T>& b)
 {
 	return vec4<T>(
 		a.x - b.x,
@@ -1052,7 +1155,7 @@ inline const vec4<T> operator-(const vec4<T> a, const vec4<T> b)
 		a.w - b.w);
 }
 template <class T>
-inline const vec4<T> operator*(const vec4<T> a, const vec4<T> b)
+inline constexpr vec4<T> operator*(const vec4<T>& a, const vec4<T>& b)
 {
 	return vec4<T>(
 		a.x * b.x,
@@ -1061,7 +1164,7 @@ inline const vec4<T> operator*(const vec4<T> a, const vec4<T> b)
 		a.w * b.w);
 }
 template <class T>
-inline const vec4<T> operator-(const vec4<T> a)
+inline constexpr vec4<T> operator-(const vec4<T>& a)
 {
 	return vec4<T>(
 		-a.x,
@@ -1070,7 +1173,7 @@ inline const vec4<T> operator-(const vec4<T> a)
 		-a.w);
 }
 template <class T>
-inline const vec4<T> operator*(const T a, const vec4<T> b)
+inline constexpr vec4<T> operator*(const T a, const vec4<T>& b)
 {
 	return vec4<T>(
 		a * b.x,
@@ -1079,7 +1182,7 @@ inline const vec4<T> operator*(const T a, const vec4<T> b)
 		a * b.w);
 }
 template <class T>
-inline const vec4<T> operator*(const vec4<T> a, const T b)
+inline constexpr vec4<T> operator*(const vec4<T>& a, const T b)
 {
 	return vec4<T>(
 		b * a.x,
@@ -1088,7 +1191,7 @@ inline const vec4<T> operator*(const vec4<T> a, const T b)
 		b * a.w);
 }
 template <class T>
-inline const vec4<T> operator/(const vec4<T> a, const T b)
+inline constexpr vec4<T> operator/(const vec4<T>& a, const T b)
 {
 	return vec4<T>(
 		a.x / b,
@@ -1098,7 +1201,7 @@ inline const vec4<T> operator/(const vec4<T> a, const T b)
 }
 
 template <class T>
-inline std::ostream& operator<<(std::ostream& os, const vec4<T> vec)
+inline std::ostream& operator<<(std::ostream& os, const vec4<T>& vec)
 {
 	os << vec.x << " " << vec.y << " " << vec.z << " " << vec.w;
 	return os;
@@ -1107,54 +1210,66 @@ inline std::ostream& operator<<(std::ostream& os, const vec4<T> vec)
 ////////////////////
 
 template <class T>
-inline quaternion<T>::quaternion(const T x, const T y, const T z, const T w)
+inline constexpr quaternion<T>::quaternion(const T x, const T y, const T z, const T w)
 	: vec4<T>(x, y, z, w)
 {
 }
 template <class T>
-inline quaternion<T>::quaternion(const T array[4])
+inline constexpr quaternion<T>::quaternion(const T array[4])
 	: vec4<T>(array)
 {
 }
 template <class T>
-inline quaternion<T>::quaternion(const T s, const vec3<T> v)
+inline constexpr quaternion<T>::quaternion(const T s, const vec3<T>& v)
 	: vec4<T>(v.x, v.y, v.z, s)
 {
 }
 template <class T>
-inline quaternion<T>::quaternion(const vec3<T> v)
+inline quaternion<T>::quaternion(const vec3<T>& v)
 {
 	*this = quaternion<T>::exp(v);
 }
 
 template <class T>
-inline T quaternion<T>::gets() const
+inline constexpr T quaternion<T>::gets() const
 {
 	return this->w;
 }
 
 template <class T>
-inline vec3<T> quaternion<T>::getv() const
+inline constexpr vec3<T> quaternion<T>::getv() const
 {
 	return vec3<T>(this->x, this->y, this->z);
 }
 
 template <class T>
-inline quaternion<T> quaternion<T>::conjugate() const
+inline constexpr quaternion<T> quaternion<T>::conjugate() const
 {
 	return quaternion<T>(-this->x, -this->y, -this->z, this->w);
 }
 
 template <class T>
-inline vec3<T> quaternion<T>::rotatevector(const vec3<T> x) const
+inline constexpr vec3<T> quaternion<T>::rotatevector(const vec3<T>& x) const
 {
 	const vec3<T> v = getv();
 	const T s = gets();
-	return 2.0 * v.dot(x) * v + s * s * x + 2.0 * s * v.cross(x) - this->norm() * x;
+	return T(2.0) * v.dot(x) * v + (s * s - v.sqnorm()) * x + T(2.0) * s * v.cross(x);
+}
+template <class T>
+inline constexpr mat3<T> quaternion<T>::torotation() const
+{
+	const T x = this->x;
+	const T y = this->y;
+	const T z = this->z;
+	const T w = this->w;
+	return mat3<T>(
+		T(1.0) - T(2.0) * (y * y + z * z), T(2.0) * (x * y - w * z), T(2.0) * (x * z + w * y),
+		T(2.0) * (x * y + w * z), T(1.0) - T(2.0) * (x * x + z * z), T(2.0) * (y * z - w * x),
+		T(2.0) * (x * z - w * y), T(2.0) * (y * z + w * x), T(1.0) - T(2.0) * (x * x + y * y));
 }
 
 template <class T>
-inline const quaternion<T> operator+(const quaternion<T> a, const quaternion<T> b)
+inline constexpr quaternion<T> operator+(const quaternion<T>& a, const quaternion<T>& b)
 {
 	return quaternion<T>(
 		a.x + b.x,
@@ -1163,7 +1278,7 @@ inline const quaternion<T> operator+(const quaternion<T> a, const quaternion<T>
 		a.w + b.w);
 }
 template <class T>
-inline const quaternion<T> operator-(const quaternion<T> a, const quaternion<T> b)
+inline constexpr quaternion<T> operator-(const quaternion<T>& a, const quaternion<T>& b)
 {
 	return quaternion<T>(
 		a.x - b.x,
@@ -1172,7 +1287,7 @@ inline const quaternion<T> operator-(const quaternion<T> a, const quaternion<T>
 		a.w - b.w);
 }
 template <class T>
-inline const quaternion<T> operator-(const quaternion<T> a)
+inline constexpr quaternion<T> operator-(const quaternion<T>& a)
 {
 	return quaternion<T>(
 		-a.x,
@@ -1181,18 +1296,27 @@ inline const quaternion<T> operator-(const quaternion<T> a)
 		-a.w);
 }
 template <class T>
-inline const quaternion<T> operator*(const quaternion<T> a, const quaternion<T> b)
+inline constexpr quaternion<T> operator*(const quaternion<T>& a, const quaternion<T>& b)
 {
+#if defined(MATHFUNC_SIMD)
+	if constexpr (std::is_same_v<T, float>) {
+		if (!std::is_constant_evaluated()) {
+			quaternion<T> ret;
+			SimdQuaternionMul(a.cmp, b.cmp, ret.cmp);
+			return ret;
+		}
+	}
+#endif
 	T s0 = a.gets();
 	T s1 = b.gets();
 	vec3<T> v0 = a.getv();
-	vec3<T> v1 = a.getv();
+	vec3<T> v1 = b.getv();
 	T s = s0 * s1 - v0.dot(v1);
 	vec3<T> v = s0 * v1 + s1 * v0 + v0.cross(v1);
 	return quaternion<T>(s, v);
 }
 template <class T>
-inline const quaternion<T> operator*(const T a, const quaternion<T> b)
+inline constexpr quaternion<T> operator*(const T a, const quaternion<T>& b)
 {
 	return quaternion<T>(
 		a * b.x,
@@ -1201,7 +1325,7 @@ inline const quaternion<T> operator*(const T a, const quaternion<T> b)
 		a * b.w);
 }
 template <class T>
-inline const quaternion<T> operator*(const quaternion<T> a, const T b)
+inline constexpr quaternion<T> operator*(const quaternion<T>& a, const T b)
 {
 	return quaternion<T>(
 		b * a.x,
@@ -1210,7 +1334,7 @@ inline const quaternion<T> operator*(const quaternion<T> a, const T b)
 		b * a.w);
 }
 template <class T>
-inline const quaternion<T> operator/(const quaternion<T> a, const T b)
+inline constexpr quaternion<T> operator/(const quaternion<T>& a, const T b)
 {
 	return quaternion<T>(
 		a.x / b,
@@ -1220,7 +1344,7 @@ inline const quaternion<T> operator/(const quaternion<T> a, const T b)
 }
 
 template <class T>
-inline std::ostream& operator<<(std::ostream& os, const quaternion<T> vec)
+inline std::ostream& operator<<(std::ostream& os, const quaternion<T>& vec)
 {
 	os << vec.x << " " << vec.y << " " << vec.z << " " << vec.w;
 	return os;
@@ -1229,73 +1353,73 @@ inline std::ostream& operator<<(std::ostream& os, const quaternion<T> vec)
 ////////////////////
 
 template <class T>
-inline mat2<T>::mat2(const T m00, const T m01, const T m10, const T m11)
+inline constexpr mat2<T>::mat2(const T m00, const T m01, const T m10, const T m11)
 	: cmp{ m00, m01, m10, m11 }
 {
 }
 template <class T>
-inline mat2<T>::mat2(const T(array)[4])
+inline constexpr mat2<T>::mat2(const T(array)[4])
 	: cmp{ array[0], array[1], array[2], array[3] }
 {
 }
 template <class T>
-inline mat2<T>::mat2(const vec2<T> row0, const vec2<T> row1)
+inline constexpr mat2<T>::mat2(const vec2<T>& row0, const vec2<T>& row1)
 	: cmp{
-		row0.cmp[0],
-		row0.cmp[1],
-		row1.cmp[0],
-		row1.cmp[1]
+		row0.x,
+		row0.y,
+		row1.x,
+		row1.y
 	}
 {
 }
 template <class T>
-inline mat2<T>::mat2()
+inline constexpr mat2<T>::mat2()
 	:cmp{ 0.0, 0.0, 0.0, 0.0 }
 {
 }
 template <class T>
-inline T mat2<T>::dot(const mat2<T> m) const
+inline constexpr T mat2<T>::dot(const mat2<T>& m) const
 {
 	return cmp[0] * m.cmp[0] + cmp[1] * m.cmp[1] + cmp[2] * m.cmp[2] + cmp[3] * m.cmp[3];
 }
 template <class T>
-inline T mat2<T>::sqnorm() const
+inline constexpr T mat2<T>::sqnorm() const
 {
 	return this->dot(*this);
 }
 template <class T>
-inline T mat2<T>::norm() const
+inline constexpr T mat2<T>::norm() const
 {
 	T t = this->sqnorm();
 	if (t < 0.0000000001)
 		return 0.0;
 	else
-		return std::sqrt(t);
+		return MathSqrt(t);
 }
 template <class T>
-inline mat2<T> mat2<T>::transpose() const
+inline constexpr mat2<T> mat2<T>::transpose() const
 {
 	return mat2<T>(cmp[0], cmp[2], cmp[1], cmp[3]);
 }
 template <class T>
-inline T mat2<T>::trace() const
+inline constexpr T mat2<T>::trace() const
 {
 	return cmp[0] + cmp[3];
 }
 template <class T>
-inline T mat2<T>::determinant() const
+inline constexpr T mat2<T>::determinant() const
 {
 	return cmp[0] * cmp[3] - cmp[1] * cmp[2];
 }
 template <class T>
-inline mat2<T> mat2<T>::adjugate() const
+inline constexpr mat2<T> mat2<T>::adjugate() const
 {
 	return mat2<T>(
 		cmp[3], -cmp[2],
 		-cmp[1], cmp[0]);
 }
 template <class T>
-inline mat2<T> mat2<T>::inverse() const
+inline constexpr mat2<T> mat2<T>::inverse() const
 {
 	T det = this->determinant();
 	//assert(det >= 0.0000000001 && "singular matrix");
@@ -1303,23 +1427,23 @@ inline mat2<T> mat2<T>::inverse() const
 }
 
 template <class T>
-inline T& mat2<T>::operator()(const uint32_t idxr, const uint32_t idxc)&
+inline constexpr T& mat2<T>::operator()(const uint32_t idxr, const uint32_t idxc)&
 {
 	return cmp[idxr * 2 + idxc];
 }
 template <class T>
-inline const T& mat2<T>::operator()(const uint32_t idxr, const uint32_t idxc) const&
+inline constexpr const T& mat2<T>::operator()(const uint32_t idxr, const uint32_t idxc) const&
 {
 	return cmp[idxr * 2 + idxc];
 }
 template <class T>
-inline const T mat2<T>::operator()(const uint32_t idxr, const uint32_t idxc)&&
+inline constexpr const T mat2<T>::operator()(const uint32_t idxr, const uint32_t idxc)&&
 {
 	return cmp[idxr * 2 + idxc];
 }
 
 template <class T>
-inline mat2<T>& mat2<T>::operator=(const mat2<T> m)&
+inline constexpr mat2<T>& mat2<T>::operator=(const mat2<T>& m)&
 {
 	for (uint32_t i = 0; i < 4; i++) {
 		this->cmp[i] = m.cmp[i];
@@ -1327,7 +1451,7 @@ inline mat2<T>& mat2<T>::operator=(const mat2<T> m)&
 	return *this;
 }
 template <class T>
-inline mat2<T>& mat2<T>::operator+=(const mat2<T> m)&
+inline constexpr mat2<T>& mat2<T>::operator+=(const mat2<T>& m)&
 {
 	for (uint32_t i = 0; i < 4; i++) {
 		this->cmp[i] += m.cmp[i];
@@ -1335,7 +1459,7 @@ inline mat2<T>& mat2<T>::operator+=(const mat2<T> m)&
 	return *this;
 }
 template <class T>
-inline mat2<T>& mat2<T>::operator-=(const mat2<T> m)&
+inline constexpr mat2<T>& mat2<T>::operator-=(const mat2<T>& m)&
 {
 	for (uint32_t i = 0; i < 4; i++) {
 		this->cmp[i] -= m.cmp[i];
@@ -1343,7 +1467,7 @@ inline mat2<T>& mat2<T>::operator-=(const mat2<T> m)&
 	return *this;
 }
 template <class T>
-inline mat2<T>& mat2<T>::operator*=(const T s)&
+inline constexpr mat2<T>& mat2<T>::operator*=(const T s)&
 {
 	for (uint32_t i = 0; i < 4; i++) {
 		this->cmp[i] *= s;
@@ -1351,7 +1475,7 @@ inline mat2<T>& mat2<T>::operator*=(const T s)&
 	return *this;
 }
 template <class T>
-inline mat2<T>& mat2<T>::operator/=(const T s)&
+inline constexpr mat2<T>& mat2<T>::operator/=(const T s)&
 {
 	for (uint32_t i = 0; i < 4; i++) {
 		this->cmp[i] /= s;
@@ -1361,7 +1485,7 @@ inline mat2<T>& mat2<T>::operator/=(const T s)&
 
 template <class T>
 template <class U>
-inline mat2<T>::operator mat2<U>() const
+inline constexpr mat2<T>::operator mat2<U>() const
 {
 	return mat2<U>(
 		static_cast<U>(cmp[0]),
@@ -1371,7 +1495,7 @@ inline mat2<T>::operator mat2<U>() const
 }
 
 template <class T>
-inline const mat2<T> operator+(const mat2<T> a, const mat2<T> b)
+inline constexpr mat2<T> operator+(const mat2<T>& a, const mat2<T>& b)
 {
 	return mat2<T>(
 		a.cmp[0] + b.cmp[0],
@@ -1380,7 +1504,7 @@ inline const mat2<T> operator+(const mat2<T> a, const mat2<T> b)
 		a.cmp[3] + b.cmp[3]);
 }
 template <class T>
-inline const mat2<T> operator-(const mat2<T> a, const mat2<T> b)
+inline constexpr mat2<T> operator-(const mat2<T>& a, const mat2<T>& b)
 {
 	return mat2<T>(
 		a.cmp[0] - b.cmp[0],
@@ -1389,7 +1513,7 @@ inline const mat2<T> operator-(const mat2<T> a, const mat2<T> b)
 		a.cmp[3] - b.cmp[3]);
 }
 template <class T>
-inline const mat2<T> operator-(const mat2<T> a)
+inline constexpr mat2<T> operator-(const mat2<T>& a)
 {
 	return mat2<T>(
 		-a.cmp[0],
@@ -1398,7 +1522,7 @@ inline const mat2<T> operator-(const mat2<T> a)
 		-a.cmp[3]);
 }
 template <class T>
-inline const mat2<T> operator*(const T a, const mat2<T> b)
+inline constexpr mat2<T> operator*(const T a, const mat2<T>& b)
 {
 	return mat2<T>(
 		a * b.cmp[0],
@@ -1407,7 +1531,7 @@ inline const mat2<T> operator*(const T a, const mat2<T> b)
 		a * b.cmp[3]);
 }
 template <class T>
-inline const mat2<T> operator*(const mat2<T> a, const T b)
+inline constexpr mat2<T> operator*(const mat2<T>& a, const T b)
 {
 	return mat2<T>(
 		b * a.cmp[0],
@@ -1416,7 +1540,7 @@ inline const mat2<T> operator*(const mat2<T> a, const T b)
 		b * a.cmp[3]);
 }
 template <class T>
-inline const mat2<T> operator*(const mat2<T> a, const mat2<T> b)
+inline constexpr mat2<T> operator*(const mat2<T>& a, const mat2<T>& b)
 {
 	return mat2<T>(
 		a.cmp[0] * b.cmp[0] + a.cmp[1] * b.cmp[2],
@@ -1425,14 +1549,14 @@ inline const mat2<T> operator*(const mat2<T> a, const mat2<T> b)
 		a.cmp[2] * b.cmp[1] + a.cmp[3] * b.cmp[3]);
 }
 template <class T>
-inline const vec2<T> operator*(const mat2<T> a, const vec2<T> b)
+inline constexpr vec2<T> operator*(const mat2<T>& a, const vec2<T>& b)
 {
 	return vec2<T>(
 		a.cmp[0] * b.x + a.cmp[1] * b.y,
 		a.cmp[2] * b.x + a.cmp[3] * b.y);
 }
 template <class T>
-inline const mat2<T> operator/(const mat2<T> a, const T b)
+inline constexpr mat2<T> operator/(const mat2<T>& a, const T b)
 {
 	return mat2<T>(
 		a.cmp[0] / b,
@@ -1442,7 +1566,7 @@ inline const mat2<T> operator/(const mat2<T> a, const T b)
 }
 
 template <class T>
-inline std::ostream& operator<<(std::ostream& os, const mat2<T> mat)
+inline std::ostream& operator<<(std::ostream& os, const mat2<T>& mat)
 {
 	for (int32_t i = 0; i < 2; i++) {
 		for (int32_t j = 0; j < 2; j++) {
@@ -1456,7 +1580,7 @@ inline std::ostream& operator<<(std::ostream& os, const mat2<T> mat)
 ////////////////////
 
 template <class T>
-inline mat3<T>::mat3(const T m00, const T m01, const T m02, const T m10, const T m11, const T m12, const T m20, const T m21, const T m22)
+inline constexpr mat3<T>::mat3(const T m00, const T m01, const T m02, const T m10, const T m11, const T m12, const T m20, const T m21, const T m22)
 	: cmp{
 		m00,
 		m01,
@@ -1471,7 +1595,7 @@ inline mat3<T>::mat3(const T m00, const T m01, const T m02, const T m10, const T
 {
 }
 template <class T>
-inline mat3<T>::mat3(const T array[9])
+inline constexpr mat3<T>::mat3(const T array[9])
 	: cmp{
 		array[0],
 		array[1],
@@ -1486,22 +1610,22 @@ inline mat3<T>::mat3(const T array[9])
 {
 }
 template <class T>
-inline mat3<T>::mat3(const vec3<T> row0, const vec3<T> row1, const vec3<T> row2)
+inline constexpr mat3<T>::mat3(const vec3<T>& row0, const vec3<T>& row1, const vec3<T>& row2)
 	: cmp{
-		row0.cmp[0],
-		row0.cmp[1],
-		row0.cmp[2],
-		row1.cmp[0],
-		row1.cmp[1],
-		row1.cmp[2],
-		row2.cmp[0],
-		row2.cmp[1],
-		row2.cmp[2]
+		row0.x,
+		row0.y,
+		row0.z,
+		row1.x,
+		row1.y,
+		row1.z,
+		row2.x,
+		row2.y,
+		row2.z
 	}
 {
 }
 template <class T>
-inline mat3<T>::mat3()
+inline constexpr mat3<T>::mat3()
 	:cmp{
 		0.0, 0.0, 0.0,
 		0.0, 0.0, 0.0,
@@ -1511,26 +1635,26 @@ inline mat3<T>::mat3()
 }
 
 template <class T>
-inline T mat3<T>::dot(const mat3<T> m) const
+inline constexpr T mat3<T>::dot(const mat3<T>& m) const
 {
 	return cmp[0] * m.cmp[0] + cmp[1] * m.cmp[1] + cmp[2] * m.cmp[2] + cmp[3] * m.cmp[3] + cmp[4] * m.cmp[4] + cmp[5] * m.cmp[5] + cmp[6] * m.cmp[6] + cmp[7] * m.cmp[7] + cmp[8] * m.cmp[8];
 }
 template <class T>
-inline T mat3<T>::sqnorm() const
+inline constexpr T mat3<T>::sqnorm() const
 {
 	return this->dot(*this);
 }
 template <class T>
-inline T mat3<T>::norm() const
+inline constexpr T mat3<T>::norm() const
 {
 	T t = this->sqnorm();
 	if (t < 0.0000000001)
 		return 0.0;
 	else
-		return std::sqrt(t);
+		return MathSqrt(t);
 }
 template <class T>
-inline mat3<T> mat3<T>::transpose() const
+inline constexpr mat3<T> mat3<T>::transpose() const
 {
 	return mat3<T>(
 		cmp[0],
@@ -1544,31 +1668,31 @@ inline mat3<T> mat3<T>::transpose() const
 		cmp[8]);
 }
 template <class T>
-inline T mat3<T>::trace() const
+inline constexpr T mat3<T>::trace() const
 {
 	return cmp[0] + cmp[4] + cmp[8];
 }
 template <class T>
-inline T mat3<T>::determinant() const
+inline constexpr T mat3<T>::determinant() const
 {
 	return cmp[2] * (cmp[3] * cmp[7] - cmp[6] * cmp[4]) + cmp[5] * (cmp[6] * cmp[1] - cmp[0] * cmp[7]) + cmp[8] * (cmp[0] * cmp[4] - cmp[3] * cmp[1]);
 }
 template <class T>
-inline mat3<T> mat3<T>::adjugate() const
+inline constexpr mat3<T> mat3<T>::adjugate() const
 {
 	return mat3<T>(
 		(cmp[4] * cmp[8] - cmp[5] * cmp[7]),
-		-(cmp[3] * cmp[8] - cmp[6] * cmp[5]),
-		(cmp[3] * cmp[7] - cmp[4] * cmp[6]),
 		-(cmp[1] * cmp[8] - cmp[2] * cmp[7]),
-		(cmp[0] * cmp[8] - cmp[2] * cmp[6]),
-		-(cmp[0] * cmp[7] - cmp[1] * cmp[6]),
 		(cmp[1] * cmp[5] - cmp[2] * cmp[4]),
+		-(cmp[3] * cmp[8] - cmp[6] * cmp[5]),
+		(cmp[0] * cmp[8] - cmp[2] * cmp[6]),
 		-(cmp[0] * cmp[5] - cmp[2] * cmp[3]),
+		(cmp[3] * cmp[7] - cmp[4] * cmp[6]),
+		-(cmp[0] * cmp[7] - cmp[1] * cmp[6]),
 		(cmp[0] * cmp[4] - cmp[1] * cmp[3]));
 }
 template <class T>
-inline mat3<T> mat3<T>::inverse() const
+inline constexpr mat3<T> mat3<T>::inverse() const
 {
 	T det = this->determinant();
 	//assert(det >= 0.0000000001 && "singular matrix");
@@ -1576,23 +1700,23 @@ inline mat3<T> mat3<T>::inverse() const
 }
 
 template <class T>
-inline T& mat3<T>::operator()(const uint32_t idxr, const uint32_t idxc)&
+inline constexpr T& mat3<T>::operator()(const uint32_t idxr, const uint32_t idxc)&
 {
 	return cmp[idxr * 3 + idxc];
 }
 template <class T>
-inline const T& mat3<T>::operator()(const uint32_t idxr, const uint32_t idxc) const&
+inline constexpr const T& mat3<T>::operator()(const uint32_t idxr, const uint32_t idxc) const&
 {
 	return cmp[idxr * 3 + idxc];
 }
 template <class T>
-inline const T mat3<T>::operator()(const uint32_t idxr, const uint32_t idxc)&&
+inline constexpr const T mat3<T>::operator()(const uint32_t idxr, const uint32_t idxc)&&
 {
 	return cmp[idxr * 3 + idxc];
 }
 
 template <class T>
-inline mat3<T>& mat3<T>::operator=(const mat3<T> m)&
+inline constexpr mat3<T>& mat3<T>::operator=(const mat3<T>& m)&
 {
 	for (uint32_t i = 0; i < 9; i++) {
 		this->cmp[i] = m.cmp[i];
@@ -1600,7 +1724,7 @@ inline mat3<T>& mat3<T>::operator=(const mat3<T> m)&
 	return *this;
 }
 template <class T>
-inline mat3<T>& mat3<T>::operator+=(const mat3<T> m)&
+inline constexpr mat3<T>& mat3<T>::operator+=(const mat3<T>& m)&
 {
 	for (uint32_t i = 0; i < 9; i++) {
 		this->cmp[i] += m.cmp[i];
@@ -1608,7 +1732,7 @@ inline mat3<T>& mat3<T>::operator+=(const mat3<T> m)&
 	return *this;
 }
 template <class T>
-inline mat3<T>& mat3<T>::operator-=(const mat3<T> m)&
+inline constexpr mat3<T>& mat3<T>::operator-=(const mat3<T>& m)&
 {
 	for (uint32_t i = 0; i < 9; i++) {
 		this->cmp[i] -= m.cmp[i];
@@ -1616,7 +1740,7 @@ inline mat3<T>& mat3<T>::operator-=(const mat3<T> m)&
 	return *this;
 }
 template <class T>
-inline mat3<T>& mat3<T>::operator*=(const T s)&
+inline constexpr mat3<T>& mat3<T>::operator*=(const T s)&
 {
 	for (uint32_t i = 0; i < 9; i++) {
 		this->cmp[i] *= s;
@@ -1624,7 +1748,7 @@ inline mat3<T>& mat3<T>::operator*=(const T s)&
 	return *this;
 }
 template <class T>
-inline mat3<T>& mat3<T>::operator/=(const T s)&
+inline constexpr mat3<T>& mat3<T>::operator/=(const T s)&
 {
 	for (uint32_t i = 0; i < 9; i++) {
 		this->cmp[i] /= s;
@@ -1634,7 +1758,7 @@ inline mat3<T>& mat3<T>::operator/=(const T s)&
 
 template <class T>
 template <class U>
-inline mat3<T>::operator mat3<U>() const
+inline constexpr mat3<T>::operator mat3<U>() const
 {
 	return mat3<U>(
 		static_cast<U>(cmp[0]),
@@ -1649,7 +1773,7 @@ inline mat3<T>::operator mat3<U>() const
 }
 
 template <class T>
-inline const mat3<T> operator+(const mat3<T> a, const mat3<T> b)
+inline constexpr mat3<T> operator+(const mat3<T>& a, const mat3<T>& b)
 {
 	return mat3<T>(
 		a.cmp[0] + b.cmp[0],
@@ -1663,7 +1787,7 @@ inline const mat3<T> operator+(const mat3<T> a, const mat3<T> b)
 		a.cmp[8] + b.cmp[8]);
 }
 template <class T>
-inline const mat3<T> operator-(const mat3<T> a, const mat3<T> b)
+inline constexpr mat3<T> operator-(const mat3<T>& a, const mat3<T>& b)
 {
 	return mat3<T>(
 		a.cmp[0] - b.cmp[0],
@@ -1677,7 +1801,7 @@ inline const mat3<T> operator-(const mat3<T> a, const mat3<T> b)
 		a.cmp[8] - b.cmp[8]);
 }
 template <class T>
-inline const mat3<T> operator-(const mat3<T> a)
+inline constexpr mat3<T> operator-(const mat3<T>& a)
 {
 	return mat3<T>(
 		-a.cmp[0],
@@ -1691,7 +1815,7 @@ inline const mat3<T> operator-(const mat3<T> a)
 		-a.cmp[8]);
 }
 template <class T>
-inline const mat3<T> operator*(const T a, const mat3<T> b)
+inline constexpr mat3<T> operator*(const T a, const mat3<T>& b)
 {
 	return mat3<T>(
 		a * b.cmp[0],
@@ -1705,7 +1829,7 @@ inline const mat3<T> operator*(const T a, const mat3<T> b)
 		a * b.cmp[8]);
 }
 template <class T>
-inline const mat3<T> operator*(const mat3<T> a, const T b)
+inline constexpr mat3<T> operator*(const mat3<T>& a, const T b)
 {
 	return mat3<T>(
 		b * a.cmp[0],
@@ -1719,7 +1843,7 @@ inline const mat3<T> operator*(const mat3<T> a, const T b)
 		b * a.cmp[8]);
 }
 template <class T>
-inline const mat3<T> operator*(const mat3<T> a, const mat3<T> b)
+inline constexpr mat3<T> operator*(const mat3<T>& a, const mat3<T>& b)
 {
 	return mat3<T>(
 		a.cmp[0] * b.cmp[0] + a.cmp[1] * b.cmp[3] + a.cmp[2] * b.cmp[6],
@@ -1733,7 +1857,7 @@ inline const mat3<T> operator*(const mat3<T> a, const mat3<T> b)
 		a.cmp[6] * b.cmp[2] + a.cmp[7] * b.cmp[5] + a.cmp[8] * b.cmp[8]);
 }
 template <class T>
-inline const vec3<T> operator*(const mat3<T> a, const vec3<T> b)
+inline constexpr vec3<T> operator*(const mat3<T>& a, const vec3<T>& b)
 {
 	return vec3<T>(
 		a.cmp[0] * b.x + a.cmp[1] * b.y + a.cmp[2] * b.z,
@@ -1741,7 +1865,7 @@ inline const vec3<T> operator*(const mat3<T> a, const vec3<T> b)
 		a.cmp[6] * b.x + a.cmp[7] * b.y + a.cmp[8] * b.z);
 }
 template <class T>
-inline const mat3<T> operator/(const mat3<T> a, const T b)
+inline constexpr mat3<T> operator/(const mat3<T>& a, const T b)
 {
 	return mat3<T>(
 		a.cmp[0] / b,
@@ -1756,7 +1880,7 @@ inline const mat3<T> operator/(const mat3<T> a, const T b)
 }
 
 template <class T>
-inline std::ostream& operator<<(std::ostream& os, const mat3<T> mat)
+inline std::ostream& operator<<(std::ostream& os, const mat3<T>& mat)
 {
 	for (int32_t i = 0; i < 3; i++) {
 		for (int32_t j = 0; j < 3; j++) {
@@ -1770,7 +1894,7 @@ inline std::ostream& operator<<(std::ostream& os, const mat3<T> mat)
 ////////////////////
 
 template <class T>
-inline mat4<T>::mat4(const T m00, const T m01, const T m02, const T m03,
+inline constexpr mat4<T>::mat4(const T m00, const T m01, const T m02, const T m03,
 	const T m10, const T m11, const T m12, const T m13,
 	const T m20, const T m21, const T m22, const T m23,
 	const T m30, const T m31, const T m32, const T m33)
@@ -1796,7 +1920,7 @@ inline mat4<T>::mat4(const T m00, const T m01, const T m02, const T m03,
 }
 
 template <class T>
-inline mat4<T>::mat4(const T array[16])
+inline constexpr mat4<T>::mat4(const T array[16])
 	:cmp{
 		array[0],
 		array[1],
@@ -1819,18 +1943,18 @@ inline mat4<T>::mat4(const T array[16])
 }
 
 template <class T>
-inline mat4<T>::mat4(const mat3<T> mat, const vec3<T> vec)
+inline constexpr mat4<T>::mat4(const mat3<T>& mat, const vec3<T>& vec)
 	: cmp{
 		mat.cmp[0], mat.cmp[1], mat.cmp[2], 0.0,
 		mat.cmp[3], mat.cmp[4], mat.cmp[5], 0.0,
 		mat.cmp[6], mat.cmp[7], mat.cmp[8], 0.0,
-		vec.cmp[0], vec.cmp[1], vec.cmp[2], 1.0
+		vec.x, vec.y, vec.z, 1.0
 	}
 {
 }
 
 template<class T>
-inline mat4<T>::mat4()
+inline constexpr mat4<T>::mat4()
 	:cmp{
 	0.0, 0.0, 0.0, 0.0,
 	0.0, 0.0, 0.0, 0.0,
@@ -1841,8 +1965,17 @@ inline mat4<T>::mat4()
 }
 
 template <class T>
-inline mat4<T> mat4<T>::transpose() const
+inline constexpr mat4<T> mat4<T>::transpose() const
 {
+#if defined(MATHFUNC_SIMD)
+	if constexpr (std::is_same_v<T, float>) {
+		if (!std::is_constant_evaluated()) {
+			mat4<T> ret;
+			SimdMat4Transpose(cmp, ret.cmp);
+			return ret;
+		}
+	}
+#endif
 	return mat4<T>(
 		cmp[0], cmp[4], cmp[8], cmp[12],
 		cmp[1], cmp[5], cmp[9], cmp[13],
@@ -1850,24 +1983,116 @@ inline mat4<T> mat4<T>::transpose() const
 		cmp[3], cmp[7], cmp[11], cmp[15]);
 }
 
+// 2x2 の小行列式 s, c から余因子を作る
+// s : 上 2 行, c : 下 2 行
+template <class T>
+inline constexpr T mat4<T>::determinant() const
+{
+	const T s0 = cmp[0] * cmp[5] - cmp[4] * cmp[1];
+	const T s1 = cmp[0] * cmp[6] - cmp[4] * cmp[2];
+	const T s2 = cmp[0] * cmp[7] - cmp[4] * cmp[3];
+	const T s3 = cmp[1] * cmp[6] - cmp[5] * cmp[2];
+	const T s4 = cmp[1] * cmp[7] - cmp[5] * cmp[3];
+	const T s5 = cmp[2] * cmp[7] - cmp[6] * cmp[3];
+
+	const T c5 = cmp[10] * cmp[15] - cmp[14] * cmp[11];
+	const T c4 = cmp[9] * cmp[15] - cmp[13] * cmp[11];
+	const T c3 = cmp[9] * cmp[14] - cmp[13] * cmp[10];
+	const T c2 = cmp[8] * cmp[15] - cmp[12] * cmp[11];
+	const T c1 = cmp[8] * cmp[14] - cmp[12] * cmp[10];
+	const T c0 = cmp[8] * cmp[13] - cmp[12] * cmp[9];
+
+	return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+}
 template <class T>
-inline T& mat4<T>::operator()(const uint32_t idxr, const uint32_t idxc)&
+inline constexpr mat4<T> mat4<T>::adjugate() const
+{
+	const T s0 = cmp[0] * cmp[5] - cmp[4] * cmp[1];
+	const T s1 = cmp[0] * cmp[6] - cmp[4] * cmp[2];
+	const T s2 = cmp[0] * cmp[7] - cmp[4] * cmp[3];
+	const T s3 = cmp[1] * cmp[6] - cmp[5] * cmp[2];
+	const T s4 = cmp[1] * cmp[7] - cmp[5] * cmp[3];
+	const T s5 = cmp[2] * cmp[7] - cmp[6] * cmp[3];
+
+	const T c5 = cmp[10] * cmp[15] - cmp[14] * cmp[11];
+	const T c4 = cmp[9] * cmp[15] - cmp[13] * cmp[11];
+	const T c3 = cmp[9] * cmp[14] - cmp[13] * cmp[10];
+	const T c2 = cmp[8] * cmp[15] - cmp[12] * cmp[11];
+	const T c1 = cmp[8] * cmp[14] - cmp[12] * cmp[10];
+	const T c0 = cmp[8] * cmp[13] - cmp[12] * cmp[9];
+
+	// 負の成分は mat3::adjugate と同じく全体に - を付ける (SimdMat4Inverse と 0 の符号まで一致させる)
+	return mat4<T>(
+		(cmp[5] * c5 - cmp[6] * c4 + cmp[7] * c3),
+		-(cmp[1] * c5 - cmp[2] * c4 + cmp[3] * c3),
+		(cmp[13] * s5 - cmp[14] * s4 + cmp[15] * s3),
+		-(cmp[9] * s5 - cmp[10] * s4 + cmp[11] * s3),
+
+		-(cmp[4] * c5 - cmp[6] * c2 + cmp[7] * c1),
+		(cmp[0] * c5 - cmp[2] * c2 + cmp[3] * c1),
+		-(cmp[12] * s5 - cmp[14] * s2 + cmp[15] * s1),
+		(cmp[8] * s5 - cmp[10] * s2 + cmp[11] * s1),
+
+		(cmp[4] * c4 - cmp[5] * c2 + cmp[7] * c0),
+		-(cmp[0] * c4 - cmp[1] * c2 + cmp[3] * c0),
+		(cmp[12] * s4 - cmp[13] * s2 + cmp[15] * s0),
+		-(cmp[8] * s4 - cmp[9] * s2 + cmp[11] * s0),
+
+		-(cmp[4] * c3 - cmp[5] * c1 + cmp[6] * c0),
+		(cmp[0] * c3 - cmp[1] * c1 + cmp[2] * c0),
+		-(cmp[12] * s3 - cmp[13] * s1 + cmp[14] * s0),
+		(cmp[8] * s3 - cmp[9] * s1 + cmp[10] * s0));
+}
+template <class T>
+inline constexpr mat4<T> mat4<T>::inverse() const
+{
+#if defined(MATHFUNC_SIMD)
+	if constexpr (std::is_same_v<T, float>) {
+		if (!std::is_constant_evaluated()) {
+			mat4<T> ret;
+			SimdMat4Inverse(cmp, ret.cmp);
+			return ret;
+		}
+	}
+#endif
+	T det = this->determinant();
+	//assert(det >= 0.0000000001 && "singular matrix");
+	return (this->adjugate()) / det;
+}
+template <class T>
+inline constexpr mat4<T> mat4<T>::affineinverse() const
+{
+	const mat3<T> linear(
+		cmp[0], cmp[1], cmp[2],
+		cmp[4], cmp[5], cmp[6],
+		cmp[8], cmp[9], cmp[10]);
+	const mat3<T> inv = linear.inverse();
+	const vec3<T> t = -(inv * vec3<T>(cmp[3], cmp[7], cmp[11]));
+	return mat4<T>(
+		inv.cmp[0], inv.cmp[1], inv.cmp[2], t.x,
+		inv.cmp[3], inv.cmp[4], inv.cmp[5], t.y,
+		inv.cmp[6], inv.cmp[7], inv.cmp[8], t.z,
+		0.0, 0.0, 0.0, 1.0);
+}
+
+template <class T>
+inline constexpr T& mat4<T>::operator()(const uint32_t idxr, const uint32_t idxc)&
 {
 	return cmp[idxr * 4 + idxc];
 }
 template <class T>
-inline const T& mat4<T>::operator()(const uint32_t idxr, const uint32_t idxc) const&
+inline constexpr const T& mat4<T>::operator()(const uint32_t idxr, const uint32_t idxc) const&
 {
 	return cmp[idxr * 4 + idxc];
 }
 template <class T>
-inline const T mat4<T>::operator()(const uint32_t idxr, const uint32_t idxc)&&
+inline constexpr const T mat4<T>::operator()(const uint32_t idxr, const uint32_t idxc)&&
 {
 	return cmp[idxr * 4 + idxc];
 }
 
 template <class T>
-inline mat4<T>& mat4<T>::operator=(const mat4<T> m)&
+inline constexpr mat4<T>& mat4<T>::operator=(const mat4<T>& m)&
 {
 	for (uint32_t i = 0; i < 16; i++) {
 		this->cmp[i] = m.cmp[i];
@@ -1875,7 +2100,7 @@ inline mat4<T>& mat4<T>::operator=(const mat4<T> m)&
 	return *this;
 }
 template <class T>
-inline mat4<T>& mat4<T>::operator+=(const mat4<T> m)&
+inline constexpr mat4<T>& mat4<T>::operator+=(const mat4<T>& m)&
 {
 	for (uint32_t i = 0; i < 16; i++) {
 		this->cmp[i] += m.cmp[i];
@@ -1883,7 +2108,7 @@ inline mat4<T>& mat4<T>::operator+=(const mat4<T> m)&
 	return *this;
 }
 template <class T>
-inline mat4<T>& mat4<T>::operator-=(const mat4<T> m)&
+inline constexpr mat4<T>& mat4<T>::operator-=(const mat4<T>& m)&
 {
 	for (uint32_t i = 0; i < 16; i++) {
 		this->cmp[i] -= m.cmp[i];
@@ -1891,7 +2116,7 @@ inline mat4<T>& mat4<T>::operator-=(const mat4<T> m)&
 	return *this;
 }
 template <class T>
-inline mat4<T>& mat4<T>::operator*=(const T s)&
+inline constexpr mat4<T>& mat4<T>::operator*=(const T s)&
 {
 	for (uint32_t i = 0; i < 16; i++) {
 		this->cmp[i] *= s;
@@ -1899,7 +2124,7 @@ inline mat4<T>& mat4<T>::operator*=(const T s)&
 	return *this;
 }
 template <class T>
-inline mat4<T>& mat4<T>::operator/=(const T s)&
+inline constexpr mat4<T>& mat4<T>::operator/=(const T s)&
 {
 	for (uint32_t i = 0; i < 16; i++) {
 		this->cmp[i] /= s;
@@ -1909,7 +2134,7 @@ inline mat4<T>& mat4<T>::operator/=(const T s)&
 
 template <class T>
 template <class U>
-inline mat4<T>::operator mat4<U>() const
+inline constexpr mat4<T>::operator mat4<U>() const
 {
 	return mat4<U>(
 		static_cast<U>(cmp[0]),
@@ -1931,7 +2156,7 @@ inline mat4<T>::operator mat4<U>() const
 }
 
 template <class T>
-inline const mat4<T> operator+(const mat4<T> a, const mat4<T> b)
+inline constexpr mat4<T> operator+(const mat4<T>& a, const mat4<T>& b)
 {
 	return mat4<T>(
 		a.cmp[0] + b.cmp[0],
@@ -1952,7 +2177,7 @@ inline const mat4<T> operator+(const mat4<T> a, const mat4<T> b)
 		a.cmp[15] + b.cmp[15]);
 }
 template <class T>
-inline const mat4<T> operator-(const mat4<T> a, const mat4<T> b)
+inline constexpr mat4<T> operator-(const mat4<T>& a, const mat4<T>& b)
 {
 	return mat4<T>(
 		a.cmp[0] - b.cmp[0],
@@ -1973,7 +2198,7 @@ inline const mat4<T> operator-(const mat4<T> a, const mat4<T> b)
 		a.cmp[15] - b.cmp[15]);
 }
 template <class T>
-inline const mat4<T> operator-(const mat4<T> a)
+inline constexpr mat4<T> operator-(const mat4<T>& a)
 {
 	return mat4<T>(
 		-a.cmp[0],
@@ -1994,7 +2219,7 @@ inline const mat4<T> operator-(const mat4<T> a)
 		-a.cmp[15]);
 }
 template <class T>
-inline const mat4<T> operator*(const T a, const mat4<T> b)
+inline constexpr mat4<T> operator*(const T a, const mat4<T>& b)
 {
 	return mat4<T>(
 		a * b.cmp[0],
@@ -2015,7 +2240,7 @@ inline const mat4<T> operator*(const T a, const mat4<T> b)
 		a * b.cmp[15]);
 }
 template <class T>
-inline const mat4<T> operator*(const mat4<T> a, const T b)
+inline constexpr mat4<T> operator*(const mat4<T>& a, const T b)
 {
 	return mat4<T>(
 		b * a.cmp[0],
@@ -2036,8 +2261,17 @@ inline const mat4<T> operator*(const mat4<T> a, const T b)
 		b * a.cmp[15]);
 }
 template <class T>
-inline const mat4<T> operator*(const mat4<T> a, const mat4<T> b)
+inline constexpr mat4<T> operator*(const mat4<T>& a, const mat4<T>& b)
 {
+#if defined(MATHFUNC_SIMD)
+	if constexpr (std::is_same_v<T, float>) {
+		if (!std::is_constant_evaluated()) {
+			mat4<T> ret;
+			SimdMat4Mul(a.cmp, b.cmp, ret.cmp);
+			return ret;
+		}
+	}
+#endif
 	return mat4<T>(
 		a.cmp[0] * b.cmp[0] + a.cmp[1] * b.cmp[4] + a.cmp[2] * b.cmp[8] + a.cmp[3] * b.cmp[12],
 		a.cmp[0] * b.cmp[1] + a.cmp[1] * b.cmp[5] + a.cmp[2] * b.cmp[9] + a.cmp[3] * b.cmp[13],
@@ -2061,8 +2295,17 @@ inline const mat4<T> operator*(const mat4<T> a, const mat4<T> b)
 
 }
 template <class T>
-inline const vec4<T> operator*(const mat4<T> a, const vec4<T> b)
+inline constexpr vec4<T> operator*(const mat4<T>& a, const vec4<T>& b)
 {
+#if defined(MATHFUNC_SIMD)
+	if constexpr (std::is_same_v<T, float>) {
+		if (!std::is_constant_evaluated()) {
+			vec4<T> ret;
+			SimdMat4MulVec4(a.cmp, b.cmp, ret.cmp);
+			return ret;
+		}
+	}
+#endif
 	return vec4<T>(
 		a.cmp[0] * b.x + a.cmp[1] * b.y + a.cmp[2] * b.z + a.cmp[3] * b.w,
 		a.cmp[4] * b.x + a.cmp[5] * b.y + a.cmp[6] * b.z + a.cmp[7] * b.w,
@@ -2070,7 +2313,7 @@ inline const vec4<T> operator*(const mat4<T> a, const vec4<T> b)
 		a.cmp[12] * b.x + a.cmp[13] * b.y + a.cmp[14] * b.z + a.cmp[15] * b.w);
 }
 template <class T>
-inline const mat4<T> operator/(const mat4<T> a, const T b)
+inline constexpr mat4<T> operator/(const mat4<T>& a, const T b)
 {
 	return mat4<T>(
 		a.cmp[0] / b,
@@ -2092,7 +2335,7 @@ inline const mat4<T> operator/(const mat4<T> a, const T b)
 }
 
 template <class T>
-inline std::ostream& operator<<(std::ostream& os, const mat4<T> mat)
+inline std::ostream& operator<<(std::ostream& os, const mat4<T>& mat)
 {
 	for (int32_t i = 0; i < 4; i++) {
 		for (int32_t j = 0; j < 4; j++) {
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <cstdlib>
 #include <memory>
+#include <new>
 #include <iostream>
 
 struct HeapDebugInfo
@@ -22,6 +25,24 @@ public:
 	{
 		std::free(p);
 	}
+
+	// malloc が保証する境界 (alignof(std::max_align_t)) より大きい alignment は aligned new で確保する
+	// 解放するときは同じ alignment を渡す
+	void* allocate(std::size_t byteSize, std::size_t alignment, HeapDebugInfo& debugInfo)
+	{
+		if (alignment <= alignof(std::max_align_t))
+			return allocate(byteSize, debugInfo);
+		std::cout << debugInfo.debugFlag << std::endl;
+		return ::operator new(byteSize, std::align_val_t(alignment));
+	}
+
+	void deallocate(void * p, std::size_t alignment)
+	{
+		if (alignment <= alignof(std::max_align_t))
+			deallocate(p);
+		else
+			::operator delete(p, std::align_val_t(alignment));
+	}
 };
 
 template<class T>
@@ -47,12 +68,12 @@ public:
 
 	T* allocate(std::size_t size)
 	{
-		return static_cast<T*>(m_pRootAllocator->allocate(sizeof(T) * size, m_debugInfo));
+		return static_cast<T*>(m_pRootAllocator->allocate(sizeof(T) * size, alignof(T), m_debugInfo));
 	}
 
 	void deallocate(T* p, std::size_t size)
 	{
-		m_pRootAllocator->deallocate(p);
+		m_pRootAllocator->deallocate(p, alignof(T));
 	}
 };
 
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+// [0, count) の各 index について func(index) を threadCount 本の thread で実行する
+// index は atomic counter で 1 つずつ取り出すので、処理時間に偏りがあっても負荷が均される
+// threadCount <= 1 のときは呼び出し元の thread で順に実行する
+template <class F>
+void ParallelFor(const uint32_t& count, const uint32_t& threadCount, const F& func)
+{
+	const uint32_t workerCount = std::min(threadCount, count);
+	if (workerCount <= 1) {
+		for (uint32_t i = 0; i < count; i++)
+			func(i);
+		return;
+	}
+
+	std::atomic<uint32_t> next(0);
+	auto worker = [&]() {
+		for (uint32_t i = next.fetch_add(1); i < count; i = next.fetch_add(1))
+			func(i);
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(workerCount - 1);
+	for (uint32_t i = 0; i < workerCount - 1; i++)
+		threads.emplace_back(worker);
+
+	worker();
+
+	for (auto& thread : threads)
+		thread.join();
+}
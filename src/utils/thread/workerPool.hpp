@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 常駐する thread で job を順に処理する
+// ParallelFor と違い Push した側は待たないので、読み込みを裏で進めながら別の処理ができる
+// 破棄するときは積まれている job を全て終えてから thread を止める
+class WorkerPool
+{
+public:
+	explicit WorkerPool(const uint32_t& threadCount)
+	{
+		const uint32_t count = (threadCount > 0) ? threadCount : 1;
+		m_threads.reserve(count);
+		for (uint32_t i = 0; i < count; i++)
+			m_threads.emplace_back([this]() { WorkerLoop(); });
+	}
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	~WorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_isStopping = true;
+		}
+		m_jobCV.notify_all();
+		for (auto& thread : m_threads)
+			thread.join();
+	}
+
+	void Push(std::function<void()> job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_jobs.push_back(std::move(job));
+		}
+		m_jobCV.notify_one();
+	}
+
+	// 積まれている job と実行中の job が全て終わるまで待つ
+	void WaitIdle()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_idleCV.wait(lock, [this]() { return m_jobs.empty() && m_activeCount == 0; });
+	}
+
+	uint32_t GetThreadCount() const
+	{
+		return uint32_t(m_threads.size());
+	}
+
+private:
+	std::vector<std::thread> m_threads;
+	std::deque<std::function<void()>> m_jobs;
+	std::mutex m_mutex;
+	std::condition_variable m_jobCV;
+	std::condition_variable m_idleCV;
+	uint32_t m_activeCount = 0;
+	bool m_isStopping = false;
+
+	void WorkerLoop()
+	{
+		while (true) {
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_jobCV.wait(lock, [this]() { return m_isStopping || !m_jobs.empty(); });
+				if (m_jobs.empty())
+					return;
+				job = std::move(m_jobs.front());
+				m_jobs.pop_front();
+				m_activeCount++;
+			}
+
+			job();
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_activeCount--;
+				if (m_jobs.empty() && m_activeCount == 0)
+					m_idleCV.notify_all();
+			}
+		}
+	}
+};
@@ -3,6 +3,8 @@
 #include "src/utils/mathfunc/mathfunc.hpp"
 #include "src/utils/memory/array.hpp"
 #include "src/utils/memory/allocator.hpp"
+#include "src/utils/fileloader/PositionCache.hpp"
+#include "src/utils/fileloader/RansCoder.hpp"
 
 
 int main()
@@ -1,13 +1,1002 @@
 #include <cstdint>
+#include <cstddef>
+#include <cstring>
 #include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
 
+// 演算子は scalar 版のままにして、SIMD の kernel と bit 単位で比べる
+#define MATHFUNC_SCALAR
 #include "src/utils/mathfunc/mathfunc.hpp"
+#include "src/utils/mathfunc/mathAligned.hpp"
+#include "src/utils/mathfunc/mathSoA.hpp"
+#include "src/utils/mathfunc/mathDecomposition.hpp"
+#include "src/utils/mathfunc/mathExpr.hpp"
+#include "src/utils/mathfunc/mathTransform.hpp"
+#include "src/utils/mathfunc/mathUtils.hpp"
+#include "src/utils/geometry/IntOnMesh.hpp"
+#include "src/utils/memory/allocator.hpp"
+#include "src/utils/fileloader/PositionCache.hpp"
 
 template class vec3<float>;
 template class vec3<double>;
 
+template <class T>
+bool IsSameBits(const T& a, const T& b)
+{
+	return std::memcmp(a.cmp, b.cmp, sizeof(a.cmp)) == 0;
+}
+
+// コンパイル時に計算できるか
+constexpr fquaternion ConstexprHalfTurn = fquaternion(0.0f, 0.0f, 1.0f, 1.0f) / fquaternion(0.0f, 0.0f, 1.0f, 1.0f).norm();
+static_assert(ConstexprHalfTurn.rotatevector(fvec3(1.0f, 0.0f, 0.0f))(1) > 0.999f);
+static_assert((ConstexprHalfTurn * ConstexprHalfTurn).torotation()(0, 0) < -0.999f);
+constexpr fmat3 ConstexprMat3(fvec3(2.0f, 1.0f, 0.0f), fvec3(0.0f, 1.0f, 0.0f), fvec3(1.0f, 0.0f, 4.0f));
+static_assert((ConstexprMat3 * ConstexprMat3.inverse())(0, 1) == 0.0f && ConstexprMat3.determinant() == 8.0f);
+constexpr fmat4 ConstexprCamera = makeCameraMatrix(fvec3(0.0f, 0.0f, 0.0f), fvec3(0.0f, 0.0f, 3.0f), fvec3(0.0f, 1.0f, 0.0f));
+static_assert((ConstexprCamera * ConstexprCamera.affineinverse())(2, 3) == 0.0f);
+static_assert((makeProjectionMatrixVk(0.1f, 100.0f, 0.1f, -0.1f, 0.1f, -0.1f) * fvec4(0.0f, 0.0f, -1.0f, 1.0f)).w == 1.0f);
+static_assert(dvec3(3.0, 4.0, 12.0).norm() == 13.0 && fvec2(3.0f, 4.0f).normalized()(0) == 0.6f);
+
+// コンパイル時の sqrt (MathSqrt) と実行時の std::sqrt を比べる
+// 一致しなかった回数を返す
+uint32_t CompareConstexprSqrt()
+{
+	constexpr uint32_t count = 256;
+	constexpr auto Table	 = []() {
+		    struct {
+			    float f[count];
+			    double d[count];
+		    } table {};
+		    for (uint32_t i = 0; i < count; i++) {
+			    table.f[i] = MathSqrt(0.001f + 1.37f * float(i * i));
+			    table.d[i] = MathSqrt(0.001 + 1.37 * double(i * i));
+		    }
+		    return table;
+	}();
+
+	uint32_t mismatch = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		mismatch += Table.f[i] != std::sqrt(0.001f + 1.37f * float(i * i));
+		mismatch += Table.d[i] != std::sqrt(0.001 + 1.37 * double(i * i));
+	}
+	std::cout << "constexpr sqrt : " << (mismatch == 0 ? "ok" : "mismatch ") << (mismatch == 0 ? "" : std::to_string(mismatch)) << std::endl;
+	return mismatch;
+}
+
+// SoA の型の lane ごとの結果を scalar 版と bit 単位で比べる
+// 一致しなかった回数を返す
+uint32_t CompareSoAWithScalar()
+{
+	std::mt19937 engine(2);
+	std::uniform_real_distribution<float> dist(-4.0f, 4.0f);
+	std::uniform_int_distribution<int32_t> smallint(-2, 2);
+
+	auto Random = [&](float* const p, const uint32_t size, const bool isInteger) {
+		for (uint32_t i = 0; i < size; i++)
+			p[i] = isInteger ? float(smallint(engine)) : dist(engine);
+	};
+
+	uint32_t mismatch[10] = {};
+	for (uint32_t n = 0; n < 20000; n++) {
+		const bool isInteger = (n % 8) == 0;
+
+		fvec3 a[SoAWidth], b[SoAWidth];
+		fmat3 ma[SoAWidth], mb[SoAWidth];
+		for (uint32_t l = 0; l < SoAWidth; l++) {
+			Random(a[l].cmp, 3, isInteger);
+			Random(b[l].cmp, 3, isInteger);
+			Random(ma[l].cmp, 9, isInteger);
+			Random(mb[l].cmp, 9, isInteger);
+		}
+
+		fvec3x8 a8, b8;
+		fmat3x8 ma8, mb8;
+		a8.load(a);
+		b8.load(b);
+		for (uint32_t i = 0; i < 9; i++) {
+			float lanes[2][SoAWidth];
+			for (uint32_t l = 0; l < SoAWidth; l++) {
+				lanes[0][l] = ma[l].cmp[i];
+				lanes[1][l] = mb[l].cmp[i];
+			}
+			ma8.cmp[i] = SimdLoad8(lanes[0]);
+			mb8.cmp[i] = SimdLoad8(lanes[1]);
+		}
+
+		const floatx8 dot8	  = a8.dot(b8);
+		const fvec3x8 cross8	  = a8.cross(b8);
+		const fvec3x8 normalized8 = a8.normalized();
+		const fmat3x8 tensor8	  = a8.tensorproduct(b8);
+		const fmat3x8 mul8	  = ma8 * mb8;
+		const fvec3x8 mulvec8	  = ma8 * a8;
+		const fmat3x8 transpose8  = ma8.transpose();
+		const floatx8 det8	  = ma8.determinant();
+		const fmat3x8 inverse8	  = ma8.inverse();
+		const fvec3x8 expr8	  = 2.0f * a8 - (a8 + b8) / dot8;
+
+		for (uint32_t l = 0; l < SoAWidth; l++) {
+			const float dot	 = a[l].dot(b[l]);
+			const float det	 = ma[l].determinant();
+			const float dotl = dot8.lane(l);
+			const float detl = det8.lane(l);
+			mismatch[0] += std::memcmp(&dotl, &dot, sizeof(float)) != 0;
+			mismatch[1] += !IsSameBits(cross8.lane(l), a[l].cross(b[l]));
+			mismatch[2] += !IsSameBits(normalized8.lane(l), a[l].normalized());
+			mismatch[3] += !IsSameBits(tensor8.lane(l), a[l].tensorproduct(b[l]));
+			mismatch[4] += !IsSameBits(mul8.lane(l), ma[l] * mb[l]);
+			mismatch[5] += !IsSameBits(mulvec8.lane(l), ma[l] * a[l]);
+			mismatch[6] += !IsSameBits(transpose8.lane(l), ma[l].transpose());
+			mismatch[7] += std::memcmp(&detl, &det, sizeof(float)) != 0;
+			mismatch[8] += !IsSameBits(inverse8.lane(l), ma[l].inverse());
+			mismatch[9] += !IsSameBits(expr8.lane(l), 2.0f * a[l] - (a[l] + b[l]) / dot);
+		}
+	}
+
+	const char* const names[10] = { "vec3 dot", "vec3 cross", "vec3 normalized", "vec3 tensorproduct", "mat3 *", "mat3 * vec3", "mat3 transpose", "mat3 determinant", "mat3 inverse", "vec3 expression" };
+	uint32_t total = 0;
+	for (uint32_t i = 0; i < 10; i++) {
+		std::cout << "soa " << names[i] << " : " << (mismatch[i] == 0 ? "ok" : "mismatch ") << (mismatch[i] == 0 ? "" : std::to_string(mismatch[i])) << std::endl;
+		total += mismatch[i];
+	}
+
+	// 端数のある長さで AoS -> SoA -> AoS と gather -> scatter が元に戻るか
+	uint32_t roundtrip = 0;
+	std::vector<fvec3> aos(37);
+	for (auto& v : aos)
+		Random(v.cmp, 3, false);
+	std::vector<uint32_t> reversed(aos.size());
+	for (uint32_t i = 0; i < reversed.size(); i++)
+		reversed[i] = uint32_t(reversed.size()) - 1 - i;
+
+	SoAArray<fvec3> soa(aos.data(), aos.size());
+	std::vector<fvec3> back(aos.size());
+	soa.store(back.data());
+	SoAArray<fvec3> permuted(aos.size());
+	for (uint32_t i = 0; i < aos.size(); i += SoAWidth) {
+		const uint32_t count = std::min<uint32_t>(SoAWidth, aos.size() - i);
+		permuted.scatter(soa.gather(reversed.data() + i, 1, count), reversed.data() + i, 1, count);
+	}
+	std::vector<fvec3> scattered(aos.size());
+	for (uint32_t i = 0; i < aos.size(); i += SoAWidth) {
+		const uint32_t count = std::min<uint32_t>(SoAWidth, aos.size() - i);
+		fvec3x8 v;
+		v.gather(aos.data(), reversed.data() + i, 1, count);
+		v.scatter(scattered.data(), reversed.data() + i, 1, count);
+	}
+	for (uint32_t i = 0; i < aos.size(); i++) {
+		roundtrip += !IsSameBits(scattered[i], aos[i]);
+		roundtrip += !IsSameBits(back[i], aos[i]);
+		roundtrip += !IsSameBits(permuted.get(i), aos[i]);
+	}
+	const fvec3 padding = soa.batch(soa.batchsize() - 1).lane(SoAWidth - 1);
+	roundtrip += (padding.x != 0.0f || padding.y != 0.0f || padding.z != 0.0f);
+	std::cout << "soa array gather/scatter : " << (roundtrip == 0 ? "ok" : "mismatch ") << (roundtrip == 0 ? "" : std::to_string(roundtrip)) << std::endl;
+
+	return total + roundtrip;
+}
+
+template <class T>
+T MaxAbs(const mat3<T>& m)
+{
+	T result = 0;
+	for (uint32_t i = 0; i < 9; i++)
+		result = std::max(result, std::abs(m.cmp[i]));
+	return result;
+}
+
+// SVD, 極分解, 対称行列の固有値分解が元の行列に戻るか, U, V, R が回転か, 値が大きい順か
+// illtolerance は特異値, 固有値が 1e3 倍ずつ離れた悪条件の行列での許容誤差 (最大の値に対する比)
+// 失敗した回数を返す
+template <class T>
+uint32_t CheckDecomposition(const char* const name, const T tolerance, const T illtolerance)
+{
+	std::mt19937 engine(3);
+	std::uniform_real_distribution<T> dist(-4.0, 4.0);
+	std::uniform_int_distribution<int32_t> smallint(-2, 2);
+
+	auto IsRotation = [&](const mat3<T>& m) {
+		return MaxAbs(m * m.transpose() - mat3<T>::identity()) < tolerance && m.determinant() > 0;
+	};
+
+	auto RandomRotation = [&]() {
+		quaternion<T> q(dist(engine), dist(engine), dist(engine), dist(engine));
+		q /= q.norm();
+		return q.torotation();
+	};
+
+	uint32_t failure[4] = {};
+	for (uint32_t n = 0; n < 20000; n++) {
+		// 整数の成分は特異行列や重複した特異値を作るため
+		mat3<T> a;
+		for (uint32_t i = 0; i < 9; i++)
+			a.cmp[i] = (n % 8 == 0) ? T(smallint(engine)) : dist(engine);
+		const T scale = std::max(T(1.0), MaxAbs(a));
+
+		mat3<T> u, v;
+		vec3<T> sigma;
+		SVD(a, u, sigma, v);
+		const mat3<T> sigmamat(sigma.x, 0.0, 0.0, 0.0, sigma.y, 0.0, 0.0, 0.0, sigma.z);
+		const bool svdok = MaxAbs(u * sigmamat * v.transpose() - a) < tolerance * scale && IsRotation(u) && IsRotation(v)
+				   && sigma.x >= sigma.y - tolerance * scale && sigma.y >= std::abs(sigma.z) - tolerance * scale
+				   && (std::abs(a.determinant()) < tolerance * scale * scale * scale || (sigma.z < 0) == (a.determinant() < 0));
+		failure[0] += !svdok;
+
+		// 成分がとても小さい, 大きい行列 (A^T A が underflow, overflow する大きさ) も同じ相対誤差で分解できるか
+		if (n % 8 == 1) {
+			for (const T k : { std::sqrt(std::numeric_limits<T>::min()) * T(1.0e-3), std::sqrt(std::numeric_limits<T>::max()) * T(1.0e3) }) {
+				mat3<T> uk, vk;
+				vec3<T> sigmak;
+				SVD(k * a, uk, sigmak, vk);
+				const mat3<T> sigmakmat(sigmak.x, 0.0, 0.0, 0.0, sigmak.y, 0.0, 0.0, 0.0, sigmak.z);
+				failure[0] += !(MaxAbs(uk * sigmakmat * vk.transpose() - k * a) < tolerance * scale * k && IsRotation(uk) && IsRotation(vk)
+						&& std::abs(sigmak.x / k - sigma.x) < tolerance * scale && std::abs(sigmak.y / k - sigma.y) < tolerance * scale);
+			}
+		}
+
+		mat3<T> r, s;
+		PolarDecomposition(a, r, s);
+		failure[1] += !(MaxAbs(r * s - a) < tolerance * scale && IsRotation(r) && MaxAbs(s - s.transpose()) < tolerance * scale);
+
+		// 慣性テンソルと同じく、tensor product の和から作る対称行列
+		mat3<T> inertia = mat3<T>::zero();
+		for (uint32_t k = 0; k < 4; k++) {
+			const vec3<T> r(dist(engine), dist(engine), dist(engine));
+			inertia += r.sqnorm() * mat3<T>::identity() - r.tensorproduct(r);
+		}
+		mat3<T> axes;
+		vec3<T> moment;
+		SymmetricEigen(inertia, axes, moment);
+		const mat3<T> momentmat(moment.x, 0.0, 0.0, 0.0, moment.y, 0.0, 0.0, 0.0, moment.z);
+		failure[2] += !(MaxAbs(axes * momentmat * axes.transpose() - inertia) < tolerance * MaxAbs(inertia) && IsRotation(axes) && moment.x >= moment.y && moment.y >= moment.z);
+
+		// 特異値 1e3, 1, 1e-3 の行列と、固有値 1e6, 1e3, 1 の対称行列 (Jacobi 法の sweep 数が足りないと誤差が残る)
+		const mat3<T> q0 = RandomRotation();
+		const mat3<T> q1 = RandomRotation();
+		const mat3<T> ill = q0 * mat3<T>(1.0e3, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0e-3) * q1.transpose();
+		SVD(ill, u, sigma, v);
+		const mat3<T> illsigmamat(sigma.x, 0.0, 0.0, 0.0, sigma.y, 0.0, 0.0, 0.0, sigma.z);
+		const bool illsvdok = MaxAbs(u * illsigmamat * v.transpose() - ill) < illtolerance * T(1.0e3) && IsRotation(u) && IsRotation(v);
+
+		const mat3<T> spread = q0 * mat3<T>(1.0e6, 0.0, 0.0, 0.0, 1.0e3, 0.0, 0.0, 0.0, 1.0) * q0.transpose();
+		SymmetricEigen(spread, axes, moment);
+		const mat3<T> spreadmat(moment.x, 0.0, 0.0, 0.0, moment.y, 0.0, 0.0, 0.0, moment.z);
+		failure[3] += !(illsvdok && MaxAbs(axes * spreadmat * axes.transpose() - spread) < illtolerance * T(1.0e6) && IsRotation(axes));
+	}
+
+	const char* const names[4] = { "svd", "polar decomposition", "symmetric eigen", "ill-conditioned svd and eigen" };
+	uint32_t total = 0;
+	for (uint32_t i = 0; i < 4; i++) {
+		std::cout << name << " " << names[i] << " : " << (failure[i] == 0 ? "ok" : "failure ") << (failure[i] == 0 ? "" : std::to_string(failure[i])) << std::endl;
+		total += failure[i];
+	}
+	return total;
+}
+
+// fmat3x8 の分解の lane ごとの結果を fmat3 の分解と bit 単位で比べる
+uint32_t CompareSoADecompositionWithScalar()
+{
+	std::mt19937 engine(4);
+	std::uniform_real_distribution<float> dist(-4.0f, 4.0f);
+
+	uint32_t mismatch[3] = {};
+	for (uint32_t n = 0; n < 5000; n++) {
+		fmat3 a[SoAWidth];
+		fmat3x8 a8;
+		for (uint32_t i = 0; i < 9; i++) {
+			float lanes[SoAWidth];
+			for (uint32_t l = 0; l < SoAWidth; l++) {
+				a[l].cmp[i] = dist(engine);
+				lanes[l]    = a[l].cmp[i];
+			}
+			a8.cmp[i] = SimdLoad8(lanes);
+		}
+
+		fmat3x8 u8, v8, r8, s8, e8;
+		fvec3x8 sigma8, lambda8;
+		SVD(a8, u8, sigma8, v8);
+		PolarDecomposition(a8, r8, s8);
+		SymmetricEigen(a8 + a8.transpose(), e8, lambda8);
+
+		for (uint32_t l = 0; l < SoAWidth; l++) {
+			fmat3 u, v, r, s, e;
+			fvec3 sigma, lambda;
+			SVD(a[l], u, sigma, v);
+			PolarDecomposition(a[l], r, s);
+			SymmetricEigen(a[l] + a[l].transpose(), e, lambda);
+			mismatch[0] += !IsSameBits(u8.lane(l), u) || !IsSameBits(sigma8.lane(l), sigma) || !IsSameBits(v8.lane(l), v);
+			mismatch[1] += !IsSameBits(r8.lane(l), r) || !IsSameBits(s8.lane(l), s);
+			mismatch[2] += !IsSameBits(e8.lane(l), e) || !IsSameBits(lambda8.lane(l), lambda);
+		}
+	}
+
+	const char* const names[3] = { "svd", "polar decomposition", "symmetric eigen" };
+	uint32_t total = 0;
+	for (uint32_t i = 0; i < 3; i++) {
+		std::cout << "soa " << names[i] << " : " << (mismatch[i] == 0 ? "ok" : "mismatch ") << (mismatch[i] == 0 ? "" : std::to_string(mismatch[i])) << std::endl;
+		total += mismatch[i];
+	}
+	return total;
+}
+
+template <class T>
+T MaxAbs(const mat4<T>& m)
+{
+	T result = 0;
+	for (uint32_t i = 0; i < 16; i++)
+		result = std::max(result, std::abs(m.cmp[i]));
+	return result;
+}
+
+// fquaternionx8 を scalar 版と比べる
+// 積, rotatevector, torotation, storetransform, normalized は bit 単位, 近似を含むものは誤差で比べる
+// 一致しなかった回数と誤差が大きすぎた回数の和を返す
+uint32_t CompareSoAQuaternionWithScalar()
+{
+	std::mt19937 engine(6);
+	std::uniform_real_distribution<float> dist(-4.0f, 4.0f);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	auto RandomQuaternion = [&]() {
+		return fquaternion(dist(engine), dist(engine), dist(engine), dist(engine));
+	};
+	auto Unit = [](const fquaternion& q) {
+		return q / q.norm();
+	};
+	auto ToDouble = [](const fquaternion& q) {
+		return dquaternion(q.x, q.y, q.z, q.w);
+	};
+	auto Difference = [](const dquaternion& a, const dquaternion& b) {
+		return std::max(std::max(std::abs(a.x - b.x), std::abs(a.y - b.y)), std::max(std::abs(a.z - b.z), std::abs(a.w - b.w)));
+	};
+
+	uint32_t mismatch[5] = {};
+	uint32_t failure[5]  = {};
+	for (uint32_t n = 0; n < 20000; n++) {
+		fquaternion raw[SoAWidth], a[SoAWidth], b[SoAWidth];
+		fvec3 v[SoAWidth], omega[SoAWidth];
+		float t[SoAWidth];
+		for (uint32_t l = 0; l < SoAWidth; l++) {
+			raw[l] = RandomQuaternion();
+			a[l]   = Unit(raw[l]);
+			// ほぼ同じ向き (slerp が nlerp になる) と, 反対の符号で同じ向きも混ぜる
+			if (l == 1)
+				b[l] = Unit(a[l] + 0.001f * RandomQuaternion());
+			else if (l == 2)
+				b[l] = Unit(-a[l] + 0.1f * RandomQuaternion());
+			else
+				b[l] = Unit(RandomQuaternion());
+			v[l]	 = fvec3(dist(engine), dist(engine), dist(engine));
+			omega[l] = fvec3(dist(engine), dist(engine), dist(engine));
+			t[l]	 = (n % 16 == 0) ? float(l % 2) : unit(engine);
+		}
+		const float dt = 0.001f;
+
+		fquaternionx8 raw8, a8, b8;
+		fvec3x8 v8, omega8;
+		raw8.load(raw);
+		a8.load(a);
+		b8.load(b);
+		v8.load(v);
+		omega8.load(omega);
+		const floatx8 t8(SimdLoad8(t));
+
+		fmat4 transform8[SoAWidth];
+		a8.storetransform(transform8, v8);
+		const fquaternionx8 mul8	 = a8 * b8;
+		const fvec3x8 rotated8		 = a8.rotatevector(v8);
+		const fmat3x8 rotation8		 = a8.torotation();
+		const fquaternionx8 normalized8	 = raw8.normalized();
+		const fquaternionx8 fast8	 = raw8.fastnormalized();
+		const fquaternionx8 integrated8	 = a8.integrate(omega8, dt);
+		const fquaternionx8 nlerp8	 = fquaternionx8::nlerp(a8, b8, t8);
+		const fquaternionx8 slerp8	 = fquaternionx8::slerp(a8, b8, t8);
+
+		for (uint32_t l = 0; l < SoAWidth; l++) {
+			mismatch[0] += !IsSameBits(mul8.lane(l), a[l] * b[l]);
+			mismatch[1] += !IsSameBits(rotated8.lane(l), a[l].rotatevector(v[l]));
+			mismatch[2] += !IsSameBits(rotation8.lane(l), a[l].torotation());
+			mismatch[3] += !IsSameBits(transform8[l], ftransform(a[l], v[l]).tomat4());
+			mismatch[4] += !IsSameBits(normalized8.lane(l), fquaternion(fvec4(raw[l]).normalized().cmp));
+
+			const dquaternion fast = ToDouble(fast8.lane(l));
+			failure[0] += !(std::abs(fast.norm() - 1.0) < 1.0e-6 && Difference(fast, ToDouble(normalized8.lane(l))) < 1.0e-6);
+
+			// 1 次の積分と, omega dt だけの回転を正確に掛けたもの
+			const dquaternion q	     = ToDouble(a[l]) / ToDouble(a[l]).norm();
+			const dquaternion integrated = ToDouble(integrated8.lane(l));
+			const dvec3 angle	     = static_cast<dvec3>(dt * omega[l]);
+			const double theta	     = std::sqrt(angle.sqnorm());
+			const dquaternion rotation(std::cos(0.5 * theta), (std::sin(0.5 * theta) / theta) * angle);
+			failure[1] += !(Difference(integrated, rotation * q) < 2.0e-6);
+
+			dquaternion q1 = ToDouble(b[l]) / ToDouble(b[l]).norm();
+			if (q.dot(q1) < 0.0)
+				q1 = -q1;
+			const dquaternion lerp = q + double(t[l]) * (q1 - q);
+			failure[2] += !(Difference(ToDouble(nlerp8.lane(l)), lerp / lerp.norm()) < 2.0e-6);
+
+			// slerp は q0 からの角度が t に比例する (q0, q1 がほぼ同じ向きのときは nlerp なので 1e-7 まで許す)
+			const dquaternion slerp = dquaternion::slerp(q, q1, t[l]);
+			const double halftheta	= std::acos(std::min(q.dot(q1), 1.0));
+			failure[3] += !(std::abs(slerp.dot(q) - std::cos(t[l] * halftheta)) < 1.0e-7 && std::abs(slerp.norm() - 1.0) < 1.0e-12);
+			failure[4] += !(Difference(ToDouble(slerp8.lane(l)), slerp) < 2.0e-6);
+		}
+	}
+
+	const char* const names[5] = { "quaternion *", "quaternion rotatevector", "quaternion torotation", "quaternion storetransform", "quaternion normalized" };
+	const char* const approximations[5] = { "quaternion fastnormalized", "quaternion integrate", "quaternion nlerp", "dquaternion slerp", "quaternion slerp" };
+	uint32_t total = 0;
+	for (uint32_t i = 0; i < 5; i++) {
+		std::cout << "soa " << names[i] << " : " << (mismatch[i] == 0 ? "ok" : "mismatch ") << (mismatch[i] == 0 ? "" : std::to_string(mismatch[i])) << std::endl;
+		total += mismatch[i];
+	}
+	for (uint32_t i = 0; i < 5; i++) {
+		std::cout << "soa " << approximations[i] << " : " << (failure[i] == 0 ? "ok" : "failure ") << (failure[i] == 0 ? "" : std::to_string(failure[i])) << std::endl;
+		total += failure[i];
+	}
+
+	// slerp の acos, sin の多項式
+	double acoserror = 0.0, sinerror = 0.0;
+	for (uint32_t i = 0; i <= 4096; i += SoAWidth) {
+		float x[SoAWidth], y[SoAWidth];
+		for (uint32_t l = 0; l < SoAWidth; l++)
+			x[l] = std::min(1.0f, float(i + l) / 4096.0f);
+		SimdStore8(y, SoAAcos(SimdLoad8(x)));
+		for (uint32_t l = 0; l < SoAWidth; l++)
+			acoserror = std::max(acoserror, std::abs(double(y[l]) - std::acos(double(x[l]))));
+		for (uint32_t l = 0; l < SoAWidth; l++)
+			x[l] *= 1.57079632679f;
+		SimdStore8(y, SoASin(SimdLoad8(x)));
+		for (uint32_t l = 0; l < SoAWidth; l++)
+			sinerror = std::max(sinerror, std::abs(double(y[l]) - std::sin(double(x[l]))));
+	}
+	const bool polynomial = acoserror < 3.0e-7 && sinerror < 2.0e-7;
+	std::cout << "soa acos, sin polynomial : " << (polynomial ? "ok" : "failure ") << (polynomial ? "" : std::to_string(acoserror) + " " + std::to_string(sinerror)) << std::endl;
+
+	return total + !polynomial;
+}
+
+// MeshCM, MeshInertia の 1 三角形分の式を、普通の演算子と mathExpr.hpp の式で計算して bit 単位で比べる
+// 一致しなかった回数を返す
+template <class T>
+uint32_t CompareExprWithOperator(const char* const name)
+{
+	std::mt19937 engine(6);
+	std::uniform_real_distribution<T> dist(-4.0, 4.0);
+
+	uint32_t failure[3] = {};
+	vec3<T> cm(0.0, 0.0, 0.0), cmexpr(0.0, 0.0, 0.0);
+	mat3<T> inertia, inertiaexpr;
+	for (uint32_t n = 0; n < 20000; n++) {
+		const vec3<T> r0(dist(engine), dist(engine), dist(engine));
+		const vec3<T> r1(dist(engine), dist(engine), dist(engine));
+		const vec3<T> r2(dist(engine), dist(engine), dist(engine));
+		const T rho = dist(engine);
+		const T stp = vec3<T>::STP(r0, r1, r2);
+
+		cm = cm + rho * stp * (T(1.0 / 24.0) * (r0 + r1 + r2));
+		cmexpr += rho * stp * (T(1.0 / 24.0) * (Lazy(r0) + Lazy(r1) + Lazy(r2)));
+		failure[0] += !IsSameBits(cm, cmexpr);
+
+		inertia = inertia + rho * stp * T(1.0 / 120.0) * (T(2.0) * (r0.sqnorm() + r1.sqnorm() + r2.sqnorm() + r0.dot(r1) + r1.dot(r2) + r2.dot(r0)) * mat3<T>::identity() - T(2.0) * (r0.tensorproduct(r0) + r1.tensorproduct(r1) + r2.tensorproduct(r2)) - (r0.tensorproduct(r1) + r1.tensorproduct(r0) + r1.tensorproduct(r2) + r2.tensorproduct(r1) + r2.tensorproduct(r0) + r0.tensorproduct(r2)));
+
+		const Vec3Ref<T> e0 = Lazy(r0), e1 = Lazy(r1), e2 = Lazy(r2);
+		inertiaexpr += rho * stp * T(1.0 / 120.0) * (T(2.0) * (Dot(e0, e0) + Dot(e1, e1) + Dot(e2, e2) + Dot(e0, e1) + Dot(e1, e2) + Dot(e2, e0)) * Identity<T>() - T(2.0) * (TensorProduct(e0, e0) + TensorProduct(e1, e1) + TensorProduct(e2, e2)) - (TensorProduct(e0, e1) + TensorProduct(e1, e0) + TensorProduct(e1, e2) + TensorProduct(e2, e1) + TensorProduct(e2, e0) + TensorProduct(e0, e2)));
+		failure[1] += !IsSameBits(inertia, inertiaexpr);
+
+		// 一時変数を Lazy に渡したとき, 単項の -, 割り算, 式から vec3 / mat3 への変換
+		const mat3<T> m  = -(Lazy(r0.tensorproduct(r1)) - Lazy(inertia)) / rho;
+		const vec3<T> v  = -(Lazy(r0 - r1) * rho - Lazy(r2)) / stp;
+		failure[2] += !(IsSameBits(m, mat3<T>(-(r0.tensorproduct(r1) - inertia) / rho)) && IsSameBits(v, vec3<T>(-((r0 - r1) * rho - r2) / stp)));
+	}
+
+	const char* const names[3] = { "vec3 expression", "mat3 expression", "temporary, negate and divide" };
+	uint32_t total = 0;
+	for (uint32_t i = 0; i < 3; i++) {
+		std::cout << name << " " << names[i] << " : " << (failure[i] == 0 ? "ok" : "mismatch ") << (failure[i] == 0 ? "" : std::to_string(failure[i])) << std::endl;
+		total += failure[i];
+	}
+	return total;
+}
+
+// fvec3a, fmat3a, fmat4a が GPU の std430 と同じ配置で、元の型と値が変わらずに行き来できるか
+// TypeAllocator で確保した配列が alignment を守るか
+// 失敗した回数を返す
+uint32_t CheckAligned()
+{
+	struct LightBlock {
+		fvec3 position;
+		float intensity;
+		fvec3a color;
+		fvec3a direction;
+		fmat4a matrix;
+		fmat3a rotation;
+	};
+	static_assert(offsetof(LightBlock, intensity) == 12 && offsetof(LightBlock, color) == 16 && offsetof(LightBlock, direction) == 32);
+	static_assert(offsetof(LightBlock, matrix) == 48 && offsetof(LightBlock, rotation) == 112 && sizeof(LightBlock) == 160);
+	static_assert(sizeof(dvec3a) == 32 && alignof(dvec3a) == 32 && sizeof(dmat3a) == 96);
+
+	std::mt19937 engine(7);
+	std::uniform_real_distribution<float> dist(-4.0f, 4.0f);
+
+	uint32_t failure[3] = {};
+	for (uint32_t n = 0; n < 1000; n++) {
+		fvec3 v[SoAWidth];
+		fvec3a va[SoAWidth];
+		for (uint32_t l = 0; l < SoAWidth; l++) {
+			v[l]  = fvec3(dist(engine), dist(engine), dist(engine));
+			va[l] = v[l];
+		}
+		fmat3 m;
+		fmat4 m4;
+		for (uint32_t i = 0; i < 9; i++)
+			m.cmp[i] = dist(engine);
+		for (uint32_t i = 0; i < 16; i++)
+			m4.cmp[i] = dist(engine);
+
+		// 元の型の演算子にそのまま渡せて、結果を代入で戻せる
+		const fvec3a sum = va[0] + va[1].cross(va[2]);
+		const fmat3a ma	 = m;
+		const fmat4a m4a = m4 * m4;
+		failure[0] += !IsSameBits<fvec3>(sum, v[0] + v[1].cross(v[2])) || !IsSameBits(m4a * fvec4(va[3].x, va[3].y, va[3].z, 1.0f), (m4 * m4) * fvec4(v[3].x, v[3].y, v[3].z, 1.0f));
+		failure[0] += !IsSameBits(static_cast<fmat3>(ma), m) || ma(2, 1) != m(2, 1) || ma.cmp[3] != 0.0f || ma.cmp[7] != 0.0f || ma.cmp[11] != 0.0f;
+
+		// fvec3a の配列と fvec3x8 の転置での受け渡し (端数あり)
+		const uint32_t count = 1 + n % SoAWidth;
+		fvec3x8 x8, xa8;
+		x8.load(v, count);
+		xa8.load(va, count);
+		fvec3a back[SoAWidth];
+		xa8.store(back, count);
+		for (uint32_t l = 0; l < SoAWidth; l++) {
+			failure[1] += !IsSameBits(xa8.lane(l), x8.lane(l));
+			if (l < count) {
+				float w;
+				std::memcpy(&w, reinterpret_cast<const uint8_t*>(&back[l]) + 12, sizeof(float));
+				failure[1] += !IsSameBits<fvec3>(back[l], va[l]) || w != 0.0f;
+			}
+		}
+	}
+
+	// malloc の境界より大きい alignment (dvec3a の 32 byte) は aligned new で確保する
+	RootAllocator rootAllocator;
+	std::vector<fvec3a, TypeAllocator<fvec3a>> fvector(TypeAllocator<fvec3a>(&rootAllocator, "fvec3a allocator"));
+	std::vector<dvec3a, TypeAllocator<dvec3a>> dvector(TypeAllocator<dvec3a>(&rootAllocator, "dvec3a allocator"));
+	for (uint32_t size = 1; size <= 64; size *= 2) {
+		fvector.resize(size, fvec3a(1.0f, 2.0f, 3.0f));
+		dvector.resize(size, dvec3a(1.0, 2.0, 3.0));
+		failure[2] += (reinterpret_cast<uintptr_t>(fvector.data()) % alignof(fvec3a)) != 0 || (reinterpret_cast<uintptr_t>(dvector.data()) % alignof(dvec3a)) != 0;
+		failure[2] += dvector[size - 1].z != 3.0;
+	}
+
+	const char* const names[3] = { "aligned types", "aligned fvec3x8 load/store", "aligned allocator" };
+	uint32_t total = 0;
+	for (uint32_t i = 0; i < 3; i++) {
+		std::cout << names[i] << " : " << (failure[i] == 0 ? "ok" : "failure ") << (failure[i] == 0 ? "" : std::to_string(failure[i])) << std::endl;
+		total += failure[i];
+	}
+	return total;
+}
+
+// float の値を KahanSum, PairwiseSum で足したときの誤差が n によらず小さいか
+// 失敗した回数を返す
+uint32_t CheckAccumulator()
+{
+	std::mt19937 engine(7);
+	std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+	const uint32_t n = 1 << 22;
+	KahanSum<float> kahan(0.0f);
+	PairwiseSum<float> pairwise(0.0f);
+	KahanSum<fvec3> kahanvec(fvec3::zero());
+	float naive  = 0.0f;
+	double exact = 0.0;
+	for (uint32_t i = 0; i < n; i++) {
+		const float x = dist(engine);
+		kahan.add(x);
+		pairwise.add(x);
+		kahanvec.add(fvec3(x, -x, 2.0f * x));
+		naive += x;
+		exact += x;
+	}
+
+	const double error[3] = {
+		std::abs(kahan.value() - exact) / exact,
+		std::abs(pairwise.value() - exact) / exact,
+		std::abs(kahanvec.value().z - 2.0 * exact) / (2.0 * exact),
+	};
+	const bool ok = error[0] < 1.0e-7 && error[1] < 1.0e-6 && error[2] < 1.0e-7 && kahanvec.value().x == -kahanvec.value().y;
+	std::cout << "accumulator : " << (ok ? "ok" : "failure") << " naive " << std::abs(naive - exact) / exact << " kahan " << error[0] << " pairwise " << error[1] << std::endl;
+	return !ok;
+}
+
+// 原点から離れた細かい球で MeshCM, MeshInertia の float 版と double 版を、全て double で計算した値と比べる
+// 失敗した回数を返す
+uint32_t CheckMeshIntegral()
+{
+	const uint32_t n     = 400;
+	const float pi	     = 3.14159265358979f;
+	const fvec3 center   = fvec3(40.0f, -25.0f, 10.0f);
+	auto Ring	     = [n](const uint32_t i, const uint32_t j) { return 1 + (i - 1) * 2 * n + (j % (2 * n)); };
+	std::vector<fvec3> vertex;
+	std::vector<uint32_t> index;
+	vertex.push_back(center + fvec3(0.0f, 0.0f, 1.0f));
+	for (uint32_t i = 1; i < n; i++) {
+		for (uint32_t j = 0; j < 2 * n; j++) {
+			const float theta = pi * i / n;
+			const float phi	  = pi * j / n;
+			vertex.push_back(center + fvec3(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta)));
+		}
+	}
+	vertex.push_back(center + fvec3(0.0f, 0.0f, -1.0f));
+	const uint32_t bottom = vertex.size() - 1;
+	for (uint32_t j = 0; j < 2 * n; j++) {
+		index.insert(index.end(), { 0, Ring(1, j), Ring(1, j + 1) });
+		index.insert(index.end(), { bottom, Ring(n - 1, j + 1), Ring(n - 1, j) });
+	}
+	for (uint32_t i = 1; i < n - 1; i++) {
+		for (uint32_t j = 0; j < 2 * n; j++) {
+			index.insert(index.end(), { Ring(i, j), Ring(i + 1, j), Ring(i + 1, j + 1) });
+			index.insert(index.end(), { Ring(i, j), Ring(i + 1, j + 1), Ring(i, j + 1) });
+		}
+	}
+
+	// 全て double で順に足す
+	dvec3 refcm    = dvec3::zero();
+	double refmass = 0.0;
+	dmat3 refinertia;
+	for (uint32_t pass = 0; pass < 2; pass++) {
+		for (uint32_t i = 0; i < index.size() / 3; i++) {
+			const dvec3 r0 = static_cast<dvec3>(vertex[index[3 * i + 0]]) - (pass == 0 ? dvec3::zero() : refcm);
+			const dvec3 r1 = static_cast<dvec3>(vertex[index[3 * i + 1]]) - (pass == 0 ? dvec3::zero() : refcm);
+			const dvec3 r2 = static_cast<dvec3>(vertex[index[3 * i + 2]]) - (pass == 0 ? dvec3::zero() : refcm);
+			const double stp = dvec3::STP(r0, r1, r2);
+			if (pass == 0) {
+				refcm += stp * (1.0 / 24.0) * (r0 + r1 + r2);
+				refmass += stp / 6.0;
+			} else {
+				refinertia += stp * (1.0 / 120.0) * (2.0 * (r0.sqnorm() + r1.sqnorm() + r2.sqnorm() + r0.dot(r1) + r1.dot(r2) + r2.dot(r0)) * dmat3::identity() - 2.0 * (r0.tensorproduct(r0) + r1.tensorproduct(r1) + r2.tensorproduct(r2)) - (r0.tensorproduct(r1) + r1.tensorproduct(r0) + r1.tensorproduct(r2) + r2.tensorproduct(r1) + r2.tensorproduct(r0) + r0.tensorproduct(r2)));
+			}
+		}
+		if (pass == 0)
+			refcm = refcm / refmass;
+	}
+
+	fvec3 fcm;
+	float fmass;
+	fmat3 finertia;
+	MeshCM(fcm, fmass, vertex.data(), vertex.size(), index.data(), index.size(), 1.0f);
+	MeshInertia(finertia, static_cast<fvec3>(refcm), vertex.data(), vertex.size(), index.data(), index.size(), 1.0f);
+
+	dvec3 dcm;
+	double dmass;
+	dmat3 dinertia;
+	MeshCM(dcm, dmass, vertex.data(), vertex.size(), index.data(), index.size(), 1.0f);
+	MeshInertia(dinertia, refcm, vertex.data(), vertex.size(), index.data(), index.size(), 1.0f);
+
+	// 許容誤差は 1 つの三角形の値の float での誤差をもとに決める
+	const double error[2][3] = {
+		{ std::abs(fmass - refmass) / refmass, std::sqrt((static_cast<dvec3>(fcm) - refcm).sqnorm()), MaxAbs(static_cast<dmat3>(finertia) - refinertia) / MaxAbs(refinertia) },
+		{ std::abs(dmass - refmass) / refmass, std::sqrt((dcm - refcm).sqnorm()), MaxAbs(dinertia - refinertia) / MaxAbs(refinertia) },
+	};
+	const double tolerance[2] = { 2.0e-4, 2.0e-5 };
+
+	uint32_t total = 0;
+	const char* const names[2] = { "float", "double" };
+	for (uint32_t p = 0; p < 2; p++) {
+		const bool ok = error[p][0] < tolerance[p] && error[p][1] < tolerance[p] && error[p][2] < tolerance[p];
+		std::cout << names[p] << " mesh integral (" << index.size() / 3 << " triangles) : " << (ok ? "ok" : "failure") << " mass " << error[p][0] << " cm " << error[p][1] << " inertia " << error[p][2] << std::endl;
+		total += !ok;
+	}
+	return total;
+}
+
+// mat4 の逆行列と transform の合成, 逆変換, mat4 への変換が合っているか
+// 失敗した回数を返す
+template <class T>
+uint32_t CheckTransform(const char* const name, const T tolerance)
+{
+	std::mt19937 engine(5);
+	std::uniform_real_distribution<T> dist(-4.0, 4.0);
+	std::uniform_real_distribution<T> positive(0.25, 4.0);
+
+	auto RandomTransform = [&]() {
+		quaternion<T> q(dist(engine), dist(engine), dist(engine), dist(engine));
+		q /= q.norm();
+		return transform<T>(q, vec3<T>(dist(engine), dist(engine), dist(engine)), positive(engine));
+	};
+
+	uint32_t failure[4] = {};
+	for (uint32_t n = 0; n < 20000; n++) {
+		// 一般の行列は行列式が小さすぎるものを除いて比べる
+		mat4<T> m;
+		for (uint32_t i = 0; i < 16; i++)
+			m.cmp[i] = dist(engine);
+		const T det = m.determinant();
+		if (std::abs(det) > T(1.0))
+			failure[0] += !(MaxAbs(m * m.inverse() - mat4<T>::identity()) < tolerance * MaxAbs(m) * MaxAbs(m.adjugate()) / std::abs(det));
+
+		const transform<T> a = RandomTransform();
+		const transform<T> b = RandomTransform();
+		const mat4<T> ma     = a.tomat4();
+		const T scale	     = MaxAbs(ma) * MaxAbs(b.tomat4());
+		failure[1] += !(MaxAbs(ma.affineinverse() * ma - mat4<T>::identity()) < tolerance * scale && MaxAbs(ma.affineinverse() - ma.inverse()) < tolerance * scale);
+
+		failure[2] += !(MaxAbs((a * b).tomat4() - ma * b.tomat4()) < tolerance * scale && MaxAbs((a.inverse() * a).tomat4() - mat4<T>::identity()) < tolerance * scale);
+
+		const vec3<T> x(dist(engine), dist(engine), dist(engine));
+		const vec4<T> mx = ma * vec4<T>(x.x, x.y, x.z, 1.0);
+		float gpu[12];
+		a.storegpu(gpu);
+		T gpuerror = 0;
+		for (uint32_t i = 0; i < 12; i++)
+			gpuerror = std::max(gpuerror, std::abs(T(gpu[i]) - ma.cmp[i]));
+		failure[3] += !((a.transformpoint(x) - vec3<T>(mx.x, mx.y, mx.z)).norm() < tolerance * scale && gpuerror < 1.0e-5f * MaxAbs(ma));
+	}
+
+	const char* const names[4] = { "mat4 inverse", "mat4 affineinverse", "transform * and inverse", "transform point and storegpu" };
+	uint32_t total = 0;
+	for (uint32_t i = 0; i < 4; i++) {
+		std::cout << name << " " << names[i] << " : " << (failure[i] == 0 ? "ok" : "failure ") << (failure[i] == 0 ? "" : std::to_string(failure[i])) << std::endl;
+		total += failure[i];
+	}
+	return total;
+}
+
+// position cache に書いて読み戻し、量子化の誤差が group の幅 / 65535 の半分程度に収まるか
+// 壊れたファイルを Open, ReadFrame が false で弾くか
+// 失敗した回数を返す
+uint32_t CheckPositionCache()
+{
+	const uint32_t vertexCount = 100;
+	const uint32_t frameCount  = 40;
+	const uint32_t interval	   = 16;
+	const std::string filename = (std::filesystem::temp_directory_path() / "mathProgram_positioncache.bin").string();
+
+	std::vector<std::vector<fvec3>> frames(frameCount, std::vector<fvec3>(vertexCount));
+	for (uint32_t f = 0; f < frameCount; f++) {
+		for (uint32_t i = 0; i < vertexCount; i++) {
+			const float x = 0.1f * i;
+			frames[f][i]  = fvec3(x, std::sin(x + 0.2f * f), 3.0f + 0.5f * std::cos(0.7f * x - 0.1f * f));
+		}
+	}
+
+	PositionCacheWriter writer;
+	bool isWritten = writer.Open(filename.c_str(), vertexCount, 30.0f, interval);
+	for (uint32_t f = 0; f < frameCount && isWritten; f++)
+		isWritten = writer.AppendFrame(frames[f]);
+	isWritten = isWritten && writer.Close();
+	if (!isWritten) {
+		std::cout << "position cache round trip : failure (write)" << std::endl;
+		return 1;
+	}
+
+	// 許容誤差は group ごとの AABB の幅から決める
+	std::vector<fvec3> tolerance(frameCount);
+	for (uint32_t g = 0; g * interval < frameCount; g++) {
+		fvec3 lower = frames[g * interval][0], upper = lower;
+		for (uint32_t f = g * interval; f < std::min(frameCount, (g + 1) * interval); f++) {
+			for (const auto& p : frames[f]) {
+				for (uint32_t a = 0; a < 3; a++) {
+					lower.cmp[a] = std::min(lower.cmp[a], p.cmp[a]);
+					upper.cmp[a] = std::max(upper.cmp[a], p.cmp[a]);
+				}
+			}
+		}
+		for (uint32_t f = g * interval; f < std::min(frameCount, (g + 1) * interval); f++) {
+			for (uint32_t a = 0; a < 3; a++)
+				tolerance[f].cmp[a] = 0.51f * (upper.cmp[a] - lower.cmp[a]) / 65535.0f + 1.0e-6f * std::max(std::abs(lower.cmp[a]), std::abs(upper.cmp[a]));
+		}
+	}
+
+	uint32_t failure[2] = {};
+	float maxError	    = 0.0f;
+	PositionCache cache;
+	if (!cache.Open(filename.c_str()) || cache.GetFrameCount() != frameCount || cache.GetVertexCount() != vertexCount) {
+		failure[0]++;
+	} else {
+		// 順に読むものと、keyframe から展開し直すものの両方
+		std::vector<uint32_t> order(frameCount);
+		for (uint32_t f = 0; f < frameCount; f++)
+			order[f] = f;
+		std::vector<uint32_t> shuffled = order;
+		std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(6));
+		order.insert(order.end(), shuffled.begin(), shuffled.end());
+
+		std::vector<fvec3> positions(vertexCount);
+		for (const uint32_t f : order) {
+			if (!cache.ReadFrame(f, positions.data())) {
+				failure[0]++;
+				continue;
+			}
+			for (uint32_t i = 0; i < vertexCount; i++) {
+				for (uint32_t a = 0; a < 3; a++) {
+					const float error = std::abs(positions[i].cmp[a] - frames[f][i].cmp[a]);
+					maxError	  = std::max(maxError, error);
+					failure[0] += !(error <= tolerance[f].cmp[a]);
+				}
+			}
+		}
+	}
+	cache.Close();
+
+	std::vector<char> original;
+	{
+		std::ifstream file(filename, std::ios::binary);
+		original.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+	PositionCacheHeader header;
+	std::memcpy(&header, original.data(), sizeof(PositionCacheHeader));
+
+	// 書き換えたファイルを Open して、frame 0 を読めるかを返す
+	auto OpenBroken = [&](const std::vector<char>& data, bool& isReadable) {
+		{
+			std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+			file.write(data.data(), data.size());
+		}
+		PositionCache broken;
+		std::vector<fvec3> positions(vertexCount);
+		const bool isOpened = broken.Open(filename.c_str());
+		isReadable	    = isOpened && broken.ReadFrame(0, positions.data());
+		broken.Close();
+		return isOpened;
+	};
+
+	bool isReadable;
+	// index の途中で切れたもの
+	std::vector<char> data(original.begin(), original.end() - sizeof(PositionCacheGroup));
+	failure[1] += OpenBroken(data, isReadable);
+
+	// indexOffset が足し算で桁あふれするもの
+	data		     = original;
+	PositionCacheHeader h = header;
+	h.indexOffset	     = UINT64_MAX - 30;
+	std::memcpy(data.data(), &h, sizeof(PositionCacheHeader));
+	failure[1] += OpenBroken(data, isReadable);
+
+	// frame の offset が header を指すもの
+	data		   = original;
+	PositionCacheFrame frame;
+	std::memcpy(&frame, original.data() + header.indexOffset, sizeof(PositionCacheFrame));
+	frame.offset	   = 0;
+	std::memcpy(data.data() + header.indexOffset, &frame, sizeof(PositionCacheFrame));
+	failure[1] += OpenBroken(data, isReadable);
+
+	// predictor が壊れたものは Open できても ReadFrame で弾く
+	data = original;
+	std::memcpy(&frame, original.data() + header.indexOffset, sizeof(PositionCacheFrame));
+	data[frame.offset] = char(0xEE);
+	OpenBroken(data, isReadable);
+	failure[1] += isReadable;
+
+	std::error_code ec;
+	std::filesystem::remove(filename, ec);
+
+	const char* const names[2] = { "position cache round trip", "position cache broken file" };
+	uint32_t total		   = 0;
+	for (uint32_t i = 0; i < 2; i++) {
+		std::cout << names[i] << " : " << (failure[i] == 0 ? "ok" : "failure ") << (failure[i] == 0 ? "" : std::to_string(failure[i]));
+		if (i == 0)
+			std::cout << " max error " << maxError;
+		std::cout << std::endl;
+		total += failure[i];
+	}
+	return total;
+}
+
+#if defined(MATHFUNC_SIMD_SSE) || defined(MATHFUNC_SIMD_NEON)
+
+// 一致しなかった回数を返す
+uint32_t CompareSimdWithScalar()
+{
+	std::mt19937 engine(1);
+	std::uniform_real_distribution<float> dist(-4.0f, 4.0f);
+	std::uniform_int_distribution<int32_t> smallint(-2, 2);
+
+	// 整数の成分は 0 や特異行列を作りやすくするため
+	auto Random = [&](float* const p, const uint32_t size, const bool isInteger) {
+		for (uint32_t i = 0; i < size; i++)
+			p[i] = isInteger ? float(smallint(engine)) : dist(engine);
+	};
+
+	uint32_t mismatch[13] = {};
+	for (uint32_t n = 0; n < 100000; n++) {
+		const bool isInteger = (n % 8) == 0;
+
+		fvec4 v0, v1;
+		Random(v0.cmp, 4, isInteger);
+		Random(v1.cmp, 4, isInteger);
+		const float dot	 = SimdVec4Dot(v0.cmp, v1.cmp);
+		const float vdot = v0.dot(v1);
+		mismatch[0] += std::memcmp(&dot, &vdot, sizeof(float)) != 0;
+
+		fvec4 normalized;
+		SimdVec4Normalized(v0.cmp, normalized.cmp);
+		mismatch[1] += !IsSameBits(normalized, v0.normalized());
+
+		fquaternion q0, q1, q;
+		Random(q0.cmp, 4, isInteger);
+		Random(q1.cmp, 4, isInteger);
+		SimdQuaternionMul(q0.cmp, q1.cmp, q.cmp);
+		mismatch[2] += !IsSameBits(q, q0 * q1);
+
+		fmat3 a3, b3, m3;
+		fvec3 v3, r3;
+		Random(a3.cmp, 9, isInteger);
+		Random(b3.cmp, 9, isInteger);
+		Random(v3.cmp, 3, isInteger);
+		SimdMat3Mul(a3.cmp, b3.cmp, m3.cmp);
+		mismatch[3] += !IsSameBits(m3, a3 * b3);
+		SimdMat3MulVec3(a3.cmp, v3.cmp, r3.cmp);
+		mismatch[4] += !IsSameBits(r3, a3 * v3);
+		SimdMat3Transpose(a3.cmp, m3.cmp);
+		mismatch[5] += !IsSameBits(m3, a3.transpose());
+		SimdMat3Inverse(a3.cmp, m3.cmp);
+		mismatch[6] += !IsSameBits(m3, a3.inverse());
+		fvec3 w3;
+		Random(w3.cmp, 3, isInteger);
+		SimdVec3Cross(v3.cmp, w3.cmp, r3.cmp);
+		mismatch[10] += !IsSameBits(r3, v3.cross(w3));
+
+		fmat4 a4, b4, m4;
+		fvec4 r4;
+		Random(a4.cmp, 16, isInteger);
+		Random(b4.cmp, 16, isInteger);
+		SimdMat4Mul(a4.cmp, b4.cmp, m4.cmp);
+		mismatch[7] += !IsSameBits(m4, a4 * b4);
+		SimdMat4MulVec4(a4.cmp, v0.cmp, r4.cmp);
+		mismatch[8] += !IsSameBits(r4, a4 * v0);
+		SimdMat4Transpose(a4.cmp, m4.cmp);
+		mismatch[9] += !IsSameBits(m4, a4.transpose());
+		SimdMat4Inverse(a4.cmp, m4.cmp);
+		mismatch[11] += !IsSameBits(m4, a4.inverse());
+		SimdMat4AffineInverse(a4.cmp, m4.cmp);
+		mismatch[12] += !IsSameBits(m4, a4.affineinverse());
+	}
+
+	const char* const names[13] = { "vec4 dot", "vec4 normalized", "quaternion *", "mat3 *", "mat3 * vec3", "mat3 transpose", "mat3 inverse", "mat4 *", "mat4 * vec4", "mat4 transpose", "vec3 cross", "mat4 inverse", "mat4 affineinverse" };
+	uint32_t total = 0;
+	for (uint32_t i = 0; i < 13; i++) {
+		std::cout << "simd " << names[i] << " : " << (mismatch[i] == 0 ? "ok" : "mismatch ") << (mismatch[i] == 0 ? "" : std::to_string(mismatch[i])) << std::endl;
+		total += mismatch[i];
+	}
+	return total;
+}
+
+#endif
+
 int main(int argc, char const* argv[])
 {
+	if (CompareConstexprSqrt() != 0)
+		return 1;
+	if (CompareSoAWithScalar() != 0)
+		return 1;
+	if (CheckDecomposition<float>("fmat3", 1.0e-4f, 1.0e-4f) + CheckDecomposition<double>("dmat3", 1.0e-12, 1.0e-12) + CompareSoADecompositionWithScalar() != 0)
+		return 1;
+	if (CompareSoAQuaternionWithScalar() != 0)
+		return 1;
+	if (CheckTransform<float>("float", 1.0e-5f) + CheckTransform<double>("double", 1.0e-12) != 0)
+		return 1;
+	if (CompareExprWithOperator<float>("float") + CompareExprWithOperator<double>("double") != 0)
+		return 1;
+	if (CheckAccumulator() + CheckMeshIntegral() != 0)
+		return 1;
+	if (CheckAligned() != 0)
+		return 1;
+	if (CheckPositionCache() != 0)
+		return 1;
+
+#if defined(MATHFUNC_SIMD_SSE) || defined(MATHFUNC_SIMD_NEON)
+	if (CompareSimdWithScalar() != 0)
+		return 1;
+#endif
+
 
 	vec3<float> v0(2.0, 0.5, 2.0);
 	vec3<float> v1(1.0, 0.0, 2.0);
@@ -1,24 +1,39 @@
 #include "src/utils/mathfunc/mathUtils.hpp"
+#include "src/utils/mathfunc/mathAligned.hpp"
 #include "src/renderer/renderer.hpp"
 #include "src/renderer/mesh/drawArray.hpp"
 #include "src/utils/memory/allocator.hpp"
 
+#include <cstddef>
 #include <cstring>
+#include <chrono>
 #include <filesystem>
 #include <array>
 #include <memory>
 #include <vector>
 
 #include "src/utils/fileloader/OBJLoader.hpp"
+#include "src/utils/fileloader/MeshCache.hpp"
+#include "src/utils/fileloader/MTLLoader.hpp"
+#include "src/utils/fileloader/ImageLoader.hpp"
+#include "src/utils/fileloader/TextureContainer.hpp"
+#include "src/utils/fileloader/MeshSequence.hpp"
 #include "src/utils/geometry/meshgenerator.hpp"
 #include "src/utils/geometry/MeshConv.hpp"
 #include "src/utils/geometry/IntOnMesh.hpp"
+#include "src/utils/geometry/MeshOptimize.hpp"
+#include "src/utils/geometry/Meshlet.hpp"
+#include "src/utils/geometry/MeshSimplify.hpp"
+#include "src/utils/thread/parallelFor.hpp"
 
 std::string GetShaderResourceDir()
 {
 	return SHADER_BINARY_DIR;
 }
 
+// 斜めから見た texture に使う異方性フィルタの段数 (デバイスの上限で丸められる)
+constexpr float TextureMaxAnisotropy = 8.0f;
+
 struct MaterialFlags {
 	uint32_t useAlbedoTexture;
 	uint32_t useMetallicRoughnessTexture;
@@ -56,6 +71,16 @@ public:
 	Renderer::DescriptorSetInterface descriptorSetInterfaceForShadow;
 	DrawVertexArray<BasicVertex> drawArray;
 	DrawVertexArray<int32_t> indexdrawArray;
+	DrawVertexArray<uint16_t> index16drawArray; // 頂点数が少ないときはこちらを使う
+	Renderer::IndexType indexType = Renderer::IndexUint32;
+
+	// meshlet ごとの indirect draw (空なら通常の indexed draw)
+	std::vector<Meshlet> meshlets;
+	Renderer::GpuBuffer indirectBuffer;
+
+	// シャドウパス用 LOD (index buffer の後ろに連結、空なら LOD なし)
+	std::vector<uint32_t> lodIndexOffsets;
+	std::vector<float> lodErrors;
 
 	Renderer::GpuBuffer uboBuffer;
 	Renderer::GpuBuffer srtMatrixBuffer;
@@ -72,15 +97,17 @@ public:
 	uint32_t vertexCount = 0;
 	uint32_t indexCount = 0;
 
-	DrawObject(TypeAllocator<BasicVertex>& vertexAllocator, TypeAllocator<int32_t>& intAllocator)
+	DrawObject(TypeAllocator<BasicVertex>& vertexAllocator, TypeAllocator<int32_t>& intAllocator, TypeAllocator<uint16_t>& shortAllocator)
 		: drawArray(0, vertexAllocator)
 		, indexdrawArray(0, intAllocator, true)
+		, index16drawArray(0, shortAllocator, true)
 	{
 	}
 
-	DrawObject(TypeAllocator<BasicVertex>& vertexAllocator, TypeAllocator<int32_t>& intAllocator, uint32_t vertexCount, uint32_t indexCount)
+	DrawObject(TypeAllocator<BasicVertex>& vertexAllocator, TypeAllocator<int32_t>& intAllocator, TypeAllocator<uint16_t>& shortAllocator, uint32_t vertexCount, uint32_t indexCount)
 		: drawArray(0, vertexAllocator)
 		, indexdrawArray(0, intAllocator, true)
+		, index16drawArray(0, shortAllocator, true)
 		, vertexCount(vertexCount)
 		, indexCount(indexCount)
 	{
@@ -91,8 +118,15 @@ public:
 		drawArray.resize(vertexCount);
 		renderer.InitializeVertexArray(&drawArray);
 
-		indexdrawArray.resize(indexCount);
-		renderer.InitializeVertexArray(&indexdrawArray);
+		indexType = SelectIndexType(vertexCount);
+		if (indexType == Renderer::IndexUint16) {
+			index16drawArray.resize(indexCount);
+			renderer.InitializeVertexArray(&index16drawArray);
+		}
+		else {
+			indexdrawArray.resize(indexCount);
+			renderer.InitializeVertexArray(&indexdrawArray);
+		}
 
 		uboBuffer = renderer.CreateGpuBuffer(32, Renderer::Uniform);
 		void* uboCpuPtr = nullptr;
@@ -142,6 +176,45 @@ public:
 		renderer.UnmapCpuMemoryPointer(srtMatrixBuffer);
 	}
 
+	// indexType に応じて 16bit / 32bit のどちらかに書き込む
+	void SetIndex(uint32_t i, uint32_t index)
+	{
+		if (indexType == Renderer::IndexUint16)
+			index16drawArray[i] = static_cast<uint16_t>(index);
+		else
+			indexdrawArray[i] = static_cast<int32_t>(index);
+	}
+
+	void UpdateIndexArray(Renderer& renderer)
+	{
+		if (indexType == Renderer::IndexUint16)
+			renderer.UpdateVertexArray(&index16drawArray);
+		else
+			renderer.UpdateVertexArray(&indexdrawArray);
+	}
+
+	GpuMemoryImpl* GetIndexGpuMemoryImpl()
+	{
+		return (indexType == Renderer::IndexUint16) ? index16drawArray.getGpuMemoryImpl() : indexdrawArray.getGpuMemoryImpl();
+	}
+
+	uint32_t GetIndexCount()
+	{
+		return (indexType == Renderer::IndexUint16) ? index16drawArray.size() : indexdrawArray.size();
+	}
+
+	// LOD が無ければ index buffer 全体
+	void GetLodIndexRange(uint32_t lod, uint32_t& firstIndex, uint32_t& count)
+	{
+		if (lodIndexOffsets.empty()) {
+			firstIndex = 0;
+			count = GetIndexCount();
+			return;
+		}
+		firstIndex = lodIndexOffsets[lod];
+		count = lodIndexOffsets[lod + 1] - lodIndexOffsets[lod];
+	}
+
 	void WriteDescriptorSet(Renderer& renderer)
 	{
 		renderer.WriteDescriptorSet(descriptorWriterParams, descriptorSetInterface);
@@ -155,18 +228,31 @@ public:
 		createImageParams.width = width;
 		createImageParams.height = height;
 		createImageParams.format = format;
+		// 遠くの物体で模様がちらつかないよう、level 0 から GPU で mip を作る
+		createImageParams.mipLevels = 0;
+		createImageParams.generateMips = true;
+		createImageParams.maxAnisotropy = TextureMaxAnisotropy;
 
-		Renderer::GpuTexture& targetTex = (slot == TextureType::Albedo) ? textureMemory
-			: (slot == TextureType::MetallicRoughness) ? metallicRoughnessTexture
-			: normalTexture;
-		targetTex = renderer.CreateGpuTexture(createImageParams);
+		Renderer::GpuTexture texture = renderer.CreateGpuTexture(createImageParams);
 
 		Renderer::GpuBuffer stagingBuffer = renderer.CreateGpuBuffer(width * height * 4, Renderer::Transfer);
 		void* stagingBufferCpu = nullptr;
 		renderer.GetCpuMemoryPointer(stagingBuffer, &stagingBufferCpu);
 		std::memcpy(stagingBufferCpu, cpuData, width * height * 4);
 		renderer.UnmapCpuMemoryPointer(stagingBuffer);
-		renderer.TransferStagingBufferToImage(stagingBuffer, targetTex);
+		renderer.TransferStagingBufferToImage(stagingBuffer, texture);
+		renderer.DestroyGpuBuffer(stagingBuffer);
+
+		SetTexture(renderer, slot, texture);
+	}
+
+	// 転送済みの texture を slot に設定する
+	void SetTexture(Renderer& renderer, TextureType slot, const Renderer::GpuTexture& texture)
+	{
+		Renderer::GpuTexture& targetTex = (slot == TextureType::Albedo) ? textureMemory
+			: (slot == TextureType::MetallicRoughness) ? metallicRoughnessTexture
+			: normalTexture;
+		targetTex = texture;
 
 		switch (slot) {
 		case TextureType::Albedo:
@@ -272,7 +358,7 @@ void CreateGBufferRenderPass(Renderer& renderer)
 	Renderer::RenderPassParams renderPassParams;
 	renderPassParams.name = "GBufferPass";
 	renderPassParams.attachments = {
-		{ // 0: SwapChain (ŏIo)
+		{ // 0: SwapChain (最終出力)
 			Renderer::ImageFormat::SameAsSwapChain,
 			false,
 			true,
@@ -283,7 +369,7 @@ void CreateGBufferRenderPass(Renderer& renderer)
 			false, // isDepthStencilAttatchment
 			false, // isInputAttatchment
 		},
-		{ // 1: Albedo - J[A^b`g + Input Attachment
+		{ // 1: Albedo - カラーアタッチメント + Input Attachment
 			Renderer::ImageFormat::RGBA8_UNORM,
 			false,
 			true,
@@ -294,7 +380,7 @@ void CreateGBufferRenderPass(Renderer& renderer)
 			false, // isDepthStencilAttatchment
 			true,  // isInputAttatchment
 		},
-		{ // 2: Normal - J[A^b`g + Input Attachment
+		{ // 2: Normal - カラーアタッチメント + Input Attachment
 			Renderer::ImageFormat::RGBA16_SFLOAT,
 			false,
 			true,
@@ -305,7 +391,7 @@ void CreateGBufferRenderPass(Renderer& renderer)
 			false, // isDepthStencilAttatchment
 			true,  // isInputAttatchment
 		},
-		{ // 3: Position - J[A^b`g + Input Attachment
+		{ // 3: Position - カラーアタッチメント + Input Attachment
 			Renderer::ImageFormat::RGBA32_FLOAT,
 			false,
 			true,
@@ -316,7 +402,7 @@ void CreateGBufferRenderPass(Renderer& renderer)
 			false, // isDepthStencilAttatchment
 			true,  // isInputAttatchment
 		},
-		{ // 4: MetallicRoughness - J[A^b`g + Input Attachment
+		{ // 4: MetallicRoughness - カラーアタッチメント + Input Attachment
 			Renderer::ImageFormat::RGBA8_UNORM,
 			false,
 			true,
@@ -514,11 +600,21 @@ Renderer::VertexAttributeLayout RegisterVertexAttribute(Renderer& renderer)
 	return vertexAttributeLayout;
 }
 
-// tH[h_OpWIgpCvC
-// - RenderPass œ삵A_VF[_{tOgVF[_Œڕ`悷
-// - Set0: Js(binding0) + Cgf[^(binding1) + VhE}bveNX`(binding2)
-// - Set1: IuWFNgŗLf[^iUBO(binding0) + SRTs(binding1) + eNX`(binding2)j
-// - Reversed-Z fvXeXgiGreaterjAvbVRX^g
+// シャドウパス用 position のみの頂点レイアウト
+Renderer::VertexAttributeLayout RegisterPositionOnlyVertexAttribute(Renderer& renderer)
+{
+	Renderer::VertexAttributeLayout vertexAttributeLayout;
+	Renderer::CreatePositionOnlyVertexAttributeLayout<BasicVertex>(&vertexAttributeLayout);
+	renderer.RegisterVertexInputStateImpl3(&vertexAttributeLayout);
+
+	return vertexAttributeLayout;
+}
+
+// フォワードレンダリング用ジオメトリパイプライン
+// - RenderPass 上で動作し、頂点シェーダ＋フラグメントシェーダで直接描画する
+// - Set0: カメラ行列(binding0) + ライトデータ(binding1) + シャドウマップテクスチャ(binding2)
+// - Set1: オブジェクト固有データ（UBO(binding0) + SRT行列(binding1) + テクスチャ(binding2)）
+// - Reversed-Z デプステスト（Greater）、プッシュコンスタントあり
 void CreateGeometryPipeline(Renderer& renderer, std::string vertexAttributeName)
 {
 	Renderer::GraphicsPipelineParams graphicsPipelineParams;
@@ -597,16 +693,16 @@ void CreateGeometryPipeline(Renderer& renderer, std::string vertexAttributeName)
 	renderer.CreateGraphicsPipeline(graphicsPipelineParams);
 }
 
-// G-Buffer݃pCvCixVF[fBO1iKj
-// - GBufferPass  Subpass 0 œ
-// - 4̃J[A^b`giAlbedo, Normal, Position, MetallicRoughnessjMRTŏo
-// - Set0: Jsibinding0, Vertexj
-// - Set1: IuWFNgŗLf[^
-//   - binding0: SRTs + MaterialFlagsiVertex|Fragmentj
-//   - binding1: AxheNX`iFragmentj
-//   - binding2: ^bNEtlXeNX`iFragmentj
-//   - binding3: @eNX`iFragmentj
-// - Reversed-Z fvXeXgiGreaterjAfvX݂
+// G-Buffer書き込みパイプライン（遅延シェーディング第1段階）
+// - GBufferPass の Subpass 0 で動作
+// - 4つのカラーアタッチメント（Albedo, Normal, Position, MetallicRoughness）にMRTで出力
+// - Set0: カメラ行列（binding0, Vertex）
+// - Set1: オブジェクト固有データ
+//   - binding0: SRT行列 + MaterialFlags（Vertex|Fragment）
+//   - binding1: アルベドテクスチャ（Fragment）
+//   - binding2: メタリック・ラフネステクスチャ（Fragment）
+//   - binding3: 法線テクスチャ（Fragment）
+// - Reversed-Z デプステスト（Greater）、デプス書き込みあり
 void CreateGBufferPipeline(Renderer& renderer, std::string vertexAttributeName)
 {
 	Renderer::GraphicsPipelineParams graphicsPipelineParams;
@@ -626,7 +722,7 @@ void CreateGBufferPipeline(Renderer& renderer, std::string vertexAttributeName)
 
 	graphicsPipelineParams.vertexLayoutName = vertexAttributeName;
 
-	// 0 Js
+	// 0 カメラ行列
 	Renderer::DescriptorSetLayoutParams descriptorSetLayout0;
 	Renderer::DescriptorSetBindingParams cameraMatrixBinding;
 	cameraMatrixBinding.bindingNum = 0;
@@ -636,7 +732,7 @@ void CreateGBufferPipeline(Renderer& renderer, std::string vertexAttributeName)
 	descriptorSetLayout0.descriptorSetBindingParams.push_back(&cameraMatrixBinding);
 	descriptorSetLayout0.isBindless = false;
 
-	// 1 IuWFNgŗLiSRTsAeNX`A}eAtOj
+	// 1 オブジェクト固有（SRT行列、テクスチャ、マテリアルフラグ）
 	Renderer::DescriptorSetLayoutParams descriptorSetLayout1;
 	Renderer::DescriptorSetBindingParams srtMatrixBinding;
 	srtMatrixBinding.bindingNum = 0;
@@ -681,14 +777,14 @@ void CreateGBufferPipeline(Renderer& renderer, std::string vertexAttributeName)
 	renderer.CreateGraphicsPipeline(graphicsPipelineParams);
 }
 
-// CeBOpCvCixVF[fBO2iKj
-// - GBufferPass  Subpass 1 œ
-// - Input Attachment oR G-BufferiAlbedo, Normal, Position, MetallicRoughnessjǂݎ
-// - Cook-Torrance BRDF ɂ PBR CeBO{ PCF VhE}bsOs
-// - g[}bsO{K}␳KpAXbv`F[ɍŏIJ[o
-// - Set0: Input Attachmentsibinding0-3: Albedo, Normal, Position, MetallicRoughnessj
-// - Set1: Cgf[^UBOibinding0j+ VhE}bveNX`ibinding1j
-// - fvXeXgAtXN[Op`i_3jŕ`
+// ライティングパイプライン（遅延シェーディング第2段階）
+// - GBufferPass の Subpass 1 で動作
+// - Input Attachment 経由で G-Buffer（Albedo, Normal, Position, MetallicRoughness）を読み取り
+// - Cook-Torrance BRDF による PBR ライティング＋ PCF シャドウマッピングを実行
+// - トーンマッピング＋ガンマ補正を適用し、スワップチェーンに最終カラーを出力
+// - Set0: Input Attachments（binding0-3: Albedo, Normal, Position, MetallicRoughness）
+// - Set1: ライトデータUBO（binding0）+ シャドウマップテクスチャ（binding1）
+// - デプステスト無効、フルスクリーン三角形（頂点3つ）で描画
 void CreateLightingPipeline(Renderer& renderer, std::string vertexAttributeName)
 {
 	Renderer::GraphicsPipelineParams graphicsPipelineParams;
@@ -740,7 +836,7 @@ void CreateLightingPipeline(Renderer& renderer, std::string vertexAttributeName)
 	descriptorSetLayout0.descriptorSetBindingParams.push_back(&metallicRoughnessInputBinding);
 	descriptorSetLayout0.isBindless = false;
 
-	// 1 CgʒuƃVhE}bv
+	// 1 ライト位置とシャドウマップ
 	Renderer::DescriptorSetLayoutParams descriptorSetLayout1;
 	Renderer::DescriptorSetBindingParams lightDataBinding;
 	lightDataBinding.bindingNum = 0;
@@ -771,12 +867,12 @@ void CreateLightingPipeline(Renderer& renderer, std::string vertexAttributeName)
 	renderer.CreateGraphicsPipeline(graphicsPipelineParams);
 }
 
-// VhE}bvpCvCifvXI[j
-// - ShadowMapPass œiJ[A^b`g0AfvX̂݁j
-// - _VF[_̂݁itOgVF[_ȂjŃfvXobt@ɏ
-// - Set0: Cg_̎ˉeEr[sibinding0, Vertexj
-// - Set1: IuWFNgSRTsibinding0, Vertexj
-// - Reversed-Z fvXeXgiGreaterj
+// シャドウマップ生成パイプライン（デプスオンリー）
+// - ShadowMapPass で動作（カラーアタッチメント0個、デプスのみ）
+// - 頂点シェーダのみ（フラグメントシェーダなし）でデプスバッファに書き込み
+// - Set0: ライト視点の射影・ビュー行列（binding0, Vertex）
+// - Set1: オブジェクトのSRT行列（binding0, Vertex）
+// - Reversed-Z デプステスト（Greater）
 void CreateShadowMapPipeline(Renderer& renderer, std::string vertexAttributeName)
 {
 	Renderer::GraphicsPipelineParams graphicsPipelineParams;
@@ -854,10 +950,16 @@ std::vector<Renderer::DrawParams> MakeDrawParamsForGeometryPipeline(Renderer& re
 	std::vector<Renderer::DrawParams> drawParamsList;
 	for (auto* obj : drawObjects) {
 		Renderer::DrawParams dp;
-		dp.pVertexArray = obj->drawArray.getGpuMemoryImpl();
+		dp.pVertexArray = obj->drawArray.getPositionGpuMemoryImpl();
+		dp.pAdditionalVertexArrays.push_back(obj->drawArray.getGpuMemoryImpl());
 		dp.instanceCount = 1;
-		dp.pIndexArray = obj->indexdrawArray.getGpuMemoryImpl();
-		dp.count = obj->indexdrawArray.size();
+		dp.pIndexArray = obj->GetIndexGpuMemoryImpl();
+		dp.indexType = obj->indexType;
+		obj->GetLodIndexRange(0, dp.firstIndex, dp.count);
+		if (!obj->meshlets.empty()) {
+			dp.pIndirectArray = obj->indirectBuffer.pGpuMemoryImpl;
+			dp.indirectDrawCount = static_cast<uint32_t>(obj->meshlets.size());
+		}
 		dp.descriptorSetInterfaces.push_back(obj->descriptorSetInterface);
 		dp.descriptorSetInterfaces.push_back(descriptorSetInterface);
 		dp.graphicsPipelineName = "testPipeline";
@@ -882,10 +984,11 @@ std::vector<Renderer::DrawParams> MakeDrawParamsForShadowPipeline(Renderer& rend
 	std::vector<Renderer::DrawParams> drawParamsList;
 	for (auto* obj : drawObjects) {
 		Renderer::DrawParams dp;
-		dp.pVertexArray = obj->drawArray.getGpuMemoryImpl();
+		dp.pVertexArray = obj->drawArray.getPositionGpuMemoryImpl();
 		dp.instanceCount = 1;
-		dp.pIndexArray = obj->indexdrawArray.getGpuMemoryImpl();
-		dp.count = obj->indexdrawArray.size();
+		dp.pIndexArray = obj->GetIndexGpuMemoryImpl();
+		dp.indexType = obj->indexType;
+		obj->GetLodIndexRange(0, dp.firstIndex, dp.count);
 		dp.descriptorSetInterfaces.push_back(obj->descriptorSetInterfaceForShadow);
 		dp.descriptorSetInterfaces.push_back(descriptorSetInterface);
 		dp.graphicsPipelineName = "shadowTestPipeline";
@@ -946,10 +1049,16 @@ std::vector<Renderer::DrawParams> MakeDrawParamsForGBufferPipeline(Renderer& ren
 		}
 
 		Renderer::DrawParams dp;
-		dp.pVertexArray = obj->drawArray.getGpuMemoryImpl();
+		dp.pVertexArray = obj->drawArray.getPositionGpuMemoryImpl();
+		dp.pAdditionalVertexArrays.push_back(obj->drawArray.getGpuMemoryImpl());
 		dp.instanceCount = 1;
-		dp.pIndexArray = obj->indexdrawArray.getGpuMemoryImpl();
-		dp.count = obj->indexdrawArray.size();
+		dp.pIndexArray = obj->GetIndexGpuMemoryImpl();
+		dp.indexType = obj->indexType;
+		obj->GetLodIndexRange(0, dp.firstIndex, dp.count);
+		if (!obj->meshlets.empty()) {
+			dp.pIndirectArray = obj->indirectBuffer.pGpuMemoryImpl;
+			dp.indirectDrawCount = static_cast<uint32_t>(obj->meshlets.size());
+		}
 		dp.descriptorSetInterfaces.push_back(gBufferCameraDescSet);
 		dp.descriptorSetInterfaces.push_back(gBufferObjectDescSet);
 		dp.graphicsPipelineName = "gBufferPipeline";
@@ -960,7 +1069,7 @@ std::vector<Renderer::DrawParams> MakeDrawParamsForGBufferPipeline(Renderer& ren
 
 Renderer::DrawParams MakeDrawParamsForLightingPipeline(Renderer& renderer, Renderer::GpuBuffer& lightDataUbo)
 {
-	// set 0: Input AttachmentsiG-Bufferǂݎj
+	// set 0: Input Attachments（G-Bufferから読み取り）
 	auto lightingInputDescSet = renderer.CreateDescriptorSetInterface("lightingPipeline", 0);
 	{
 		auto albedoTex = renderer.GetRenderPassAttatchmentTexture("GBufferPass", Renderer::AlbedoAttachment);
@@ -985,7 +1094,7 @@ Renderer::DrawParams MakeDrawParamsForLightingPipeline(Renderer& renderer, Rende
 		renderer.WriteDescriptorSet(writerParams, lightingInputDescSet);
 	}
 
-	// set 1: Cgf[^ + VhE}bv
+	// set 1: ライトデータ + シャドウマップ
 	auto lightingLightDescSet = renderer.CreateDescriptorSetInterface("lightingPipeline", 1);
 	{
 		auto shadowMapTexture = renderer.GetRenderPassAttatchmentTexture("ShadowMapPass", Renderer::AttatchmentLabel::DepthAttachment);
@@ -1022,7 +1131,395 @@ Renderer::DrawParams MakeDrawParamsForLightingPipeline(Renderer& renderer, Rende
 	return drawParams;
 }
 
-// oj[IuWFNg𐶐E
+// 描画用メッシュの index 順と頂点順を GPU の vertex cache 向けに並べ替える
+void OptimizeRenderMesh(std::vector<fvec3>& positions, std::vector<fvec3>& normals, std::vector<fvec2>& uvs, std::vector<uint32_t>& faceindices)
+{
+	constexpr uint32_t cacheSize = 16;
+
+	const uint32_t vertSize = static_cast<uint32_t>(positions.size());
+	const uint32_t iListSize = static_cast<uint32_t>(faceindices.size());
+
+	float ACMR, ATVR;
+	AnalyzeVertexCache(faceindices.data(), iListSize, vertSize, cacheSize, ACMR, ATVR);
+	std::cout << "vertex cache before : ACMR " << ACMR << " ATVR " << ATVR << std::endl;
+
+	uint32_t* pCacheIListData = nullptr;
+	OptimizeVertexCache(faceindices.data(), iListSize, vertSize, &pCacheIListData);
+
+	uint32_t* pOverdrawIListData = nullptr;
+	OptimizeOverdraw(positions.data(), vertSize, pCacheIListData, iListSize, cacheSize, 1.05f, &pOverdrawIListData);
+
+	uint32_t* pRemap = nullptr;
+	uint32_t newVertSize = 0;
+	OptimizeVertexFetch(pOverdrawIListData, iListSize, vertSize, &pRemap, newVertSize);
+
+	fvec3* pPositions = nullptr;
+	fvec3* pNormals = nullptr;
+	fvec2* pUvs = nullptr;
+	RemapVertexData(positions.data(), vertSize, pRemap, newVertSize, &pPositions);
+	RemapVertexData(normals.data(), vertSize, pRemap, newVertSize, &pNormals);
+	RemapVertexData(uvs.data(), vertSize, pRemap, newVertSize, &pUvs);
+
+	positions.assign(pPositions, pPositions + newVertSize);
+	normals.assign(pNormals, pNormals + newVertSize);
+	uvs.assign(pUvs, pUvs + newVertSize);
+	faceindices.assign(pOverdrawIListData, pOverdrawIListData + iListSize);
+
+	AnalyzeVertexCache(faceindices.data(), iListSize, newVertSize, cacheSize, ACMR, ATVR);
+	std::cout << "vertex cache after  : ACMR " << ACMR << " ATVR " << ATVR << std::endl;
+
+	delete[] pCacheIListData;
+	delete[] pOverdrawIListData;
+	delete[] pRemap;
+	delete[] pPositions;
+	delete[] pNormals;
+	delete[] pUvs;
+}
+
+// index list を meshlet 順に並べ直し、meshlet の bounds を drawObject に持たせる
+void BuildRenderMeshlets(std::vector<fvec3>& positions, std::vector<uint32_t>& faceindices, DrawObject& drawObject)
+{
+	Meshlet* pMeshlets = nullptr;
+	uint32_t meshletSize = 0;
+	uint32_t* pMeshletVertices = nullptr;
+	uint32_t meshletVertexSize = 0;
+	uint8_t* pMeshletTriangles = nullptr;
+	uint32_t meshletTriangleSize = 0;
+	BuildMeshlets(
+		positions.data(),
+		static_cast<uint32_t>(positions.size()),
+		faceindices.data(),
+		static_cast<uint32_t>(faceindices.size()),
+		MeshletMaxVertices,
+		MeshletMaxTriangles,
+		&pMeshlets,
+		meshletSize,
+		&pMeshletVertices,
+		meshletVertexSize,
+		&pMeshletTriangles,
+		meshletTriangleSize);
+
+	uint32_t* pIListData = nullptr;
+	uint32_t iListSize = 0;
+	BuildMeshletIndexList(pMeshlets, meshletSize, pMeshletVertices, pMeshletTriangles, &pIListData, iListSize);
+
+	faceindices.assign(pIListData, pIListData + iListSize);
+	drawObject.meshlets.assign(pMeshlets, pMeshlets + meshletSize);
+
+	std::cout << "meshlet : " << meshletSize << " meshlets, " << meshletTriangleSize << " triangles" << std::endl;
+
+	delete[] pMeshlets;
+	delete[] pMeshletVertices;
+	delete[] pMeshletTriangles;
+	delete[] pIListData;
+}
+
+// 視錐台外・裏向きの meshlet を instanceCount = 0 にして indirect buffer に書き込む
+// clipMatrix と cameraPosition は drawObject の object space で与える
+uint32_t UpdateMeshletDrawCommands(Renderer& renderer, DrawObject& drawObject, const fmat4& clipMatrix, const fvec3& cameraPosition)
+{
+	void* ptr = nullptr;
+	renderer.GetCpuMemoryPointer(drawObject.indirectBuffer, &ptr);
+	auto* commands = static_cast<Renderer::DrawIndexedIndirectCommand*>(ptr);
+
+	uint32_t visibleCount = 0;
+	for (uint32_t i = 0; i < drawObject.meshlets.size(); i++) {
+		const Meshlet& meshlet = drawObject.meshlets[i];
+		bool isVisible = !IsMeshletOutsideFrustum(meshlet, clipMatrix) && !IsMeshletBackfacing(meshlet, cameraPosition);
+
+		commands[i].indexCount = 3 * meshlet.triangleCount;
+		commands[i].instanceCount = isVisible ? 1 : 0;
+		commands[i].firstIndex = 3 * meshlet.triangleOffset;
+		commands[i].vertexOffset = 0;
+		commands[i].firstInstance = 0;
+
+		if (isVisible)
+			visibleCount++;
+	}
+
+	renderer.UnmapCpuMemoryPointer(drawObject.indirectBuffer);
+	return visibleCount;
+}
+
+// シャドウパス用の LOD を faceindices の後ろに連結する
+// シャドウパスは position しか使わないので seam は潰してよい
+void BuildShadowLODs(std::vector<fvec3>& positions, std::vector<uint32_t>& faceindices, DrawObject& drawObject)
+{
+	uint32_t* pIListData = nullptr;
+	uint32_t iListSize = 0;
+	uint32_t* pLodOffset = nullptr;
+	float* pLodError = nullptr;
+	uint32_t lodCount = 0;
+	GenerateLODChain(
+		positions.data(),
+		static_cast<uint32_t>(positions.size()),
+		faceindices.data(),
+		static_cast<uint32_t>(faceindices.size()),
+		5,
+		0.5f,
+		0.05f,
+		false,
+		&pIListData,
+		iListSize,
+		&pLodOffset,
+		&pLodError,
+		lodCount);
+
+	faceindices.assign(pIListData, pIListData + iListSize);
+	drawObject.lodIndexOffsets.assign(pLodOffset, pLodOffset + lodCount + 1);
+	drawObject.lodErrors.assign(pLodError, pLodError + lodCount);
+
+	for (uint32_t i = 0; i < lodCount; i++)
+		std::cout << "shadow LOD" << i << " : " << (pLodOffset[i + 1] - pLodOffset[i]) / 3 << " triangles, error " << pLodError[i] << std::endl;
+
+	delete[] pIListData;
+	delete[] pLodOffset;
+	delete[] pLodError;
+}
+
+Renderer::ImageFormat ToRendererImageFormat(const ImagePixelFormat& format)
+{
+	switch (format) {
+	case ImagePixelFormat::RGBA32F:
+		return Renderer::ImageFormat::RGBA32_FLOAT;
+	case ImagePixelFormat::BC1:
+		return Renderer::ImageFormat::BC1_RGBA_UNORM;
+	case ImagePixelFormat::BC3:
+		return Renderer::ImageFormat::BC3_UNORM;
+	case ImagePixelFormat::BC5:
+		return Renderer::ImageFormat::BC5_UNORM;
+	case ImagePixelFormat::BC7:
+		return Renderer::ImageFormat::BC7_UNORM;
+	default:
+		return Renderer::ImageFormat::RGBA8_UNORM;
+	}
+}
+
+// 画像 (mip 込み) から texture を作る
+// staging buffer は StagingBatchSize までまとめて 1 つ作り、その中の転送を 1 回の submit で済ませる
+constexpr size_t StagingBatchSize = 64 * 1024 * 1024;
+
+void CreateTexturesFromImages(Renderer& renderer, const std::vector<const ImageData*>& images, std::vector<Renderer::GpuTexture>& textures)
+{
+	textures.resize(images.size());
+	for (size_t i = 0; i < images.size(); i++) {
+		Renderer::CreateImageParams params;
+		params.width = images[i]->width;
+		params.height = images[i]->height;
+		params.format = ToRendererImageFormat(images[i]->format);
+		params.mipLevels = static_cast<uint32_t>(images[i]->mips.size());
+		params.maxAnisotropy = TextureMaxAnisotropy;
+		// CPU で mip を作っていない画像は GPU で作る (level 0 だけ転送される, 圧縮形式は縮小できない)
+		if (params.mipLevels == 1 && !IsBlockCompressed(images[i]->format)) {
+			params.mipLevels = 0;
+			params.generateMips = true;
+		}
+		textures[i] = renderer.CreateGpuTexture(params);
+	}
+
+	// bufferOffset は texel size の倍数にしておく必要がある
+	const auto alignedSize = [](const size_t& size) { return (size + 15) & ~size_t(15); };
+
+	size_t begin = 0;
+	while (begin < images.size()) {
+		// 入るだけ詰める (1 枚で StagingBatchSize を越えるものは単独で送る)
+		size_t end = begin;
+		size_t batchSize = 0;
+		while (end < images.size() && (end == begin || batchSize + images[end]->pixels.size() <= StagingBatchSize)) {
+			batchSize += alignedSize(images[end]->pixels.size());
+			end++;
+		}
+
+		Renderer::GpuBuffer stagingBuffer = renderer.CreateGpuBuffer(static_cast<uint32_t>(batchSize), Renderer::Transfer);
+		uint8_t* stagingBufferCpu = nullptr;
+		renderer.GetCpuMemoryPointer(stagingBuffer, (void**)&stagingBufferCpu);
+
+		ValueArray<Renderer::ImageUploadRegion> regions;
+		size_t offset = 0;
+		for (size_t i = begin; i < end; i++) {
+			std::memcpy(stagingBufferCpu + offset, images[i]->pixels.data(), images[i]->pixels.size());
+			for (uint32_t level = 0; level < images[i]->mips.size(); level++) {
+				const ImageMipLevel& mip = images[i]->mips[level];
+				Renderer::ImageUploadRegion region;
+				region.texture = textures[i];
+				region.mipLevel = level;
+				region.width = mip.width;
+				region.height = mip.height;
+				region.bufferOffset = static_cast<uint32_t>(offset + mip.offset);
+				regions.push_back(region);
+			}
+			offset += alignedSize(images[i]->pixels.size());
+		}
+
+		renderer.UnmapCpuMemoryPointer(stagingBuffer);
+		renderer.TransferStagingBufferToImages(stagingBuffer, regions);
+		renderer.DestroyGpuBuffer(stagingBuffer);
+
+		begin = end;
+	}
+}
+
+// material の texture を ImageLoadQueue に積んだときの id
+struct MaterialImageRequest {
+	static constexpr uint32_t NoImage = 0xFFFFFFFF;
+
+	uint32_t albedo = NoImage;
+	uint32_t metallic = NoImage;
+	uint32_t roughness = NoImage;
+	uint32_t normal = NoImage;
+};
+
+// textureEncoder で作った container (<画像>.pbtx) が同じ設定で作られていて元画像より新しければ、そちらを読む
+// (例: textureEncoder -f bc7 -srgb -flip albedo.png, textureEncoder -f bc5 -flip normal.png)
+std::string SelectTextureFile(const std::string& filename, const ImageLoadParams& params, const bool& isTextureCompressionBCSupported)
+{
+	if (!isTextureCompressionBCSupported)
+		return filename;
+
+	const std::string containerfilename = GetTextureContainerPath(filename.c_str());
+	const uint32_t flags = (params.isSRGB ? TextureContainerSRGB : 0) | (params.isFlipVertical ? TextureContainerFlipVertical : 0);
+	return IsTextureContainerUpToDate(containerfilename.c_str(), filename.c_str(), flags) ? containerfilename : filename;
+}
+
+MaterialImageRequest RequestMaterialImages(ImageLoadQueue& queue, const OBJMaterial& material, const bool& isTextureCompressionBCSupported)
+{
+	ImageLoadParams colorParams;
+	colorParams.isSRGB = true;
+	colorParams.isFlipVertical = true;
+
+	ImageLoadParams dataParams;
+	dataParams.isFlipVertical = true;
+
+	// metallic / roughness は 1 枚に詰めてから mip を作る
+	ImageLoadParams packParams;
+	packParams.isFlipVertical = true;
+	packParams.generateMips = false;
+
+	MaterialImageRequest request;
+	if (!material.albedoTexture.empty())
+		request.albedo = queue.Request(SelectTextureFile(material.albedoTexture, colorParams, isTextureCompressionBCSupported), colorParams);
+	if (!material.metallicTexture.empty())
+		request.metallic = queue.Request(material.metallicTexture, packParams);
+	if (!material.roughnessTexture.empty())
+		request.roughness = queue.Request(material.roughnessTexture, packParams);
+	if (!material.normalTexture.empty())
+		request.normal = queue.Request(SelectTextureFile(material.normalTexture, dataParams, isTextureCompressionBCSupported), dataParams);
+	return request;
+}
+
+// metallic (r) と roughness (g) を 1 枚の RGBA8 に詰める (G-Buffer シェーダは .r を metallic, .g を roughness として読む)
+// 片方しか無ければもう片方は material の値で埋める。大きさが違えば roughness 側に合わせて最近傍で拾う
+// 両方無くても metallic が 0 でなければ 1x1 の texture にする (頂点の roughness は使われなくなる)
+bool PackMetallicRoughness(const ImageData* metallic, const ImageData* roughness, const OBJMaterial& material, ImageData& packed)
+{
+	if (metallic == nullptr && roughness == nullptr && material.metallic <= 0.0f)
+		return false;
+
+	const ImageData* base = (roughness != nullptr) ? roughness : metallic;
+	packed.width = (base != nullptr) ? base->width : 1;
+	packed.height = (base != nullptr) ? base->height : 1;
+	packed.format = ImagePixelFormat::RGBA8;
+	packed.pixels.resize(size_t(packed.width) * packed.height * 4);
+	packed.mips.assign(1, ImageMipLevel { packed.width, packed.height, 0 });
+
+	const auto toUnorm = [](const float& value) { return uint8_t(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f); };
+	// 灰色の画像を想定して r を読む
+	const auto fetch = [&packed](const ImageData& image, const uint32_t& x, const uint32_t& y) {
+		const uint32_t sx = uint32_t(uint64_t(x) * image.width / packed.width);
+		const uint32_t sy = uint32_t(uint64_t(y) * image.height / packed.height);
+		const size_t index = size_t(sy) * image.width + sx;
+		if (image.format == ImagePixelFormat::RGBA32F)
+			return uint8_t(std::clamp(reinterpret_cast<const float*>(image.pixels.data())[4 * index], 0.0f, 1.0f) * 255.0f + 0.5f);
+		return image.pixels[4 * index];
+	};
+
+	const uint8_t metallicValue = toUnorm(material.metallic);
+	const uint8_t roughnessValue = toUnorm(material.roughness);
+	for (uint32_t y = 0; y < packed.height; y++) {
+		for (uint32_t x = 0; x < packed.width; x++) {
+			uint8_t* texel = packed.pixels.data() + 4 * (size_t(y) * packed.width + x);
+			texel[0] = (metallic != nullptr) ? fetch(*metallic, x, y) : metallicValue;
+			texel[1] = (roughness != nullptr) ? fetch(*roughness, x, y) : roughnessValue;
+			texel[2] = 0;
+			texel[3] = 255;
+		}
+	}
+
+	GenerateImageMips(packed, false);
+	return true;
+}
+
+// material ごとの texture (無い slot は nullptr)
+struct MaterialTextures {
+	Renderer::GpuTexture albedo;
+	Renderer::GpuTexture metallicRoughness;
+	Renderer::GpuTexture normal;
+};
+
+// decode が終わった画像から全 material の texture をまとめて作る
+// 読めなかった画像は無いものとして扱う
+void CreateMaterialTextures(Renderer& renderer, ImageLoadQueue& queue, const std::vector<OBJMaterial>& materials,
+	const std::vector<MaterialImageRequest>& requests, std::vector<MaterialTextures>& materialTextures)
+{
+	const auto wait = [&queue](const uint32_t& id, const std::string& filename) -> const ImageData* {
+		if (id == MaterialImageRequest::NoImage)
+			return nullptr;
+		const ImageData* image = queue.Wait(id);
+		if (image == nullptr)
+			std::cout << "fail to load texture: " << filename << std::endl;
+		return image;
+	};
+
+	std::vector<const ImageData*> albedoImages(materials.size());
+	std::vector<const ImageData*> metallicImages(materials.size());
+	std::vector<const ImageData*> roughnessImages(materials.size());
+	std::vector<const ImageData*> normalImages(materials.size());
+	for (size_t i = 0; i < materials.size(); i++) {
+		albedoImages[i] = wait(requests[i].albedo, materials[i].albedoTexture);
+		metallicImages[i] = wait(requests[i].metallic, materials[i].metallicTexture);
+		roughnessImages[i] = wait(requests[i].roughness, materials[i].roughnessTexture);
+		normalImages[i] = wait(requests[i].normal, materials[i].normalTexture);
+	}
+
+	std::vector<ImageData> packedImages(materials.size());
+	std::vector<uint8_t> hasPackedImage(materials.size(), 0);
+	ParallelFor(static_cast<uint32_t>(materials.size()), std::thread::hardware_concurrency(), [&](const uint32_t i) {
+		hasPackedImage[i] = PackMetallicRoughness(metallicImages[i], roughnessImages[i], materials[i], packedImages[i]);
+	});
+
+	// 同じ画像を参照する material があっても texture は 1 つにする
+	std::vector<const ImageData*> images;
+	const auto indexOf = [&images](const ImageData* image) {
+		if (image == nullptr)
+			return MaterialImageRequest::NoImage;
+		auto it = std::find(images.begin(), images.end(), image);
+		if (it == images.end())
+			it = images.insert(images.end(), image);
+		return uint32_t(it - images.begin());
+	};
+
+	std::vector<std::array<uint32_t, 3>> textureIndices(materials.size());
+	for (size_t i = 0; i < materials.size(); i++) {
+		textureIndices[i][0] = indexOf(albedoImages[i]);
+		textureIndices[i][1] = indexOf(hasPackedImage[i] ? &packedImages[i] : nullptr);
+		textureIndices[i][2] = indexOf(normalImages[i]);
+	}
+
+	std::vector<Renderer::GpuTexture> textures;
+	CreateTexturesFromImages(renderer, images, textures);
+
+	materialTextures.resize(materials.size());
+	for (size_t i = 0; i < materials.size(); i++) {
+		const auto textureOf = [&textures](const uint32_t& index) {
+			return (index != MaterialImageRequest::NoImage) ? textures[index] : Renderer::GpuTexture();
+		};
+		materialTextures[i].albedo = textureOf(textureIndices[i][0]);
+		materialTextures[i].metallicRoughness = textureOf(textureIndices[i][1]);
+		materialTextures[i].normal = textureOf(textureIndices[i][2]);
+	}
+}
+
+// バニーオブジェクトを生成・初期化する
 void CreateBunnyObject(Renderer& renderer, DrawObject& drawObject)
 {
 	std::vector<fvec3> positions;
@@ -1032,28 +1529,75 @@ void CreateBunnyObject(Renderer& renderer, DrawObject& drawObject)
 
 	constexpr auto resourcePath = RESOURCE_DIR "/Bunny.obj";
 
-	LoadOBJtoRenderTriangleMesh(
-		resourcePath,
-		positions,
-		normals,
-		uvs,
-		faceindices,
-		fvec3(0.0f, 0.0f, 0.0f),
-		1.f);
+	// mtllib があれば mesh を読んでいる間に texture の decode を裏で進める
+	// バニーは material 1 つを前提にして、先頭の material を使う
+	std::vector<OBJMaterial> materials;
+	LoadOBJMaterials(resourcePath, materials);
+	if (materials.size() > 1)
+		materials.resize(1);
+
+	ImageLoadQueue imageQueue(std::thread::hardware_concurrency());
+	std::vector<MaterialImageRequest> imageRequests;
+	for (const auto& material : materials)
+		imageRequests.push_back(RequestMaterialImages(imageQueue, material, renderer.IsTextureCompressionBCSupported()));
+
+	// 2 回目以降は Bunny.obj.render.pbmc を mmap するだけで済む
+	{
+		MeshCache cache;
+		if (!LoadMeshCache(
+			resourcePath,
+			MeshCacheRenderTriangle,
+			fvec3(0.0f, 0.0f, 0.0f),
+			1.f,
+			false,
+			cache,
+			std::thread::hardware_concurrency())) {
+			std::cout << "failed to load " << resourcePath << std::endl;
+			exit(1);
+		}
+
+		positions.assign(cache.positions.data, cache.positions.data + cache.positions.size);
+		normals.assign(cache.normals.data, cache.normals.data + cache.normals.size);
+		uvs.assign(cache.uvs.data, cache.uvs.data + cache.uvs.size);
+		faceindices.assign(cache.indices.data, cache.indices.data + cache.indices.size);
+	}
+
+	OptimizeRenderMesh(positions, normals, uvs, faceindices);
+	BuildRenderMeshlets(positions, faceindices, drawObject);
+	BuildShadowLODs(positions, faceindices, drawObject);
 
 	drawObject.vertexCount = static_cast<uint32_t>(positions.size());
 	drawObject.indexCount = static_cast<uint32_t>(faceindices.size());
 	drawObject.Initialize(renderer);
+	drawObject.indirectBuffer = renderer.CreateGpuBuffer(drawObject.meshlets.size() * sizeof(Renderer::DrawIndexedIndirectCommand), Renderer::Indirect);
 
 	drawObject.metallicRoughnessTexture = CreateDefaultTexture(renderer, 0x00000000);
 	drawObject.normalTexture = CreateDefaultTexture(renderer, 0x7F7F0000);
-	{
+
+	fvec3 albedo = fvec3(1.0f, 1.0f, 1.0f);
+	float roughness = 0.5f;
+	if (materials.empty()) {
 		uint32_t checkerData[128 * 128];
 		for (uint32_t i = 0; i < 128; i++)
 			for (uint32_t j = 0; j < 128; j++)
 				checkerData[128 * i + j] = ((i / 16 + j / 16) % 2 == 0) ? 0xFF555555 : 0xFFFFFFFF;
 		drawObject.SetTexture(renderer, DrawObject::TextureType::Albedo, 128, 128, checkerData);
 	}
+	else {
+		std::vector<MaterialTextures> materialTextures;
+		CreateMaterialTextures(renderer, imageQueue, materials, imageRequests, materialTextures);
+
+		// texture が無い値は頂点属性で渡す
+		if (materialTextures[0].albedo.pGpuTextureMemoryImpl != nullptr)
+			drawObject.SetTexture(renderer, DrawObject::TextureType::Albedo, materialTextures[0].albedo);
+		else
+			albedo = materials[0].albedo;
+		if (materialTextures[0].metallicRoughness.pGpuTextureMemoryImpl != nullptr)
+			drawObject.SetTexture(renderer, DrawObject::TextureType::MetallicRoughness, materialTextures[0].metallicRoughness);
+		if (materialTextures[0].normal.pGpuTextureMemoryImpl != nullptr)
+			drawObject.SetTexture(renderer, DrawObject::TextureType::Normal, materialTextures[0].normal);
+		roughness = materials[0].roughness;
+	}
 
 	drawObject.WriteDescriptorSet(renderer);
 
@@ -1067,27 +1611,27 @@ void CreateBunnyObject(Renderer& renderer, DrawObject& drawObject)
 		drawObject.drawArray[i].uv(0) = uvs[i].x;
 		drawObject.drawArray[i].uv(1) = uvs[i].y;
 
-		drawObject.drawArray[i].color(0) = 1.0f;
-		drawObject.drawArray[i].color(1) = 1.0f;
-		drawObject.drawArray[i].color(2) = 1.0f;
+		drawObject.drawArray[i].color(0) = albedo.x;
+		drawObject.drawArray[i].color(1) = albedo.y;
+		drawObject.drawArray[i].color(2) = albedo.z;
 		drawObject.drawArray[i].color(3) = 1.0f;
 
 		drawObject.drawArray[i].tangent(0) = 1.0f;
 		drawObject.drawArray[i].tangent(1) = 0.0f;
 		drawObject.drawArray[i].tangent(2) = 0.0f;
 		drawObject.drawArray[i].tangent(3) = 1.0f;
-		drawObject.drawArray[i].roughness = 0.5f;
+		drawObject.drawArray[i].roughness = roughness;
 	}
 
 	for (uint32_t i = 0; i < faceindices.size(); i++) {
-		drawObject.indexdrawArray[i] = static_cast<int32_t>(faceindices[i]);
+		drawObject.SetIndex(i, faceindices[i]);
 	}
 
 	renderer.UpdateVertexArray(&drawObject.drawArray);
-	renderer.UpdateVertexArray(&drawObject.indexdrawArray);
+	drawObject.UpdateIndexArray(renderer);
 }
 
-// iʃbVjIuWFNg𐶐E
+// 床（平面メッシュ）オブジェクトを生成・初期化する
 void CreateFloorObject(Renderer& renderer, DrawObject& drawObject)
 {
 	fvec2* pVertData2d;
@@ -1181,32 +1725,89 @@ void CreateFloorObject(Renderer& renderer, DrawObject& drawObject)
 	}
 
 	for (uint32_t i = 0; i < iListSize; i++) {
-		drawObject.indexdrawArray[i] = static_cast<int32_t>(pIListData[i]);
+		drawObject.SetIndex(i, pIListData[i]);
+	}
+
+	renderer.UpdateVertexArray(&drawObject.drawArray);
+	drawObject.UpdateIndexArray(renderer);
+}
+
+// シミュレーション結果の mesh sequence (tools/meshSequenceEncoder で作る) を再生するオブジェクトを生成・初期化する
+// uv と index は最初に 1 度だけ送り、frame ごとには position と normal だけを差し替える
+void CreateSequenceObject(Renderer& renderer, DrawObject& drawObject, const MeshSequence& sequence, const fvec3& position)
+{
+	drawObject.vertexCount = sequence.GetVertexCount();
+	drawObject.indexCount = sequence.indices.size;
+
+	drawObject.Initialize(renderer);
+
+	drawObject.srtMatrix = fmat4::identity();
+	drawObject.srtMatrix(0, 3) = position.x;
+	drawObject.srtMatrix(1, 3) = position.y;
+	drawObject.srtMatrix(2, 3) = position.z;
+	drawObject.srtMatrix = drawObject.srtMatrix.transpose();
+	drawObject.UploadObjectData(renderer);
+
+	drawObject.metallicRoughnessTexture = CreateDefaultTexture(renderer, 0x00000000);
+	drawObject.normalTexture = CreateDefaultTexture(renderer, 0x7F7F0000);
+	drawObject.textureMemory = CreateDefaultTexture(renderer, 0xFFFFFFFF);
+
+	drawObject.WriteDescriptorSet(renderer);
+
+	// frame 0 の position と normal は mmap した領域から直接読む
+	std::vector<fvec3> positions(sequence.GetVertexCount());
+	std::vector<fvec3> normals(sequence.GetVertexCount());
+	if (sequence.GetFrameCount() > 0)
+		sequence.ReadFrame(0, positions.data(), normals.data());
+
+	for (uint32_t i = 0; i < drawObject.vertexCount; i++) {
+		drawObject.drawArray[i].position(0) = positions[i].x;
+		drawObject.drawArray[i].position(1) = positions[i].y;
+		drawObject.drawArray[i].position(2) = positions[i].z;
+		drawObject.drawArray[i].normal(0) = normals[i].x;
+		drawObject.drawArray[i].normal(1) = normals[i].y;
+		drawObject.drawArray[i].normal(2) = normals[i].z;
+		drawObject.drawArray[i].uv(0) = sequence.uvs[i].x;
+		drawObject.drawArray[i].uv(1) = sequence.uvs[i].y;
+		drawObject.drawArray[i].color(0) = 0.8f;
+		drawObject.drawArray[i].color(1) = 0.3f;
+		drawObject.drawArray[i].color(2) = 0.2f;
+		drawObject.drawArray[i].color(3) = 1.0f;
+
+		drawObject.drawArray[i].tangent(0) = 1.0f;
+		drawObject.drawArray[i].tangent(1) = 0.0f;
+		drawObject.drawArray[i].tangent(2) = 0.0f;
+		drawObject.drawArray[i].tangent(3) = 1.0f;
+		drawObject.drawArray[i].roughness = 0.5f;
+	}
+
+	for (uint32_t i = 0; i < drawObject.indexCount; i++) {
+		drawObject.SetIndex(i, sequence.indices[i]);
 	}
 
 	renderer.UpdateVertexArray(&drawObject.drawArray);
-	renderer.UpdateVertexArray(&drawObject.indexdrawArray);
+	drawObject.UpdateIndexArray(renderer);
 }
 
+// shader の uniform block と同じ配置 (vec3 は fvec3a で 16 byte に揃える, lightPos の後ろには lightIntensity が入る)
 struct LightData {
 	fvec3 lightPos;
 	float lightIntensity;
-	fvec3 color;
-	float padding2;
-	fvec3 cameraPos;
-	float padding3;
-	fmat4 lightPersMatrix;
-	fmat4 lightCameraMatrix;
+	fvec3a color;
+	fvec3a cameraPos;
+	fmat4a lightPersMatrix;
+	fmat4a lightCameraMatrix;
 };
+static_assert(offsetof(LightData, color) == 16 && offsetof(LightData, cameraPos) == 32 && offsetof(LightData, lightPersMatrix) == 48);
 
 struct PersMatrixData {
-	fmat4 cameraMatrix;
-	fmat4 persMatrix;
+	fmat4a cameraMatrix;
+	fmat4a persMatrix;
 };
 
 struct LightPersMatrixData {
-	fmat4 lightPersMatrix;
-	fmat4 lightCameraMatrix;
+	fmat4a lightPersMatrix;
+	fmat4a lightCameraMatrix;
 };
 
 int main()
@@ -1228,11 +1829,12 @@ int main()
 	//////////
 
 	auto vertexAttribute = RegisterVertexAttribute(renderer);
+	auto positionOnlyVertexAttribute = RegisterPositionOnlyVertexAttribute(renderer);
 
 	/////////
 
 	CreateGeometryPipeline(renderer, vertexAttribute.name);
-	CreateShadowMapPipeline(renderer, vertexAttribute.name);
+	CreateShadowMapPipeline(renderer, positionOnlyVertexAttribute.name);
 	CreateGBufferPipeline(renderer, vertexAttribute.name);
 	CreateLightingPipeline(renderer, vertexAttribute.name);
 
@@ -1240,24 +1842,42 @@ int main()
 	RootAllocator RootAllocator;
 	TypeAllocator<BasicVertex> vertexAllocator(&RootAllocator, "vertexAllocator");
 	TypeAllocator<int32_t> intAllocator(&RootAllocator, "intAllocator");
+	TypeAllocator<uint16_t> shortAllocator(&RootAllocator, "shortAllocator");
 
-	// `IuWFNgzŊǗĩIuWFNgǉɔj
+	// 描画オブジェクトを配列で管理（今後のオブジェクト追加に備える）
 	std::vector<std::unique_ptr<DrawObject>> drawObjects;
-	drawObjects.push_back(std::make_unique<DrawObject>(vertexAllocator, intAllocator));
-	drawObjects.push_back(std::make_unique<DrawObject>(vertexAllocator, intAllocator));
+	drawObjects.push_back(std::make_unique<DrawObject>(vertexAllocator, intAllocator, shortAllocator));
+	drawObjects.push_back(std::make_unique<DrawObject>(vertexAllocator, intAllocator, shortAllocator));
 
 	CreateBunnyObject(renderer, *drawObjects[0]);
 	CreateFloorObject(renderer, *drawObjects[1]);
 
-	// |C^zieMakeDrawParams֐ɓnpj
+	// resources に sequence.pbms があればバニーの隣で再生する
+	constexpr auto sequencePath = RESOURCE_DIR "/sequence.pbms";
+	MeshSequence sequence;
+	std::unique_ptr<MeshSequenceStream> sequenceStream;
+	DrawObject* pSequenceObject = nullptr;
+	std::error_code sequenceError;
+	if (std::filesystem::exists(sequencePath, sequenceError) && sequence.Open(sequencePath) && sequence.GetFrameCount() > 0) {
+		drawObjects.push_back(std::make_unique<DrawObject>(vertexAllocator, intAllocator, shortAllocator));
+		pSequenceObject = drawObjects.back().get();
+		CreateSequenceObject(renderer, *pSequenceObject, sequence, fvec3(1.5f, 0.0f, 0.0f));
+		sequenceStream = std::make_unique<MeshSequenceStream>(sequence);
+	}
+	const auto sequenceStartTime = std::chrono::steady_clock::now();
+	uint32_t sequenceFrame = 0; // CreateSequenceObject で frame 0 を書いてある
+
+	// ポインタ配列（各MakeDrawParams関数に渡す用）
 	std::vector<DrawObject*> drawObjectPtrs;
 	for (auto& obj : drawObjects) {
 		drawObjectPtrs.push_back(obj.get());
 	}
 
 	// perspective
+	const fvec3 cameraPosition = fvec3(0.0f, 2.0f, 5.0f);
 	auto persMat = makeProjectionMatrixVk(0.01, 100.0, 0.01, -0.01, 0.01, -0.01).transpose();
-	auto cameraMat = makeCameraMatrix(fvec3(0.0f, 0.0f, 0.0f), fvec3(0.0f, 2.0f, 5.0f), fvec3(0.0f, 1.0f, 0.0f)).transpose();
+	auto cameraMat = makeCameraMatrix(fvec3(0.0f, 0.0f, 0.0f), cameraPosition, fvec3(0.0f, 1.0f, 0.0f)).transpose();
+	const fmat4 viewProjectionMatrix = persMat.transpose() * cameraMat.transpose();
 
 	auto persMatUbo = renderer.CreateGpuBuffer(sizeof(PersMatrixData), Renderer::Uniform);
 	void* persMatUboCpuBuffer = nullptr;
@@ -1301,7 +1921,7 @@ int main()
 	auto descriptorSetInterfaceShadow = renderer.CreateDescriptorSetInterface("shadowTestPipeline", 0);
 	auto shadowDrawParams = MakeDrawParamsForShadowPipeline(renderer, drawObjectPtrs, lightPersMatrixUbo, descriptorSetInterfaceShadow);
 
-	///// xVF[fBOpDescriptorݒ
+	///// 遅延シェーディング用のDescriptor設定
 
 	auto gBufferDrawParams = MakeDrawParamsForGBufferPipeline(renderer, drawObjectPtrs, persMatUbo);
 	auto lightingDrawParams = MakeDrawParamsForLightingPipeline(renderer, lightDataUbo);
@@ -1325,9 +1945,31 @@ int main()
 		(*srtMatrixCpu)(0, 3) = 0.0f;
 		(*srtMatrixCpu)(1, 3) = 0.2f;
 		(*srtMatrixCpu)(2, 3) = 0.0f;
+		fmat4 bunnySrtMatrix = *srtMatrixCpu;
 		(*srtMatrixCpu) = (*srtMatrixCpu).transpose();
 		renderer.UnmapCpuMemoryPointer(drawObjects[0]->srtMatrixBuffer);
 
+		// バニーの meshlet culling（srt は平行移動のみなのでカメラ位置は平行移動を引くだけで object space になる）
+		UpdateMeshletDrawCommands(
+			renderer,
+			*drawObjects[0],
+			viewProjectionMatrix * bunnySrtMatrix,
+			cameraPosition - fvec3(bunnySrtMatrix(0, 3), bunnySrtMatrix(1, 3), bunnySrtMatrix(2, 3)));
+
+		// sequence は経過時間から frame を決める (描画が遅れたら frame を飛ばす)
+		// frame が変わらない間は前の頂点のまま描く (同じ frame を AcquireFrame すると seek になる)
+		if (sequenceStream) {
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - sequenceStartTime).count();
+			const uint32_t frame = uint64_t(seconds * sequence.GetFrameRate()) % sequence.GetFrameCount();
+			const fvec3* pPositions = nullptr;
+			const fvec3* pNormals = nullptr;
+			if (frame != sequenceFrame && sequenceStream->AcquireFrame(frame, pPositions, pNormals)) {
+				renderer.UpdateVertexArrayPositions(&pSequenceObject->drawArray, pPositions, pNormals);
+				sequenceStream->ReleaseFrame();
+				sequenceFrame = frame;
+			}
+		}
+
 		lightData.lightPos = fvec3(3.0 * std::sin(counter / -60.0f), 9.0f, 3.0f * std::cos(counter / -60.0f));
 		lightData.color = fvec3(1.0f, 1.0f, 1.0f);
 
@@ -1343,6 +1985,21 @@ int main()
 		std::memcpy(lightDataUboCpuBuffer, &lightData, sizeof(LightData));
 		renderer.UnmapCpuMemoryPointer(lightDataUbo);
 
+		// シャドウマップ上での投影サイズからオブジェクトごとに LOD を選ぶ
+		{
+			const float shadowMapHeight = static_cast<float>(rendererInitializeParams.windowSize.y);
+			const float projectionScale = 0.5f * shadowMapHeight * std::abs(lightPersMatrixData.lightPersMatrix(1, 1));
+			for (uint32_t i = 0; i < drawObjectPtrs.size(); i++) {
+				DrawObject* obj = drawObjectPtrs[i];
+				if (obj->lodErrors.empty())
+					continue;
+				fvec3 objectPosition = (i == 0) ? fvec3(bunnySrtMatrix(0, 3), bunnySrtMatrix(1, 3), bunnySrtMatrix(2, 3)) : fvec3::zero();
+				float distance = std::sqrt((lightData.lightPos - objectPosition).sqnorm());
+				uint32_t lod = SelectLOD(obj->lodErrors.data(), static_cast<uint32_t>(obj->lodErrors.size()), distance, projectionScale, 1.0f);
+				obj->GetLodIndexRange(lod, shadowDrawParams[i].firstIndex, shadowDrawParams[i].count);
+			}
+		}
+
 		renderer.GetCpuMemoryPointer(lightPersMatrixUbo, &lightPersMatrixUboCpuBuffer);
 		LightPersMatrixData* lightPersMatrixDataCpu = reinterpret_cast<LightPersMatrixData*>(lightPersMatrixUboCpuBuffer);
 		std::memcpy(lightPersMatrixDataCpu, &lightPersMatrixData, sizeof(LightPersMatrixData));
@@ -1378,10 +2035,10 @@ int main()
 		renderer.EndRenderPass();
 
 		//////////////////
-		// xVF[fBO`
+		// 遅延シェーディング描画
 		//////////////////
 
-		// G-BufferNA
+		// G-Bufferクリア
 		Renderer::BeginRenderPassParams beginClearGBufferPassParams{ "ClearGBufferPass" };
 		beginClearGBufferPassParams.clearColors.resize(6);
 		beginClearGBufferPassParams.clearColorValues.resize(6);
@@ -1400,11 +2057,11 @@ int main()
 		renderer.BeginRenderPass(beginClearGBufferPassParams);
 		renderer.EndRenderPass();
 
-		// G-BufferpXJniSubpass 0: G-Buffer݁j
+		// G-Bufferパス開始（Subpass 0: G-Buffer書き込み）
 		Renderer::BeginRenderPassParams beginGBufferPassParams{ "GBufferPass" };
 		renderer.BeginRenderPass(beginGBufferPassParams);
 
-		// G-Bufferɏ
+		// G-Bufferに書き込み
 		for (auto& dp : gBufferDrawParams) {
 			renderer.Draw(dp);
 		}
@@ -1416,7 +2073,7 @@ int main()
 		renderer.EndRenderPass();
 
 		////////////////////
-		//// tH[h_Oi̕`cj
+		//// フォワードレンダリング（既存の描画も残す）
 		////////////////////
 
 		//Renderer::BeginRenderPassParams beginClearRenderPassParams{ "ClearRenderPass" };
@@ -0,0 +1,130 @@
+#include <cstdint>
+#include <cstdlib>
+#include <cctype>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <filesystem>
+#include <algorithm>
+
+#include "src/utils/fileloader/MeshSequence.hpp"
+
+// frame ごとの OBJ (同じ接続の mesh の列) を 1 つの mesh sequence (.pbms) にまとめる
+// 入力にディレクトリを渡すと、その中の .obj をファイル名順に frame として並べる
+// ファイル名の中の数字は数として比べる (frame_2.obj, frame_10.obj の順, 0 埋めしていなくてもよい)
+
+void PrintUsage()
+{
+	std::cout << "usage: meshSequenceEncoder [options] -o output.pbms input..." << std::endl;
+	std::cout << "  -o output           output file" << std::endl;
+	std::cout << "  -fps rate           frames per second (default: 30)" << std::endl;
+	std::cout << "  -scale s            mesh scale (default: 1)" << std::endl;
+	std::cout << "  -j threads          OBJ reader threads (default: all cores)" << std::endl;
+}
+
+// 数字の並びを数として比べる文字列の順序 (natural sort)
+bool NaturalLess(const std::string& a, const std::string& b)
+{
+	size_t i = 0, j = 0;
+	while (i < a.size() && j < b.size()) {
+		const bool adigit = std::isdigit(static_cast<unsigned char>(a[i]));
+		const bool bdigit = std::isdigit(static_cast<unsigned char>(b[j]));
+		if (!adigit || !bdigit) {
+			if (a[i] != b[j])
+				return a[i] < b[j];
+			i++;
+			j++;
+			continue;
+		}
+
+		// 先頭の 0 を飛ばし、桁数, 数字の並びの順に比べる
+		size_t iend = i, jend = j;
+		while (iend < a.size() && std::isdigit(static_cast<unsigned char>(a[iend])))
+			iend++;
+		while (jend < b.size() && std::isdigit(static_cast<unsigned char>(b[jend])))
+			jend++;
+		size_t inz = i, jnz = j;
+		while (inz + 1 < iend && a[inz] == '0')
+			inz++;
+		while (jnz + 1 < jend && b[jnz] == '0')
+			jnz++;
+		if (iend - inz != jend - jnz)
+			return iend - inz < jend - jnz;
+		const int c = a.compare(inz, iend - inz, b, jnz, jend - jnz);
+		if (c != 0)
+			return c < 0;
+		// 同じ数なら 0 埋めの短い方を先にする
+		if (iend - i != jend - j)
+			return iend - i < jend - j;
+		i = iend;
+		j = jend;
+	}
+	return a.size() - i < b.size() - j;
+}
+
+int main(int argc, char const* argv[])
+{
+	std::string output;
+	float frameRate = 30.0f;
+	float meshscale = 1.0f;
+	uint32_t threadCount = std::thread::hardware_concurrency();
+	std::vector<std::string> inputs;
+
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		if (arg == "-o" && i + 1 < argc)
+			output = argv[++i];
+		else if (arg == "-fps" && i + 1 < argc)
+			frameRate = std::atof(argv[++i]);
+		else if (arg == "-scale" && i + 1 < argc)
+			meshscale = std::atof(argv[++i]);
+		else if (arg == "-j" && i + 1 < argc)
+			threadCount = std::max(1, std::atoi(argv[++i]));
+		else if (!arg.empty() && arg[0] == '-') {
+			PrintUsage();
+			return 1;
+		}
+		else
+			inputs.push_back(arg);
+	}
+
+	if (inputs.empty() || output.empty() || frameRate <= 0.0f) {
+		PrintUsage();
+		return 1;
+	}
+
+	std::vector<std::string> objfilenames;
+	for (const auto& input : inputs) {
+		std::error_code ec;
+		if (!std::filesystem::is_directory(input, ec)) {
+			objfilenames.push_back(input);
+			continue;
+		}
+
+		std::vector<std::string> frames;
+		for (const auto& entry : std::filesystem::directory_iterator(input, ec)) {
+			if (entry.is_regular_file() && entry.path().extension() == ".obj")
+				frames.push_back(entry.path().generic_string());
+		}
+		std::sort(frames.begin(), frames.end(), NaturalLess);
+		objfilenames.insert(objfilenames.end(), frames.begin(), frames.end());
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+
+	if (!ConvertOBJSequenceToMeshSequence(objfilenames, output.c_str(), fvec3(0.0f, 0.0f, 0.0f), meshscale, frameRate, threadCount))
+		return 1;
+
+	MeshSequence sequence;
+	if (!sequence.Open(output.c_str()))
+		return 1;
+
+	const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::cout << output << " : " << sequence.GetFrameCount() << " frames, " << sequence.GetVertexCount() << " vertices, "
+		  << sequence.indices.size / 3 << " triangles, "
+		  << sequence.GetHeader().frameStride / 1024 << " KiB/frame, " << milliseconds << " ms" << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,143 @@
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "src/utils/fileloader/ImageLoader.hpp"
+#include "src/utils/fileloader/BlockCompression.hpp"
+#include "src/utils/fileloader/TextureContainer.hpp"
+
+// 画像を BC 圧縮して mip 込みの texture container (.pbtx) に書く
+// 出力先を省くと <入力>.pbtx に書く (rendererTest は元画像の隣にあるこの名前を探す)
+
+void PrintUsage()
+{
+	std::cout << "usage: textureEncoder [options] input..." << std::endl;
+	std::cout << "  -f bc1|bc3|bc5|bc7  format (default: bc7)" << std::endl;
+	std::cout << "  -srgb               average mips in linear space (color textures)" << std::endl;
+	std::cout << "  -flip               flip vertically (OBJ uv, used by rendererTest)" << std::endl;
+	std::cout << "  -nomip              write level 0 only" << std::endl;
+	std::cout << "  -o output           output file (single input only)" << std::endl;
+	std::cout << "  -j threads          encoder threads (default: all cores)" << std::endl;
+}
+
+bool ParseFormat(const std::string& name, ImagePixelFormat& format)
+{
+	if (name == "bc1")
+		format = ImagePixelFormat::BC1;
+	else if (name == "bc3")
+		format = ImagePixelFormat::BC3;
+	else if (name == "bc5")
+		format = ImagePixelFormat::BC5;
+	else if (name == "bc7")
+		format = ImagePixelFormat::BC7;
+	else
+		return false;
+	return true;
+}
+
+// level 0 を展開して元画像と比べる (BC5 は RG, BC1 は不透明な texel の RGB だけ)
+double ComputePSNR(const ImageData& source, const ImageData& compressed)
+{
+	std::vector<uint8_t> decoded(size_t(source.width) * source.height * 4);
+	if (!DecodeBCImage(compressed.pixels.data(), source.width, source.height, compressed.format, decoded.data()))
+		return 0.0;
+
+	const uint32_t channelCount = (compressed.format == ImagePixelFormat::BC5) ? 2 : (compressed.format == ImagePixelFormat::BC1) ? 3 : 4;
+	double squaredError = 0.0;
+	size_t count = 0;
+	for (size_t i = 0; i < size_t(source.width) * source.height; i++) {
+		if (compressed.format == ImagePixelFormat::BC1 && source.pixels[4 * i + 3] < 128)
+			continue;
+		for (uint32_t c = 0; c < channelCount; c++) {
+			const double d = double(source.pixels[4 * i + c]) - decoded[4 * i + c];
+			squaredError += d * d;
+			count++;
+		}
+	}
+	if (count == 0 || squaredError == 0.0)
+		return INFINITY;
+	return 10.0 * std::log10(255.0 * 255.0 * count / squaredError);
+}
+
+int main(int argc, char const* argv[])
+{
+	ImagePixelFormat format = ImagePixelFormat::BC7;
+	bool isSRGB = false;
+	bool isFlipVertical = false;
+	bool generateMips = true;
+	std::string output;
+	uint32_t threadCount = std::thread::hardware_concurrency();
+	std::vector<std::string> inputs;
+
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		if (arg == "-f" && i + 1 < argc) {
+			if (!ParseFormat(argv[++i], format)) {
+				std::cout << "unknown format: " << argv[i] << std::endl;
+				return 1;
+			}
+		}
+		else if (arg == "-srgb")
+			isSRGB = true;
+		else if (arg == "-flip")
+			isFlipVertical = true;
+		else if (arg == "-nomip")
+			generateMips = false;
+		else if (arg == "-o" && i + 1 < argc)
+			output = argv[++i];
+		else if (arg == "-j" && i + 1 < argc)
+			threadCount = std::max(1, std::atoi(argv[++i]));
+		else if (!arg.empty() && arg[0] == '-') {
+			PrintUsage();
+			return 1;
+		}
+		else
+			inputs.push_back(arg);
+	}
+
+	if (inputs.empty() || (!output.empty() && inputs.size() > 1)) {
+		PrintUsage();
+		return 1;
+	}
+
+	const uint32_t flags = (isSRGB ? TextureContainerSRGB : 0) | (isFlipVertical ? TextureContainerFlipVertical : 0);
+
+	bool isSucceeded = true;
+	for (const auto& input : inputs) {
+		const auto start = std::chrono::steady_clock::now();
+
+		ImageData image;
+		if (!LoadImageFile(input.c_str(), image, isFlipVertical)) {
+			isSucceeded = false;
+			continue;
+		}
+		if (image.format != ImagePixelFormat::RGBA8) {
+			std::cout << input << " : only 8bit images can be block compressed" << std::endl;
+			isSucceeded = false;
+			continue;
+		}
+		if (generateMips)
+			GenerateImageMips(image, isSRGB);
+
+		ImageData compressed;
+		CompressImage(image, format, compressed, threadCount);
+
+		const std::string containerfilename = output.empty() ? GetTextureContainerPath(input.c_str()) : output;
+		if (!WriteTextureContainer(containerfilename.c_str(), input.c_str(), compressed, flags)) {
+			isSucceeded = false;
+			continue;
+		}
+
+		const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		std::cout << containerfilename << " : " << image.width << "x" << image.height << ", " << compressed.mips.size() << " levels, "
+			  << image.pixels.size() / 1024 << " KiB -> " << compressed.pixels.size() / 1024 << " KiB, "
+			  << "PSNR " << ComputePSNR(image, compressed) << " dB, " << milliseconds << " ms" << std::endl;
+	}
+
+	return isSucceeded ? 0 : 1;
+}